@@ -0,0 +1,157 @@
+// Copyright 2013 The Flutter Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// ignore_for_file: public_member_api_docs
+
+import 'dart:async';
+import 'dart:collection';
+import 'dart:math';
+import 'dart:typed_data';
+
+import 'package:messageport_tizen/messageport_tizen.dart';
+
+/// Builds payloads that are larger than the ones in the send buttons.
+Map<String, dynamic> largePayloads() {
+  Map<String, dynamic> nested(int depth) {
+    final Map<String, dynamic> map = <String, dynamic>{};
+    for (int i = 0; i < 8; i++) {
+      map['key$i'] = depth == 0
+          ? <dynamic>['value$i', i, i * 0.5, i.isEven]
+          : nested(depth - 1);
+    }
+    return map;
+  }
+
+  final Random random = Random(0);
+  return <String, dynamic>{
+    'NestedMap': nested(3),
+    'Bytes': Uint8List.fromList(
+        List<int>.generate(64 * 1024, (_) => random.nextInt(256))),
+  };
+}
+
+class BenchmarkResult {
+  BenchmarkResult(this.name, this.messagesPerSecond, this.sendLatencyUs,
+      this.receiveLatencyUs, {this.steadyStateAllocations = 0});
+
+  final String name;
+  final double messagesPerSecond;
+
+  /// p50, p99 and p999 of awaiting [RemotePort.send], in microseconds.
+  final List<int> sendLatencyUs;
+
+  /// p50, p99 and p999 from [RemotePort.send] to the local listener.
+  final List<int> receiveLatencyUs;
+
+  /// Native pool allocations made after the warmup.
+  final int steadyStateAllocations;
+
+  /// Returns reasons why this run failed. Timings are only reported, they
+  /// are compared with a baseline by the host benchmark of the plugin.
+  List<String> regressions() {
+    final List<String> failures = <String>[];
+    if (steadyStateAllocations > 0) {
+      failures.add('$name: $steadyStateAllocations allocations after warmup');
+    }
+    return failures;
+  }
+
+  @override
+  String toString() {
+    return '$name: ${messagesPerSecond.toStringAsFixed(1)} msg/s, '
+        'send p50/p99/p999 ${sendLatencyUs.join('/')} us, '
+        'receive p50/p99/p999 ${receiveLatencyUs.join('/')} us, '
+        '$steadyStateAllocations allocations';
+  }
+}
+
+/// Measures messageport send and receive on the device by sending messages
+/// from the application to its own local port.
+class MessagePortBenchmark {
+  MessagePortBenchmark(this.appId, {this.iterations = 1000, this.warmup = 50});
+
+  static const String kPortName = 'benchmarkPort';
+
+  final String appId;
+  final int iterations;
+  final int warmup;
+
+  final Queue<int> _sentAt = Queue<int>();
+  final Stopwatch _clock = Stopwatch()..start();
+  final List<int> _receiveLatencies = <int>[];
+  Completer<void>? _drained;
+  int _pending = 0;
+
+  Future<List<BenchmarkResult>> run(Map<String, dynamic> payloads) async {
+    final LocalPort localPort =
+        await TizenMessagePort.createLocalPort(kPortName);
+    localPort.register(_onMessage);
+    try {
+      final RemotePort remotePort =
+          await TizenMessagePort.connectToRemotePort(appId, kPortName);
+      final List<BenchmarkResult> results = <BenchmarkResult>[];
+      for (final MapEntry<String, dynamic> payload in payloads.entries) {
+        await _measure(remotePort, payload.value, warmup);
+        final Map<String, int> before =
+            await TizenMessagePort.getAllocationStats();
+        final BenchmarkResult result = await _measure(
+            remotePort, payload.value, iterations,
+            name: payload.key);
+        final Map<String, int> after =
+            await TizenMessagePort.getAllocationStats();
+        final int allocations = _allocations(after) - _allocations(before);
+        results.add(BenchmarkResult(result.name, result.messagesPerSecond,
+            result.sendLatencyUs, result.receiveLatencyUs,
+            steadyStateAllocations: allocations));
+      }
+      return results;
+    } finally {
+      await localPort.unregister();
+    }
+  }
+
+  void _onMessage(dynamic message, [RemotePort? remotePort]) {
+    if (_sentAt.isEmpty) {
+      return;
+    }
+    _receiveLatencies.add(_clock.elapsedMicroseconds - _sentAt.removeFirst());
+    if (--_pending == 0) {
+      _drained?.complete();
+    }
+  }
+
+  Future<BenchmarkResult> _measure(
+      RemotePort remotePort, dynamic payload, int count,
+      {String name = 'warmup'}) async {
+    final List<int> sendLatencies = <int>[];
+    _receiveLatencies.clear();
+    _pending = count;
+    _drained = Completer<void>();
+
+    final int start = _clock.elapsedMicroseconds;
+    for (int i = 0; i < count; i++) {
+      final int sentAt = _clock.elapsedMicroseconds;
+      _sentAt.add(sentAt);
+      await remotePort.send(payload);
+      sendLatencies.add(_clock.elapsedMicroseconds - sentAt);
+    }
+    await _drained!.future.timeout(const Duration(seconds: 30));
+    final int elapsed = _clock.elapsedMicroseconds - start;
+
+    return BenchmarkResult(name, count * 1000000 / elapsed,
+        _percentiles(sendLatencies), _percentiles(_receiveLatencies));
+  }
+
+  static int _allocations(Map<String, int> stats) {
+    return stats['bundlesCreated']! +
+        stats['eventsCreated']! +
+        stats['bufferGrowths']!;
+  }
+
+  static List<int> _percentiles(List<int> samples) {
+    final List<int> sorted = List<int>.from(samples)..sort();
+    int at(double p) => sorted[max(0, (p * sorted.length).ceil() - 1)];
+    return <int>[at(0.5), at(0.99), at(0.999)];
+  }
+}
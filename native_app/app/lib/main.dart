@@ -10,6 +10,8 @@ import 'package:flutter/material.dart';
 import 'package:url_launcher/url_launcher.dart';
 import 'package:messageport_tizen/messageport_tizen.dart';
 
+import 'benchmark.dart';
+
 const String kPortName = 'servicePort';
 const String kRemoteAppId = 'CU637OfEVI.native_app';
 
@@ -228,6 +230,36 @@ class _MyAppState extends State<MyApp> {
     );
   }
 
+  bool _benchmarkRunning = false;
+
+  Future<void> _runBenchmark() async {
+    setState(() {
+      _benchmarkRunning = true;
+    });
+    try {
+      final List<BenchmarkResult> results =
+          await MessagePortBenchmark(kRemoteAppId).run(<String, dynamic>{
+        ..._sendOptions,
+        ...largePayloads(),
+      });
+      final List<String> regressions = <String>[];
+      for (final BenchmarkResult result in results) {
+        _log(result.toString());
+        regressions.addAll(result.regressions());
+      }
+      if (regressions.isEmpty) {
+        _log('Benchmark passed');
+      } else {
+        regressions.forEach(_log);
+        _log('Benchmark FAILED: ${regressions.length} regression(s)');
+      }
+    } finally {
+      setState(() {
+        _benchmarkRunning = false;
+      });
+    }
+  }
+
   final List<String> _logList = <String>[];
 
   void _log(String log) {
@@ -301,6 +333,19 @@ class _MyAppState extends State<MyApp> {
             context,
             _remotePort != null && (_localPort?.registered ?? false),
           ),
+          Builder(
+            builder: (BuildContext context) => _textButton(
+              'Benchmark',
+              () async {
+                try {
+                  await _runBenchmark();
+                } catch (e) {
+                  _showErrorDialog(context, e);
+                }
+              },
+              !_benchmarkRunning,
+            ),
+          ),
           _logger(context),
         ]),
       ),
@@ -3,6 +3,7 @@
 // found in the LICENSE file.
 
 import 'dart:async';
+import 'dart:typed_data';
 
 import 'src/messageport_manager.dart';
 
@@ -13,36 +14,110 @@ TizenMessagePortManager _manager = TizenMessagePortManager();
 /// This is used by [LocalPort.register].
 typedef OnMessageReceived = Function(dynamic message, [RemotePort? remotePort]);
 
+/// How messages are carried between ports.
+enum PortTransport {
+  /// The Tizen message port API, which goes through the platform daemon.
+  messagePort,
+
+  /// Unix domain sockets between the applications, which bypass the
+  /// daemon. Both sides have to use this transport. Trusted ports only
+  /// accept messages from processes of the same user, signing certificates
+  /// are not checked.
+  socket,
+}
+
+/// How urgently messages of a port are handled.
+///
+/// Messages of a less urgent port that waited too long are handled before
+/// more urgent ones, so no port is starved.
+enum PortPriority {
+  /// Handled right away.
+  high,
+
+  /// Handled after high priority messages, waits up to 20 ms.
+  normal,
+
+  /// Handled after other messages, waits up to 100 ms.
+  low,
+}
+
 /// Local port to receive messages.
 class LocalPort {
-  LocalPort._(this.portName, this.trusted);
+  LocalPort._(this.portName, this.trusted, this.transport, this._handle);
 
   /// Registers port and sets listener.
   ///
+  /// Only messages matching all [filters] are passed to [onMessage]. They
+  /// are checked natively, so other messages are never decoded or sent to
+  /// Dart. Filters apply to all ports with the same name, the ones given
+  /// last win.
+  ///
+  /// If the port was created with flow control, [onQueuePressure] is called
+  /// when its native inbound queue reaches the high water mark, and when it
+  /// drains back to half of it.
+  ///
   /// Exception will be thrown when using on already registered port.
-  void register(OnMessageReceived onMessage) {
+  void register(OnMessageReceived onMessage,
+      {List<MessageFilter> filters = const <MessageFilter>[],
+      void Function(QueuePressure pressure)? onQueuePressure}) {
     if (registered) {
       throw Exception('Port $portName is already registered');
     }
 
+    // Sent before the port is listened to, so no message passes unfiltered.
+    _manager.setFilters(this, filters);
+
     final Stream<dynamic> stream = _manager.registerLocalPort(this);
     _streamSubscription = stream.listen((dynamic event) {
-      if (event is Map) {
-        final Map<dynamic, dynamic> map = event;
-        final dynamic message = map['message'];
-        if (map.containsKey('remotePort')) {
-          final String remoteAppId = map['remoteAppId'] as String;
-          final String remotePort = map['remotePort'] as String;
-          final bool trusted = map['trusted'] as bool;
-          onMessage(message, RemotePort._(remoteAppId, remotePort, trusted));
-        } else {
-          onMessage(message);
+      // Events are delivered in lists when inbound batching is enabled.
+      if (event is List) {
+        for (final dynamic message in event) {
+          _onEvent(message, onMessage, onQueuePressure);
         }
+      } else {
+        _onEvent(event, onMessage, onQueuePressure);
       }
     });
     _registered = true;
   }
 
+  void _onEvent(dynamic event, OnMessageReceived onMessage,
+      void Function(QueuePressure pressure)? onQueuePressure) {
+    if (event is Map && event.containsKey('queuePressure')) {
+      onQueuePressure?.call(QueuePressure._fromMap(
+          event['queuePressure'] as Map<dynamic, dynamic>));
+    } else if (event is Map) {
+      final Map<dynamic, dynamic> map = event;
+      final dynamic message = _manager.decodeMessage(map);
+      if (map.containsKey('remotePort')) {
+        final String remoteAppId = map['remoteAppId'] as String;
+        final String remotePort = map['remotePort'] as String;
+        final bool trusted = map['trusted'] as bool;
+        // Replies go back over the transport the message came with.
+        onMessage(
+            message,
+            RemotePort._(remoteAppId, remotePort, trusted, transport,
+                map['requestId'] as int?));
+      } else {
+        onMessage(message);
+      }
+    }
+  }
+
+  /// Returns counters of compressed messages received on this port.
+  ///
+  /// A `PlatformException` with code `Could not get compression stats` is
+  /// thrown until this port received a compressed message, unless it was
+  /// created with `compressionDictionaries`.
+  Future<CompressionStats> getCompressionStats() {
+    return _manager.getCompressionStats(localPort: this);
+  }
+
+  /// Returns how many messages each filter given to [register] dropped.
+  Future<List<int>> getFilterStats() {
+    return _manager.getFilterStats(this);
+  }
+
   /// Unregisters messageport. No operation for already unregistered port.
   Future<void> unregister() async {
     await _streamSubscription?.cancel();
@@ -55,34 +130,167 @@ class LocalPort {
   /// Returns port name.
   final String portName;
 
+  /// Transport messages are received over.
+  final PortTransport transport;
+
   /// Checks whether local port is registered.
   bool get registered {
     return _registered;
   }
 
+  /// Native handle of the port, shared by ports with the same name.
+  int get handle => _handle;
+
+  final int _handle;
   StreamSubscription<dynamic>? _streamSubscription;
   bool _registered = false;
 }
 
 /// Remote port to send messages.
 class RemotePort {
-  RemotePort._(this.remoteAppId, this.portName, this.trusted);
+  RemotePort._(this.remoteAppId, this.portName, this.trusted, this.transport,
+      [this._requestId]);
 
   /// Sends message through remote messageport.
-  Future<void> send(dynamic message) async {
-    return _manager.send(this, message);
+  ///
+  /// If [background] is true, the message is sent from a native sender
+  /// thread, so a slow receiver does not block other platform calls. Such
+  /// sends are done in the order they were made. When too many of them are
+  /// pending, a `PlatformException` with code `Send queue is full` is thrown
+  /// and the message is not sent.
+  ///
+  /// If this port came with a message sent by [request], the message is the
+  /// reply to it and [background] is ignored.
+  Future<void> send(dynamic message, {bool background = false}) async {
+    return _manager.send(this, message,
+        background: background, replyTo: _requestId);
+  }
+
+  /// Sends [message] and returns the reply of the remote application.
+  ///
+  /// The remote application replies with [send] on the port it received the
+  /// message with. The reply is matched to the request natively and is not
+  /// passed to the listener of [replyPort], which has to be registered. A
+  /// `PlatformException` with code `Request timed out` is thrown if no reply
+  /// comes within [timeout]; a late reply is then passed to the listener.
+  Future<dynamic> request(dynamic message, LocalPort replyPort,
+      {Duration timeout = const Duration(seconds: 5)}) async {
+    return _manager.request(this, replyPort, message, timeout);
+  }
+
+  /// Sends [state] so that only what changed since the last call goes over
+  /// IPC.
+  ///
+  /// The last state sent to this port is kept natively, and [state] is sent
+  /// as a diff from it, with added, changed and removed keys of nested maps.
+  /// The receiving local port applies the diff and passes the full state to
+  /// its listener as a message. If it missed an update, it asks for the
+  /// full state again through [localPort], which has to be registered.
+  /// Other values than maps are compared as a whole.
+  Future<void> syncState(Map<dynamic, dynamic> state, LocalPort localPort) {
+    return _manager.syncState(this, localPort, state);
   }
 
   /// Sends message through remote messageport with [localPort].
   ///
   /// Remote application can reply to the message by use of provided local port.
-  Future<void> sendWithLocalPort(dynamic message, LocalPort localPort) async {
-    return _manager.sendWithLocalPort(this, localPort, message);
+  /// See [send] for [background].
+  Future<void> sendWithLocalPort(dynamic message, LocalPort localPort,
+      {bool background = false}) async {
+    return _manager.sendWithLocalPort(this, localPort, message,
+        background: background);
+  }
+
+  /// Enables coalescing of messages sent with [send].
+  ///
+  /// Messages are queued natively and sent together in one bundle once
+  /// [maxBatchSize] messages are queued or [maxDelay] has passed since the
+  /// first one. The receiving local port delivers them one by one, as if they
+  /// were sent separately. The future returned by [send] completes when the
+  /// message is queued, or with `background` set, once its batch is sent,
+  /// with an error if sending the batch failed.
+  ///
+  /// Messages sent with [sendWithLocalPort] are not coalesced, but are sent
+  /// after the queued ones.
+  Future<void> enableCoalescing(
+      {int maxBatchSize = 32,
+      Duration maxDelay = const Duration(milliseconds: 5)}) async {
+    if (maxBatchSize <= 0 || maxDelay.isNegative) {
+      throw ArgumentError('Invalid coalescing parameters');
+    }
+    return _manager.setCoalescing(this, maxBatchSize, maxDelay);
+  }
+
+  /// Sends queued messages and disables coalescing.
+  Future<void> disableCoalescing() async {
+    return _manager.setCoalescing(this, 0, Duration.zero);
+  }
+
+  /// Creates a shared memory stream and sends its handshake through this port.
+  ///
+  /// The receiving application gets the handshake as a message and opens the
+  /// stream with [SharedStreamWriter.readerFromHandshake]. After that, data
+  /// written to the returned writer does not go through message port IPC.
+  /// Both applications have to be signed with the same certificate.
+  Future<SharedStreamWriter> createSharedStream(
+      {int capacity = 1024 * 1024}) async {
+    final String path = await _manager.createStream(capacity);
+    await send(<String, String>{SharedStreamWriter._handshakeKey: path});
+    return SharedStreamWriter._(path);
+  }
+
+  /// Compresses messages sent to this port as described by [compression],
+  /// or disables compression if it is null.
+  Future<void> setCompression(MessageCompression? compression) async {
+    return _manager.setCompression(this, compression);
+  }
+
+  /// Returns counters of messages sent to this port since compression was
+  /// set up.
+  ///
+  /// A `PlatformException` with code `Could not get compression stats` is
+  /// thrown if compression is not set up.
+  Future<CompressionStats> getCompressionStats() {
+    return _manager.getCompressionStats(remotePort: this);
+  }
+
+  /// Stores messages sent to this port while it is not registered, and sends
+  /// them once it is.
+  ///
+  /// Messages are kept in order in a file of up to [maxBytes], so messages
+  /// left when the application exits are sent by its next run, once it
+  /// enables the outbox of this port again with the same [maxBytes].
+  /// Messages stored longer than [timeToLive], if given, are dropped. Once
+  /// the port is registered, stored messages are sent in batches before any
+  /// later message. [send] fails if the outbox is full.
+  ///
+  /// Messages sent with [sendWithLocalPort], requests, states synced with
+  /// [syncState] and broadcasts are never stored. Registration of ports of
+  /// [PortTransport.socket] can not be watched, their stored messages are
+  /// sent on the next [send] or [check].
+  Future<void> enableOutbox(
+      {int maxBytes = 1024 * 1024, Duration? timeToLive}) async {
+    if (maxBytes <= 0 || (timeToLive != null && timeToLive <= Duration.zero)) {
+      throw ArgumentError('Invalid outbox parameters');
+    }
+    return _manager.setOutbox(this, maxBytes, timeToLive);
+  }
+
+  /// Disables the outbox, dropping messages still stored.
+  Future<void> disableOutbox() async {
+    return _manager.setOutbox(this, 0, null);
+  }
+
+  /// Sets the order in which [send] with `background` set sends messages to
+  /// this port, relative to messages to other ports.
+  Future<void> setPriority(PortPriority priority) async {
+    return _manager.setPriority(this, priority);
   }
 
   // Checks whether remote port is registered in remote application.
   Future<bool> check() async {
-    return _manager.checkForRemotePort(remoteAppId, portName, trusted);
+    return _manager.checkForRemotePort(
+        remoteAppId, portName, trusted, transport);
   }
 
   /// Returns remote appId.
@@ -93,6 +301,258 @@ class RemotePort {
 
   /// Checks whether remote port is trusted.
   final bool trusted;
+
+  /// Transport messages are sent over.
+  final PortTransport transport;
+
+  /// Native handle of the port.
+  ///
+  /// Ports returned by [TizenMessagePort.connectToRemotePort] get it when
+  /// connected; ports received with a message on first use.
+  Future<int> get handle {
+    return _handle ??= _manager.connectRemotePort(this);
+  }
+
+  Future<int>? _handle;
+  final int? _requestId;
+}
+
+/// What happens to messages received while the inbound queue of a local
+/// port is full.
+enum OverflowPolicy {
+  /// The oldest queued message is dropped.
+  dropOldest,
+
+  /// The received message is dropped.
+  dropNewest,
+
+  /// A queued message with the same value under
+  /// [InboundFlowControl.coalesceKey] is replaced by the received one. If
+  /// there is none, the oldest queued message is dropped.
+  coalesceByKey,
+}
+
+/// Flow control of messages received on a local port.
+///
+/// At most [window] messages are on their way to Dart at a time. Further
+/// messages wait in a native queue of up to [highWaterMark] messages, so
+/// memory use and latency stay bounded however fast messages come in.
+/// Messages which do not fit are handled according to [policy].
+///
+/// Blocking the sender is not supported, as messages are received on the
+/// platform thread.
+class InboundFlowControl {
+  /// Creates flow control options.
+  InboundFlowControl(
+      {this.highWaterMark = 256,
+      this.window = 64,
+      this.policy = OverflowPolicy.dropOldest,
+      this.coalesceKey}) {
+    if (highWaterMark <= 0 ||
+        window <= 0 ||
+        (policy == OverflowPolicy.coalesceByKey && coalesceKey == null)) {
+      throw ArgumentError('Invalid flow control parameters');
+    }
+  }
+
+  /// Messages queued natively, at most.
+  final int highWaterMark;
+
+  /// Messages sent to Dart and not yet received by it, at most.
+  final int window;
+
+  /// What happens to messages which do not fit in the queue.
+  final OverflowPolicy policy;
+
+  /// Top-level map key of messages coalesced by
+  /// [OverflowPolicy.coalesceByKey].
+  final String? coalesceKey;
+}
+
+/// State of the native inbound queue of a local port.
+class QueuePressure {
+  QueuePressure._fromMap(Map<dynamic, dynamic> map)
+      : aboveHighWaterMark = map['aboveHighWaterMark'] as bool,
+        queued = map['queued'] as int,
+        dropped = map['dropped'] as int;
+
+  /// Whether the queue reached the high water mark, rather than drained
+  /// back to half of it.
+  final bool aboveHighWaterMark;
+
+  /// Messages in the queue.
+  final int queued;
+
+  /// Messages dropped or coalesced since the port was registered.
+  final int dropped;
+}
+
+/// A remote port a message is broadcast to.
+class BroadcastTarget {
+  /// Creates a target.
+  const BroadcastTarget(this.remoteAppId, this.portName,
+      {this.trusted = false, this.transport = PortTransport.messagePort});
+
+  /// Remote appId.
+  final String remoteAppId;
+
+  /// Port name.
+  final String portName;
+
+  /// Whether the remote port is trusted.
+  final bool trusted;
+
+  /// Transport the message is sent over.
+  final PortTransport transport;
+}
+
+/// A condition messages received on a local port have to meet.
+///
+/// Conditions which are not given match every message. [key] and [value]
+/// are looked up in the top-level map of the message, messages which are
+/// not maps do not match them.
+class MessageFilter {
+  /// Creates a filter.
+  MessageFilter({this.remoteAppIds, this.trusted, this.key, this.value}) {
+    if (value != null &&
+        (key == null || !(value is String || value is int || value is bool))) {
+      throw ArgumentError('value has to be a String, int or bool of a key');
+    }
+  }
+
+  /// Applications the message has to come from.
+  final List<String>? remoteAppIds;
+
+  /// Whether the message has to come from a trusted port, or not.
+  final bool? trusted;
+
+  /// Key the top-level map of the message has to contain.
+  final String? key;
+
+  /// Value [key] has to map to.
+  final Object? value;
+
+  /// Returns the filter as sent to the platform.
+  Map<String, dynamic> toMap() {
+    final Map<String, dynamic> map = <String, dynamic>{};
+    if (remoteAppIds != null) {
+      map['remoteAppIds'] = remoteAppIds;
+    }
+    if (trusted != null) {
+      map['trusted'] = trusted;
+    }
+    if (key != null) {
+      map['key'] = key;
+    }
+    if (value != null) {
+      map['value'] = value;
+    }
+    return map;
+  }
+}
+
+/// Compression of messages sent to a remote port.
+///
+/// Messages of at least [threshold] encoded bytes are deflated natively
+/// before they are put into the bundle, and inflated by the receiving local
+/// port before they reach its listener. Messages which do not get smaller
+/// are sent as they are.
+///
+/// A [dictionary] holding byte sequences common in the messages, such as
+/// their map keys, improves compression of small messages. The receiving
+/// local port has to be created with the same dictionary in
+/// `compressionDictionaries`.
+///
+/// Compression is offered to the receiving local port, which accepts it
+/// on [localPort] if it can inflate the messages. Messages are sent
+/// uncompressed until then, so receivers which do not support compression
+/// or lack the dictionary still get them.
+class MessageCompression {
+  /// Creates compression settings.
+  const MessageCompression(
+      {required this.localPort, this.threshold = 1024, this.dictionary});
+
+  /// Local port of this application compression is accepted on. It has to
+  /// use the transport of the remote port.
+  final LocalPort localPort;
+
+  /// Minimal size of an encoded message to be compressed.
+  final int threshold;
+
+  /// Preset dictionary, up to 32 KiB are used.
+  final Uint8List? dictionary;
+}
+
+/// Compression counters of a port.
+///
+/// For a remote port they count messages sent since compression was set up,
+/// for a local port only compressed messages received.
+class CompressionStats {
+  /// Creates stats from the map sent by the platform.
+  CompressionStats.fromMap(Map<String, int> map)
+      : messages = map['messages']!,
+        compressedMessages = map['compressedMessages']!,
+        messageBytes = map['messageBytes']!,
+        bundleBytes = map['bundleBytes']!,
+        time = Duration(microseconds: map['timeUs']!);
+
+  /// Number of messages.
+  final int messages;
+
+  /// Number of messages which were compressed.
+  final int compressedMessages;
+
+  /// Size of the messages when encoded.
+  final int messageBytes;
+
+  /// Size of the messages as sent in bundles.
+  final int bundleBytes;
+
+  /// Time spent compressing or decompressing.
+  final Duration time;
+
+  /// Ratio of bundle bytes to message bytes, 1 if nothing was counted.
+  double get ratio => messageBytes == 0 ? 1 : bundleBytes / messageBytes;
+}
+
+/// Producer side of a shared memory stream.
+///
+/// Records are written to a single-producer, single-consumer ring buffer in
+/// a memory mapped file, and the reader is woken up without IPC.
+class SharedStreamWriter {
+  SharedStreamWriter._(this.path);
+
+  static const String _handshakeKey = 'messageport.sharedStream';
+
+  /// Returns records of the stream announced by [message], or null if
+  /// [message] is not a shared stream handshake.
+  ///
+  /// Records are delivered in the order they were written.
+  static Stream<Uint8List>? readerFromHandshake(dynamic message) {
+    if (message is Map && message.length == 1) {
+      final dynamic path = message[_handshakeKey];
+      if (path is String) {
+        return _manager.openStream(path);
+      }
+    }
+    return null;
+  }
+
+  /// Path of the memory mapped file of the stream.
+  final String path;
+
+  /// Writes one record.
+  ///
+  /// A `PlatformException` with code `Stream is full` is thrown when the
+  /// reader has not consumed enough data yet; the record is not written then.
+  Future<void> write(Uint8List data) async {
+    return _manager.writeStream(path, data);
+  }
+
+  /// Closes the stream. The reader gets the records written so far.
+  Future<void> close() async {
+    return _manager.closeStream(path);
+  }
 }
 
 /// API for accessing MessagePorts in Tizen.
@@ -106,10 +566,49 @@ class TizenMessagePort {
   /// Remember to call `register()` on local port to enable receiving messages.
   /// Multiple local ports with the same [portName] can be created and registered.
   /// Incoming messages will be delivered to all registered local ports with the same name.
+  ///
+  /// If [deliveryBatchSize] is greater than 1, received messages are passed
+  /// from the platform in batches of up to [deliveryBatchSize] messages,
+  /// at most [deliveryInterval] after the first one was received. This takes
+  /// one platform channel message per batch instead of one per message. The
+  /// listener is still called for every message. Options of the first
+  /// created port with a given name apply.
+  ///
+  /// [compressionDictionaries] are dictionaries senders may compress
+  /// messages to this port with, see [MessageCompression].
+  ///
+  /// [flowControl] bounds messages waiting to be delivered, see
+  /// [InboundFlowControl].
+  ///
+  /// [transport] selects how messages are received, see [PortTransport].
+  ///
+  /// [priority] orders delivery of messages to this port relative to other
+  /// ports when many messages arrive at once, see [PortPriority].
+  ///
+  /// Ports listed in `messageport_ports.conf` in the resource directory of
+  /// the application are registered natively when the plugin is loaded, one
+  /// per line as `<portName> [trusted] [socket]`. Messages received before
+  /// [LocalPort.register] is called are kept, up to 1024, and passed to the
+  /// listener once it is. Such ports take the options of the first call
+  /// with their name, except [transport], which is taken from the file.
   static Future<LocalPort> createLocalPort(String portName,
-      {bool trusted = false}) async {
-    await _manager.createLocalPort(portName, trusted);
-    return LocalPort._(portName, trusted);
+      {bool trusted = false,
+      int deliveryBatchSize = 1,
+      Duration deliveryInterval = const Duration(milliseconds: 16),
+      List<Uint8List> compressionDictionaries = const <Uint8List>[],
+      InboundFlowControl? flowControl,
+      PortTransport transport = PortTransport.messagePort,
+      PortPriority priority = PortPriority.normal}) async {
+    final int handle = await _manager.createLocalPort(
+        portName,
+        trusted,
+        deliveryBatchSize,
+        deliveryInterval,
+        compressionDictionaries,
+        flowControl,
+        transport,
+        priority);
+    return LocalPort._(portName, trusted, transport, handle);
   }
 
   /// Connects to [portName] remote port in [remoteAppId].
@@ -120,13 +619,179 @@ class TizenMessagePort {
   /// through them to applications that share a signing certificate.
   /// Set [trusted] to false, to change this behaviour.
   ///
+  /// If [timeout] is given, waits up to [timeout] for the remote port to be
+  /// registered instead of failing right away.
+  ///
+  /// If [compression] is given, messages sent to the port are compressed,
+  /// once the remote local port accepted compression.
+  ///
+  /// [transport] has to be the one the remote local port was created with.
+  /// Registration of socket ports is not pushed by the platform, so they
+  /// are checked every 100 ms while waiting for [timeout].
+  ///
+  /// [priority] is set with [RemotePort.setPriority].
+  ///
   /// Exception will be thrown if the remote port does not exist.
   static Future<RemotePort> connectToRemotePort(
       String remoteAppId, String portName,
-      {bool trusted = false}) async {
-    if (await _manager.checkForRemotePort(remoteAppId, portName, trusted)) {
-      return RemotePort._(remoteAppId, portName, trusted);
+      {bool trusted = false,
+      Duration? timeout,
+      MessageCompression? compression,
+      PortTransport transport = PortTransport.messagePort,
+      PortPriority priority = PortPriority.normal}) async {
+    final RemotePort remotePort = transport == PortTransport.messagePort
+        ? await _connect(remoteAppId, portName, trusted, timeout)
+        : await _connectSocket(remoteAppId, portName, trusted, timeout);
+    await remotePort.handle;
+    if (compression != null) {
+      await remotePort.setCompression(compression);
+    }
+    if (priority != PortPriority.normal) {
+      await remotePort.setPriority(priority);
+    }
+    return remotePort;
+  }
+
+  static Future<RemotePort> _connect(String remoteAppId, String portName,
+      bool trusted, Duration? timeout) async {
+    if (timeout == null) {
+      if (await _manager.checkForRemotePort(remoteAppId, portName, trusted)) {
+        return RemotePort._(
+            remoteAppId, portName, trusted, PortTransport.messagePort);
+      }
+      throw Exception('Remote port not found');
+    }
+
+    final Completer<bool> found = Completer<bool>();
+    final StreamSubscription<bool> subscription =
+        watchRemotePort(remoteAppId, portName, trusted: trusted).listen(
+            (bool registered) {
+      if (registered && !found.isCompleted) {
+        found.complete(true);
+      }
+    }, onError: (Object error) {
+      if (!found.isCompleted) {
+        found.completeError(error);
+      }
+    });
+    try {
+      if (await found.future.timeout(timeout, onTimeout: () => false)) {
+        return RemotePort._(
+            remoteAppId, portName, trusted, PortTransport.messagePort);
+      }
+    } finally {
+      await subscription.cancel();
     }
     throw Exception('Remote port not found');
   }
+
+  static Future<RemotePort> _connectSocket(String remoteAppId,
+      String portName, bool trusted, Duration? timeout) async {
+    final DateTime deadline = DateTime.now().add(timeout ?? Duration.zero);
+    while (true) {
+      if (await _manager.checkForRemotePort(
+          remoteAppId, portName, trusted, PortTransport.socket)) {
+        return RemotePort._(
+            remoteAppId, portName, trusted, PortTransport.socket);
+      }
+      if (!DateTime.now().isBefore(deadline)) {
+        throw Exception('Remote port not found');
+      }
+      await Future<void>.delayed(const Duration(milliseconds: 100));
+    }
+  }
+
+  /// Sends [message] to all [targets] and returns, for each of them, null if
+  /// the message was sent or the error message.
+  ///
+  /// The message is encoded once and sent natively to the targets in
+  /// parallel, so the call takes about as long as sending to the slowest
+  /// target. Targets are not checked before, a missing port is reported in
+  /// its result. Messages are not compressed, and reach each target after
+  /// messages queued for it by coalescing.
+  static Future<List<String?>> broadcast(
+      List<BroadcastTarget> targets, dynamic message) {
+    return _manager.broadcast(targets, message);
+  }
+
+  /// Returns counters of native pool allocations.
+  ///
+  /// Bundles, message events and buffers are reused natively. In the steady
+  /// state only `bundlesReused` and `eventsReused` grow, while
+  /// `bundlesCreated`, `eventsCreated` and `bufferGrowths` stay the same.
+  static Future<Map<String, int>> getAllocationStats() {
+    return _manager.getAllocationStats();
+  }
+
+  /// Returns counters of every port used since the application started.
+  ///
+  /// The map holds `localPorts` and `remotePorts` lists and `elapsedUs`, the
+  /// time since the counters were last reset. Each port has `messages`,
+  /// `bytes` and `failures` counters and latency histograms: `decodeTime`
+  /// and `replayDelay` for local ports, `encodeTime` and `sendTime` for
+  /// remote ports. `replayDelay` is how long messages received before the
+  /// port was listened to waited natively. Remote ports [RemotePort.syncState]
+  /// was called on have a `stateSync` map with `updates`, `fullUpdates`,
+  /// `resyncs` and `bytes` counters. Remote ports with an outbox, see
+  /// [RemotePort.enableOutbox], have an `outbox` map with `pending`,
+  /// `stored`, `drained`, `expired` and `rejected` counters. The map also
+  /// holds `sendQueueDelay` and `deliveryQueueDelay`, maps of `high`,
+  /// `normal` and `low` histograms of how long background sends and
+  /// deliveries of each [PortPriority] waited. A histogram is a map with
+  /// `count`, `sumUs` and `buckets`, where bucket 0 counts latencies of 0
+  /// and bucket `i` latencies from `2^(i-1)` up to `2^i` microseconds.
+  ///
+  /// Counters are always enabled, no debug build is needed.
+  static Future<Map<String, dynamic>> getStats() {
+    return _manager.getStats();
+  }
+
+  /// Resets counters returned by [getStats].
+  static Future<void> resetStats() {
+    return _manager.resetStats();
+  }
+
+  /// Starts or stops recording native trace events.
+  ///
+  /// Sends, received bundles and platform calls are recorded into a fixed
+  /// size ring buffer, which keeps the most recent events. Recording does
+  /// not format or log anything, so it can be enabled in release builds.
+  static Future<void> setTracing(bool enabled) {
+    return _manager.setTracing(enabled);
+  }
+
+  /// Returns recorded trace events in the Chrome trace event JSON format,
+  /// which can be opened in `chrome://tracing` or Perfetto.
+  static Future<String> dumpTrace() {
+    return _manager.dumpTrace();
+  }
+
+  /// Watches registration of [portName] remote port in [remoteAppId].
+  ///
+  /// The stream emits the current state first and then `true` or `false`
+  /// whenever the remote port is registered or unregistered. Changes are
+  /// pushed by the platform, so no polling is needed.
+  static Stream<bool> watchRemotePort(String remoteAppId, String portName,
+      {bool trusted = false}) {
+    late StreamController<bool> controller;
+    StreamSubscription<dynamic>? subscription;
+    controller = StreamController<bool>(onListen: () {
+      subscription = _manager.presenceEvents.where((dynamic event) {
+        return event is Map &&
+            event['remoteAppId'] == remoteAppId &&
+            event['portName'] == portName &&
+            event['trusted'] == trusted;
+      }).listen((dynamic event) {
+        controller.add(event['registered'] as bool);
+      });
+      // Checking the port also starts watching it natively.
+      _manager
+          .checkForRemotePort(
+              remoteAppId, portName, trusted, PortTransport.messagePort)
+          .then(controller.add, onError: controller.addError);
+    }, onCancel: () {
+      return subscription?.cancel();
+    });
+    return controller.stream;
+  }
 }
@@ -3,76 +3,377 @@
 // found in the LICENSE file.
 
 import 'dart:async';
+import 'dart:math';
+import 'dart:typed_data';
 
 import 'package:flutter/services.dart';
 import 'package:messageport_tizen/messageport_tizen.dart';
 
 const MethodChannel _channel = MethodChannel('tizen/messageport');
+const StandardMessageCodec _messageCodec = StandardMessageCodec();
 
 class TizenMessagePortManager {
   TizenMessagePortManager();
 
-  Future<void> createLocalPort(String portName, bool trusted) async {
+  /// Returns the handle of the port.
+  Future<int> createLocalPort(
+      String portName,
+      bool trusted,
+      int deliveryBatchSize,
+      Duration deliveryInterval,
+      List<Uint8List> compressionDictionaries,
+      InboundFlowControl? flowControl,
+      PortTransport transport,
+      PortPriority priority) async {
     final Map<String, dynamic> args = <String, dynamic>{};
     args['portName'] = portName;
     args['trusted'] = trusted;
-    return _channel.invokeMethod('createLocal', args);
+    args['transport'] = _transportName(transport);
+    args['priority'] = priority.toString().split('.').last;
+    args['deliveryBatchSize'] = deliveryBatchSize;
+    args['deliveryIntervalUs'] = deliveryInterval.inMicroseconds;
+    args['compressionDictionaries'] = compressionDictionaries;
+    if (flowControl != null) {
+      args['highWaterMark'] = flowControl.highWaterMark;
+      args['ackWindow'] = flowControl.window;
+      args['overflowPolicy'] = flowControl.policy.toString().split('.').last;
+      if (flowControl.coalesceKey != null) {
+        args['coalesceKey'] = flowControl.coalesceKey;
+      }
+    }
+    final int? handle = await _channel.invokeMethod<int>('createLocal', args);
+    // Options of the first port created with a name apply natively.
+    _flowControls.putIfAbsent(handle!, () => flowControl);
+    return handle;
   }
 
-  Future<bool> checkForRemotePort(
-      String remoteAppId, String portName, bool trusted) async {
+  /// Returns the handle of [remotePort], which later calls refer to the
+  /// port by instead of its names.
+  ///
+  /// Handles are cached, so reply ports received with every message do not
+  /// connect again.
+  Future<int> connectRemotePort(RemotePort remotePort) {
+    final String transport = _transportName(remotePort.transport);
+    final String key = '$transport/${remotePort.trusted}/'
+        '${remotePort.remoteAppId}/${remotePort.portName}';
+    return _remotePortHandles[key] ??= () async {
+      final Map<String, dynamic> args = <String, dynamic>{};
+      args['remoteAppId'] = remotePort.remoteAppId;
+      args['portName'] = remotePort.portName;
+      args['trusted'] = remotePort.trusted;
+      args['transport'] = transport;
+      final int? handle =
+          await _channel.invokeMethod<int>('connectRemote', args);
+      return handle!;
+    }();
+  }
+
+  Future<bool> checkForRemotePort(String remoteAppId, String portName,
+      bool trusted, PortTransport transport) async {
     final Map<String, dynamic> args = <String, dynamic>{};
     args['remoteAppId'] = remoteAppId;
     args['portName'] = portName;
     args['trusted'] = trusted;
+    args['transport'] = _transportName(transport);
     final bool status =
         await _channel.invokeMethod<bool>('checkForRemote', args) as bool;
     return status;
   }
 
-  Future<void> send(RemotePort remotePort, dynamic message) async {
+  Future<void> send(RemotePort remotePort, dynamic message,
+      {bool background = false, int? replyTo}) async {
     final Map<String, dynamic> args = <String, dynamic>{};
-    args['trusted'] = remotePort.trusted;
-    args['remoteAppId'] = remotePort.remoteAppId;
-    args['portName'] = remotePort.portName;
-    args['message'] = message;
+    args['background'] = background;
+    args['remotePort'] = await remotePort.handle;
+    if (replyTo != null) {
+      args['replyTo'] = replyTo;
+    }
+    _putMessage(args, message);
 
     return _channel.invokeMethod('send', args);
   }
 
+  Future<List<String?>> broadcast(
+      List<BroadcastTarget> targets, dynamic message) async {
+    final Map<String, dynamic> args = <String, dynamic>{};
+    args['targets'] = targets
+        .map((BroadcastTarget target) => <String, dynamic>{
+              'remoteAppId': target.remoteAppId,
+              'portName': target.portName,
+              'trusted': target.trusted,
+              'transport': _transportName(target.transport),
+            })
+        .toList(growable: false);
+    _putMessage(args, message);
+
+    final List<dynamic>? errors =
+        await _channel.invokeMethod<List<dynamic>>('broadcast', args);
+    return errors!.cast<String?>();
+  }
+
+  /// Sends [message] and returns the decoded reply, which is matched to the
+  /// request natively.
+  Future<dynamic> request(RemotePort remotePort, LocalPort localPort,
+      dynamic message, Duration timeout) async {
+    final Map<String, dynamic> args = <String, dynamic>{};
+    args['remotePort'] = await remotePort.handle;
+    args['localPort'] = localPort.handle;
+    args['timeoutUs'] = timeout.inMicroseconds;
+    _putMessage(args, message);
+
+    final Uint8List? reply =
+        await _channel.invokeMethod<Uint8List>('request', args);
+    return _messageCodec.decodeMessage(
+        ByteData.view(reply!.buffer, reply.offsetInBytes, reply.lengthInBytes));
+  }
+
+  Future<void> syncState(RemotePort remotePort, LocalPort localPort,
+      Map<dynamic, dynamic> state) async {
+    final Map<String, dynamic> args = <String, dynamic>{};
+    args['remotePort'] = await remotePort.handle;
+    args['localPort'] = localPort.handle;
+    args['state'] = state;
+
+    return _channel.invokeMethod('syncState', args);
+  }
+
   Future<void> sendWithLocalPort(
-      RemotePort remotePort, LocalPort localPort, dynamic message) async {
+      RemotePort remotePort, LocalPort localPort, dynamic message,
+      {bool background = false}) async {
     final Map<String, dynamic> args = <String, dynamic>{};
-    args['trusted'] = remotePort.trusted;
-    args['remoteAppId'] = remotePort.remoteAppId;
-    args['portName'] = remotePort.portName;
-    args['localPort'] = localPort.portName;
-    args['localPortTrusted'] = localPort.trusted;
-    args['message'] = message;
+    args['background'] = background;
+    args['remotePort'] = await remotePort.handle;
+    args['localPort'] = localPort.handle;
+    _putMessage(args, message);
 
     return _channel.invokeMethod('send', args);
   }
 
-  Stream<dynamic> registerLocalPort(LocalPort localPort) {
-    if (localPort.trusted) {
-      if (!_trustedLocalPorts.containsKey(localPort.portName)) {
-        final EventChannel eventChannel =
-            EventChannel('tizen/messageport/${localPort.portName}_trusted');
-        _trustedLocalPorts[localPort.portName] =
-            eventChannel.receiveBroadcastStream();
+  Future<void> setFilters(LocalPort localPort, List<MessageFilter> filters) {
+    final Map<String, dynamic> args = <String, dynamic>{};
+    args['localPort'] = localPort.handle;
+    args['filters'] = filters
+        .map((MessageFilter filter) => filter.toMap())
+        .toList(growable: false);
+    return _channel.invokeMethod('setFilters', args);
+  }
+
+  Future<List<int>> getFilterStats(LocalPort localPort) async {
+    final Map<String, dynamic> args = <String, dynamic>{};
+    args['localPort'] = localPort.handle;
+    final List<dynamic>? dropped =
+        await _channel.invokeMethod<List<dynamic>>('getFilterStats', args);
+    return dropped!.cast<int>();
+  }
+
+  Future<Map<String, int>> getAllocationStats() async {
+    final Map<dynamic, dynamic>? stats = await _channel
+        .invokeMethod<Map<dynamic, dynamic>>('getAllocationStats');
+    return stats!.cast<String, int>();
+  }
+
+  Future<Map<String, dynamic>> getStats() async {
+    final Map<dynamic, dynamic>? stats =
+        await _channel.invokeMethod<Map<dynamic, dynamic>>('getStats');
+    return stats!.cast<String, dynamic>();
+  }
+
+  Future<void> resetStats() async {
+    return _channel.invokeMethod('resetStats');
+  }
+
+  Future<void> setTracing(bool enabled) async {
+    final Map<String, dynamic> args = <String, dynamic>{};
+    args['enabled'] = enabled;
+    return _channel.invokeMethod('setTracing', args);
+  }
+
+  Future<String> dumpTrace() async {
+    final String? trace = await _channel.invokeMethod<String>('dumpTrace');
+    return trace!;
+  }
+
+  Future<String> createStream(int capacity) async {
+    final Map<String, dynamic> args = <String, dynamic>{};
+    args['capacity'] = capacity;
+    final String? path =
+        await _channel.invokeMethod<String>('createStream', args);
+    return path!;
+  }
+
+  Future<void> writeStream(String path, Uint8List data) async {
+    final Map<String, dynamic> args = <String, dynamic>{};
+    args['path'] = path;
+    args['data'] = data;
+    return _channel.invokeMethod('writeStream', args);
+  }
+
+  Future<void> closeStream(String path) async {
+    final Map<String, dynamic> args = <String, dynamic>{};
+    args['path'] = path;
+    return _channel.invokeMethod('closeStream', args);
+  }
+
+  Stream<Uint8List> openStream(String path) async* {
+    final Map<String, dynamic> args = <String, dynamic>{};
+    args['path'] = path;
+    await _channel.invokeMethod<void>('openStream', args);
+    yield* EventChannel('tizen/messageport/stream$path')
+        .receiveBroadcastStream()
+        .expand((dynamic records) =>
+            (records as List<dynamic>).cast<Uint8List>());
+  }
+
+  /// Registration changes of remote ports checked so far.
+  ///
+  /// Events are maps with `remoteAppId`, `portName`, `trusted` and
+  /// `registered` keys.
+  Stream<dynamic> get presenceEvents {
+    return _presenceEvents ??=
+        const EventChannel('tizen/messageport/presence')
+            .receiveBroadcastStream();
+  }
+
+  Future<void> setCoalescing(
+      RemotePort remotePort, int maxBatchSize, Duration maxDelay) async {
+    final Map<String, dynamic> args = <String, dynamic>{};
+    args['remotePort'] = await remotePort.handle;
+    args['maxBatchSize'] = maxBatchSize;
+    args['maxDelayUs'] = maxDelay.inMicroseconds;
+
+    return _channel.invokeMethod('setCoalescing', args);
+  }
+
+  Future<void> setPriority(RemotePort remotePort, PortPriority priority) async {
+    final Map<String, dynamic> args = <String, dynamic>{};
+    args['remotePort'] = await remotePort.handle;
+    args['priority'] = priority.toString().split('.').last;
+
+    return _channel.invokeMethod('setPriority', args);
+  }
+
+  /// Zero [maxBytes] disables the outbox.
+  Future<void> setOutbox(
+      RemotePort remotePort, int maxBytes, Duration? timeToLive) async {
+    final Map<String, dynamic> args = <String, dynamic>{};
+    args['remotePort'] = await remotePort.handle;
+    args['maxBytes'] = maxBytes;
+    if (timeToLive != null) {
+      args['ttlUs'] = timeToLive.inMicroseconds;
+    }
+
+    return _channel.invokeMethod('setOutbox', args);
+  }
+
+  Future<void> setCompression(
+      RemotePort remotePort, MessageCompression? compression) async {
+    final Map<String, dynamic> args = <String, dynamic>{};
+    args['remotePort'] = await remotePort.handle;
+    args['enabled'] = compression != null;
+    if (compression != null) {
+      args['localPort'] = compression.localPort.handle;
+      args['threshold'] = compression.threshold;
+      if (compression.dictionary != null) {
+        args['dictionary'] = compression.dictionary;
       }
-      return _trustedLocalPorts[localPort.portName]!;
     }
-    if (!_localPorts.containsKey(localPort.portName)) {
-      final EventChannel eventChannel =
-          EventChannel('tizen/messageport/${localPort.portName}');
-      _localPorts[localPort.portName] = eventChannel.receiveBroadcastStream();
+
+    return _channel.invokeMethod('setCompression', args);
+  }
+
+  /// Returns stats of [remotePort] if given, otherwise of [localPort].
+  Future<CompressionStats> getCompressionStats(
+      {RemotePort? remotePort, LocalPort? localPort}) async {
+    final Map<String, dynamic> args = <String, dynamic>{};
+    if (remotePort != null) {
+      args['remotePort'] = await remotePort.handle;
+    } else {
+      args['localPort'] = localPort!.handle;
+    }
+    final Map<dynamic, dynamic>? stats = await _channel
+        .invokeMethod<Map<dynamic, dynamic>>('getCompressionStats', args);
+    return CompressionStats.fromMap(stats!.cast<String, int>());
+  }
+
+  /// Decodes a message received on a local port.
+  ///
+  /// Native side forwards message bytes as they were put into the bundle,
+  /// so they are decoded only once, here.
+  dynamic decodeMessage(Map<dynamic, dynamic> event) {
+    final dynamic encoded = event['encodedMessage'];
+    if (encoded is Uint8List) {
+      return _messageCodec.decodeMessage(ByteData.view(
+          encoded.buffer, encoded.offsetInBytes, encoded.lengthInBytes));
+    }
+    return event['message'];
+  }
+
+  /// Encodes [message] on the Dart side, so native side can put it into
+  /// the bundle without decoding and encoding it again.
+  void _putMessage(Map<String, dynamic> args, dynamic message) {
+    final ByteData? encoded = _messageCodec.encodeMessage(message);
+    if (encoded == null) {
+      args['message'] = message;
+      return;
     }
+    args['encodedMessage'] = encoded.buffer
+        .asUint8List(encoded.offsetInBytes, encoded.lengthInBytes);
+  }
+
+  String _transportName(PortTransport transport) {
+    return transport.toString().split('.').last;
+  }
 
-    return _localPorts[localPort.portName]!;
+  Stream<dynamic> registerLocalPort(LocalPort localPort) {
+    final String channelName = localPort.trusted
+        ? 'tizen/messageport/${localPort.portName}_trusted'
+        : 'tizen/messageport/${localPort.portName}';
+    return _localPorts[channelName] ??= _acknowledged(
+        EventChannel(channelName).receiveBroadcastStream(), localPort.handle);
+  }
+
+  /// Acknowledges messages received on a port with flow control, so that
+  /// the platform sends more. Messages are counted by a single subscription,
+  /// however many ports listen.
+  Stream<dynamic> _acknowledged(Stream<dynamic> events, int handle) {
+    final InboundFlowControl? flowControl = _flowControls[handle];
+    if (flowControl == null) {
+      return events;
+    }
+    final int ackEvery = max(1, flowControl.window ~/ 2);
+    int received = 0;
+    StreamSubscription<dynamic>? subscription;
+    late StreamController<dynamic> controller;
+    controller = StreamController<dynamic>.broadcast(onListen: () {
+      received = 0;
+      subscription = events.listen((dynamic event) {
+        // Queue pressure events are not acknowledged.
+        final List<dynamic> batch =
+            event is List ? event : <dynamic>[event];
+        for (final dynamic message in batch) {
+          if (message is Map && !message.containsKey('queuePressure')) {
+            received++;
+          }
+        }
+        if (received >= ackEvery) {
+          final Map<String, dynamic> args = <String, dynamic>{};
+          args['localPort'] = handle;
+          args['count'] = received;
+          _channel.invokeMethod<void>('ackMessages', args);
+          received = 0;
+        }
+        controller.add(event);
+      }, onError: controller.addError);
+    }, onCancel: () {
+      return subscription?.cancel();
+    });
+    return controller.stream;
   }
 
+  Stream<dynamic>? _presenceEvents;
+  final Map<int, InboundFlowControl?> _flowControls =
+      <int, InboundFlowControl?>{};
+  final Map<String, Future<int>> _remotePortHandles = <String, Future<int>>{};
+  // Keyed by event channel name.
   final Map<String, Stream<dynamic>> _localPorts = <String, Stream<dynamic>>{};
-  final Map<String, Stream<dynamic>> _trustedLocalPorts =
-      <String, Stream<dynamic>>{};
 }
@@ -0,0 +1,461 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures send and receive of the plugin through its method and event
+// channels, as the example app uses them: messages are encoded on the Dart
+// side and sent to a local port of the same app.
+//
+// Usage: messageport_benchmark [--baseline FILE] [--write-baseline]
+//                              [--tolerance RATIO] [--messages COUNT]
+//                              [--cpu INDEX]
+//
+// Each payload is measured in several runs, and its result is the best
+// of them. With --baseline, fails if the throughput, p50 or p99 latency of
+// a payload is worse than its baseline by more than the tolerance, 0.5 by
+// default. With --write-baseline, writes the results to FILE instead. With
+// --cpu, the benchmark is pinned to one CPU, which makes runs steadier.
+
+#include <Ecore.h>
+#include <app_common.h>
+#include <sched.h>
+#include <flutter/host_messenger.h>
+#include <flutter/plugin_registrar.h>
+#include <flutter/standard_message_codec.h>
+#include <flutter/standard_method_codec.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "messageport_tizen_plugin.h"
+
+namespace {
+
+using flutter::EncodableList;
+using flutter::EncodableMap;
+using flutter::EncodableValue;
+
+constexpr char kMethodChannel[] = "tizen/messageport";
+constexpr char kPortName[] = "benchmark";
+// Messages in flight before waiting for their delivery, as an app sending
+// in a burst would.
+constexpr int kWindow = 32;
+// Runs of each payload. Other load of a shared host only makes a run
+// slower, by half of the p50 of small payloads for seconds at a time, so
+// the best of several runs is compared rather than their median.
+constexpr int kRuns = 9;
+
+struct Payload {
+  std::string name;
+  EncodableValue value;
+  // Messages sent, relative to --messages.
+  double count_scale;
+};
+
+struct Result {
+  double messages_per_s = 0;
+  double p50_us = 0;
+  double p99_us = 0;
+  double p999_us = 0;
+};
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+EncodableValue Map(
+    std::initializer_list<std::pair<const char*, EncodableValue>> entries) {
+  EncodableMap map;
+  for (const auto& entry : entries) {
+    map[EncodableValue(entry.first)] = entry.second;
+  }
+  return EncodableValue(map);
+}
+
+// The _sendOptions of the example app, plus large messages.
+std::vector<Payload> Payloads() {
+  std::vector<Payload> payloads;
+  payloads.push_back({"bool", EncodableValue(true), 1});
+  payloads.push_back({"int", EncodableValue(134), 1});
+  payloads.push_back({"double", EncodableValue(157.986), 1});
+  payloads.push_back({"String", EncodableValue("Test message"), 1});
+  payloads.push_back(
+      {"List",
+       EncodableValue(EncodableList{EncodableValue(1), EncodableValue(2),
+                                    EncodableValue(3)}),
+       1});
+  payloads.push_back({"Map",
+                      Map({{"a", EncodableValue(1)},
+                           {"b", EncodableValue(2)},
+                           {"c", EncodableValue(3)}}),
+                      1});
+
+  // 64 records of nested maps and lists, about 20 KiB encoded.
+  EncodableList records;
+  for (int i = 0; i < 64; ++i) {
+    EncodableList samples;
+    for (int j = 0; j < 16; ++j) {
+      samples.push_back(EncodableValue(i * 16 + j));
+    }
+    EncodableValue owner = Map({{"app", EncodableValue("org.example")},
+                                {"uid", EncodableValue(5000 + i)}});
+    EncodableValue attributes = Map({{"enabled", EncodableValue(i % 2 == 0)},
+                                     {"samples", EncodableValue(samples)},
+                                     {"owner", owner}});
+    records.push_back(
+        Map({{"id", EncodableValue(i)},
+             {"name", EncodableValue("record " + std::to_string(i))},
+             {"score", EncodableValue(i * 0.5)},
+             {"attributes", attributes}}));
+  }
+  payloads.push_back(
+      {"NestedMap", Map({{"records", EncodableValue(records)}}), 0.1});
+
+  // Random, so that compression does not shrink it.
+  std::mt19937 random(1);
+  std::vector<uint8_t> blob(64 * 1024);
+  for (auto& byte : blob) {
+    byte = static_cast<uint8_t>(random());
+  }
+  payloads.push_back({"Bytes64K", EncodableValue(blob), 0.1});
+  return payloads;
+}
+
+// Drives the plugin as the Dart side of the app would.
+class Driver {
+ public:
+  Driver() {
+    MessageportTizenPluginRegisterWithRegistrar(messenger_.registrar());
+  }
+
+  ~Driver() {
+    flutter::PluginRegistrarManager::GetInstance()->RemoveRegistrar(
+        messenger_.registrar());
+  }
+
+  // Calls |method| and returns its result. Exits on error, as nothing
+  // can be measured without it.
+  EncodableValue Call(const std::string& method, EncodableValue arguments) {
+    const auto& codec = flutter::StandardMethodCodec::GetInstance();
+    auto call = codec.EncodeMethodCall(flutter::MethodCall<EncodableValue>(
+        method, std::make_unique<EncodableValue>(std::move(arguments))));
+    EncodableValue result;
+    bool replied = false;
+    messenger_.DispatchToPlugin(
+        kMethodChannel, call->data(), call->size(),
+        [&](const uint8_t* reply, size_t reply_size) {
+          bool is_error = false;
+          std::string code;
+          std::string message;
+          if (!codec.DecodeEnvelope(reply, reply_size, &is_error, &result,
+                                    &code, &message) ||
+              is_error) {
+            fprintf(stderr, "%s failed: %s %s\n", method.c_str(), code.c_str(),
+                    message.c_str());
+            exit(EXIT_FAILURE);
+          }
+          replied = true;
+        });
+    // Background sends reply from the main loop.
+    while (!replied) {
+      ecore_main_loop_iterate_may_block(1);
+    }
+    return result;
+  }
+
+  // Listens to a local port, calling the handler set by set_on_event for
+  // each message.
+  void Listen(const std::string& port_name) {
+    const std::string channel = "tizen/messageport/" + port_name;
+    const auto& codec = flutter::StandardMethodCodec::GetInstance();
+    messenger_.SetDartHandler(
+        channel, [this, &codec](const uint8_t* message, size_t message_size,
+                                flutter::BinaryReply) {
+          bool is_error = false;
+          EncodableValue event;
+          std::string code;
+          std::string error;
+          if (!codec.DecodeEnvelope(message, message_size, &is_error, &event,
+                                    &code, &error) ||
+              is_error) {
+            fprintf(stderr, "Event error: %s %s\n", code.c_str(),
+                    error.c_str());
+            exit(EXIT_FAILURE);
+          }
+          on_event_(event);
+        });
+    auto listen = codec.EncodeMethodCall(
+        flutter::MethodCall<EncodableValue>("listen", nullptr));
+    messenger_.DispatchToPlugin(channel, listen->data(), listen->size(),
+                                nullptr);
+  }
+
+  void set_on_event(std::function<void(const EncodableValue&)> on_event) {
+    on_event_ = std::move(on_event);
+  }
+
+ private:
+  flutter::HostMessenger messenger_;
+  std::function<void(const EncodableValue&)> on_event_;
+};
+
+std::string HostAppId() {
+  char* id = nullptr;
+  app_get_id(&id);
+  std::string app_id = id ? id : "";
+  free(id);
+  return app_id;
+}
+
+double Percentile(const std::vector<int64_t>& sorted_ns, double fraction) {
+  size_t index = static_cast<size_t>(fraction * (sorted_ns.size() - 1));
+  return sorted_ns[index] / 1000.0;
+}
+
+Result Measure(Driver& driver, int remote_port, const Payload& payload,
+               int messages) {
+  const auto& message_codec = flutter::StandardMessageCodec::GetInstance();
+  std::unique_ptr<std::vector<uint8_t>> encoded =
+      message_codec.EncodeMessage(payload.value);
+
+  std::vector<int64_t> sent_ns(messages);
+  std::vector<int64_t> latencies_ns;
+  latencies_ns.reserve(messages);
+  int received = 0;
+  bool verified = false;
+  driver.set_on_event([&](const EncodableValue& event) {
+    latencies_ns.push_back(NowNs() - sent_ns[received++]);
+    if (!verified) {
+      // Checks once that the message arrives intact.
+      const auto& map = std::get<EncodableMap>(event);
+      auto bytes = map.find(EncodableValue("encodedMessage"));
+      if (bytes == map.end() ||
+          std::get<std::vector<uint8_t>>(bytes->second) != *encoded) {
+        fprintf(stderr, "%s: message arrived changed\n",
+                payload.name.c_str());
+        exit(EXIT_FAILURE);
+      }
+      verified = true;
+    }
+  });
+
+  EncodableMap arguments;
+  arguments[EncodableValue("remotePort")] = EncodableValue(remote_port);
+  arguments[EncodableValue("encodedMessage")] = EncodableValue(*encoded);
+  EncodableValue send_arguments(arguments);
+
+  int64_t start_ns = NowNs();
+  int sent = 0;
+  while (sent < messages) {
+    int burst = std::min(kWindow, messages - sent);
+    for (int i = 0; i < burst; ++i) {
+      sent_ns[sent] = NowNs();
+      driver.Call("send", send_arguments);
+      sent++;
+    }
+    while (received < sent) {
+      ecore_main_loop_iterate_may_block(1);
+    }
+  }
+  int64_t elapsed_ns = NowNs() - start_ns;
+
+  std::sort(latencies_ns.begin(), latencies_ns.end());
+  Result result;
+  result.messages_per_s = messages * 1e9 / elapsed_ns;
+  result.p50_us = Percentile(latencies_ns, 0.5);
+  result.p99_us = Percentile(latencies_ns, 0.99);
+  result.p999_us = Percentile(latencies_ns, 0.999);
+  return result;
+}
+
+// Each line of a baseline is a payload name and its result:
+// name messages_per_s p50_us p99_us p999_us
+std::map<std::string, Result> ReadBaseline(const std::string& path) {
+  std::map<std::string, Result> baseline;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream fields(line);
+    std::string name;
+    Result result;
+    if (fields >> name >> result.messages_per_s >> result.p50_us >>
+        result.p99_us >> result.p999_us) {
+      baseline[name] = result;
+    }
+  }
+  return baseline;
+}
+
+bool WriteBaseline(const std::string& path,
+                   const std::vector<std::pair<std::string, Result>>& results) {
+  std::ofstream file(path);
+  file << "# name messages_per_s p50_us p99_us p999_us\n";
+  char line[256];
+  for (const auto& entry : results) {
+    const Result& result = entry.second;
+    snprintf(line, sizeof(line), "%s %.0f %.1f %.1f %.1f\n",
+             entry.first.c_str(), result.messages_per_s, result.p50_us,
+             result.p99_us, result.p999_us);
+    file << line;
+  }
+  return static_cast<bool>(file);
+}
+
+// Returns how |result| is worse than |base| by more than |tolerance|, or
+// an empty string. p999 is only reported, as it is a handful of samples of
+// each run.
+std::string Regressions(const Result& result, const Result& base,
+                        double tolerance) {
+  std::ostringstream regressions;
+  if (result.messages_per_s < base.messages_per_s / (1 + tolerance)) {
+    regressions << " throughput " << result.messages_per_s << " < "
+                << base.messages_per_s << " messages/s;";
+  }
+  if (result.p50_us > base.p50_us * (1 + tolerance)) {
+    regressions << " p50 " << result.p50_us << " > " << base.p50_us
+                << " us;";
+  }
+  if (result.p99_us > base.p99_us * (1 + tolerance)) {
+    regressions << " p99 " << result.p99_us << " > " << base.p99_us
+                << " us;";
+  }
+  return regressions.str();
+}
+
+// Runs the benchmark on CPU |cpu| only.
+bool PinToCpu(int cpu) {
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  return sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+}
+
+// Returns the best of each field of |results|.
+Result Best(const std::vector<Result>& results) {
+  Result best = results[0];
+  for (const Result& result : results) {
+    best.messages_per_s = std::max(best.messages_per_s, result.messages_per_s);
+    best.p50_us = std::min(best.p50_us, result.p50_us);
+    best.p99_us = std::min(best.p99_us, result.p99_us);
+    best.p999_us = std::min(best.p999_us, result.p999_us);
+  }
+  return best;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::string baseline_path;
+  bool write_baseline = false;
+  // Results may be this much worse than the baseline, as a ratio.
+  double tolerance = 0.5;
+  int messages = 20000;
+  int cpu = -1;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+      baseline_path = argv[++i];
+    } else if (strcmp(argv[i], "--write-baseline") == 0) {
+      write_baseline = true;
+    } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+      tolerance = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--messages") == 0 && i + 1 < argc) {
+      messages = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--cpu") == 0 && i + 1 < argc) {
+      cpu = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (write_baseline && baseline_path.empty()) {
+    fprintf(stderr, "--write-baseline needs --baseline\n");
+    return EXIT_FAILURE;
+  }
+  // Pinned before any thread is started, so that they are all pinned.
+  if (cpu >= 0 && !PinToCpu(cpu)) {
+    fprintf(stderr, "Could not pin to CPU %d\n", cpu);
+    return EXIT_FAILURE;
+  }
+  std::map<std::string, Result> baseline;
+  if (!baseline_path.empty() && !write_baseline) {
+    baseline = ReadBaseline(baseline_path);
+  }
+
+  ecore_init();
+  std::vector<std::pair<std::string, Result>> results;
+  bool regressed = false;
+  {
+    Driver driver;
+    EncodableMap port;
+    port[EncodableValue("portName")] = EncodableValue(kPortName);
+    port[EncodableValue("trusted")] = EncodableValue(false);
+    driver.Call("createLocal", EncodableValue(port));
+    driver.Listen(kPortName);
+    port[EncodableValue("remoteAppId")] = EncodableValue(HostAppId());
+    int remote_port =
+        std::get<int32_t>(driver.Call("connectRemote", EncodableValue(port)));
+
+    printf("%-10s %12s %10s %10s %10s\n", "payload", "messages/s", "p50 us",
+           "p99 us", "p999 us");
+    const std::vector<Payload> payloads = Payloads();
+    std::vector<int> counts;
+    for (const Payload& payload : payloads) {
+      counts.push_back(std::max(
+          1000, static_cast<int>(messages * payload.count_scale)));
+      // Warms up allocators and pools before measuring.
+      Measure(driver, remote_port, payload, counts.back() / 10);
+    }
+    // Payloads take turns, so that the runs of each one are spread over the
+    // whole benchmark rather than a slow period of the host.
+    std::vector<std::vector<Result>> runs(payloads.size());
+    for (int run = 0; run < kRuns; ++run) {
+      for (size_t i = 0; i < payloads.size(); ++i) {
+        runs[i].push_back(Measure(driver, remote_port, payloads[i], counts[i]));
+      }
+    }
+
+    for (size_t i = 0; i < payloads.size(); ++i) {
+      const Payload& payload = payloads[i];
+      Result result = Best(runs[i]);
+      auto expected = baseline.find(payload.name);
+      std::string regressions;
+      if (expected != baseline.end()) {
+        regressions = Regressions(result, expected->second, tolerance);
+      }
+      printf("%-10s %12.0f %10.1f %10.1f %10.1f\n", payload.name.c_str(),
+             result.messages_per_s, result.p50_us, result.p99_us,
+             result.p999_us);
+      if (!baseline_path.empty() && !write_baseline) {
+        if (expected == baseline.end()) {
+          printf("%s: no baseline\n", payload.name.c_str());
+        } else if (!regressions.empty()) {
+          printf("%s regressed:%s\n", payload.name.c_str(),
+                 regressions.c_str());
+          regressed = true;
+        }
+      }
+      results.emplace_back(payload.name, result);
+    }
+  }
+
+  if (write_baseline && !WriteBaseline(baseline_path, results)) {
+    fprintf(stderr, "Could not write %s\n", baseline_path.c_str());
+    return EXIT_FAILURE;
+  }
+  return regressed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Stand-in for the parts of Ecore and Eina the plugin uses, for host builds.
+// The main loop runs on the thread which called ecore_init, and only runs
+// while that thread iterates it.
+
+#ifndef HOST_STUBS_ECORE_H
+#define HOST_STUBS_ECORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef unsigned char Eina_Bool;
+#define EINA_TRUE 1
+#define EINA_FALSE 0
+#define ECORE_CALLBACK_RENEW EINA_TRUE
+#define ECORE_CALLBACK_CANCEL EINA_FALSE
+
+typedef struct _Ecore_Timer Ecore_Timer;
+typedef struct _Ecore_Fd_Handler Ecore_Fd_Handler;
+
+typedef Eina_Bool (*Ecore_Task_Cb)(void* data);
+typedef void (*Ecore_Cb)(void* data);
+typedef Eina_Bool (*Ecore_Fd_Cb)(void* data, Ecore_Fd_Handler* fd_handler);
+
+typedef enum {
+  ECORE_FD_READ = 1,
+  ECORE_FD_WRITE = 2,
+  ECORE_FD_ERROR = 4,
+} Ecore_Fd_Handler_Flags;
+
+int ecore_init(void);
+int ecore_shutdown(void);
+
+// Runs ready timers, fd handlers and async calls once, without waiting.
+void ecore_main_loop_iterate(void);
+// Same as ecore_main_loop_iterate, but waits for something to be ready if
+// |may_block| is non-zero. Returns the number of callbacks run.
+int ecore_main_loop_iterate_may_block(int may_block);
+void ecore_main_loop_begin(void);
+// Safe to call from any thread.
+void ecore_main_loop_quit(void);
+
+Ecore_Timer* ecore_timer_add(double in, Ecore_Task_Cb func, const void* data);
+void* ecore_timer_del(Ecore_Timer* timer);
+
+// Safe to call from any thread.
+void ecore_main_loop_thread_safe_call_async(Ecore_Cb callback, void* data);
+
+double ecore_time_get(void);
+double ecore_loop_time_get(void);
+
+Ecore_Fd_Handler* ecore_main_fd_handler_add(int fd,
+                                            Ecore_Fd_Handler_Flags flags,
+                                            Ecore_Fd_Cb func, const void* data,
+                                            Ecore_Fd_Cb buf_func,
+                                            const void* buf_data);
+void* ecore_main_fd_handler_del(Ecore_Fd_Handler* fd_handler);
+int ecore_main_fd_handler_fd_get(Ecore_Fd_Handler* fd_handler);
+
+Eina_Bool eina_main_loop_is(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // HOST_STUBS_ECORE_H
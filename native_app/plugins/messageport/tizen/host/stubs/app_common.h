@@ -0,0 +1,32 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Stand-in for the application paths and id, for host builds. The id is
+// taken from the MESSAGEPORT_HOST_APP_ID environment variable. Directories
+// are created under MESSAGEPORT_HOST_ROOT, or a directory in /tmp named
+// after the process. Returned strings have to be freed.
+
+#ifndef HOST_STUBS_APP_COMMON_H
+#define HOST_STUBS_APP_COMMON_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  APP_ERROR_NONE = 0,
+  APP_ERROR_INVALID_PARAMETER = -22,
+} app_error_e;
+
+int app_get_id(char** id);
+// Paths end with a slash.
+char* app_get_resource_path(void);
+char* app_get_data_path(void);
+char* app_get_shared_trusted_path(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // HOST_STUBS_APP_COMMON_H
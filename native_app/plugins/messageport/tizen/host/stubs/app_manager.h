@@ -0,0 +1,32 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Stand-in for application lookups by process, for host builds. A process
+// is taken to run the application named by MESSAGEPORT_HOST_APP_ID in its
+// environment, as app_get_id does. Returned strings have to be freed.
+
+#ifndef HOST_STUBS_APP_MANAGER_H
+#define HOST_STUBS_APP_MANAGER_H
+
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TIZEN_ERROR_APPLICATION_MANAGER -0x01110000
+
+typedef enum {
+  APP_MANAGER_ERROR_NONE = 0,
+  APP_MANAGER_ERROR_INVALID_PARAMETER = -22,
+  APP_MANAGER_ERROR_NO_SUCH_APP = TIZEN_ERROR_APPLICATION_MANAGER | 0x01,
+} app_manager_error_e;
+
+int app_manager_get_app_id(pid_t pid, char** app_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // HOST_STUBS_APP_MANAGER_H
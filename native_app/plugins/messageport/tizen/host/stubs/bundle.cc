@@ -0,0 +1,200 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <bundle.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+struct keyval_t {
+  int type;
+  // Strings keep their terminating NUL.
+  std::vector<uint8_t> value;
+};
+
+struct _bundle_t {
+  std::map<std::string, keyval_t> values;
+};
+
+namespace {
+
+int Add(bundle* b, const char* key, int type, const void* data, size_t size) {
+  if (nullptr == b || nullptr == key || (nullptr == data && size > 0)) {
+    return BUNDLE_ERROR_INVALID_PARAMETER;
+  }
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  auto inserted = b->values.emplace(
+      key, keyval_t{type, std::vector<uint8_t>(bytes, bytes + size)});
+  return inserted.second ? BUNDLE_ERROR_NONE : BUNDLE_ERROR_KEY_EXISTS;
+}
+
+keyval_t* Find(bundle* b, const char* key, int type) {
+  if (nullptr == b || nullptr == key) {
+    return nullptr;
+  }
+  auto entry = b->values.find(key);
+  if (entry == b->values.end() || entry->second.type != type) {
+    return nullptr;
+  }
+  return &entry->second;
+}
+
+void Append(std::vector<uint8_t>& out, const void* data, size_t size) {
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  out.insert(out.end(), bytes, bytes + size);
+}
+
+bool Take(const uint8_t*& data, size_t& size, void* out, size_t length) {
+  if (size < length) {
+    return false;
+  }
+  memcpy(out, data, length);
+  data += length;
+  size -= length;
+  return true;
+}
+
+}  // namespace
+
+bundle* bundle_create(void) { return new _bundle_t(); }
+
+int bundle_free(bundle* b) {
+  if (nullptr == b) {
+    return BUNDLE_ERROR_INVALID_PARAMETER;
+  }
+  delete b;
+  return BUNDLE_ERROR_NONE;
+}
+
+bundle* bundle_dup(bundle* b_from) {
+  if (nullptr == b_from) {
+    return nullptr;
+  }
+  return new _bundle_t(*b_from);
+}
+
+int bundle_get_count(bundle* b) {
+  return nullptr == b ? 0 : static_cast<int>(b->values.size());
+}
+
+int bundle_del(bundle* b, const char* key) {
+  if (nullptr == b || nullptr == key) {
+    return BUNDLE_ERROR_INVALID_PARAMETER;
+  }
+  return b->values.erase(key) ? BUNDLE_ERROR_NONE
+                              : BUNDLE_ERROR_KEY_NOT_AVAILABLE;
+}
+
+int bundle_add_str(bundle* b, const char* key, const char* str) {
+  if (nullptr == str) {
+    return BUNDLE_ERROR_INVALID_PARAMETER;
+  }
+  return Add(b, key, BUNDLE_TYPE_STR, str, strlen(str) + 1);
+}
+
+int bundle_get_str(bundle* b, const char* key, char** str) {
+  keyval_t* kv = Find(b, key, BUNDLE_TYPE_STR);
+  if (nullptr == kv) {
+    return BUNDLE_ERROR_KEY_NOT_AVAILABLE;
+  }
+  *str = reinterpret_cast<char*>(kv->value.data());
+  return BUNDLE_ERROR_NONE;
+}
+
+int bundle_add_byte(bundle* b, const char* key, const void* bytes,
+                    const size_t size) {
+  return Add(b, key, BUNDLE_TYPE_BYTE, bytes, size);
+}
+
+int bundle_get_byte(bundle* b, const char* key, void** bytes, size_t* size) {
+  keyval_t* kv = Find(b, key, BUNDLE_TYPE_BYTE);
+  if (nullptr == kv) {
+    return BUNDLE_ERROR_KEY_NOT_AVAILABLE;
+  }
+  *bytes = kv->value.data();
+  *size = kv->value.size();
+  return BUNDLE_ERROR_NONE;
+}
+
+void bundle_foreach(bundle* b, bundle_iterator_t iter, void* user_data) {
+  if (nullptr == b || nullptr == iter) {
+    return;
+  }
+  for (auto& entry : b->values) {
+    iter(entry.first.c_str(), entry.second.type, &entry.second, user_data);
+  }
+}
+
+int bundle_keyval_get_basic_val(bundle_keyval_t* kv, void** val,
+                                size_t* size) {
+  if (nullptr == kv) {
+    return BUNDLE_ERROR_INVALID_PARAMETER;
+  }
+  *val = kv->value.data();
+  *size = kv->value.size();
+  return BUNDLE_ERROR_NONE;
+}
+
+// Each value is encoded as its type, key size, value size, key and value.
+int bundle_encode(bundle* b, bundle_raw** r, int* len) {
+  if (nullptr == b || nullptr == r || nullptr == len) {
+    return BUNDLE_ERROR_INVALID_PARAMETER;
+  }
+  std::vector<uint8_t> out;
+  for (const auto& entry : b->values) {
+    int32_t type = entry.second.type;
+    uint32_t key_size = entry.first.size();
+    uint32_t value_size = entry.second.value.size();
+    Append(out, &type, sizeof(type));
+    Append(out, &key_size, sizeof(key_size));
+    Append(out, &value_size, sizeof(value_size));
+    Append(out, entry.first.data(), key_size);
+    Append(out, entry.second.value.data(), value_size);
+  }
+  *r = static_cast<bundle_raw*>(malloc(out.size() + 1));
+  memcpy(*r, out.data(), out.size());
+  *len = out.size();
+  return BUNDLE_ERROR_NONE;
+}
+
+bundle* bundle_decode(const bundle_raw* r, const int len) {
+  if (nullptr == r || len < 0) {
+    return nullptr;
+  }
+  const uint8_t* data = r;
+  size_t size = len;
+  bundle* b = bundle_create();
+  while (size > 0) {
+    int32_t type;
+    uint32_t key_size;
+    uint32_t value_size;
+    if (!Take(data, size, &type, sizeof(type)) ||
+        !Take(data, size, &key_size, sizeof(key_size)) ||
+        !Take(data, size, &value_size, sizeof(value_size)) ||
+        size < static_cast<size_t>(key_size) + value_size) {
+      bundle_free(b);
+      return nullptr;
+    }
+    std::string key(reinterpret_cast<const char*>(data), key_size);
+    b->values[key] =
+        keyval_t{type, std::vector<uint8_t>(data + key_size,
+                                            data + key_size + value_size)};
+    data += key_size + value_size;
+    size -= key_size + value_size;
+  }
+  return b;
+}
+
+int bundle_free_encoded_rawdata(bundle_raw** r) {
+  if (nullptr == r) {
+    return BUNDLE_ERROR_INVALID_PARAMETER;
+  }
+  free(*r);
+  *r = nullptr;
+  return BUNDLE_ERROR_NONE;
+}
@@ -0,0 +1,66 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Stand-in for the bundle API, for host builds. Only string and byte values
+// are supported.
+
+#ifndef HOST_STUBS_BUNDLE_H
+#define HOST_STUBS_BUNDLE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _bundle_t bundle;
+typedef unsigned char bundle_raw;
+typedef struct keyval_t bundle_keyval_t;
+
+typedef enum {
+  BUNDLE_ERROR_NONE = 0,
+  BUNDLE_ERROR_OUT_OF_MEMORY = -12,
+  BUNDLE_ERROR_INVALID_PARAMETER = -22,
+  BUNDLE_ERROR_KEY_NOT_AVAILABLE = -126,
+  BUNDLE_ERROR_KEY_EXISTS = -17,
+} bundle_error_e;
+
+typedef enum {
+  BUNDLE_TYPE_NONE = -1,
+  BUNDLE_TYPE_ANY = 0,
+  BUNDLE_TYPE_STR = 1 | 0x0100,
+  BUNDLE_TYPE_STR_ARRAY = 1 | 0x0200 | 0x0100,
+  BUNDLE_TYPE_BYTE = 2,
+  BUNDLE_TYPE_BYTE_ARRAY = 2 | 0x0200,
+} bundle_type;
+
+typedef void (*bundle_iterator_t)(const char* key, const int type,
+                                  const bundle_keyval_t* kv, void* user_data);
+
+bundle* bundle_create(void);
+int bundle_free(bundle* b);
+bundle* bundle_dup(bundle* b_from);
+int bundle_get_count(bundle* b);
+int bundle_del(bundle* b, const char* key);
+
+int bundle_add_str(bundle* b, const char* key, const char* str);
+int bundle_get_str(bundle* b, const char* key, char** str);
+int bundle_add_byte(bundle* b, const char* key, const void* bytes,
+                    const size_t size);
+int bundle_get_byte(bundle* b, const char* key, void** bytes, size_t* size);
+
+void bundle_foreach(bundle* b, bundle_iterator_t iter, void* user_data);
+// Strings are given with their terminating NUL.
+int bundle_keyval_get_basic_val(bundle_keyval_t* kv, void** val,
+                                size_t* size);
+
+int bundle_encode(bundle* b, bundle_raw** r, int* len);
+bundle* bundle_decode(const bundle_raw* r, const int len);
+int bundle_free_encoded_rawdata(bundle_raw** r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // HOST_STUBS_BUNDLE_H
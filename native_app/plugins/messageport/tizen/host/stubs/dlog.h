@@ -0,0 +1,38 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Stand-in for dlog, for host builds. Messages are written to stderr if
+// their priority is at least the one named by the MESSAGEPORT_LOG
+// environment variable ("debug", "info", "warn" or "error"), errors only by
+// default.
+
+#ifndef HOST_STUBS_DLOG_H
+#define HOST_STUBS_DLOG_H
+
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  DLOG_UNKNOWN = 0,
+  DLOG_DEFAULT,
+  DLOG_VERBOSE,
+  DLOG_DEBUG,
+  DLOG_INFO,
+  DLOG_WARN,
+  DLOG_ERROR,
+  DLOG_FATAL,
+  DLOG_SILENT,
+} log_priority;
+
+int dlog_print(log_priority prio, const char* tag, const char* fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // HOST_STUBS_DLOG_H
@@ -0,0 +1,284 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <Ecore.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+struct _Ecore_Timer {
+  double interval;
+  double deadline;
+  Ecore_Task_Cb func;
+  void* data;
+  bool deleted;
+};
+
+struct _Ecore_Fd_Handler {
+  int fd;
+  Ecore_Fd_Handler_Flags flags;
+  Ecore_Fd_Cb func;
+  void* data;
+  bool deleted;
+};
+
+namespace {
+
+struct MainLoop {
+  std::thread::id thread;
+  int wake_fd = -1;
+  double loop_time = 0;
+  std::atomic<bool> quit{false};
+  // Entries are deleted by the loop, once no iteration uses them.
+  std::vector<Ecore_Timer*> timers;
+  std::vector<Ecore_Fd_Handler*> fd_handlers;
+  std::mutex async_mutex;
+  std::deque<std::pair<Ecore_Cb, void*>> async_calls;
+};
+
+MainLoop* loop = nullptr;
+int init_count = 0;
+
+double Now() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+template <typename T>
+void Sweep(std::vector<T*>& entries) {
+  auto deleted = std::remove_if(entries.begin(), entries.end(), [](T* entry) {
+    if (entry->deleted) {
+      delete entry;
+      return true;
+    }
+    return false;
+  });
+  entries.erase(deleted, entries.end());
+}
+
+int RunAsyncCalls() {
+  std::deque<std::pair<Ecore_Cb, void*>> calls;
+  {
+    std::lock_guard<std::mutex> lock(loop->async_mutex);
+    calls.swap(loop->async_calls);
+  }
+  for (auto& call : calls) {
+    call.first(call.second);
+  }
+  return calls.size();
+}
+
+int RunTimers() {
+  int count = 0;
+  double now = Now();
+  // Timers added by callbacks wait for the next iteration.
+  size_t size = loop->timers.size();
+  for (size_t i = 0; i < size; i++) {
+    Ecore_Timer* timer = loop->timers[i];
+    if (timer->deleted || timer->deadline > now) {
+      continue;
+    }
+    count++;
+    if (timer->func(timer->data) == ECORE_CALLBACK_RENEW && !timer->deleted) {
+      timer->deadline = now + timer->interval;
+    } else {
+      timer->deleted = true;
+    }
+  }
+  Sweep(loop->timers);
+  return count;
+}
+
+// Waits up to |timeout_ms|, or forever if negative, and runs ready fd
+// handlers.
+int PollFds(int timeout_ms) {
+  std::vector<pollfd> fds;
+  std::vector<Ecore_Fd_Handler*> handlers;
+  fds.push_back({loop->wake_fd, POLLIN, 0});
+  for (Ecore_Fd_Handler* handler : loop->fd_handlers) {
+    if (handler->deleted) {
+      continue;
+    }
+    short events = 0;
+    if (handler->flags & ECORE_FD_READ) {
+      events |= POLLIN;
+    }
+    if (handler->flags & ECORE_FD_WRITE) {
+      events |= POLLOUT;
+    }
+    fds.push_back({handler->fd, events, 0});
+    handlers.push_back(handler);
+  }
+  if (poll(fds.data(), fds.size(), timeout_ms) <= 0) {
+    return 0;
+  }
+  if (fds[0].revents & POLLIN) {
+    uint64_t value;
+    if (read(loop->wake_fd, &value, sizeof(value)) < 0) {
+      // Woken up by another thread meanwhile.
+    }
+  }
+
+  int count = 0;
+  for (size_t i = 0; i < handlers.size(); i++) {
+    Ecore_Fd_Handler* handler = handlers[i];
+    if (fds[i + 1].revents == 0 || handler->deleted) {
+      continue;
+    }
+    count++;
+    if (handler->func(handler->data, handler) == ECORE_CALLBACK_CANCEL) {
+      handler->deleted = true;
+    }
+  }
+  Sweep(loop->fd_handlers);
+  return count;
+}
+
+int NextTimeoutMs() {
+  {
+    std::lock_guard<std::mutex> lock(loop->async_mutex);
+    if (!loop->async_calls.empty()) {
+      return 0;
+    }
+  }
+  double deadline = INFINITY;
+  for (Ecore_Timer* timer : loop->timers) {
+    if (!timer->deleted) {
+      deadline = std::min(deadline, timer->deadline);
+    }
+  }
+  if (std::isinf(deadline)) {
+    return -1;
+  }
+  double delay = deadline - Now();
+  return delay > 0 ? static_cast<int>(std::ceil(delay * 1000)) : 0;
+}
+
+}  // namespace
+
+int ecore_init(void) {
+  if (init_count++ == 0) {
+    loop = new MainLoop();
+    loop->thread = std::this_thread::get_id();
+    loop->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    loop->loop_time = Now();
+  }
+  return init_count;
+}
+
+int ecore_shutdown(void) {
+  if (init_count == 0 || --init_count > 0) {
+    return init_count;
+  }
+  for (Ecore_Timer* timer : loop->timers) {
+    delete timer;
+  }
+  for (Ecore_Fd_Handler* handler : loop->fd_handlers) {
+    delete handler;
+  }
+  close(loop->wake_fd);
+  delete loop;
+  loop = nullptr;
+  return 0;
+}
+
+int ecore_main_loop_iterate_may_block(int may_block) {
+  loop->loop_time = Now();
+  int count = RunAsyncCalls();
+  count += RunTimers();
+  int timeout_ms = 0;
+  if (may_block && count == 0) {
+    timeout_ms = NextTimeoutMs();
+  }
+  count += PollFds(timeout_ms);
+  return count;
+}
+
+void ecore_main_loop_iterate(void) { ecore_main_loop_iterate_may_block(0); }
+
+void ecore_main_loop_begin(void) {
+  loop->quit = false;
+  while (!loop->quit) {
+    ecore_main_loop_iterate_may_block(1);
+  }
+}
+
+void ecore_main_loop_quit(void) {
+  loop->quit = true;
+  uint64_t value = 1;
+  if (write(loop->wake_fd, &value, sizeof(value)) < 0) {
+    // The counter is already non-zero.
+  }
+}
+
+Ecore_Timer* ecore_timer_add(double in, Ecore_Task_Cb func, const void* data) {
+  auto* timer = new Ecore_Timer{in, Now() + in, func, const_cast<void*>(data),
+                                false};
+  loop->timers.push_back(timer);
+  return timer;
+}
+
+void* ecore_timer_del(Ecore_Timer* timer) {
+  if (nullptr == timer) {
+    return nullptr;
+  }
+  timer->deleted = true;
+  return timer->data;
+}
+
+void ecore_main_loop_thread_safe_call_async(Ecore_Cb callback, void* data) {
+  {
+    std::lock_guard<std::mutex> lock(loop->async_mutex);
+    loop->async_calls.emplace_back(callback, data);
+  }
+  uint64_t value = 1;
+  if (write(loop->wake_fd, &value, sizeof(value)) < 0) {
+    // The counter is already non-zero.
+  }
+}
+
+double ecore_time_get(void) { return Now(); }
+
+double ecore_loop_time_get(void) { return loop->loop_time; }
+
+Ecore_Fd_Handler* ecore_main_fd_handler_add(int fd,
+                                            Ecore_Fd_Handler_Flags flags,
+                                            Ecore_Fd_Cb func, const void* data,
+                                            Ecore_Fd_Cb buf_func,
+                                            const void* buf_data) {
+  if (fd < 0 || nullptr == func) {
+    return nullptr;
+  }
+  auto* handler =
+      new Ecore_Fd_Handler{fd, flags, func, const_cast<void*>(data), false};
+  loop->fd_handlers.push_back(handler);
+  return handler;
+}
+
+void* ecore_main_fd_handler_del(Ecore_Fd_Handler* fd_handler) {
+  if (nullptr == fd_handler) {
+    return nullptr;
+  }
+  fd_handler->deleted = true;
+  return fd_handler->data;
+}
+
+int ecore_main_fd_handler_fd_get(Ecore_Fd_Handler* fd_handler) {
+  return fd_handler->fd;
+}
+
+Eina_Bool eina_main_loop_is(void) {
+  return loop && std::this_thread::get_id() == loop->thread;
+}
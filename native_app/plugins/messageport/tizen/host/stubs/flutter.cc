@@ -0,0 +1,496 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <flutter/byte_buffer_streams.h>
+#include <flutter/host_messenger.h>
+#include <flutter/plugin_registrar.h>
+#include <flutter/standard_message_codec.h>
+#include <flutter/standard_method_codec.h>
+
+#include <cstring>
+#include <map>
+#include <string>
+
+namespace flutter {
+
+namespace {
+
+enum class EncodedType : uint8_t {
+  kNull = 0,
+  kTrue,
+  kFalse,
+  kInt32,
+  kInt64,
+  kLargeInt,
+  kFloat64,
+  kString,
+  kUInt8List,
+  kInt32List,
+  kInt64List,
+  kFloat64List,
+  kList,
+  kMap,
+  kFloat32List,
+};
+
+template <typename T>
+void ReadVector(ByteStreamReader* stream, size_t count, uint8_t alignment,
+                std::vector<T>* out) {
+  out->resize(count);
+  if (alignment > 1) {
+    stream->ReadAlignment(alignment);
+  }
+  stream->ReadBytes(reinterpret_cast<uint8_t*>(out->data()),
+                    count * sizeof(T));
+}
+
+// Writes the elements of |vector|, after its size.
+template <typename T>
+void WriteVector(const std::vector<T>& vector, uint8_t alignment,
+                 ByteStreamWriter* stream) {
+  if (alignment > 1) {
+    stream->WriteAlignment(alignment);
+  }
+  stream->WriteBytes(reinterpret_cast<const uint8_t*>(vector.data()),
+                     vector.size() * sizeof(T));
+}
+
+}  // namespace
+
+StandardCodecSerializer::StandardCodecSerializer() = default;
+
+StandardCodecSerializer::~StandardCodecSerializer() = default;
+
+const StandardCodecSerializer& StandardCodecSerializer::GetInstance() {
+  static StandardCodecSerializer sInstance;
+  return sInstance;
+}
+
+EncodableValue StandardCodecSerializer::ReadValue(
+    ByteStreamReader* stream) const {
+  return ReadValueOfType(stream->ReadByte(), stream);
+}
+
+void StandardCodecSerializer::WriteValue(const EncodableValue& value,
+                                         ByteStreamWriter* stream) const {
+  switch (value.index()) {
+    case 0:
+      stream->WriteByte(static_cast<uint8_t>(EncodedType::kNull));
+      break;
+    case 1:
+      stream->WriteByte(static_cast<uint8_t>(
+          std::get<bool>(value) ? EncodedType::kTrue : EncodedType::kFalse));
+      break;
+    case 2: {
+      stream->WriteByte(static_cast<uint8_t>(EncodedType::kInt32));
+      int32_t number = std::get<int32_t>(value);
+      stream->WriteBytes(reinterpret_cast<const uint8_t*>(&number), 4);
+      break;
+    }
+    case 3: {
+      stream->WriteByte(static_cast<uint8_t>(EncodedType::kInt64));
+      int64_t number = std::get<int64_t>(value);
+      stream->WriteBytes(reinterpret_cast<const uint8_t*>(&number), 8);
+      break;
+    }
+    case 4: {
+      stream->WriteByte(static_cast<uint8_t>(EncodedType::kFloat64));
+      stream->WriteAlignment(8);
+      double number = std::get<double>(value);
+      stream->WriteBytes(reinterpret_cast<const uint8_t*>(&number), 8);
+      break;
+    }
+    case 5: {
+      stream->WriteByte(static_cast<uint8_t>(EncodedType::kString));
+      const auto& string = std::get<std::string>(value);
+      WriteSize(string.size(), stream);
+      stream->WriteBytes(reinterpret_cast<const uint8_t*>(string.data()),
+                         string.size());
+      break;
+    }
+    case 6: {
+      stream->WriteByte(static_cast<uint8_t>(EncodedType::kUInt8List));
+      const auto& vector = std::get<std::vector<uint8_t>>(value);
+      WriteSize(vector.size(), stream);
+      WriteVector(vector, 1, stream);
+      break;
+    }
+    case 7: {
+      stream->WriteByte(static_cast<uint8_t>(EncodedType::kInt32List));
+      const auto& vector = std::get<std::vector<int32_t>>(value);
+      WriteSize(vector.size(), stream);
+      WriteVector(vector, 4, stream);
+      break;
+    }
+    case 8: {
+      stream->WriteByte(static_cast<uint8_t>(EncodedType::kInt64List));
+      const auto& vector = std::get<std::vector<int64_t>>(value);
+      WriteSize(vector.size(), stream);
+      WriteVector(vector, 8, stream);
+      break;
+    }
+    case 9: {
+      stream->WriteByte(static_cast<uint8_t>(EncodedType::kFloat64List));
+      const auto& vector = std::get<std::vector<double>>(value);
+      WriteSize(vector.size(), stream);
+      WriteVector(vector, 8, stream);
+      break;
+    }
+    case 10: {
+      stream->WriteByte(static_cast<uint8_t>(EncodedType::kList));
+      const auto& list = std::get<EncodableList>(value);
+      WriteSize(list.size(), stream);
+      for (const auto& item : list) {
+        WriteValue(item, stream);
+      }
+      break;
+    }
+    case 11: {
+      stream->WriteByte(static_cast<uint8_t>(EncodedType::kMap));
+      const auto& map = std::get<EncodableMap>(value);
+      WriteSize(map.size(), stream);
+      for (const auto& pair : map) {
+        WriteValue(pair.first, stream);
+        WriteValue(pair.second, stream);
+      }
+      break;
+    }
+    case 12:
+      // Custom values need a custom serializer.
+      stream->WriteByte(static_cast<uint8_t>(EncodedType::kNull));
+      break;
+    case 13: {
+      stream->WriteByte(static_cast<uint8_t>(EncodedType::kFloat32List));
+      const auto& vector = std::get<std::vector<float>>(value);
+      WriteSize(vector.size(), stream);
+      WriteVector(vector, 4, stream);
+      break;
+    }
+  }
+}
+
+EncodableValue StandardCodecSerializer::ReadValueOfType(
+    uint8_t type, ByteStreamReader* stream) const {
+  switch (static_cast<EncodedType>(type)) {
+    case EncodedType::kNull:
+      return EncodableValue();
+    case EncodedType::kTrue:
+      return EncodableValue(true);
+    case EncodedType::kFalse:
+      return EncodableValue(false);
+    case EncodedType::kInt32: {
+      int32_t number = 0;
+      stream->ReadBytes(reinterpret_cast<uint8_t*>(&number), 4);
+      return EncodableValue(number);
+    }
+    case EncodedType::kInt64: {
+      int64_t number = 0;
+      stream->ReadBytes(reinterpret_cast<uint8_t*>(&number), 8);
+      return EncodableValue(number);
+    }
+    case EncodedType::kFloat64: {
+      double number = 0;
+      stream->ReadAlignment(8);
+      stream->ReadBytes(reinterpret_cast<uint8_t*>(&number), 8);
+      return EncodableValue(number);
+    }
+    case EncodedType::kLargeInt:
+    case EncodedType::kString: {
+      size_t size = ReadSize(stream);
+      std::string string(size, '\0');
+      stream->ReadBytes(reinterpret_cast<uint8_t*>(&string[0]), size);
+      return EncodableValue(string);
+    }
+    case EncodedType::kUInt8List: {
+      std::vector<uint8_t> vector;
+      ReadVector(stream, ReadSize(stream), 1, &vector);
+      return EncodableValue(vector);
+    }
+    case EncodedType::kInt32List: {
+      std::vector<int32_t> vector;
+      ReadVector(stream, ReadSize(stream), 4, &vector);
+      return EncodableValue(vector);
+    }
+    case EncodedType::kInt64List: {
+      std::vector<int64_t> vector;
+      ReadVector(stream, ReadSize(stream), 8, &vector);
+      return EncodableValue(vector);
+    }
+    case EncodedType::kFloat64List: {
+      std::vector<double> vector;
+      ReadVector(stream, ReadSize(stream), 8, &vector);
+      return EncodableValue(vector);
+    }
+    case EncodedType::kList: {
+      size_t length = ReadSize(stream);
+      EncodableList list;
+      list.reserve(length);
+      for (size_t i = 0; i < length; ++i) {
+        list.push_back(ReadValue(stream));
+      }
+      return EncodableValue(list);
+    }
+    case EncodedType::kMap: {
+      size_t length = ReadSize(stream);
+      EncodableMap map;
+      for (size_t i = 0; i < length; ++i) {
+        EncodableValue key = ReadValue(stream);
+        EncodableValue value = ReadValue(stream);
+        map.emplace(std::move(key), std::move(value));
+      }
+      return EncodableValue(map);
+    }
+    case EncodedType::kFloat32List: {
+      std::vector<float> vector;
+      ReadVector(stream, ReadSize(stream), 4, &vector);
+      return EncodableValue(vector);
+    }
+  }
+  return EncodableValue();
+}
+
+size_t StandardCodecSerializer::ReadSize(ByteStreamReader* stream) const {
+  uint8_t byte = stream->ReadByte();
+  if (byte < 254) {
+    return byte;
+  }
+  if (byte == 254) {
+    uint16_t value = 0;
+    stream->ReadBytes(reinterpret_cast<uint8_t*>(&value), 2);
+    return value;
+  }
+  uint32_t value = 0;
+  stream->ReadBytes(reinterpret_cast<uint8_t*>(&value), 4);
+  return value;
+}
+
+void StandardCodecSerializer::WriteSize(size_t size,
+                                        ByteStreamWriter* stream) const {
+  if (size < 254) {
+    stream->WriteByte(static_cast<uint8_t>(size));
+  } else if (size <= 0xffff) {
+    stream->WriteByte(254);
+    uint16_t value = static_cast<uint16_t>(size);
+    stream->WriteBytes(reinterpret_cast<uint8_t*>(&value), 2);
+  } else {
+    stream->WriteByte(255);
+    uint32_t value = static_cast<uint32_t>(size);
+    stream->WriteBytes(reinterpret_cast<uint8_t*>(&value), 4);
+  }
+}
+
+const StandardMessageCodec& StandardMessageCodec::GetInstance(
+    const StandardCodecSerializer* serializer) {
+  if (nullptr == serializer) {
+    serializer = &StandardCodecSerializer::GetInstance();
+  }
+  static std::map<const StandardCodecSerializer*, StandardMessageCodec*>
+      sInstances;
+  auto& instance = sInstances[serializer];
+  if (nullptr == instance) {
+    instance = new StandardMessageCodec(serializer);
+  }
+  return *instance;
+}
+
+std::unique_ptr<EncodableValue> StandardMessageCodec::DecodeMessageInternal(
+    const uint8_t* binary_message, size_t message_size) const {
+  if (nullptr == binary_message) {
+    return std::make_unique<EncodableValue>();
+  }
+  ByteBufferStreamReader stream(binary_message, message_size);
+  auto value =
+      std::make_unique<EncodableValue>(serializer_->ReadValue(&stream));
+  if (stream.overflowed()) {
+    return nullptr;
+  }
+  return value;
+}
+
+std::unique_ptr<std::vector<uint8_t>>
+StandardMessageCodec::EncodeMessageInternal(
+    const EncodableValue& message) const {
+  auto encoded = std::make_unique<std::vector<uint8_t>>();
+  ByteBufferStreamWriter stream(encoded.get());
+  serializer_->WriteValue(message, &stream);
+  return encoded;
+}
+
+const StandardMethodCodec& StandardMethodCodec::GetInstance(
+    const StandardCodecSerializer* serializer) {
+  if (nullptr == serializer) {
+    serializer = &StandardCodecSerializer::GetInstance();
+  }
+  static std::map<const StandardCodecSerializer*, StandardMethodCodec*>
+      sInstances;
+  auto& instance = sInstances[serializer];
+  if (nullptr == instance) {
+    instance = new StandardMethodCodec(serializer);
+  }
+  return *instance;
+}
+
+std::unique_ptr<MethodCall<EncodableValue>>
+StandardMethodCodec::DecodeMethodCallInternal(const uint8_t* message,
+                                              size_t message_size) const {
+  if (nullptr == message) {
+    return nullptr;
+  }
+  ByteBufferStreamReader stream(message, message_size);
+  EncodableValue method_name = serializer_->ReadValue(&stream);
+  if (!std::holds_alternative<std::string>(method_name)) {
+    return nullptr;
+  }
+  EncodableValue arguments = serializer_->ReadValue(&stream);
+  if (stream.overflowed()) {
+    return nullptr;
+  }
+  std::unique_ptr<EncodableValue> arguments_pointer;
+  if (!arguments.IsNull()) {
+    arguments_pointer = std::make_unique<EncodableValue>(std::move(arguments));
+  }
+  return std::make_unique<MethodCall<EncodableValue>>(
+      std::get<std::string>(method_name), std::move(arguments_pointer));
+}
+
+std::unique_ptr<std::vector<uint8_t>>
+StandardMethodCodec::EncodeMethodCallInternal(
+    const MethodCall<EncodableValue>& method_call) const {
+  auto encoded = std::make_unique<std::vector<uint8_t>>();
+  ByteBufferStreamWriter stream(encoded.get());
+  serializer_->WriteValue(EncodableValue(method_call.method_name()), &stream);
+  if (method_call.arguments()) {
+    serializer_->WriteValue(*method_call.arguments(), &stream);
+  } else {
+    serializer_->WriteValue(EncodableValue(), &stream);
+  }
+  return encoded;
+}
+
+std::unique_ptr<std::vector<uint8_t>>
+StandardMethodCodec::EncodeSuccessEnvelopeInternal(
+    const EncodableValue* result) const {
+  auto encoded = std::make_unique<std::vector<uint8_t>>();
+  ByteBufferStreamWriter stream(encoded.get());
+  stream.WriteByte(0);
+  serializer_->WriteValue(result ? *result : EncodableValue(), &stream);
+  return encoded;
+}
+
+std::unique_ptr<std::vector<uint8_t>>
+StandardMethodCodec::EncodeErrorEnvelopeInternal(
+    const std::string& error_code, const std::string& error_message,
+    const EncodableValue* error_details) const {
+  auto encoded = std::make_unique<std::vector<uint8_t>>();
+  ByteBufferStreamWriter stream(encoded.get());
+  stream.WriteByte(1);
+  serializer_->WriteValue(EncodableValue(error_code), &stream);
+  if (error_message.empty()) {
+    serializer_->WriteValue(EncodableValue(), &stream);
+  } else {
+    serializer_->WriteValue(EncodableValue(error_message), &stream);
+  }
+  serializer_->WriteValue(error_details ? *error_details : EncodableValue(),
+                          &stream);
+  return encoded;
+}
+
+bool StandardMethodCodec::DecodeEnvelopeInternal(
+    const uint8_t* response, size_t response_size, bool* is_error,
+    EncodableValue* result, std::string* error_code,
+    std::string* error_message) const {
+  if (nullptr == response || response_size == 0) {
+    return false;
+  }
+  ByteBufferStreamReader stream(response, response_size);
+  uint8_t flag = stream.ReadByte();
+  if (flag == 0) {
+    *is_error = false;
+    *result = serializer_->ReadValue(&stream);
+    return !stream.overflowed();
+  }
+  if (flag != 1) {
+    return false;
+  }
+  *is_error = true;
+  EncodableValue code = serializer_->ReadValue(&stream);
+  EncodableValue message = serializer_->ReadValue(&stream);
+  *result = serializer_->ReadValue(&stream);
+  if (stream.overflowed() || !std::holds_alternative<std::string>(code)) {
+    return false;
+  }
+  *error_code = std::get<std::string>(code);
+  if (std::holds_alternative<std::string>(message)) {
+    *error_message = std::get<std::string>(message);
+  } else {
+    error_message->clear();
+  }
+  return true;
+}
+
+HostMessenger::HostMessenger() = default;
+
+HostMessenger::~HostMessenger() = default;
+
+void HostMessenger::SetDartHandler(const std::string& channel,
+                                   BinaryMessageHandler handler) {
+  if (handler) {
+    dart_handlers_[channel] = std::move(handler);
+  } else {
+    dart_handlers_.erase(channel);
+  }
+}
+
+bool HostMessenger::DispatchToPlugin(const std::string& channel,
+                                     const uint8_t* message,
+                                     size_t message_size, BinaryReply reply) {
+  auto handler = plugin_handlers_.find(channel);
+  if (handler == plugin_handlers_.end()) {
+    return false;
+  }
+  // Copied, as the handler may replace itself.
+  BinaryMessageHandler callback = handler->second;
+  callback(message, message_size,
+           reply ? std::move(reply) : [](const uint8_t*, size_t) {});
+  return true;
+}
+
+void HostMessenger::Send(const std::string& channel, const uint8_t* message,
+                         size_t message_size, BinaryReply reply) const {
+  auto handler = dart_handlers_.find(channel);
+  if (handler == dart_handlers_.end()) {
+    return;
+  }
+  handler->second(message, message_size,
+                  reply ? std::move(reply) : [](const uint8_t*, size_t) {});
+}
+
+void HostMessenger::SetMessageHandler(const std::string& channel,
+                                      BinaryMessageHandler handler) {
+  if (handler) {
+    plugin_handlers_[channel] = std::move(handler);
+  } else {
+    plugin_handlers_.erase(channel);
+  }
+}
+
+PluginRegistrar::PluginRegistrar(
+    FlutterDesktopPluginRegistrarRef core_registrar)
+    : messenger_(reinterpret_cast<HostMessenger*>(core_registrar)) {}
+
+PluginRegistrar::~PluginRegistrar() {
+  // Plugins go first, as they may use the messenger while shutting down.
+  plugins_.clear();
+}
+
+void PluginRegistrar::AddPlugin(std::unique_ptr<Plugin> plugin) {
+  plugins_.insert(std::move(plugin));
+}
+
+PluginRegistrarManager* PluginRegistrarManager::GetInstance() {
+  static PluginRegistrarManager* instance = new PluginRegistrarManager();
+  return instance;
+}
+
+}  // namespace flutter
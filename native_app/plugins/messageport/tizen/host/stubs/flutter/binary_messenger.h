@@ -0,0 +1,37 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_STUBS_FLUTTER_BINARY_MESSENGER_H
+#define HOST_STUBS_FLUTTER_BINARY_MESSENGER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace flutter {
+
+typedef std::function<void(const uint8_t* reply, size_t reply_size)>
+    BinaryReply;
+typedef std::function<void(const uint8_t* message, size_t message_size,
+                           BinaryReply reply)>
+    BinaryMessageHandler;
+
+class BinaryMessenger {
+ public:
+  virtual ~BinaryMessenger() = default;
+
+  // Sends a message to the handler of |channel| on the Dart side.
+  virtual void Send(const std::string& channel, const uint8_t* message,
+                    size_t message_size,
+                    BinaryReply reply = nullptr) const = 0;
+  // Handles messages sent from the Dart side on |channel|. Null removes the
+  // handler.
+  virtual void SetMessageHandler(const std::string& channel,
+                                 BinaryMessageHandler handler) = 0;
+};
+
+}  // namespace flutter
+
+#endif  // HOST_STUBS_FLUTTER_BINARY_MESSENGER_H
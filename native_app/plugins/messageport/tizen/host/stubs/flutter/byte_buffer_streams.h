@@ -0,0 +1,85 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_STUBS_FLUTTER_BYTE_BUFFER_STREAMS_H
+#define HOST_STUBS_FLUTTER_BYTE_BUFFER_STREAMS_H
+
+#include <cstring>
+#include <vector>
+
+#include "byte_streams.h"
+
+namespace flutter {
+
+// Reads from a buffer, returning zeros past its end.
+class ByteBufferStreamReader : public ByteStreamReader {
+ public:
+  ByteBufferStreamReader(const uint8_t* bytes, size_t size)
+      : bytes_(bytes), size_(size) {}
+
+  uint8_t ReadByte() override {
+    if (location_ >= size_) {
+      overflowed_ = true;
+      return 0;
+    }
+    return bytes_[location_++];
+  }
+
+  void ReadBytes(uint8_t* buffer, size_t length) override {
+    if (size_ - location_ < length) {
+      overflowed_ = true;
+      memset(buffer, 0, length);
+      location_ = size_;
+      return;
+    }
+    memcpy(buffer, &bytes_[location_], length);
+    location_ += length;
+  }
+
+  void ReadAlignment(uint8_t alignment) override {
+    uint8_t mod = location_ % alignment;
+    if (mod) {
+      location_ += alignment - mod;
+    }
+    if (location_ > size_) {
+      overflowed_ = true;
+      location_ = size_;
+    }
+  }
+
+  // Whether a read went past the end of the buffer.
+  bool overflowed() const { return overflowed_; }
+
+ private:
+  const uint8_t* bytes_;
+  size_t size_;
+  size_t location_ = 0;
+  bool overflowed_ = false;
+};
+
+class ByteBufferStreamWriter : public ByteStreamWriter {
+ public:
+  explicit ByteBufferStreamWriter(std::vector<uint8_t>* buffer)
+      : bytes_(buffer) {}
+
+  void WriteByte(uint8_t byte) override { bytes_->push_back(byte); }
+
+  void WriteBytes(const uint8_t* bytes, size_t length) override {
+    bytes_->insert(bytes_->end(), bytes, bytes + length);
+  }
+
+  void WriteAlignment(uint8_t alignment) override {
+    uint8_t mod = bytes_->size() % alignment;
+    if (mod) {
+      bytes_->insert(bytes_->end(), alignment - mod, 0);
+    }
+  }
+
+ private:
+  std::vector<uint8_t>* bytes_;
+};
+
+}  // namespace flutter
+
+#endif  // HOST_STUBS_FLUTTER_BYTE_BUFFER_STREAMS_H
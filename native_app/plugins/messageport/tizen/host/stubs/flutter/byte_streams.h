@@ -0,0 +1,35 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_STUBS_FLUTTER_BYTE_STREAMS_H
+#define HOST_STUBS_FLUTTER_BYTE_STREAMS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace flutter {
+
+class ByteStreamReader {
+ public:
+  virtual ~ByteStreamReader() = default;
+
+  virtual uint8_t ReadByte() = 0;
+  virtual void ReadBytes(uint8_t* buffer, size_t length) = 0;
+  // Skips padding up to a multiple of |alignment|.
+  virtual void ReadAlignment(uint8_t alignment) = 0;
+};
+
+class ByteStreamWriter {
+ public:
+  virtual ~ByteStreamWriter() = default;
+
+  virtual void WriteByte(uint8_t byte) = 0;
+  virtual void WriteBytes(const uint8_t* bytes, size_t length) = 0;
+  // Pads up to a multiple of |alignment|.
+  virtual void WriteAlignment(uint8_t alignment) = 0;
+};
+
+}  // namespace flutter
+
+#endif  // HOST_STUBS_FLUTTER_BYTE_STREAMS_H
@@ -0,0 +1,87 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Stand-ins for the Flutter C++ client wrapper, for host builds. They follow
+// the API of the wrapper shipped with the Tizen embedder, with messages
+// going through a HostMessenger instead of the engine.
+
+#ifndef HOST_STUBS_FLUTTER_ENCODABLE_VALUE_H
+#define HOST_STUBS_FLUTTER_ENCODABLE_VALUE_H
+
+#include <any>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace flutter {
+
+class EncodableValue;
+
+using EncodableList = std::vector<EncodableValue>;
+using EncodableMap = std::map<EncodableValue, EncodableValue>;
+
+// Values of application defined types. Never encoded by the standard codec.
+class CustomEncodableValue {
+ public:
+  explicit CustomEncodableValue(const std::any& value) : value_(value) {}
+
+  operator std::any&() { return value_; }
+  operator const std::any&() const { return value_; }
+
+  bool operator<(const CustomEncodableValue& other) const {
+    return this < &other;
+  }
+  bool operator==(const CustomEncodableValue& other) const {
+    return this == &other;
+  }
+
+ private:
+  std::any value_;
+};
+
+namespace internal {
+using EncodableValueVariant =
+    std::variant<std::monostate, bool, int32_t, int64_t, double, std::string,
+                 std::vector<uint8_t>, std::vector<int32_t>,
+                 std::vector<int64_t>, std::vector<double>, EncodableList,
+                 EncodableMap, CustomEncodableValue, std::vector<float>>;
+}  // namespace internal
+
+class EncodableValue : public internal::EncodableValueVariant {
+ public:
+  using super = internal::EncodableValueVariant;
+  using super::super;
+  using super::operator=;
+
+  EncodableValue() = default;
+
+  // Avoids const char* being converted to bool.
+  explicit EncodableValue(const char* string) : super(std::string(string)) {}
+  EncodableValue& operator=(const char* other) {
+    *this = std::string(other);
+    return *this;
+  }
+
+  bool IsNull() const { return std::holds_alternative<std::monostate>(*this); }
+
+  // Returns the value of an int32_t or int64_t value as int64_t.
+  int64_t LongValue() const {
+    if (std::holds_alternative<int32_t>(*this)) {
+      return std::get<int32_t>(*this);
+    }
+    return std::get<int64_t>(*this);
+  }
+
+  friend bool operator<(const EncodableValue& lhs, const EncodableValue& rhs) {
+    return static_cast<const super&>(lhs) < static_cast<const super&>(rhs);
+  }
+};
+
+}  // namespace flutter
+
+#endif  // HOST_STUBS_FLUTTER_ENCODABLE_VALUE_H
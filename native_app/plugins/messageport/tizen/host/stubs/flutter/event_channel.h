@@ -0,0 +1,125 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_STUBS_FLUTTER_EVENT_CHANNEL_H
+#define HOST_STUBS_FLUTTER_EVENT_CHANNEL_H
+
+#include <memory>
+#include <string>
+
+#include "binary_messenger.h"
+#include "event_sink.h"
+#include "event_stream_handler.h"
+#include "method_codec.h"
+
+namespace flutter {
+
+template <typename T = EncodableValue>
+class EventChannel {
+ public:
+  EventChannel(BinaryMessenger* messenger, const std::string& name,
+               const MethodCodec<T>* codec)
+      : messenger_(messenger), name_(name), codec_(codec) {}
+  ~EventChannel() = default;
+
+  EventChannel(const EventChannel&) = delete;
+  EventChannel& operator=(const EventChannel&) = delete;
+
+  // Handles "listen" and "cancel" calls from the Dart side. A listen while
+  // already listening cancels the previous stream first.
+  void SetStreamHandler(std::unique_ptr<StreamHandler<T>> handler) {
+    if (!handler) {
+      messenger_->SetMessageHandler(name_, nullptr);
+      return;
+    }
+    // The channel owns the handler, shared so the message handler can be
+    // copied.
+    std::shared_ptr<StreamHandler<T>> shared_handler(handler.release());
+    BinaryMessenger* messenger = messenger_;
+    const std::string channel_name = name_;
+    const MethodCodec<T>* codec = codec_;
+    auto is_listening = std::make_shared<bool>(false);
+    messenger_->SetMessageHandler(
+        name_, [shared_handler, messenger, channel_name, codec, is_listening](
+                   const uint8_t* message, size_t message_size,
+                   BinaryReply reply) {
+          std::unique_ptr<MethodCall<T>> call =
+              codec->DecodeMethodCall(message, message_size);
+          if (!call) {
+            reply(nullptr, 0);
+            return;
+          }
+          std::unique_ptr<std::vector<uint8_t>> response;
+          if (call->method_name() == "listen") {
+            if (*is_listening) {
+              shared_handler->OnCancel(nullptr);
+            }
+            *is_listening = true;
+            auto sink = std::make_unique<HostEventSink>(messenger,
+                                                        channel_name, codec);
+            std::unique_ptr<StreamHandlerError<T>> error =
+                shared_handler->OnListen(call->arguments(), std::move(sink));
+            response = error ? codec->EncodeErrorEnvelope(
+                                   error->error_code, error->error_message,
+                                   error->error_details.get())
+                             : codec->EncodeSuccessEnvelope();
+          } else if (call->method_name() == "cancel") {
+            if (!*is_listening) {
+              response = codec->EncodeErrorEnvelope(
+                  "error", "No active stream to cancel", nullptr);
+            } else {
+              *is_listening = false;
+              std::unique_ptr<StreamHandlerError<T>> error =
+                  shared_handler->OnCancel(call->arguments());
+              response = error ? codec->EncodeErrorEnvelope(
+                                     error->error_code, error->error_message,
+                                     error->error_details.get())
+                               : codec->EncodeSuccessEnvelope();
+            }
+          } else {
+            reply(nullptr, 0);
+            return;
+          }
+          reply(response->data(), response->size());
+        });
+  }
+
+ private:
+  // Sends events as envelopes on the channel, as the engine does.
+  class HostEventSink : public EventSink<T> {
+   public:
+    HostEventSink(BinaryMessenger* messenger, const std::string& name,
+                  const MethodCodec<T>* codec)
+        : messenger_(messenger), name_(name), codec_(codec) {}
+
+   protected:
+    void SuccessInternal(const T* event = nullptr) override {
+      auto envelope = codec_->EncodeSuccessEnvelope(event);
+      messenger_->Send(name_, envelope->data(), envelope->size());
+    }
+    void ErrorInternal(const std::string& error_code,
+                       const std::string& error_message,
+                       const T* error_details) override {
+      auto envelope =
+          codec_->EncodeErrorEnvelope(error_code, error_message, error_details);
+      messenger_->Send(name_, envelope->data(), envelope->size());
+    }
+    void EndOfStreamInternal() override {
+      messenger_->Send(name_, nullptr, 0);
+    }
+
+   private:
+    BinaryMessenger* messenger_;
+    std::string name_;
+    const MethodCodec<T>* codec_;
+  };
+
+  BinaryMessenger* messenger_;
+  std::string name_;
+  const MethodCodec<T>* codec_;
+};
+
+}  // namespace flutter
+
+#endif  // HOST_STUBS_FLUTTER_EVENT_CHANNEL_H
@@ -0,0 +1,56 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_STUBS_FLUTTER_EVENT_STREAM_HANDLER_H
+#define HOST_STUBS_FLUTTER_EVENT_STREAM_HANDLER_H
+
+#include <memory>
+#include <string>
+
+#include "encodable_value.h"
+#include "event_sink.h"
+
+namespace flutter {
+
+template <typename T = EncodableValue>
+struct StreamHandlerError {
+  const std::string error_code;
+  const std::string error_message;
+  const std::unique_ptr<T> error_details;
+
+  StreamHandlerError(const std::string& error_code,
+                     const std::string& error_message,
+                     std::unique_ptr<T>&& error_details)
+      : error_code(error_code),
+        error_message(error_message),
+        error_details(std::move(error_details)) {}
+};
+
+template <typename T = EncodableValue>
+class StreamHandler {
+ public:
+  StreamHandler() = default;
+  virtual ~StreamHandler() = default;
+
+  StreamHandler(const StreamHandler&) = delete;
+  StreamHandler& operator=(const StreamHandler&) = delete;
+
+  std::unique_ptr<StreamHandlerError<T>> OnListen(
+      const T* arguments, std::unique_ptr<EventSink<T>>&& events) {
+    return OnListenInternal(arguments, std::move(events));
+  }
+  std::unique_ptr<StreamHandlerError<T>> OnCancel(const T* arguments) {
+    return OnCancelInternal(arguments);
+  }
+
+ protected:
+  virtual std::unique_ptr<StreamHandlerError<T>> OnListenInternal(
+      const T* arguments, std::unique_ptr<EventSink<T>>&& events) = 0;
+  virtual std::unique_ptr<StreamHandlerError<T>> OnCancelInternal(
+      const T* arguments) = 0;
+};
+
+}  // namespace flutter
+
+#endif  // HOST_STUBS_FLUTTER_EVENT_STREAM_HANDLER_H
@@ -0,0 +1,55 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_STUBS_FLUTTER_EVENT_STREAM_HANDLER_FUNCTIONS_H
+#define HOST_STUBS_FLUTTER_EVENT_STREAM_HANDLER_FUNCTIONS_H
+
+#include <functional>
+#include <memory>
+
+#include "event_stream_handler.h"
+
+namespace flutter {
+
+template <typename T>
+using StreamHandlerListen = std::function<std::unique_ptr<
+    StreamHandlerError<T>>(const T* arguments,
+                           std::unique_ptr<EventSink<T>>&& events)>;
+template <typename T>
+using StreamHandlerCancel =
+    std::function<std::unique_ptr<StreamHandlerError<T>>(const T* arguments)>;
+
+template <typename T = EncodableValue>
+class StreamHandlerFunctions : public StreamHandler<T> {
+ public:
+  StreamHandlerFunctions(StreamHandlerListen<T> on_listen,
+                         StreamHandlerCancel<T> on_cancel)
+      : on_listen_(on_listen), on_cancel_(on_cancel) {}
+
+ protected:
+  std::unique_ptr<StreamHandlerError<T>> OnListenInternal(
+      const T* arguments, std::unique_ptr<EventSink<T>>&& events) override {
+    if (on_listen_) {
+      return on_listen_(arguments, std::move(events));
+    }
+    return std::make_unique<StreamHandlerError<T>>(
+        "error", "No OnListen handler set", nullptr);
+  }
+  std::unique_ptr<StreamHandlerError<T>> OnCancelInternal(
+      const T* arguments) override {
+    if (on_cancel_) {
+      return on_cancel_(arguments);
+    }
+    return std::make_unique<StreamHandlerError<T>>(
+        "error", "No OnCancel handler set", nullptr);
+  }
+
+ private:
+  StreamHandlerListen<T> on_listen_;
+  StreamHandlerCancel<T> on_cancel_;
+};
+
+}  // namespace flutter
+
+#endif  // HOST_STUBS_FLUTTER_EVENT_STREAM_HANDLER_FUNCTIONS_H
@@ -0,0 +1,55 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// The engine side of the host stand-ins: routes messages between plugin
+// handlers and handlers registered for the Dart side.
+
+#ifndef HOST_STUBS_FLUTTER_HOST_MESSENGER_H
+#define HOST_STUBS_FLUTTER_HOST_MESSENGER_H
+
+#include <flutter_plugin_registrar.h>
+
+#include <map>
+#include <string>
+
+#include "binary_messenger.h"
+
+namespace flutter {
+
+class HostMessenger : public BinaryMessenger {
+ public:
+  HostMessenger();
+  ~HostMessenger() override;
+
+  HostMessenger(const HostMessenger&) = delete;
+  HostMessenger& operator=(const HostMessenger&) = delete;
+
+  // Delivers messages the plugin sends on |channel|, as Dart would receive
+  // them. Messages on channels without a handler are dropped.
+  void SetDartHandler(const std::string& channel,
+                      BinaryMessageHandler handler);
+
+  // Sends |message| to the plugin handler of |channel|, as Dart would.
+  // Returns false if there is no handler.
+  bool DispatchToPlugin(const std::string& channel, const uint8_t* message,
+                        size_t message_size, BinaryReply reply);
+
+  // The registrar to pass to the plugin's RegisterWithRegistrar function.
+  FlutterDesktopPluginRegistrarRef registrar() {
+    return reinterpret_cast<FlutterDesktopPluginRegistrarRef>(this);
+  }
+
+  void Send(const std::string& channel, const uint8_t* message,
+            size_t message_size, BinaryReply reply = nullptr) const override;
+  void SetMessageHandler(const std::string& channel,
+                         BinaryMessageHandler handler) override;
+
+ private:
+  std::map<std::string, BinaryMessageHandler> plugin_handlers_;
+  std::map<std::string, BinaryMessageHandler> dart_handlers_;
+};
+
+}  // namespace flutter
+
+#endif  // HOST_STUBS_FLUTTER_HOST_MESSENGER_H
@@ -0,0 +1,44 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_STUBS_FLUTTER_MESSAGE_CODEC_H
+#define HOST_STUBS_FLUTTER_MESSAGE_CODEC_H
+
+#include <memory>
+#include <vector>
+
+namespace flutter {
+
+template <typename T>
+class MessageCodec {
+ public:
+  virtual ~MessageCodec() = default;
+
+  // Returns null if |binary_message| can not be decoded.
+  std::unique_ptr<T> DecodeMessage(const uint8_t* binary_message,
+                                   size_t message_size) const {
+    return DecodeMessageInternal(binary_message, message_size);
+  }
+  std::unique_ptr<T> DecodeMessage(
+      const std::vector<uint8_t>& binary_message) const {
+    size_t size = binary_message.size();
+    const uint8_t* data = size > 0 ? &binary_message[0] : nullptr;
+    return DecodeMessageInternal(data, size);
+  }
+
+  std::unique_ptr<std::vector<uint8_t>> EncodeMessage(
+      const T& message) const {
+    return EncodeMessageInternal(message);
+  }
+
+ protected:
+  virtual std::unique_ptr<T> DecodeMessageInternal(
+      const uint8_t* binary_message, size_t message_size) const = 0;
+  virtual std::unique_ptr<std::vector<uint8_t>> EncodeMessageInternal(
+      const T& message) const = 0;
+};
+
+}  // namespace flutter
+
+#endif  // HOST_STUBS_FLUTTER_MESSAGE_CODEC_H
@@ -0,0 +1,33 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_STUBS_FLUTTER_METHOD_CALL_H
+#define HOST_STUBS_FLUTTER_METHOD_CALL_H
+
+#include <memory>
+#include <string>
+
+namespace flutter {
+
+template <typename T>
+class MethodCall {
+ public:
+  MethodCall(const std::string& method_name, std::unique_ptr<T> arguments)
+      : method_name_(method_name), arguments_(std::move(arguments)) {}
+
+  MethodCall(const MethodCall&) = delete;
+  MethodCall& operator=(const MethodCall&) = delete;
+
+  const std::string& method_name() const { return method_name_; }
+  // Null if there are no arguments.
+  const T* arguments() const { return arguments_.get(); }
+
+ private:
+  std::string method_name_;
+  std::unique_ptr<T> arguments_;
+};
+
+}  // namespace flutter
+
+#endif  // HOST_STUBS_FLUTTER_METHOD_CALL_H
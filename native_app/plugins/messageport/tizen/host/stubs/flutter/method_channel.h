@@ -0,0 +1,106 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_STUBS_FLUTTER_METHOD_CHANNEL_H
+#define HOST_STUBS_FLUTTER_METHOD_CHANNEL_H
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "binary_messenger.h"
+#include "method_call.h"
+#include "method_codec.h"
+#include "method_result.h"
+
+namespace flutter {
+
+template <typename T>
+using MethodCallHandler =
+    std::function<void(const MethodCall<T>& call,
+                       std::unique_ptr<MethodResult<T>> result)>;
+
+// Encodes the result of a method call and sends it as the reply.
+template <typename T>
+class EngineMethodResult : public MethodResult<T> {
+ public:
+  EngineMethodResult(BinaryReply reply, const MethodCodec<T>* codec)
+      : reply_(std::move(reply)), codec_(codec) {}
+
+  ~EngineMethodResult() override {
+    if (reply_) {
+      // Same as the engine, a dropped result replies with nothing.
+      reply_(nullptr, 0);
+    }
+  }
+
+ protected:
+  void SuccessInternal(const T* result) override {
+    Reply(codec_->EncodeSuccessEnvelope(result));
+  }
+  void ErrorInternal(const std::string& error_code,
+                     const std::string& error_message,
+                     const T* error_details) override {
+    Reply(codec_->EncodeErrorEnvelope(error_code, error_message,
+                                      error_details));
+  }
+  void NotImplementedInternal() override {
+    BinaryReply reply = std::move(reply_);
+    reply_ = nullptr;
+    reply(nullptr, 0);
+  }
+
+ private:
+  void Reply(std::unique_ptr<std::vector<uint8_t>> envelope) {
+    BinaryReply reply = std::move(reply_);
+    reply_ = nullptr;
+    if (reply) {
+      reply(envelope->data(), envelope->size());
+    }
+  }
+
+  BinaryReply reply_;
+  const MethodCodec<T>* codec_;
+};
+
+template <typename T>
+class MethodChannel {
+ public:
+  MethodChannel(BinaryMessenger* messenger, const std::string& name,
+                const MethodCodec<T>* codec)
+      : messenger_(messenger), name_(name), codec_(codec) {}
+
+  MethodChannel(const MethodChannel&) = delete;
+  MethodChannel& operator=(const MethodChannel&) = delete;
+
+  void SetMethodCallHandler(MethodCallHandler<T> handler) const {
+    if (!handler) {
+      messenger_->SetMessageHandler(name_, nullptr);
+      return;
+    }
+    const MethodCodec<T>* codec = codec_;
+    messenger_->SetMessageHandler(
+        name_, [handler, codec](const uint8_t* message, size_t message_size,
+                                BinaryReply reply) {
+          auto result =
+              std::make_unique<EngineMethodResult<T>>(std::move(reply), codec);
+          std::unique_ptr<MethodCall<T>> call =
+              codec->DecodeMethodCall(message, message_size);
+          if (!call) {
+            result->Error("Malformed method call");
+            return;
+          }
+          handler(*call, std::move(result));
+        });
+  }
+
+ private:
+  BinaryMessenger* messenger_;
+  std::string name_;
+  const MethodCodec<T>* codec_;
+};
+
+}  // namespace flutter
+
+#endif  // HOST_STUBS_FLUTTER_METHOD_CHANNEL_H
@@ -0,0 +1,67 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_STUBS_FLUTTER_METHOD_CODEC_H
+#define HOST_STUBS_FLUTTER_METHOD_CODEC_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "method_call.h"
+
+namespace flutter {
+
+template <typename T>
+class MethodCodec {
+ public:
+  virtual ~MethodCodec() = default;
+
+  // Returns null if |message| is not a method call.
+  std::unique_ptr<MethodCall<T>> DecodeMethodCall(const uint8_t* message,
+                                                  size_t message_size) const {
+    return DecodeMethodCallInternal(message, message_size);
+  }
+  std::unique_ptr<std::vector<uint8_t>> EncodeMethodCall(
+      const MethodCall<T>& method_call) const {
+    return EncodeMethodCallInternal(method_call);
+  }
+  std::unique_ptr<std::vector<uint8_t>> EncodeSuccessEnvelope(
+      const T* result = nullptr) const {
+    return EncodeSuccessEnvelopeInternal(result);
+  }
+  std::unique_ptr<std::vector<uint8_t>> EncodeErrorEnvelope(
+      const std::string& error_code, const std::string& error_message = "",
+      const T* error_details = nullptr) const {
+    return EncodeErrorEnvelopeInternal(error_code, error_message,
+                                       error_details);
+  }
+  // Returns false if |response| is not an envelope. Otherwise sets
+  // |is_error|, and either |result| or the error fields.
+  bool DecodeEnvelope(const uint8_t* response, size_t response_size,
+                      bool* is_error, T* result, std::string* error_code,
+                      std::string* error_message) const {
+    return DecodeEnvelopeInternal(response, response_size, is_error, result,
+                                  error_code, error_message);
+  }
+
+ protected:
+  virtual std::unique_ptr<MethodCall<T>> DecodeMethodCallInternal(
+      const uint8_t* message, size_t message_size) const = 0;
+  virtual std::unique_ptr<std::vector<uint8_t>> EncodeMethodCallInternal(
+      const MethodCall<T>& method_call) const = 0;
+  virtual std::unique_ptr<std::vector<uint8_t>> EncodeSuccessEnvelopeInternal(
+      const T* result) const = 0;
+  virtual std::unique_ptr<std::vector<uint8_t>> EncodeErrorEnvelopeInternal(
+      const std::string& error_code, const std::string& error_message,
+      const T* error_details) const = 0;
+  virtual bool DecodeEnvelopeInternal(const uint8_t* response,
+                                      size_t response_size, bool* is_error,
+                                      T* result, std::string* error_code,
+                                      std::string* error_message) const = 0;
+};
+
+}  // namespace flutter
+
+#endif  // HOST_STUBS_FLUTTER_METHOD_CODEC_H
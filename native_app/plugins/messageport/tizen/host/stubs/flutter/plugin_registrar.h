@@ -0,0 +1,65 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_STUBS_FLUTTER_PLUGIN_REGISTRAR_WRAPPER_H
+#define HOST_STUBS_FLUTTER_PLUGIN_REGISTRAR_WRAPPER_H
+
+#include <flutter_plugin_registrar.h>
+
+#include <map>
+#include <memory>
+#include <set>
+
+#include "binary_messenger.h"
+
+namespace flutter {
+
+class Plugin {
+ public:
+  virtual ~Plugin() = default;
+};
+
+class PluginRegistrar {
+ public:
+  explicit PluginRegistrar(FlutterDesktopPluginRegistrarRef core_registrar);
+  virtual ~PluginRegistrar();
+
+  PluginRegistrar(const PluginRegistrar&) = delete;
+  PluginRegistrar& operator=(const PluginRegistrar&) = delete;
+
+  BinaryMessenger* messenger() { return messenger_; }
+
+  // Takes ownership of |plugin|, destroying it with the registrar.
+  void AddPlugin(std::unique_ptr<Plugin> plugin);
+
+ private:
+  BinaryMessenger* messenger_;
+  std::set<std::unique_ptr<Plugin>> plugins_;
+};
+
+// Keeps one wrapper per registrar, as in the client wrapper.
+class PluginRegistrarManager {
+ public:
+  static PluginRegistrarManager* GetInstance();
+
+  template <class T>
+  T* GetRegistrar(FlutterDesktopPluginRegistrarRef registrar_ref) {
+    auto insert_result =
+        registrars_.emplace(registrar_ref, std::make_unique<T>(registrar_ref));
+    return static_cast<T*>(insert_result.first->second.get());
+  }
+
+  // Destroys the registrar and its plugins.
+  void RemoveRegistrar(FlutterDesktopPluginRegistrarRef registrar_ref) {
+    registrars_.erase(registrar_ref);
+  }
+
+ private:
+  std::map<FlutterDesktopPluginRegistrarRef, std::unique_ptr<PluginRegistrar>>
+      registrars_;
+};
+
+}  // namespace flutter
+
+#endif  // HOST_STUBS_FLUTTER_PLUGIN_REGISTRAR_WRAPPER_H
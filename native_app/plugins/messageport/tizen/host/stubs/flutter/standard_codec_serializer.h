@@ -0,0 +1,34 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_STUBS_FLUTTER_STANDARD_CODEC_SERIALIZER_H
+#define HOST_STUBS_FLUTTER_STANDARD_CODEC_SERIALIZER_H
+
+#include "byte_streams.h"
+#include "encodable_value.h"
+
+namespace flutter {
+
+// Reads and writes values in the format of StandardMessageCodec of Dart.
+class StandardCodecSerializer {
+ public:
+  virtual ~StandardCodecSerializer();
+
+  static const StandardCodecSerializer& GetInstance();
+
+  EncodableValue ReadValue(ByteStreamReader* stream) const;
+  void WriteValue(const EncodableValue& value, ByteStreamWriter* stream) const;
+
+ protected:
+  StandardCodecSerializer();
+
+  virtual EncodableValue ReadValueOfType(uint8_t type,
+                                         ByteStreamReader* stream) const;
+  size_t ReadSize(ByteStreamReader* stream) const;
+  void WriteSize(size_t size, ByteStreamWriter* stream) const;
+};
+
+}  // namespace flutter
+
+#endif  // HOST_STUBS_FLUTTER_STANDARD_CODEC_SERIALIZER_H
@@ -0,0 +1,35 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_STUBS_FLUTTER_STANDARD_MESSAGE_CODEC_H
+#define HOST_STUBS_FLUTTER_STANDARD_MESSAGE_CODEC_H
+
+#include "encodable_value.h"
+#include "message_codec.h"
+#include "standard_codec_serializer.h"
+
+namespace flutter {
+
+class StandardMessageCodec : public MessageCodec<EncodableValue> {
+ public:
+  // |serializer| defaults to StandardCodecSerializer::GetInstance().
+  static const StandardMessageCodec& GetInstance(
+      const StandardCodecSerializer* serializer = nullptr);
+
+ protected:
+  explicit StandardMessageCodec(const StandardCodecSerializer* serializer)
+      : serializer_(serializer) {}
+
+  std::unique_ptr<EncodableValue> DecodeMessageInternal(
+      const uint8_t* binary_message, size_t message_size) const override;
+  std::unique_ptr<std::vector<uint8_t>> EncodeMessageInternal(
+      const EncodableValue& message) const override;
+
+ private:
+  const StandardCodecSerializer* serializer_;
+};
+
+}  // namespace flutter
+
+#endif  // HOST_STUBS_FLUTTER_STANDARD_MESSAGE_CODEC_H
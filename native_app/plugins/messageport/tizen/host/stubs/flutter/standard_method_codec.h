@@ -0,0 +1,44 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef HOST_STUBS_FLUTTER_STANDARD_METHOD_CODEC_H
+#define HOST_STUBS_FLUTTER_STANDARD_METHOD_CODEC_H
+
+#include "encodable_value.h"
+#include "method_codec.h"
+#include "standard_codec_serializer.h"
+
+namespace flutter {
+
+class StandardMethodCodec : public MethodCodec<EncodableValue> {
+ public:
+  // |serializer| defaults to StandardCodecSerializer::GetInstance().
+  static const StandardMethodCodec& GetInstance(
+      const StandardCodecSerializer* serializer = nullptr);
+
+ protected:
+  explicit StandardMethodCodec(const StandardCodecSerializer* serializer)
+      : serializer_(serializer) {}
+
+  std::unique_ptr<MethodCall<EncodableValue>> DecodeMethodCallInternal(
+      const uint8_t* message, size_t message_size) const override;
+  std::unique_ptr<std::vector<uint8_t>> EncodeMethodCallInternal(
+      const MethodCall<EncodableValue>& method_call) const override;
+  std::unique_ptr<std::vector<uint8_t>> EncodeSuccessEnvelopeInternal(
+      const EncodableValue* result) const override;
+  std::unique_ptr<std::vector<uint8_t>> EncodeErrorEnvelopeInternal(
+      const std::string& error_code, const std::string& error_message,
+      const EncodableValue* error_details) const override;
+  bool DecodeEnvelopeInternal(const uint8_t* response, size_t response_size,
+                              bool* is_error, EncodableValue* result,
+                              std::string* error_code,
+                              std::string* error_message) const override;
+
+ private:
+  const StandardCodecSerializer* serializer_;
+};
+
+}  // namespace flutter
+
+#endif  // HOST_STUBS_FLUTTER_STANDARD_METHOD_CODEC_H
@@ -0,0 +1,13 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Stand-in for the embedder registrar handle, for host builds. See
+// flutter/host_messenger.h for how a registrar is made.
+
+#ifndef HOST_STUBS_FLUTTER_PLUGIN_REGISTRAR_H
+#define HOST_STUBS_FLUTTER_PLUGIN_REGISTRAR_H
+
+typedef struct FlutterDesktopPluginRegistrar* FlutterDesktopPluginRegistrarRef;
+
+#endif  // HOST_STUBS_FLUTTER_PLUGIN_REGISTRAR_H
@@ -0,0 +1,320 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <Ecore.h>
+#include <app_common.h>
+#include <message_port.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+
+namespace {
+
+typedef std::tuple<std::string, std::string, bool> PortKey;
+
+struct LocalPort {
+  std::string name;
+  bool is_trusted;
+  message_port_message_cb callback;
+  void* user_data;
+};
+
+struct Watcher {
+  PortKey key;
+  bool on_registered;
+  message_port_registration_event_cb callback;
+  void* user_data;
+};
+
+// An encoded bundle on its way to a local port.
+struct Delivery {
+  PortKey target;
+  std::string sender_app_id;
+  // Empty if there is no port to reply to.
+  std::string reply_port;
+  bool reply_port_trusted;
+  bundle_raw* raw;
+  int size;
+};
+
+struct RegistrationEvent {
+  PortKey key;
+  bool registered;
+};
+
+std::mutex mutex;
+int next_id = 1;
+std::map<int, LocalPort> local_ports;
+std::map<PortKey, int> port_ids;
+std::map<int, Watcher> watchers;
+std::atomic<int> send_delay_us{0};
+
+const std::string& AppId() {
+  static const std::string app_id = [] {
+    char* id = nullptr;
+    app_get_id(&id);
+    std::string value = id ? id : "";
+    free(id);
+    return value;
+  }();
+  return app_id;
+}
+
+void Deliver(void* data) {
+  auto* delivery = static_cast<Delivery*>(data);
+  LocalPort port;
+  int id = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto entry = port_ids.find(delivery->target);
+    if (entry != port_ids.end()) {
+      id = entry->second;
+      port = local_ports[id];
+    }
+  }
+  bundle* b = bundle_decode(delivery->raw, delivery->size);
+  if (id != 0 && b) {
+    port.callback(id, delivery->sender_app_id.c_str(),
+                  delivery->reply_port.empty() ? nullptr
+                                               : delivery->reply_port.c_str(),
+                  delivery->reply_port_trusted, b, port.user_data);
+  }
+  if (b) {
+    bundle_free(b);
+  }
+  bundle_free_encoded_rawdata(&delivery->raw);
+  delete delivery;
+}
+
+void NotifyWatchers(void* data) {
+  auto* event = static_cast<RegistrationEvent*>(data);
+  std::map<int, Watcher> matching;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& watcher : watchers) {
+      if (watcher.second.key == event->key &&
+          watcher.second.on_registered == event->registered) {
+        matching.insert(watcher);
+      }
+    }
+  }
+  for (const auto& watcher : matching) {
+    watcher.second.callback(std::get<0>(event->key).c_str(),
+                            std::get<1>(event->key).c_str(),
+                            std::get<2>(event->key),
+                            watcher.second.user_data);
+  }
+  delete event;
+}
+
+int Register(const char* name, bool is_trusted,
+             message_port_message_cb callback, void* user_data) {
+  if (nullptr == name || nullptr == callback) {
+    return MESSAGE_PORT_ERROR_INVALID_PARAMETER;
+  }
+  PortKey key(AppId(), name, is_trusted);
+  int id;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto existing = port_ids.find(key);
+    if (existing != port_ids.end()) {
+      // Registering again replaces the callback, as on the device.
+      local_ports[existing->second] =
+          LocalPort{name, is_trusted, callback, user_data};
+      return existing->second;
+    }
+    id = next_id++;
+    local_ports[id] = LocalPort{name, is_trusted, callback, user_data};
+    port_ids[key] = id;
+  }
+  ecore_main_loop_thread_safe_call_async(NotifyWatchers,
+                                         new RegistrationEvent{key, true});
+  return id;
+}
+
+int Unregister(int id, bool is_trusted) {
+  PortKey key;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto port = local_ports.find(id);
+    if (port == local_ports.end() || port->second.is_trusted != is_trusted) {
+      return MESSAGE_PORT_ERROR_INVALID_PARAMETER;
+    }
+    key = PortKey(AppId(), port->second.name, is_trusted);
+    port_ids.erase(key);
+    local_ports.erase(port);
+  }
+  ecore_main_loop_thread_safe_call_async(NotifyWatchers,
+                                         new RegistrationEvent{key, false});
+  return MESSAGE_PORT_ERROR_NONE;
+}
+
+int Check(const char* app_id, const char* name, bool is_trusted,
+          bool* exist) {
+  if (nullptr == app_id || nullptr == name || nullptr == exist) {
+    return MESSAGE_PORT_ERROR_INVALID_PARAMETER;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  *exist = port_ids.count(PortKey(app_id, name, is_trusted)) > 0;
+  return MESSAGE_PORT_ERROR_NONE;
+}
+
+int Send(const char* app_id, const char* name, bool is_trusted, bundle* b,
+         int local_port_id) {
+  if (nullptr == app_id || nullptr == name || nullptr == b) {
+    return MESSAGE_PORT_ERROR_INVALID_PARAMETER;
+  }
+  auto* delivery = new Delivery{PortKey(app_id, name, is_trusted), AppId(),
+                                "", false, nullptr, 0};
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (local_port_id >= 0) {
+      auto reply_port = local_ports.find(local_port_id);
+      if (reply_port == local_ports.end()) {
+        delete delivery;
+        return MESSAGE_PORT_ERROR_INVALID_PARAMETER;
+      }
+      delivery->reply_port = reply_port->second.name;
+      delivery->reply_port_trusted = reply_port->second.is_trusted;
+    }
+    if (port_ids.count(delivery->target) == 0) {
+      delete delivery;
+      return MESSAGE_PORT_ERROR_PORT_NOT_FOUND;
+    }
+  }
+  bundle_encode(b, &delivery->raw, &delivery->size);
+  if (send_delay_us > 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(send_delay_us));
+  }
+  ecore_main_loop_thread_safe_call_async(Deliver, delivery);
+  return MESSAGE_PORT_ERROR_NONE;
+}
+
+int AddWatcher(const char* app_id, const char* name, bool is_trusted,
+               bool on_registered,
+               message_port_registration_event_cb callback, void* user_data,
+               int* watcher_id) {
+  if (nullptr == app_id || nullptr == name || nullptr == callback ||
+      nullptr == watcher_id) {
+    return MESSAGE_PORT_ERROR_INVALID_PARAMETER;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  *watcher_id = next_id++;
+  watchers[*watcher_id] = Watcher{PortKey(app_id, name, is_trusted),
+                                  on_registered, callback, user_data};
+  return MESSAGE_PORT_ERROR_NONE;
+}
+
+}  // namespace
+
+int message_port_register_local_port(const char* local_port,
+                                     message_port_message_cb callback,
+                                     void* user_data) {
+  return Register(local_port, false, callback, user_data);
+}
+
+int message_port_register_trusted_local_port(
+    const char* trusted_local_port, message_port_trusted_message_cb callback,
+    void* user_data) {
+  return Register(trusted_local_port, true, callback, user_data);
+}
+
+int message_port_unregister_local_port(int local_port_id) {
+  return Unregister(local_port_id, false);
+}
+
+int message_port_unregister_trusted_local_port(int trusted_local_port_id) {
+  return Unregister(trusted_local_port_id, true);
+}
+
+int message_port_check_remote_port(const char* remote_app_id,
+                                   const char* remote_port, bool* exist) {
+  return Check(remote_app_id, remote_port, false, exist);
+}
+
+int message_port_check_trusted_remote_port(const char* remote_app_id,
+                                           const char* remote_port,
+                                           bool* exist) {
+  return Check(remote_app_id, remote_port, true, exist);
+}
+
+int message_port_send_message(const char* remote_app_id,
+                              const char* remote_port, bundle* message) {
+  return Send(remote_app_id, remote_port, false, message, -1);
+}
+
+int message_port_send_trusted_message(const char* remote_app_id,
+                                      const char* remote_port,
+                                      bundle* message) {
+  return Send(remote_app_id, remote_port, true, message, -1);
+}
+
+int message_port_send_message_with_local_port(const char* remote_app_id,
+                                              const char* remote_port,
+                                              bundle* message,
+                                              int local_port_id) {
+  return Send(remote_app_id, remote_port, false, message, local_port_id);
+}
+
+int message_port_send_trusted_message_with_local_port(
+    const char* remote_app_id, const char* remote_port, bundle* message,
+    int local_port_id) {
+  return Send(remote_app_id, remote_port, true, message, local_port_id);
+}
+
+int message_port_add_registered_cb(
+    const char* remote_app_id, const char* remote_port,
+    bool trusted_remote_port, message_port_registration_event_cb callback,
+    void* user_data, int* watcher_id) {
+  return AddWatcher(remote_app_id, remote_port, trusted_remote_port, true,
+                    callback, user_data, watcher_id);
+}
+
+int message_port_add_unregistered_cb(
+    const char* remote_app_id, const char* remote_port,
+    bool trusted_remote_port, message_port_registration_event_cb callback,
+    void* user_data, int* watcher_id) {
+  return AddWatcher(remote_app_id, remote_port, trusted_remote_port, false,
+                    callback, user_data, watcher_id);
+}
+
+int message_port_remove_registration_event_cb(int watcher_id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  return watchers.erase(watcher_id) ? MESSAGE_PORT_ERROR_NONE
+                                    : MESSAGE_PORT_ERROR_INVALID_PARAMETER;
+}
+
+void message_port_host_set_send_delay_us(int delay_us) {
+  send_delay_us = delay_us;
+}
+
+const char* get_error_message(int err) {
+  switch (err) {
+    case MESSAGE_PORT_ERROR_NONE:
+      return "Successful";
+    case MESSAGE_PORT_ERROR_IO_ERROR:
+      return "IO error";
+    case MESSAGE_PORT_ERROR_OUT_OF_MEMORY:
+      return "Out of memory";
+    case MESSAGE_PORT_ERROR_INVALID_PARAMETER:
+      return "Invalid parameter";
+    case MESSAGE_PORT_ERROR_PORT_NOT_FOUND:
+      return "The message port of the remote application is not found";
+    case MESSAGE_PORT_ERROR_CERTIFICATE_NOT_MATCH:
+      return "The remote application is not signed with the same "
+             "certificate";
+    case MESSAGE_PORT_ERROR_MAX_EXCEEDED:
+      return "The size of the message has exceeded the maximum limit";
+    case MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE:
+      return "Resource is temporarily unavailable";
+    default:
+      return "Unknown error";
+  }
+}
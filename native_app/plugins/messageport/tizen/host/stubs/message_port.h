@@ -0,0 +1,92 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Stand-in for the message port API, for host builds. Ports live in this
+// process, under the id returned by app_get_id. Sent bundles are encoded on
+// the sending thread and decoded and delivered on the main loop, as the
+// message port daemon would.
+
+#ifndef HOST_STUBS_MESSAGE_PORT_H
+#define HOST_STUBS_MESSAGE_PORT_H
+
+#include <bundle.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TIZEN_ERROR_MESSAGE_PORT -0x01130000
+
+typedef enum {
+  MESSAGE_PORT_ERROR_NONE = 0,
+  MESSAGE_PORT_ERROR_IO_ERROR = -5,
+  MESSAGE_PORT_ERROR_OUT_OF_MEMORY = -12,
+  MESSAGE_PORT_ERROR_INVALID_PARAMETER = -22,
+  MESSAGE_PORT_ERROR_PORT_NOT_FOUND = TIZEN_ERROR_MESSAGE_PORT | 0x01,
+  MESSAGE_PORT_ERROR_CERTIFICATE_NOT_MATCH = TIZEN_ERROR_MESSAGE_PORT | 0x02,
+  MESSAGE_PORT_ERROR_MAX_EXCEEDED = TIZEN_ERROR_MESSAGE_PORT | 0x03,
+  MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE = TIZEN_ERROR_MESSAGE_PORT | 0x04,
+} message_port_error_e;
+
+typedef void (*message_port_message_cb)(int local_port_id,
+                                        const char* remote_app_id,
+                                        const char* remote_port,
+                                        bool trusted_remote_port,
+                                        bundle* message, void* user_data);
+typedef message_port_message_cb message_port_trusted_message_cb;
+typedef void (*message_port_registration_event_cb)(const char* remote_app_id,
+                                                   const char* remote_port,
+                                                   bool trusted_remote_port,
+                                                   void* user_data);
+
+int message_port_register_local_port(const char* local_port,
+                                     message_port_message_cb callback,
+                                     void* user_data);
+int message_port_register_trusted_local_port(
+    const char* trusted_local_port, message_port_trusted_message_cb callback,
+    void* user_data);
+int message_port_unregister_local_port(int local_port_id);
+int message_port_unregister_trusted_local_port(int trusted_local_port_id);
+
+int message_port_check_remote_port(const char* remote_app_id,
+                                   const char* remote_port, bool* exist);
+int message_port_check_trusted_remote_port(const char* remote_app_id,
+                                           const char* remote_port,
+                                           bool* exist);
+
+int message_port_send_message(const char* remote_app_id,
+                              const char* remote_port, bundle* message);
+int message_port_send_trusted_message(const char* remote_app_id,
+                                      const char* remote_port,
+                                      bundle* message);
+int message_port_send_message_with_local_port(const char* remote_app_id,
+                                              const char* remote_port,
+                                              bundle* message,
+                                              int local_port_id);
+int message_port_send_trusted_message_with_local_port(
+    const char* remote_app_id, const char* remote_port, bundle* message,
+    int local_port_id);
+
+int message_port_add_registered_cb(
+    const char* remote_app_id, const char* remote_port,
+    bool trusted_remote_port, message_port_registration_event_cb callback,
+    void* user_data, int* watcher_id);
+int message_port_add_unregistered_cb(
+    const char* remote_app_id, const char* remote_port,
+    bool trusted_remote_port, message_port_registration_event_cb callback,
+    void* user_data, int* watcher_id);
+int message_port_remove_registration_event_cb(int watcher_id);
+
+const char* get_error_message(int err);
+
+// Host only. Makes each send take at least |delay_us| on the sending
+// thread, as sending to a slow receiver would.
+void message_port_host_set_send_delay_us(int delay_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // HOST_STUBS_MESSAGE_PORT_H
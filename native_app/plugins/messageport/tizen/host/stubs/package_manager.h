@@ -0,0 +1,42 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Stand-in for certificate checks of the package manager, for host builds.
+// Applications are all taken to be signed with the same certificate,
+// unless package_manager_host_set_cert_match says otherwise.
+
+#ifndef HOST_STUBS_PACKAGE_MANAGER_H
+#define HOST_STUBS_PACKAGE_MANAGER_H
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  PACKAGE_MANAGER_ERROR_NONE = 0,
+  PACKAGE_MANAGER_ERROR_INVALID_PARAMETER = -22,
+} package_manager_error_e;
+
+typedef enum {
+  PACKAGE_MANAGER_COMPARE_MATCH = 0,
+  PACKAGE_MANAGER_COMPARE_MISMATCH,
+  PACKAGE_MANAGER_COMPARE_LHS_NO_CERT,
+  PACKAGE_MANAGER_COMPARE_RHS_NO_CERT,
+  PACKAGE_MANAGER_COMPARE_BOTH_NO_CERT,
+} package_manager_compare_result_type_e;
+
+int package_manager_compare_app_cert_info(
+    const char* lhs_app_id, const char* rhs_app_id,
+    package_manager_compare_result_type_e* compare_result);
+
+// Host only. Makes certificates of all applications compare as |match|.
+void package_manager_host_set_cert_match(bool match);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // HOST_STUBS_PACKAGE_MANAGER_H
@@ -0,0 +1,145 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <app_common.h>
+#include <app_manager.h>
+#include <dlog.h>
+#include <package_manager.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace {
+
+constexpr char kDefaultAppId[] = "org.tizen.messageport_host";
+
+std::atomic<bool> cert_match{true};
+
+log_priority MinPriority() {
+  static const log_priority min_priority = [] {
+    const char* level = getenv("MESSAGEPORT_LOG");
+    if (nullptr == level) {
+      return DLOG_ERROR;
+    }
+    if (strcmp(level, "debug") == 0) {
+      return DLOG_DEBUG;
+    }
+    if (strcmp(level, "info") == 0) {
+      return DLOG_INFO;
+    }
+    if (strcmp(level, "warn") == 0) {
+      return DLOG_WARN;
+    }
+    return DLOG_ERROR;
+  }();
+  return min_priority;
+}
+
+const std::string& RootPath() {
+  static const std::string root = [] {
+    const char* root = getenv("MESSAGEPORT_HOST_ROOT");
+    std::string path = root ? root
+                            : "/tmp/messageport_host." +
+                                  std::to_string(getpid());
+    mkdir(path.c_str(), 0700);
+    return path + "/";
+  }();
+  return root;
+}
+
+char* Directory(const char* name) {
+  std::string path = RootPath() + name;
+  // Parents first, for nested names.
+  for (size_t slash = path.find('/', RootPath().size());
+       slash != std::string::npos; slash = path.find('/', slash + 1)) {
+    mkdir(path.substr(0, slash).c_str(), 0700);
+  }
+  mkdir(path.c_str(), 0700);
+  return strdup((path + "/").c_str());
+}
+
+}  // namespace
+
+int dlog_print(log_priority prio, const char* tag, const char* fmt, ...) {
+  if (prio < MinPriority()) {
+    return 0;
+  }
+  static const char kLevels[] = "??VDIWEFS";
+  va_list args;
+  va_start(args, fmt);
+  fprintf(stderr, "%c/%s: ", kLevels[prio], tag);
+  int written = vfprintf(stderr, fmt, args);
+  fputc('\n', stderr);
+  va_end(args);
+  return written;
+}
+
+int app_get_id(char** id) {
+  if (nullptr == id) {
+    return APP_ERROR_INVALID_PARAMETER;
+  }
+  const char* app_id = getenv("MESSAGEPORT_HOST_APP_ID");
+  *id = strdup(app_id ? app_id : kDefaultAppId);
+  return APP_ERROR_NONE;
+}
+
+int app_manager_get_app_id(pid_t pid, char** app_id) {
+  if (nullptr == app_id) {
+    return APP_MANAGER_ERROR_INVALID_PARAMETER;
+  }
+  if (pid == getpid()) {
+    return app_get_id(app_id);
+  }
+  std::ifstream file("/proc/" + std::to_string(pid) + "/environ",
+                     std::ios::binary);
+  if (!file) {
+    return APP_MANAGER_ERROR_NO_SUCH_APP;
+  }
+  // Variables are separated by NULs.
+  std::string environment((std::istreambuf_iterator<char>(file)),
+                          std::istreambuf_iterator<char>());
+  static const std::string kVariable = "MESSAGEPORT_HOST_APP_ID=";
+  std::string id = kDefaultAppId;
+  size_t start = 0;
+  while (start < environment.size()) {
+    size_t end = std::min(environment.find('\0', start), environment.size());
+    if (environment.compare(start, kVariable.size(), kVariable) == 0) {
+      id = environment.substr(start + kVariable.size(),
+                              end - start - kVariable.size());
+      break;
+    }
+    start = end + 1;
+  }
+  *app_id = strdup(id.c_str());
+  return APP_MANAGER_ERROR_NONE;
+}
+
+char* app_get_resource_path(void) { return Directory("res"); }
+
+char* app_get_data_path(void) { return Directory("data"); }
+
+char* app_get_shared_trusted_path(void) { return Directory("shared/trusted"); }
+
+int package_manager_compare_app_cert_info(
+    const char* lhs_app_id, const char* rhs_app_id,
+    package_manager_compare_result_type_e* compare_result) {
+  if (nullptr == lhs_app_id || nullptr == rhs_app_id ||
+      nullptr == compare_result) {
+    return PACKAGE_MANAGER_ERROR_INVALID_PARAMETER;
+  }
+  *compare_result = cert_match ? PACKAGE_MANAGER_COMPARE_MATCH
+                               : PACKAGE_MANAGER_COMPARE_MISMATCH;
+  return PACKAGE_MANAGER_ERROR_NONE;
+}
+
+void package_manager_host_set_cert_match(bool match) { cert_match = match; }
@@ -0,0 +1,68 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <cstdint>
+#include <vector>
+
+#include "loopback.h"
+#include "message_pools.h"
+#include "messageport.h"
+#include "test.h"
+
+namespace {
+
+constexpr size_t kWarmupMessages = 64;
+constexpr size_t kMessages = 256;
+
+std::vector<uint8_t> Payload(size_t seq) {
+  return std::vector<uint8_t>(1024, static_cast<uint8_t>(seq));
+}
+
+// Returns how many objects the pools had to create.
+size_t Created(const AllocationStats& stats) {
+  return stats.bundles_created + stats.events_created + stats.buffer_growths;
+}
+
+TEST(SendsAndReceivesReusePooledObjects) {
+  Loopback loopback;
+  MessagePortManager& manager = loopback.manager();
+  int port = loopback.OpenPort("pooled");
+  for (size_t seq = 0; seq < kWarmupMessages; seq++) {
+    REQUIRE(manager.Send(port, Payload(seq)));
+    REQUIRE(loopback.WaitForMessages("pooled", seq + 1));
+  }
+
+  AllocationStats before = manager.GetAllocationStats();
+  for (size_t seq = 0; seq < kMessages; seq++) {
+    REQUIRE(manager.Send(port, Payload(seq)));
+    REQUIRE(loopback.WaitForMessages("pooled", kWarmupMessages + seq + 1));
+  }
+  AllocationStats after = manager.GetAllocationStats();
+  EXPECT_EQ(Created(after), Created(before));
+  EXPECT_EQ(after.bundles_reused - before.bundles_reused, kMessages);
+  EXPECT(after.events_reused - before.events_reused >= kMessages);
+}
+
+TEST(AsyncSendsReusePooledObjects) {
+  Loopback loopback;
+  MessagePortManager& manager = loopback.manager();
+  int port = loopback.OpenPort("pooled");
+  auto send_all = [&](size_t count, size_t received) {
+    for (size_t seq = 0; seq < count; seq++) {
+      REQUIRE(manager.SendAsync(port, Payload(seq),
+                                MessagePortManager::kNoLocalPort,
+                                [](MessagePortResult result) {
+                                  EXPECT(result);
+                                }));
+      REQUIRE(loopback.WaitForMessages("pooled", received + seq + 1));
+    }
+  };
+  send_all(kWarmupMessages, 0);
+
+  AllocationStats before = manager.GetAllocationStats();
+  send_all(kMessages, kWarmupMessages);
+  EXPECT_EQ(Created(manager.GetAllocationStats()), Created(before));
+}
+
+}  // namespace
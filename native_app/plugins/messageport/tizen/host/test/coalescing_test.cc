@@ -0,0 +1,73 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <Ecore.h>
+#include <message_port.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "loopback.h"
+#include "messageport.h"
+#include "test.h"
+
+namespace {
+
+// Iterates the main loop until |results| holds |count| results.
+bool WaitForResults(const std::vector<MessagePortResult>& results,
+                    size_t count) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (results.size() < count) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    ecore_main_loop_iterate();
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  return true;
+}
+
+TEST(CoalescedSendsCompleteOnceTheirBatchIsSent) {
+  std::vector<MessagePortResult> results;
+  Loopback loopback;
+  MessagePortManager& manager = loopback.manager();
+  int port = loopback.OpenPort("batch");
+  // Batches are sent once full.
+  REQUIRE(manager.SetCoalescing(port, 2, 10 * 1000 * 1000));
+
+  auto on_done = [&results](MessagePortResult result) {
+    results.push_back(result);
+  };
+  REQUIRE(manager.SendAsync(port, {1}, MessagePortManager::kNoLocalPort,
+                            on_done));
+  ecore_main_loop_iterate();
+  EXPECT(results.empty());
+  REQUIRE(manager.SendAsync(port, {2}, MessagePortManager::kNoLocalPort,
+                            on_done));
+  REQUIRE(WaitForResults(results, 2));
+  EXPECT(results[0]);
+  EXPECT(results[1]);
+  EXPECT(loopback.WaitForMessages("batch", 2));
+}
+
+TEST(FailuresOfCoalescedSendsReachTheirCallbacks) {
+  std::vector<MessagePortResult> results;
+  Loopback loopback;
+  MessagePortManager& manager = loopback.manager();
+  int port = loopback.OpenRemote("absent");
+  REQUIRE(manager.SetCoalescing(port, 2, 10 * 1000 * 1000));
+
+  for (uint8_t i = 1; i <= 2; i++) {
+    REQUIRE(manager.SendAsync(
+        port, {i}, MessagePortManager::kNoLocalPort,
+        [&results](MessagePortResult result) { results.push_back(result); }));
+  }
+  REQUIRE(WaitForResults(results, 2));
+  for (const MessagePortResult& result : results) {
+    EXPECT_EQ(result.error_code, MESSAGE_PORT_ERROR_PORT_NOT_FOUND);
+  }
+}
+
+}  // namespace
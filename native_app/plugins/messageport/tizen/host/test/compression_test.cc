@@ -0,0 +1,153 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "compression.h"
+
+#include <Ecore.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "loopback.h"
+#include "messageport.h"
+#include "test.h"
+
+namespace {
+
+// Compressible, and above any threshold used here.
+const std::vector<uint8_t> kPayload(4096, 'a');
+
+// Runs the main loop long enough for an offer and its acceptance.
+void ExchangeOffer() {
+  for (int i = 0; i < 10; i++) {
+    ecore_main_loop_iterate();
+  }
+}
+
+TEST(PayloadsRoundTripWithADictionary) {
+  std::vector<uint8_t> dictionary(64, 'a');
+  PayloadCompressor compressor(16, dictionary);
+  std::vector<uint8_t> compressed;
+  // Not confirmed by the receiver yet.
+  EXPECT(!compressor.Compress(kPayload, compressed));
+  compressor.Confirm();
+  // Below the threshold.
+  EXPECT(!compressor.Compress(std::vector<uint8_t>(8, 'a'), compressed));
+  REQUIRE(compressor.Compress(kPayload, compressed));
+  EXPECT(compressed.size() < kPayload.size());
+
+  PayloadDecompressor decompressor;
+  std::vector<uint8_t> decompressed;
+  EXPECT(!decompressor.HasDictionary(compressor.dictionary_id()));
+  EXPECT(!decompressor.Decompress(compressed.data(), compressed.size(),
+                                  decompressed));
+  decompressor.AddDictionary(dictionary);
+  EXPECT(decompressor.HasDictionary(compressor.dictionary_id()));
+  REQUIRE(decompressor.Decompress(compressed.data(), compressed.size(),
+                                  decompressed));
+  EXPECT(decompressed == kPayload);
+  // Truncated payloads are rejected.
+  EXPECT(!decompressor.Decompress(compressed.data(), compressed.size() / 2,
+                                  decompressed));
+}
+
+TEST(CompressionStartsOnceTheReceiverAccepts) {
+  Loopback loopback;
+  MessagePortManager& manager = loopback.manager();
+  int local_port = loopback.Listen("compressed");
+  int reply_port = loopback.Listen("compressed_reply");
+  int remote_port = loopback.OpenRemote("compressed");
+  REQUIRE(manager.SetCompression(remote_port, true, 0, {}, reply_port));
+
+  // Sent before the offer is accepted.
+  REQUIRE(manager.Send(remote_port, kPayload));
+  ExchangeOffer();
+  REQUIRE(manager.Send(remote_port, kPayload));
+  REQUIRE(loopback.WaitForMessages("compressed", 2));
+
+  EXPECT(loopback.received("compressed")[0] == kPayload);
+  EXPECT(loopback.received("compressed")[1] == kPayload);
+  // The acceptance is not delivered as a message.
+  EXPECT(loopback.received("compressed_reply").empty());
+  CompressionStats stats;
+  REQUIRE(manager.GetCompressionStats(remote_port, &stats));
+  EXPECT_EQ(stats.messages, 2u);
+  EXPECT_EQ(stats.compressed_messages, 1u);
+  REQUIRE(manager.GetDecompressionStats(local_port, &stats));
+  EXPECT_EQ(stats.compressed_messages, 1u);
+}
+
+TEST(CompressionWithAnUnknownDictionaryIsDeclined) {
+  Loopback loopback;
+  MessagePortManager& manager = loopback.manager();
+  loopback.Listen("dictionary");
+  int reply_port = loopback.Listen("dictionary_reply");
+  int remote_port = loopback.OpenRemote("dictionary");
+  REQUIRE(manager.SetCompression(remote_port, true, 0,
+                                 std::vector<uint8_t>(64, 'a'), reply_port));
+  ExchangeOffer();
+
+  REQUIRE(manager.Send(remote_port, kPayload));
+  REQUIRE(loopback.WaitForMessages("dictionary", 1));
+  EXPECT(loopback.received("dictionary")[0] == kPayload);
+  CompressionStats stats;
+  REQUIRE(manager.GetCompressionStats(remote_port, &stats));
+  EXPECT_EQ(stats.compressed_messages, 0u);
+}
+
+TEST(CompressionIsOfferedAgainWhenItChanges) {
+  Loopback loopback;
+  MessagePortManager& manager = loopback.manager();
+  int local_port = loopback.Listen("changed");
+  int reply_port = loopback.Listen("changed_reply");
+  int remote_port = loopback.OpenRemote("changed");
+  std::vector<uint8_t> dictionary(64, 'a');
+  REQUIRE(manager.AddCompressionDictionary(local_port, dictionary));
+  REQUIRE(manager.SetCompression(remote_port, true, 0, {}, reply_port));
+  // Replaces the offer before it is accepted.
+  REQUIRE(manager.SetCompression(remote_port, true, 0, dictionary,
+                                 reply_port));
+  ExchangeOffer();
+
+  REQUIRE(manager.Send(remote_port, kPayload));
+  REQUIRE(loopback.WaitForMessages("changed", 1));
+  EXPECT(loopback.received("changed")[0] == kPayload);
+  CompressionStats stats;
+  REQUIRE(manager.GetCompressionStats(remote_port, &stats));
+  EXPECT_EQ(stats.compressed_messages, 1u);
+}
+
+TEST(BroadcastsAreCompressedForEachPort) {
+  Loopback loopback;
+  MessagePortManager& manager = loopback.manager();
+  loopback.Listen("broadcast_compressed");
+  int reply_port = loopback.Listen("broadcast_reply");
+  int compressed_port = loopback.OpenRemote("broadcast_compressed");
+  int plain_port = loopback.OpenPort("broadcast_plain");
+  REQUIRE(manager.SetCompression(compressed_port, true, 0, {}, reply_port));
+  ExchangeOffer();
+
+  bool done = false;
+  REQUIRE(manager.Broadcast(
+      {compressed_port, plain_port}, kPayload,
+      [&done](std::vector<MessagePortResult> results) {
+        EXPECT_EQ(results.size(), 2u);
+        for (const auto& result : results) {
+          EXPECT(result);
+        }
+        done = true;
+      }));
+  REQUIRE(loopback.WaitForMessages("broadcast_compressed", 1));
+  REQUIRE(loopback.WaitForMessages("broadcast_plain", 1));
+  while (!done) {
+    ecore_main_loop_iterate();
+  }
+  EXPECT(loopback.received("broadcast_compressed")[0] == kPayload);
+  EXPECT(loopback.received("broadcast_plain")[0] == kPayload);
+  CompressionStats stats;
+  REQUIRE(manager.GetCompressionStats(compressed_port, &stats));
+  EXPECT_EQ(stats.compressed_messages, 1u);
+}
+
+}  // namespace
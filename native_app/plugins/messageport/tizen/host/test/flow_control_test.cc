@@ -0,0 +1,116 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <Ecore.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "loopback.h"
+#include "messageport.h"
+#include "test.h"
+
+namespace {
+
+// Records events of a local port, one list per call of the sink. Messages
+// are recorded by their first byte, queue pressure events as "above" or
+// "below".
+class EventLog : public flutter::EventSink<flutter::EncodableValue> {
+ public:
+  explicit EventLog(std::vector<std::vector<std::string>>* calls)
+      : calls_(calls) {}
+
+ protected:
+  void SuccessInternal(const flutter::EncodableValue* event) override {
+    std::vector<std::string> call;
+    if (const auto* list = std::get_if<flutter::EncodableList>(event)) {
+      for (const auto& entry : *list) {
+        call.push_back(Describe(entry));
+      }
+    } else {
+      call.push_back(Describe(*event));
+    }
+    calls_->push_back(std::move(call));
+  }
+  void ErrorInternal(const std::string& error_code,
+                     const std::string& error_message,
+                     const flutter::EncodableValue* error_details) override {
+    test::Fail(__FILE__, __LINE__, error_code + ": " + error_message);
+  }
+  void EndOfStreamInternal() override {}
+
+ private:
+  static std::string Describe(const flutter::EncodableValue& event) {
+    const auto& map = std::get<flutter::EncodableMap>(event);
+    auto pressure = map.find(flutter::EncodableValue("queuePressure"));
+    if (pressure != map.end()) {
+      const auto& values = std::get<flutter::EncodableMap>(pressure->second);
+      return std::get<bool>(
+                 values.at(flutter::EncodableValue("aboveHighWaterMark")))
+                 ? "above"
+                 : "below";
+    }
+    const auto& bytes = std::get<std::vector<uint8_t>>(
+        map.at(flutter::EncodableValue("encodedMessage")));
+    return std::to_string(bytes[0]);
+  }
+
+  std::vector<std::vector<std::string>>* calls_;
+};
+
+// Iterates the main loop until the sink was called |count| times.
+bool WaitForCalls(const std::vector<std::vector<std::string>>& calls,
+                  size_t count) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (calls.size() < count) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    ecore_main_loop_iterate();
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  return true;
+}
+
+TEST(QueuePressureIsBatchedWithMessages) {
+  // Outlives the manager, which flushes batches when destroyed.
+  std::vector<std::vector<std::string>> calls;
+  Loopback loopback;
+  MessagePortManager& manager = loopback.manager();
+  int local_port = -1;
+  REQUIRE(manager.RegisterLocalPort("pressure",
+                                    std::make_unique<EventLog>(&calls), false,
+                                    TransportType::kMessagePort, &local_port));
+  // Batches are sent once full.
+  REQUIRE(manager.SetInboundBatching(local_port, 2, 10 * 1000 * 1000));
+  REQUIRE(manager.SetFlowControl(local_port, 2, 1,
+                                 OverflowPolicy::kDropNewest, ""));
+  int remote_port = loopback.OpenRemote("pressure");
+
+  for (uint8_t i = 1; i <= 3; i++) {
+    REQUIRE(manager.Send(remote_port, {i}));
+  }
+  REQUIRE(WaitForCalls(calls, 1));
+  EXPECT(calls[0] == std::vector<std::string>({"1", "above"}));
+
+  REQUIRE(manager.AckDelivered(local_port, 1));
+  REQUIRE(calls.size() == 2u);
+  EXPECT(calls[1] == std::vector<std::string>({"2", "below"}));
+
+  // Messages reuse the released queue pressure events.
+  REQUIRE(manager.AckDelivered(local_port, 1));
+  REQUIRE(manager.Send(remote_port, {4}));
+  for (int i = 0; i < 100000 && calls.size() < 3; i++) {
+    ecore_main_loop_iterate();
+    manager.AckDelivered(local_port, 1);
+  }
+  REQUIRE(calls.size() == 3u);
+  EXPECT(calls[2] == std::vector<std::string>({"3", "4"}));
+}
+
+}  // namespace
@@ -0,0 +1,115 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Helpers for tests which send through a MessagePortManager.
+
+#ifndef HOST_TEST_LOOPBACK_H
+#define HOST_TEST_LOOPBACK_H
+
+#include <Ecore.h>
+#include <app_common.h>
+#include <message_port.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "messageport.h"
+#include "test.h"
+
+// Records payloads of message events sent to a local port.
+class RecordingSink : public flutter::EventSink<flutter::EncodableValue> {
+ public:
+  explicit RecordingSink(std::vector<std::vector<uint8_t>>* payloads)
+      : payloads_(payloads) {}
+
+ protected:
+  void SuccessInternal(const flutter::EncodableValue* event) override {
+    const auto& map = std::get<flutter::EncodableMap>(*event);
+    payloads_->push_back(std::get<std::vector<uint8_t>>(
+        map.at(flutter::EncodableValue("encodedMessage"))));
+  }
+  void ErrorInternal(const std::string& error_code,
+                     const std::string& error_message,
+                     const flutter::EncodableValue* error_details) override {
+    test::Fail(__FILE__, __LINE__, error_code + ": " + error_message);
+  }
+  void EndOfStreamInternal() override {}
+
+ private:
+  std::vector<std::vector<uint8_t>>* payloads_;
+};
+
+// A manager sending to local ports of its own, on the main loop of the
+// calling thread.
+class Loopback {
+ public:
+  Loopback() {
+    ecore_init();
+    char* app_id = nullptr;
+    app_get_id(&app_id);
+    app_id_ = app_id;
+    free(app_id);
+    manager_ = std::make_unique<MessagePortManager>();
+  }
+
+  ~Loopback() {
+    message_port_host_set_send_delay_us(0);
+    manager_.reset();
+    // Runs completions left by the sender threads.
+    ecore_main_loop_iterate();
+    ecore_shutdown();
+  }
+
+  MessagePortManager& manager() { return *manager_; }
+
+  // Registers local port |name|, recording messages sent to it. Returns
+  // its handle.
+  int Listen(const std::string& name) {
+    int local_port = -1;
+    EXPECT(manager_->RegisterLocalPort(
+        name, std::make_unique<RecordingSink>(&received_[name]), false,
+        TransportType::kMessagePort, &local_port));
+    return local_port;
+  }
+
+  // Returns the handle of the remote port sending to local port |name|.
+  int OpenRemote(const std::string& name) {
+    return manager_->OpenRemotePort({app_id_, name, false});
+  }
+
+  int OpenPort(const std::string& name) {
+    Listen(name);
+    return OpenRemote(name);
+  }
+
+  // Iterates the main loop until |count| messages came to |name|.
+  bool WaitForMessages(const std::string& name, size_t count) {
+    auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    while (received_[name].size() < count) {
+      if (std::chrono::steady_clock::now() > deadline) {
+        return false;
+      }
+      ecore_main_loop_iterate();
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return true;
+  }
+
+  const std::vector<std::vector<uint8_t>>& received(const std::string& name) {
+    return received_[name];
+  }
+
+ private:
+  std::string app_id_;
+  std::unique_ptr<MessagePortManager> manager_;
+  std::map<std::string, std::vector<std::vector<uint8_t>>> received_;
+};
+
+#endif  // HOST_TEST_LOOPBACK_H
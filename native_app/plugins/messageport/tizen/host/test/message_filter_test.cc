@@ -0,0 +1,124 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "message_filter.h"
+
+#include <flutter/standard_message_codec.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+
+using flutter::EncodableList;
+using flutter::EncodableMap;
+using flutter::EncodableValue;
+
+std::vector<uint8_t> Encode(const EncodableValue& message) {
+  return *flutter::StandardMessageCodec::GetInstance().EncodeMessage(message);
+}
+
+// A message with a nested map and list before |key|, so that peeking has
+// to skip them.
+std::vector<uint8_t> Message(const EncodableValue& type) {
+  return Encode(EncodableValue(EncodableMap{
+      {EncodableValue("nested"),
+       EncodableValue(EncodableMap{
+           {EncodableValue("list"),
+            EncodableValue(EncodableList{EncodableValue(1.5),
+                                         EncodableValue("text")})}})},
+      {EncodableValue("type"), type},
+  }));
+}
+
+bool Matches(const MessageFilter& filter, const std::vector<uint8_t>& data,
+             const char* remote_app_id = "app", bool trusted = false) {
+  return filter.Matches(data.data(), data.size(), remote_app_id, trusted);
+}
+
+TEST(FiltersMatchTheValueOfAKey) {
+  MessageFilter filter;
+  REQUIRE(MessageFilter::Create(
+      EncodableValue(EncodableMap{
+          {EncodableValue("key"), EncodableValue("type")},
+          {EncodableValue("value"), EncodableValue("update")},
+      }),
+      &filter));
+  EXPECT(Matches(filter, Message(EncodableValue("update"))));
+  EXPECT(!Matches(filter, Message(EncodableValue("other"))));
+  EXPECT(!Matches(filter, Message(EncodableValue(1))));
+  EXPECT(!Matches(filter, Encode(EncodableValue("not a map"))));
+  // Truncated messages do not match.
+  std::vector<uint8_t> truncated = Message(EncodableValue("update"));
+  truncated.resize(truncated.size() - 3);
+  EXPECT(!Matches(filter, truncated));
+}
+
+TEST(FiltersMatchIntAndBoolValues) {
+  MessageFilter ints;
+  REQUIRE(MessageFilter::Create(
+      EncodableValue(EncodableMap{
+          {EncodableValue("key"), EncodableValue("type")},
+          {EncodableValue("value"), EncodableValue(int64_t{1} << 40)},
+      }),
+      &ints));
+  EXPECT(Matches(ints, Message(EncodableValue(int64_t{1} << 40))));
+  EXPECT(!Matches(ints, Message(EncodableValue(1))));
+
+  MessageFilter bools;
+  REQUIRE(MessageFilter::Create(
+      EncodableValue(EncodableMap{
+          {EncodableValue("key"), EncodableValue("type")},
+          {EncodableValue("value"), EncodableValue(true)},
+      }),
+      &bools));
+  EXPECT(Matches(bools, Message(EncodableValue(true))));
+  EXPECT(!Matches(bools, Message(EncodableValue(false))));
+}
+
+TEST(FiltersMatchTheSender) {
+  MessageFilter filter;
+  REQUIRE(MessageFilter::Create(
+      EncodableValue(EncodableMap{
+          {EncodableValue("remoteAppIds"),
+           EncodableValue(EncodableList{EncodableValue("a"),
+                                        EncodableValue("b")})},
+          {EncodableValue("trusted"), EncodableValue(true)},
+      }),
+      &filter));
+  std::vector<uint8_t> message = Message(EncodableValue());
+  EXPECT(Matches(filter, message, "b", true));
+  EXPECT(!Matches(filter, message, "b", false));
+  EXPECT(!Matches(filter, message, "c", true));
+}
+
+TEST(MalformedFiltersAreRejected) {
+  MessageFilter filter;
+  EXPECT(!MessageFilter::Create(EncodableValue("filter"), &filter));
+  EXPECT(!MessageFilter::Create(
+      EncodableValue(EncodableMap{
+          {EncodableValue("remoteAppIds"), EncodableValue("a")},
+      }),
+      &filter));
+  // An empty filter matches everything.
+  REQUIRE(MessageFilter::Create(EncodableValue(EncodableMap{}), &filter));
+  EXPECT(Matches(filter, Encode(EncodableValue(1))));
+}
+
+TEST(PeekingFindsTheEncodedValue) {
+  std::vector<uint8_t> message = Message(EncodableValue("update"));
+  const uint8_t* value = nullptr;
+  size_t value_size = 0;
+  REQUIRE(PeekMapValue(message.data(), message.size(), "type", &value,
+                       &value_size));
+  std::vector<uint8_t> expected = Encode(EncodableValue("update"));
+  EXPECT(std::vector<uint8_t>(value, value + value_size) == expected);
+  EXPECT(!PeekMapValue(message.data(), message.size(), "absent", &value,
+                       &value_size));
+}
+
+}  // namespace
@@ -0,0 +1,146 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "outbox.h"
+
+#include <app_common.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+
+constexpr char kKey[] = "org.tizen.peer/port";
+
+// Returns a path for a new log named |name|.
+std::string LogPath(const std::string& name) {
+  char* directory = app_get_data_path();
+  std::string path = std::string(directory) + name + ".outbox";
+  free(directory);
+  unlink(path.c_str());
+  return path;
+}
+
+std::vector<uint8_t> Message(const std::string& text) {
+  return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+// Returns the messages of a batch read by Outbox::ReadBatch.
+std::vector<std::string> Messages(const std::vector<uint8_t>& batch) {
+  std::vector<std::string> messages;
+  size_t offset = 0;
+  while (offset + sizeof(uint32_t) <= batch.size()) {
+    uint32_t size;
+    memcpy(&size, batch.data() + offset, sizeof(size));
+    offset += sizeof(size);
+    messages.emplace_back(batch.begin() + offset,
+                          batch.begin() + offset + size);
+    offset += size;
+  }
+  return messages;
+}
+
+// Reads and consumes every pending message.
+std::vector<std::string> Drain(Outbox& outbox) {
+  std::vector<std::string> messages;
+  while (!outbox.empty()) {
+    std::vector<uint8_t> batch;
+    uint64_t cursor = outbox.ReadBatch(batch, 1 << 20);
+    for (auto& message : Messages(batch)) {
+      messages.push_back(std::move(message));
+    }
+    outbox.Consume(cursor);
+  }
+  return messages;
+}
+
+TEST(OutboxCompactsIntoANewFile) {
+  std::string path = LogPath("compact");
+  // Room for four 8 byte messages with their record headers.
+  auto outbox = Outbox::Open(path, kKey, 4 * 24, 0);
+  REQUIRE(outbox);
+  for (const char* text : {"message0", "message1", "message2", "message3"}) {
+    auto message = Message(text);
+    EXPECT(outbox->Append(message.data(), message.size()));
+  }
+  std::vector<uint8_t> batch;
+  // Reads only the first message.
+  outbox->Consume(outbox->ReadBatch(batch, 1));
+  EXPECT_EQ(Messages(batch).size(), 1u);
+
+  auto message = Message("message4");
+  REQUIRE(outbox->Append(message.data(), message.size()));
+  EXPECT(access((path + ".new").c_str(), F_OK) != 0);
+  outbox.reset();
+
+  outbox = Outbox::Open(path, kKey, 4 * 24, 0);
+  REQUIRE(outbox);
+  EXPECT_EQ(outbox->pending(), 4u);
+  std::vector<std::string> expected = {"message1", "message2", "message3",
+                                       "message4"};
+  EXPECT(Drain(*outbox) == expected);
+  outbox->Delete();
+}
+
+TEST(OutboxDropsCorruptRecordsOnReopening) {
+  std::string path = LogPath("corrupt");
+  auto outbox = Outbox::Open(path, kKey, 1024, 0);
+  REQUIRE(outbox);
+  for (const char* text : {"first", "second", "third"}) {
+    auto message = Message(text);
+    EXPECT(outbox->Append(message.data(), message.size()));
+  }
+  outbox.reset();
+
+  // Changes a byte of the second message, as a write the kernel had no
+  // time to finish would.
+  std::vector<char> contents;
+  {
+    std::ifstream in(path, std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(in),
+                    std::istreambuf_iterator<char>());
+  }
+  const std::string second = "second";
+  auto found = std::search(contents.begin(), contents.end(), second.begin(),
+                           second.end());
+  REQUIRE(found != contents.end());
+  *found = 'S';
+  {
+    std::ofstream out(path, std::ios::binary);
+    out.write(contents.data(), contents.size());
+  }
+
+  outbox = Outbox::Open(path, kKey, 1024, 0);
+  REQUIRE(outbox);
+  EXPECT_EQ(outbox->pending(), 1u);
+  EXPECT(Drain(*outbox) == std::vector<std::string>{"first"});
+  outbox->Delete();
+}
+
+TEST(OutboxIsEmptyAfterReopeningADrainedLog) {
+  std::string path = LogPath("drained");
+  auto outbox = Outbox::Open(path, kKey, 1024, 0);
+  REQUIRE(outbox);
+  auto message = Message("message");
+  EXPECT(outbox->Append(message.data(), message.size()));
+  EXPECT_EQ(Drain(*outbox).size(), 1u);
+  outbox.reset();
+
+  outbox = Outbox::Open(path, kKey, 1024, 0);
+  REQUIRE(outbox);
+  EXPECT(outbox->empty());
+  EXPECT_EQ(outbox->pending(), 0u);
+  outbox->Delete();
+}
+
+}  // namespace
@@ -0,0 +1,76 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "port_table.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+
+TEST(AppendOnlyTableEntriesKeepTheirAddress) {
+  AppendOnlyTable<int> table;
+  EXPECT(table.Get(0) == nullptr);
+  EXPECT_EQ(table.Add(std::make_unique<int>(0)), 0);
+  int* first = table.Get(0);
+  // Crosses a segment boundary.
+  for (int i = 1; i <= static_cast<int>(AppendOnlyTable<int>::kSegmentSize);
+       i++) {
+    REQUIRE(table.Add(std::make_unique<int>(i)) == i);
+  }
+  EXPECT(table.Get(0) == first);
+  EXPECT_EQ(*table.Get(AppendOnlyTable<int>::kSegmentSize),
+            static_cast<int>(AppendOnlyTable<int>::kSegmentSize));
+  EXPECT(table.Get(-1) == nullptr);
+  EXPECT(table.Get(table.size()) == nullptr);
+}
+
+TEST(AppendOnlyTableIsReadWhileEntriesAreAdded) {
+  constexpr int kEntries = 2000;
+  AppendOnlyTable<int> table;
+  std::atomic<bool> done{false};
+  std::thread reader([&table, &done] {
+    while (!done) {
+      int size = table.size();
+      for (int handle = 0; handle < size; handle++) {
+        int* entry = table.Get(handle);
+        REQUIRE(entry != nullptr);
+        EXPECT_EQ(*entry, handle);
+      }
+    }
+  });
+  for (int i = 0; i < kEntries; i++) {
+    table.Add(std::make_unique<int>(i));
+  }
+  done = true;
+  reader.join();
+  EXPECT_EQ(table.size(), static_cast<size_t>(kEntries));
+}
+
+TEST(SnapshotTableReusesSlotsOfRemovedEntries) {
+  SnapshotTable<int> table;
+  EXPECT_EQ(table.Add(std::make_shared<int>(1)), 0);
+  EXPECT_EQ(table.Add(std::make_shared<int>(2)), 1);
+  std::shared_ptr<int> held = table.Get(0);
+
+  std::shared_ptr<int> removed = table.Remove(0);
+  REQUIRE(removed != nullptr);
+  EXPECT_EQ(*removed, 1);
+  EXPECT(table.Get(0) == nullptr);
+  EXPECT(table.Remove(0) == nullptr);
+  EXPECT(table.Remove(5) == nullptr);
+  // Readers keep removed entries alive.
+  EXPECT_EQ(*held, 1);
+
+  EXPECT_EQ(table.Add(std::make_shared<int>(3)), 0);
+  int sum = 0;
+  table.ForEach([&sum](int& entry) { sum += entry; });
+  EXPECT_EQ(sum, 5);
+}
+
+}  // namespace
@@ -0,0 +1,58 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "priority_lanes.h"
+
+#include <chrono>
+#include <thread>
+
+#include "test.h"
+
+namespace {
+
+constexpr int64_t kNever = 60 * 1000 * 1000;
+
+TEST(LanesPopTheMostUrgentItemFirst) {
+  PriorityLanes<int> lanes({0, kNever, kNever});
+  EXPECT(lanes.empty());
+  lanes.Push(Priority::kLow, 1);
+  lanes.Push(Priority::kNormal, 2);
+  lanes.Push(Priority::kHigh, 3);
+  lanes.Push(Priority::kNormal, 4);
+  EXPECT_EQ(lanes.size(), 4u);
+  EXPECT(lanes.HasQueued(Priority::kHigh));
+
+  EXPECT_EQ(lanes.Pop(), 3);
+  EXPECT(!lanes.HasQueued(Priority::kHigh));
+  EXPECT(lanes.HasQueued(Priority::kNormal));
+  EXPECT_EQ(lanes.Pop(), 2);
+  EXPECT_EQ(lanes.Pop(), 4);
+  EXPECT_EQ(lanes.Pop(), 1);
+  EXPECT(lanes.empty());
+}
+
+TEST(LanesDoNotStarveLessUrgentItems) {
+  PriorityLanes<int> lanes({0, kNever, 1000});
+  lanes.Push(Priority::kLow, 1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  lanes.Push(Priority::kHigh, 2);
+  // The low priority item has waited beyond its limit.
+  EXPECT_EQ(lanes.Pop(), 1);
+  EXPECT_EQ(lanes.Pop(), 2);
+}
+
+TEST(LanesRemoveItemsByPredicate) {
+  PriorityLanes<int> lanes({0, kNever, kNever});
+  for (int i = 0; i < 6; i++) {
+    lanes.Push(i % 2 ? Priority::kNormal : Priority::kLow, i);
+  }
+  lanes.RemoveIf([](int item) { return item % 3 == 0; });
+  EXPECT_EQ(lanes.size(), 4u);
+  EXPECT_EQ(lanes.Pop(), 1);
+  EXPECT_EQ(lanes.Pop(), 5);
+  EXPECT_EQ(lanes.Pop(), 2);
+  EXPECT_EQ(lanes.Pop(), 4);
+}
+
+}  // namespace
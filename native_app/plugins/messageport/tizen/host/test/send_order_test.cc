@@ -0,0 +1,220 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <app_common.h>
+#include <message_port.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "loopback.h"
+#include "messageport.h"
+#include "test.h"
+
+namespace {
+
+constexpr int kSendDelayUs = 2000;
+
+// Payloads are the id of the sending thread and a sequence number.
+std::vector<uint8_t> Payload(uint32_t thread, uint32_t seq) {
+  std::vector<uint8_t> payload(2 * sizeof(uint32_t));
+  memcpy(payload.data(), &thread, sizeof(thread));
+  memcpy(payload.data() + sizeof(thread), &seq, sizeof(seq));
+  return payload;
+}
+
+TEST(SendsFromManyThreadsKeepTheirOrder) {
+  constexpr uint32_t kThreads = 4;
+  constexpr uint32_t kMessages = 300;
+  Loopback loopback;
+  MessagePortManager& manager = loopback.manager();
+  int port = loopback.OpenPort("order");
+
+  std::vector<std::thread> threads;
+  for (uint32_t thread = 0; thread < kThreads; thread++) {
+    threads.emplace_back([&manager, port, thread] {
+      for (uint32_t seq = 0; seq < kMessages; seq++) {
+        std::vector<uint8_t> payload = Payload(thread, seq);
+        // Sync and async sends and broadcasts, interleaved.
+        switch (seq % 3) {
+          case 0:
+            EXPECT(manager.Send(port, payload));
+            break;
+          case 1:
+            while (!manager.SendAsync(
+                port, payload, MessagePortManager::kNoLocalPort,
+                [](MessagePortResult result) { EXPECT(result); })) {
+              std::this_thread::yield();
+            }
+            break;
+          default:
+            while (!manager.Broadcast(
+                {port}, payload, [](std::vector<MessagePortResult> results) {
+                  EXPECT(results[0]);
+                })) {
+              std::this_thread::yield();
+            }
+            break;
+        }
+      }
+    });
+  }
+  bool received = loopback.WaitForMessages("order", kThreads * kMessages);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  REQUIRE(received);
+
+  std::vector<uint32_t> next_seq(kThreads, 0);
+  for (const auto& payload : loopback.received("order")) {
+    uint32_t thread;
+    uint32_t seq;
+    memcpy(&thread, payload.data(), sizeof(thread));
+    memcpy(&seq, payload.data() + sizeof(thread), sizeof(seq));
+    REQUIRE(thread < kThreads);
+    EXPECT_EQ(seq, next_seq[thread]);
+    next_seq[thread] = seq + 1;
+  }
+}
+
+// Messages stored while the port is not registered, including those of
+// sends which found no port, are sent before later ones.
+TEST(SendsToAbsentPortKeepTheirOrder) {
+  constexpr uint32_t kThreads = 2;
+  constexpr uint32_t kMessages = 200;
+  Loopback loopback;
+  MessagePortManager& manager = loopback.manager();
+  int port = loopback.OpenRemote("absent");
+  char* directory = app_get_data_path();
+  REQUIRE(manager.SetOutbox(port, directory, 1 << 20, 0));
+  free(directory);
+
+  std::vector<std::thread> threads;
+  for (uint32_t thread = 0; thread < kThreads; thread++) {
+    threads.emplace_back([&manager, port, thread] {
+      for (uint32_t seq = 0; seq < kMessages; seq++) {
+        std::vector<uint8_t> payload = Payload(thread, seq);
+        if (seq % 2 == 0) {
+          EXPECT(manager.Send(port, payload));
+          continue;
+        }
+        while (!manager.SendAsync(
+            port, payload, MessagePortManager::kNoLocalPort,
+            [](MessagePortResult result) { EXPECT(result); })) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  // The port is registered while messages are being sent.
+  loopback.WaitForMessages("absent", 0);
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  loopback.Listen("absent");
+  bool received = loopback.WaitForMessages("absent", kThreads * kMessages);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  REQUIRE(received);
+  EXPECT_EQ(loopback.received("absent").size(), kThreads * kMessages);
+
+  std::vector<uint32_t> next_seq(kThreads, 0);
+  for (const auto& payload : loopback.received("absent")) {
+    uint32_t thread;
+    uint32_t seq;
+    memcpy(&thread, payload.data(), sizeof(thread));
+    memcpy(&seq, payload.data() + sizeof(thread), sizeof(seq));
+    REQUIRE(thread < kThreads);
+    EXPECT_EQ(seq, next_seq[thread]);
+    next_seq[thread] = seq + 1;
+  }
+}
+
+// Sends to other ports do not wait for a slow send, so throughput grows
+// with the number of ports sent to in parallel.
+TEST(SendsToManyPortsScaleWithThreads) {
+  constexpr uint32_t kPorts = 4;
+  constexpr uint32_t kMessages = 40;
+  Loopback loopback;
+  MessagePortManager& manager = loopback.manager();
+  std::vector<int> ports;
+  for (uint32_t i = 0; i < kPorts; i++) {
+    ports.push_back(loopback.OpenPort("scale" + std::to_string(i)));
+  }
+  message_port_host_set_send_delay_us(kSendDelayUs);
+
+  // Returns the time taken to send kMessages to each of the first
+  // |port_count| ports, from as many threads.
+  auto send_time = [&manager, &ports](uint32_t port_count) {
+    Stopwatch stopwatch;
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < port_count; i++) {
+      threads.emplace_back([&manager, &ports, i] {
+        for (uint32_t seq = 0; seq < kMessages; seq++) {
+          EXPECT(manager.Send(ports[i], Payload(i, seq)));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    return static_cast<double>(stopwatch.ElapsedUs());
+  };
+  double one_port_us = send_time(1);
+  double all_ports_us = send_time(kPorts);
+  EXPECT(kPorts * one_port_us / all_ports_us > kPorts / 2.0);
+
+  // Async sends scale with the sender threads the same way.
+  Stopwatch stopwatch;
+  for (uint32_t seq = 0; seq < kMessages; seq++) {
+    for (uint32_t i = 0; i < kPorts; i++) {
+      REQUIRE(manager.SendAsync(
+          ports[i], Payload(i, seq), MessagePortManager::kNoLocalPort,
+          [](MessagePortResult result) { EXPECT(result); }));
+    }
+  }
+  for (uint32_t i = 0; i < kPorts; i++) {
+    // The first port got messages of both sync rounds.
+    size_t sync_messages = (i == 0 ? 2 : 1) * kMessages;
+    REQUIRE(loopback.WaitForMessages("scale" + std::to_string(i),
+                                     sync_messages + kMessages));
+  }
+  double async_us = static_cast<double>(stopwatch.ElapsedUs());
+  EXPECT(kPorts * one_port_us / async_us > kPorts / 2.0);
+}
+
+// Sync sends on the platform thread wait for background sends to the same
+// port only so long, and the turn they give up does not hold back later
+// sends.
+TEST(PlatformThreadSendsGiveUpBehindSlowSends) {
+  constexpr uint32_t kAsyncMessages = 8;
+  Loopback loopback;
+  MessagePortManager& manager = loopback.manager();
+  int port = loopback.OpenPort("slow");
+  message_port_host_set_send_delay_us(200 * 1000);
+  for (uint32_t seq = 0; seq < kAsyncMessages; seq++) {
+    REQUIRE(manager.SendAsync(
+        port, Payload(0, seq), MessagePortManager::kNoLocalPort,
+        [](MessagePortResult result) { EXPECT(result); }));
+  }
+
+  Stopwatch stopwatch;
+  MessagePortResult result = manager.Send(port, Payload(1, 0));
+  EXPECT_EQ(result.error_code, MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE);
+  EXPECT(stopwatch.ElapsedUs() < 1500 * 1000);
+
+  message_port_host_set_send_delay_us(0);
+  REQUIRE(loopback.WaitForMessages("slow", kAsyncMessages));
+  REQUIRE(manager.Send(port, Payload(1, 1)));
+  REQUIRE(loopback.WaitForMessages("slow", kAsyncMessages + 1));
+  const auto& received = loopback.received("slow");
+  EXPECT_EQ(received.size(), kAsyncMessages + 1);
+  EXPECT(received.back() == Payload(1, 1));
+}
+
+}  // namespace
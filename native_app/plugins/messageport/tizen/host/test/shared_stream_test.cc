@@ -0,0 +1,162 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "shared_stream.h"
+
+#include <app_common.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+
+// Returns a path for a new stream named |name|.
+std::string StreamPath(const std::string& name) {
+  char* directory = app_get_data_path();
+  std::string path = std::string(directory) + name + ".stream";
+  free(directory);
+  unlink(path.c_str());
+  return path;
+}
+
+// Record |index| is |index % 23| bytes of |index|, so that records of
+// different sizes end anywhere in the ring.
+std::vector<uint8_t> Record(uint32_t index) {
+  return std::vector<uint8_t>(index % 23, static_cast<uint8_t>(index));
+}
+
+// Reads |count| records in a child process and exits with 0 if they are
+// the expected ones, in order, and the stream then ends.
+[[noreturn]] void ConsumeInChild(const std::string& path, uint32_t count) {
+  std::unique_ptr<SharedStream> stream = SharedStream::Open(path);
+  if (!stream) {
+    _exit(2);
+  }
+  std::vector<std::vector<uint8_t>> records;
+  uint32_t next = 0;
+  while (stream->Read(records, 100)) {
+    for (const auto& record : records) {
+      if (next >= count || record != Record(next)) {
+        _exit(3);
+      }
+      next++;
+    }
+    records.clear();
+  }
+  _exit(next == count ? 0 : 4);
+}
+
+TEST(RecordsReachAnotherProcessInOrder) {
+  constexpr uint32_t kRecords = 5000;
+  std::string path = StreamPath("order");
+  // Small, so that the ring fills and wraps many times.
+  std::unique_ptr<SharedStream> stream = SharedStream::Create(path, 64);
+  REQUIRE(stream);
+
+  pid_t child = fork();
+  REQUIRE(child >= 0);
+  if (child == 0) {
+    ConsumeInChild(path, kRecords);
+  }
+  for (uint32_t i = 0; i < kRecords; i++) {
+    std::vector<uint8_t> record = Record(i);
+    while (!stream->Write(record.data(), record.size())) {
+      std::this_thread::yield();
+    }
+  }
+  stream->Close();
+
+  int status = 0;
+  REQUIRE(waitpid(child, &status, 0) == child);
+  REQUIRE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+TEST(WritesFailWhileTheRingIsFull) {
+  std::string path = StreamPath("full");
+  std::unique_ptr<SharedStream> producer = SharedStream::Create(path, 16);
+  REQUIRE(producer);
+  std::unique_ptr<SharedStream> consumer = SharedStream::Open(path);
+  REQUIRE(consumer);
+
+  // Each record takes a size prefix of 4 bytes.
+  const uint8_t data[16] = {};
+  EXPECT(!producer->Write(data, 13));
+  REQUIRE(producer->Write(data, 8));
+  EXPECT(!producer->Write(data, 1));
+  EXPECT(producer->Write(data, 0));
+
+  std::vector<std::vector<uint8_t>> records;
+  REQUIRE(consumer->Read(records, 0));
+  EXPECT_EQ(records.size(), 2u);
+  // Freed by the read.
+  EXPECT(producer->Write(data, 12));
+}
+
+TEST(ReadsEndOnceAClosedStreamIsRead) {
+  std::string path = StreamPath("close");
+  std::unique_ptr<SharedStream> producer = SharedStream::Create(path, 64);
+  REQUIRE(producer);
+  std::unique_ptr<SharedStream> consumer = SharedStream::Open(path);
+  REQUIRE(consumer);
+
+  const uint8_t data[] = {1, 2, 3};
+  REQUIRE(producer->Write(data, sizeof(data)));
+  producer->Close();
+  // The file is removed, the mapping stays.
+  producer.reset();
+  EXPECT(access(path.c_str(), F_OK) != 0);
+
+  std::vector<std::vector<uint8_t>> records;
+  EXPECT(consumer->Read(records, 1000));
+  REQUIRE(records.size() == 1u);
+  EXPECT(records[0] == std::vector<uint8_t>(data, data + sizeof(data)));
+  records.clear();
+  EXPECT(!consumer->Read(records, 1000));
+  EXPECT(records.empty());
+}
+
+TEST(RecordsLargerThanTheWrittenBytesBreakTheStream) {
+  constexpr size_t kCapacity = 64;
+  std::string path = StreamPath("corrupt");
+  std::unique_ptr<SharedStream> producer =
+      SharedStream::Create(path, kCapacity);
+  REQUIRE(producer);
+  std::unique_ptr<SharedStream> consumer = SharedStream::Open(path);
+  REQUIRE(consumer);
+
+  const uint8_t data[8] = {};
+  REQUIRE(producer->Write(data, sizeof(data)));
+  REQUIRE(producer->Write(data, sizeof(data)));
+  // Records follow the header, at the end of the file. The size of the
+  // second record is overwritten, as a peer could.
+  int fd = open(path.c_str(), O_RDWR);
+  REQUIRE(fd >= 0);
+  struct stat file;
+  REQUIRE(fstat(fd, &file) == 0);
+  uint32_t size = 0xffffff00;
+  off_t offset = file.st_size - kCapacity + sizeof(uint32_t) + sizeof(data);
+  EXPECT(pwrite(fd, &size, sizeof(size), offset) == sizeof(size));
+  close(fd);
+
+  std::vector<std::vector<uint8_t>> records;
+  EXPECT(!consumer->Read(records, 0));
+  // Records before the corrupt one are read.
+  EXPECT_EQ(records.size(), 1u);
+  records.clear();
+  EXPECT(!consumer->Read(records, 0));
+  EXPECT(records.empty());
+}
+
+}  // namespace
@@ -0,0 +1,36 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <Ecore.h>
+
+#include <thread>
+
+#include "loopback.h"
+#include "messageport.h"
+#include "test.h"
+
+namespace {
+
+TEST(TasksForThePlatformThreadAreDroppedWithTheManager) {
+  bool completed = false;
+  {
+    Loopback loopback;
+    MessagePortManager& manager = loopback.manager();
+    int port = loopback.OpenPort("shutdown");
+    REQUIRE(manager.SetCoalescing(port, 10, 1000 * 1000));
+    // The flush timer of queued messages is started on the platform
+    // thread, and they complete there once the manager sends their batch
+    // when it is destroyed.
+    std::thread sender([&manager, port, &completed] {
+      EXPECT(manager.SendAsync(
+          port, {1}, MessagePortManager::kNoLocalPort,
+          [&completed](MessagePortResult result) { completed = true; }));
+    });
+    sender.join();
+    // The loopback iterates the main loop after destroying the manager.
+  }
+  EXPECT(!completed);
+}
+
+}  // namespace
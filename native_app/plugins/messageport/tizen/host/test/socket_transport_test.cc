@@ -0,0 +1,206 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "socket_transport.h"
+
+#include <Ecore.h>
+#include <app_common.h>
+#include <bundle.h>
+#include <package_manager.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+
+constexpr char kKey[] = "bytes";
+
+struct Received {
+  std::string app_id;
+  std::string reply_port;
+  std::string message;
+};
+
+void OnReceived(int /*local_port_id*/, const char* remote_app_id,
+                const char* remote_port, bool /*trusted_remote_port*/,
+                bundle* message, void* user_data) {
+  void* bytes = nullptr;
+  size_t size = 0;
+  bundle_get_byte(message, kKey, &bytes, &size);
+  static_cast<std::vector<Received>*>(user_data)->push_back(
+      {remote_app_id, remote_port ? remote_port : "",
+       std::string(static_cast<const char*>(bytes), size)});
+}
+
+std::string AppId() {
+  char* id = nullptr;
+  app_get_id(&id);
+  std::string app_id = id;
+  free(id);
+  return app_id;
+}
+
+// Iterates the main loop until |count| messages were received.
+bool WaitFor(const std::vector<Received>& received, size_t count) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (received.size() < count) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    ecore_main_loop_iterate();
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  return true;
+}
+
+// Returns the abstract socket address of a port, as the transport names it.
+sockaddr_un PortAddress(const std::string& app_id, const std::string& port,
+                        bool is_trusted, socklen_t* length) {
+  std::string name = "messageport/" + app_id + "/" + port +
+                     (is_trusted ? "/trusted" : "");
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  memcpy(addr.sun_path + 1, name.data(), name.size());
+  *length = offsetof(sockaddr_un, sun_path) + 1 + name.size();
+  return addr;
+}
+
+int Send(SocketTransport& transport, const std::string& port_name,
+         const std::string& text, int local_port_id,
+         bool is_trusted = false) {
+  bundle* b = bundle_create();
+  bundle_add_byte(b, kKey, text.data(), text.size());
+  int ret = transport.Send(AppId(), port_name, is_trusted, b, local_port_id);
+  bundle_free(b);
+  return ret;
+}
+
+TEST(SocketMessagesComeFromTheConnectedApplication) {
+  ecore_init();
+  {
+    SocketTransport transport;
+    std::vector<Received> received;
+    int port = transport.RegisterLocalPort("socket", false, OnReceived,
+                                           &received);
+    REQUIRE(port > 0);
+    int reply_port = transport.RegisterLocalPort("socket_reply", false,
+                                                 OnReceived, &received);
+    REQUIRE(reply_port > 0);
+
+    EXPECT_EQ(Send(transport, "socket", "first", -1),
+              MESSAGE_PORT_ERROR_NONE);
+    EXPECT_EQ(Send(transport, "socket", "second", reply_port),
+              MESSAGE_PORT_ERROR_NONE);
+    REQUIRE(WaitFor(received, 2));
+    EXPECT_EQ(received[0].app_id, AppId());
+    EXPECT_EQ(received[0].reply_port, "");
+    EXPECT_EQ(received[0].message, "first");
+    EXPECT_EQ(received[1].app_id, AppId());
+    EXPECT_EQ(received[1].reply_port, "socket_reply");
+    EXPECT_EQ(received[1].message, "second");
+
+    EXPECT_EQ(Send(transport, "absent", "message", -1),
+              MESSAGE_PORT_ERROR_PORT_NOT_FOUND);
+  }
+  ecore_shutdown();
+}
+
+TEST(TrustedSocketPortsRequireTheSameCertificate) {
+  ecore_init();
+  {
+    SocketTransport transport;
+    std::vector<Received> received;
+    REQUIRE(transport.RegisterLocalPort("trusted", true, OnReceived,
+                                        &received) > 0);
+
+    package_manager_host_set_cert_match(false);
+    EXPECT_EQ(Send(transport, "trusted", "rejected", -1, true),
+              MESSAGE_PORT_ERROR_CERTIFICATE_NOT_MATCH);
+    bool exists = true;
+    EXPECT_EQ(transport.CheckRemotePort(AppId(), "trusted", true, &exists),
+              MESSAGE_PORT_ERROR_CERTIFICATE_NOT_MATCH);
+    EXPECT(!exists);
+
+    // Connections of other senders are closed on accepting them.
+    socklen_t length;
+    sockaddr_un addr = PortAddress(AppId(), "trusted", true, &length);
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    REQUIRE(connect(fd, reinterpret_cast<sockaddr*>(&addr), length) == 0);
+    // Earlier connections of the sends above are accepted first.
+    char byte;
+    ssize_t read = -1;
+    for (int i = 0; i < 1000 && read < 0; i++) {
+      ecore_main_loop_iterate();
+      read = recv(fd, &byte, 1, MSG_DONTWAIT);
+    }
+    EXPECT_EQ(read, 0);
+    close(fd);
+
+    package_manager_host_set_cert_match(true);
+    EXPECT_EQ(Send(transport, "trusted", "accepted", -1, true),
+              MESSAGE_PORT_ERROR_NONE);
+    REQUIRE(WaitFor(received, 1));
+    EXPECT_EQ(received[0].message, "accepted");
+  }
+  ecore_shutdown();
+}
+
+TEST(SocketSendsOnlyGoToTheAddressedApplication) {
+  ecore_init();
+  {
+    SocketTransport transport;
+    // This application listens on the address of another one's port.
+    std::string other_app_id = AppId() + ".other";
+    socklen_t length;
+    sockaddr_un addr = PortAddress(other_app_id, "squatted", false, &length);
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    REQUIRE(bind(fd, reinterpret_cast<sockaddr*>(&addr), length) == 0);
+    REQUIRE(listen(fd, 1) == 0);
+
+    bundle* b = bundle_create();
+    bundle_add_byte(b, kKey, "message", 7);
+    EXPECT_EQ(transport.Send(other_app_id, "squatted", false, b, -1),
+              MESSAGE_PORT_ERROR_PORT_NOT_FOUND);
+    bundle_free(b);
+    close(fd);
+  }
+  ecore_shutdown();
+}
+
+TEST(SocketSendsToAFullReceiverDoNotBlock) {
+  ecore_init();
+  {
+    SocketTransport transport;
+    std::vector<Received> received;
+    REQUIRE(transport.RegisterLocalPort("full", false, OnReceived,
+                                        &received) > 0);
+    // The main loop does not run, so nothing is read from the socket.
+    const std::string message(64 * 1024, 'x');
+    int ret = MESSAGE_PORT_ERROR_NONE;
+    for (int i = 0; i < 1000 && MESSAGE_PORT_ERROR_NONE == ret; i++) {
+      ret = Send(transport, "full", message, -1);
+    }
+    EXPECT_EQ(ret, MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE);
+
+    // Other threads wait for the receiver, but not indefinitely.
+    std::thread sender([&transport, &message, &ret] {
+      ret = Send(transport, "full", message, -1);
+    });
+    sender.join();
+    EXPECT_EQ(ret, MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE);
+  }
+  ecore_shutdown();
+}
+
+}  // namespace
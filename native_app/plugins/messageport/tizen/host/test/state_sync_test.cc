@@ -0,0 +1,97 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "state_sync.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+
+using flutter::EncodableMap;
+using flutter::EncodableValue;
+
+EncodableMap State(int32_t count, const std::string& name) {
+  return EncodableMap{
+      {EncodableValue("count"), EncodableValue(count)},
+      {EncodableValue("nested"),
+       EncodableValue(EncodableMap{{EncodableValue("name"),
+                                    EncodableValue(name)}})},
+  };
+}
+
+// Encodes and commits |state|, and applies the update to |receiver|.
+StateSyncReceiver::Result Sync(StateSyncSender& sender,
+                               StateSyncReceiver& receiver,
+                               EncodableMap state, uint32_t* base_seq) {
+  std::vector<uint8_t> update;
+  uint32_t seq = sender.Encode(state, update, base_seq);
+  sender.Commit(std::move(state));
+  return receiver.Apply(seq, *base_seq, update.data(), update.size());
+}
+
+TEST(StateUpdatesAreDiffsFromTheLastCommit) {
+  StateSyncSender sender;
+  StateSyncReceiver receiver;
+  uint32_t base_seq = 0;
+  EXPECT(Sync(sender, receiver, State(1, "a"), &base_seq) ==
+         StateSyncReceiver::Result::kApplied);
+  EXPECT_EQ(base_seq, 0u);
+  EXPECT(Sync(sender, receiver, State(2, "b"), &base_seq) ==
+         StateSyncReceiver::Result::kApplied);
+  EXPECT_EQ(base_seq, 1u);
+
+  EXPECT_EQ(receiver.seq(), 2u);
+  EXPECT(receiver.state() == EncodableValue(State(2, "b")));
+  EXPECT_EQ(sender.stats().updates, 2u);
+  EXPECT_EQ(sender.stats().full_updates, 1u);
+}
+
+TEST(StateDiffsRemoveKeys) {
+  EncodableMap from = State(1, "a");
+  EncodableMap to = {{EncodableValue("count"), EncodableValue(1)}};
+  EncodableMap diff;
+  DiffStates(from, to, &diff);
+  EXPECT_EQ(diff.size(), 1u);
+  REQUIRE(ApplyStateDiff(from, diff));
+  EXPECT(from == to);
+}
+
+TEST(MissedStateUpdatesAreResyncedFromTheSnapshot) {
+  StateSyncSender sender;
+  StateSyncReceiver receiver;
+  uint32_t base_seq = 0;
+  Sync(sender, receiver, State(1, "a"), &base_seq);
+  // Lost on the way.
+  StateSyncReceiver other;
+  Sync(sender, other, State(2, "b"), &base_seq);
+  EXPECT(Sync(sender, receiver, State(3, "c"), &base_seq) ==
+         StateSyncReceiver::Result::kGap);
+  EXPECT(receiver.ShouldRequestResync(1));
+  EXPECT(!receiver.ShouldRequestResync(2));
+
+  EXPECT(Sync(sender, receiver, sender.TakeSnapshot(), &base_seq) ==
+         StateSyncReceiver::Result::kApplied);
+  EXPECT_EQ(base_seq, 0u);
+  EXPECT(receiver.state() == EncodableValue(State(3, "c")));
+  // The snapshot is back, later updates are diffs again.
+  EXPECT(Sync(sender, receiver, State(4, "c"), &base_seq) ==
+         StateSyncReceiver::Result::kApplied);
+  EXPECT_EQ(base_seq, 4u);
+  EXPECT(receiver.state() == EncodableValue(State(4, "c")));
+  EXPECT_EQ(sender.stats().resyncs, 1u);
+}
+
+TEST(MalformedStateUpdatesAreRejected) {
+  StateSyncReceiver receiver;
+  const uint8_t garbage[] = {0xff, 0x01};
+  EXPECT(receiver.Apply(1, 0, garbage, sizeof(garbage)) ==
+         StateSyncReceiver::Result::kMalformed);
+  EXPECT_EQ(receiver.seq(), 0u);
+}
+
+}  // namespace
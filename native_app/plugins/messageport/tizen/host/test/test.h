@@ -0,0 +1,66 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Minimal test helpers, so that host tests build without a test framework.
+// Tests are defined with TEST and run by test_main.cc, all of them or only
+// those named on the command line.
+
+#ifndef HOST_TEST_TEST_H
+#define HOST_TEST_TEST_H
+
+#include <functional>
+#include <sstream>
+#include <string>
+
+namespace test {
+
+// Registers |run| under |name|.
+struct Registration {
+  Registration(const char* name, std::function<void()> run);
+};
+
+// Marks the running test as failed.
+void Fail(const char* file, int line, const std::string& message);
+
+template <typename A, typename B>
+std::string Describe(const char* expression, const A& actual,
+                     const B& expected) {
+  std::ostringstream out;
+  out << expression << ": " << actual << " vs " << expected;
+  return out.str();
+}
+
+}  // namespace test
+
+#define TEST(name)                                                  \
+  static void name();                                               \
+  static test::Registration name##_registration(#name, name);       \
+  static void name()
+
+// Checks go on after a failure, requirements return from the test.
+#define EXPECT(condition)                              \
+  do {                                                 \
+    if (!(condition)) {                                \
+      test::Fail(__FILE__, __LINE__, #condition);      \
+    }                                                  \
+  } while (0)
+
+#define EXPECT_EQ(actual, expected)                                       \
+  do {                                                                    \
+    if (!((actual) == (expected))) {                                      \
+      test::Fail(__FILE__, __LINE__,                                      \
+                 test::Describe(#actual " == " #expected, (actual),       \
+                                (expected)));                             \
+    }                                                                     \
+  } while (0)
+
+#define REQUIRE(condition)                             \
+  do {                                                 \
+    if (!(condition)) {                                \
+      test::Fail(__FILE__, __LINE__, #condition);      \
+      return;                                          \
+    }                                                  \
+  } while (0)
+
+#endif  // HOST_TEST_TEST_H
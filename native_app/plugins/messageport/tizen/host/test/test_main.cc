@@ -0,0 +1,70 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "test.h"
+
+namespace {
+
+std::vector<std::pair<const char*, std::function<void()>>>& Tests() {
+  static std::vector<std::pair<const char*, std::function<void()>>> tests;
+  return tests;
+}
+
+// Checks may fail on threads started by a test.
+std::mutex failure_mutex;
+int failures = 0;
+
+bool Selected(const char* name, int argc, char** argv) {
+  if (argc < 2) {
+    return true;
+  }
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+namespace test {
+
+Registration::Registration(const char* name, std::function<void()> run) {
+  Tests().emplace_back(name, std::move(run));
+}
+
+void Fail(const char* file, int line, const std::string& message) {
+  std::lock_guard<std::mutex> lock(failure_mutex);
+  failures++;
+  fprintf(stderr, "%s:%d: Failed: %s\n", file, line, message.c_str());
+}
+
+}  // namespace test
+
+int main(int argc, char** argv) {
+  int failed_tests = 0;
+  for (const auto& test : Tests()) {
+    if (!Selected(test.first, argc, argv)) {
+      continue;
+    }
+    int failures_before;
+    {
+      std::lock_guard<std::mutex> lock(failure_mutex);
+      failures_before = failures;
+    }
+    test.second();
+    std::lock_guard<std::mutex> lock(failure_mutex);
+    bool passed = failures == failures_before;
+    printf("%s %s\n", passed ? "PASS" : "FAIL", test.first);
+    failed_tests += passed ? 0 : 1;
+  }
+  return failed_tests > 0 ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "async_sender.h"
+
+#include "log.h"
+#include "platform_thread.h"
+
+// Sends of less urgent classes wait at most this long behind more urgent
+// ones, in microseconds.
+static constexpr std::array<int64_t, kPriorityCount> kMaxWaitUs = {
+    0, 20000, 100000};
+
+AsyncSender::AsyncSender(size_t max_threads, size_t capacity)
+    : max_threads_(max_threads), capacity_(capacity), lanes_(kMaxWaitUs) {}
+
+AsyncSender::~AsyncSender() { Stop(); }
+
+void AsyncSender::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  condition_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+}
+
+bool AsyncSender::Post(Queue& queue, SendFunction send,
+                       DoneCallback on_done) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_) {
+      return false;
+    }
+    if (queued_ >= capacity_) {
+      LOG_WARN("Send queue is full (%zu)", queued_);
+      return false;
+    }
+    Push(queue, std::move(send), std::move(on_done));
+  }
+  condition_.notify_one();
+  return true;
+}
+
+bool AsyncSender::PostUnbounded(Queue& queue, SendFunction send,
+                                DoneCallback on_done) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_) {
+      return false;
+    }
+    Push(queue, std::move(send), std::move(on_done));
+  }
+  condition_.notify_one();
+  return true;
+}
+
+void AsyncSender::Push(Queue& queue, SendFunction send,
+                       DoneCallback on_done) {
+  queue.jobs_.push_back({std::move(send), std::move(on_done)});
+  queued_++;
+  if (!queue.scheduled_) {
+    queue.scheduled_ = true;
+    lanes_.Push(queue.priority_, &queue);
+  }
+  if (idle_ < lanes_.size() && threads_.size() < max_threads_) {
+    threads_.emplace_back(&AsyncSender::Run, this);
+  }
+}
+
+void AsyncSender::SetPriority(Queue& queue, Priority priority) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  queue.priority_ = priority;
+}
+
+void AsyncSender::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    idle_++;
+    condition_.wait(lock, [this] { return stopped_ || !lanes_.empty(); });
+    idle_--;
+    // Queued sends are still done when stopping.
+    if (lanes_.empty()) {
+      return;
+    }
+    // One send per turn, so that a busy port does not hold back the others
+    // of its class. The queue stays out of the lanes while its send is
+    // done, so that no other thread sends to the same port meanwhile.
+    Queue* queue = lanes_.Pop();
+    Queue::Job job = std::move(queue->jobs_.front());
+    queue->jobs_.pop_front();
+    queued_--;
+
+    lock.unlock();
+    int ret = job.send();
+    if (job.on_done) {
+      RunOnPlatformThread(
+          alive_, [on_done = std::move(job.on_done), ret] { on_done(ret); });
+    }
+    lock.lock();
+
+    // Back to the end of the lane of its current priority.
+    if (queue->jobs_.empty()) {
+      queue->scheduled_ = false;
+    } else {
+      lanes_.Push(queue->priority_, queue);
+      condition_.notify_one();
+    }
+  }
+}
+
+flutter::EncodableValue AsyncSender::GetQueueDelays() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return lanes_.DelaysToEncodableValue();
+}
+
+void AsyncSender::ResetQueueDelays() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  lanes_.ResetDelays();
+}
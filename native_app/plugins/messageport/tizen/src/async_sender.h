@@ -0,0 +1,100 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef ASYNC_SENDER_H
+#define ASYNC_SENDER_H
+
+#include <flutter/encodable_value.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "priority_lanes.h"
+
+// Runs sends on up to |max_threads| dedicated threads. Sends are posted to
+// the queue of the port they go to, and are done one at a time, in the
+// order they were posted to it, while sends to other ports are done in
+// parallel. Ports, not sends, are scheduled by priority: the oldest send of
+// the most urgent port is done first, so a priority change applies to the
+// sends of a port still queued without reordering them. Completion
+// callbacks are run on the platform thread, unless the sender is destroyed
+// first.
+class AsyncSender {
+ public:
+  typedef std::function<int()> SendFunction;
+  typedef std::function<void(int error_code)> DoneCallback;
+
+  // Sends to one port waiting for a sender thread.
+  class Queue {
+   public:
+    Queue() = default;
+
+    Queue(const Queue&) = delete;
+    Queue& operator=(const Queue&) = delete;
+
+   private:
+    friend class AsyncSender;
+
+    struct Job {
+      SendFunction send;
+      DoneCallback on_done;
+    };
+
+    std::deque<Job> jobs_;
+    Priority priority_ = Priority::kNormal;
+    // Whether the queue is in a lane of the sender, or one of its sends is
+    // being done.
+    bool scheduled_ = false;
+  };
+
+  AsyncSender(size_t max_threads, size_t capacity);
+  // Called on the platform thread. Stops the sender.
+  ~AsyncSender();
+
+  // Does queued sends and stops the sender threads before returning.
+  // Sends posted later are refused.
+  void Stop();
+
+  // Returns false without queueing |send| if the sender holds |capacity|
+  // sends already, or is stopped.
+  bool Post(Queue& queue, SendFunction send, DoneCallback on_done);
+  // Queues |send| even beyond |capacity|, for sends which must not be
+  // lost. |on_done| may be null. Returns false without queueing |send| once
+  // the sender is stopped.
+  bool PostUnbounded(Queue& queue, SendFunction send, DoneCallback on_done);
+  // Sets the priority |queue| is scheduled with from now on.
+  void SetPriority(Queue& queue, Priority priority);
+
+  // Returns a map of histograms of how long ports waited for their turn,
+  // by priority class.
+  flutter::EncodableValue GetQueueDelays() const;
+  void ResetQueueDelays();
+
+ private:
+  void Run();
+  // Called with |mutex_| held.
+  void Push(Queue& queue, SendFunction send, DoneCallback on_done);
+
+  size_t max_threads_;
+  size_t capacity_;
+  // Sends in all queues.
+  size_t queued_ = 0;
+  // Queues with sends, each in the lane of its priority at most once.
+  PriorityLanes<Queue*> lanes_;
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  size_t idle_ = 0;
+  bool stopped_ = false;
+  // Started when sends are posted and no thread is idle.
+  std::vector<std::thread> threads_;
+  // Expires when the sender is destroyed, dropping completion callbacks.
+  std::shared_ptr<void> alive_ = std::make_shared<int>(0);
+};
+
+#endif  // ASYNC_SENDER_H
@@ -0,0 +1,147 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "compression.h"
+
+#include <chrono>
+#include <cstring>
+
+#include "log.h"
+
+// Payloads claiming to be larger than this when inflated are rejected.
+static constexpr uint32_t kMaxInflatedSize = 64 * 1024 * 1024;
+
+static uLong DictionaryId(const std::vector<uint8_t>& dictionary) {
+  return adler32(adler32(0, Z_NULL, 0), dictionary.data(), dictionary.size());
+}
+
+static int64_t ElapsedUs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+PayloadCompressor::PayloadCompressor(size_t threshold,
+                                     std::vector<uint8_t> dictionary)
+    : threshold_(threshold),
+      dictionary_(std::move(dictionary)),
+      dictionary_id_(dictionary_.empty() ? 0 : DictionaryId(dictionary_)) {
+  memset(&stream_, 0, sizeof(stream_));
+  // Speed matters more than ratio here, compression runs on every send.
+  int ret = deflateInit(&stream_, Z_BEST_SPEED);
+  initialized_ = ret == Z_OK;
+  if (!initialized_) {
+    LOG_ERROR("Failed: deflateInit, %d", ret);
+  }
+}
+
+PayloadCompressor::~PayloadCompressor() {
+  if (initialized_) {
+    deflateEnd(&stream_);
+  }
+}
+
+bool PayloadCompressor::Compress(const std::vector<uint8_t>& data,
+                                 std::vector<uint8_t>& out) {
+  stats_.messages++;
+  stats_.message_bytes += data.size();
+  if (!initialized_ || !confirmed_ || data.size() < threshold_ ||
+      data.size() > kMaxInflatedSize) {
+    stats_.bundle_bytes += data.size();
+    return false;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  deflateReset(&stream_);
+  if (!dictionary_.empty()) {
+    deflateSetDictionary(&stream_, dictionary_.data(), dictionary_.size());
+  }
+
+  uint32_t size = data.size();
+  out.resize(sizeof(size) + deflateBound(&stream_, data.size()));
+  memcpy(out.data(), &size, sizeof(size));
+  stream_.next_in = const_cast<Bytef*>(data.data());
+  stream_.avail_in = data.size();
+  stream_.next_out = out.data() + sizeof(size);
+  stream_.avail_out = out.size() - sizeof(size);
+  int ret = deflate(&stream_, Z_FINISH);
+  size_t compressed_size = out.size() - stream_.avail_out;
+  stats_.time_us += ElapsedUs(start);
+
+  if (ret != Z_STREAM_END || compressed_size >= data.size()) {
+    stats_.bundle_bytes += data.size();
+    return false;
+  }
+  out.resize(compressed_size);
+  stats_.compressed_messages++;
+  stats_.bundle_bytes += compressed_size;
+  return true;
+}
+
+PayloadDecompressor::PayloadDecompressor() {
+  memset(&stream_, 0, sizeof(stream_));
+  int ret = inflateInit(&stream_);
+  initialized_ = ret == Z_OK;
+  if (!initialized_) {
+    LOG_ERROR("Failed: inflateInit, %d", ret);
+  }
+}
+
+PayloadDecompressor::~PayloadDecompressor() {
+  if (initialized_) {
+    inflateEnd(&stream_);
+  }
+}
+
+void PayloadDecompressor::AddDictionary(std::vector<uint8_t> dictionary) {
+  uLong id = DictionaryId(dictionary);
+  dictionaries_[id] = std::move(dictionary);
+}
+
+bool PayloadDecompressor::HasDictionary(uLong id) const {
+  return 0 == id || dictionaries_.count(id) > 0;
+}
+
+bool PayloadDecompressor::Decompress(const uint8_t* data, size_t size,
+                                     std::vector<uint8_t>& out) {
+  uint32_t original_size = 0;
+  if (!initialized_ || size < sizeof(original_size)) {
+    return false;
+  }
+  memcpy(&original_size, data, sizeof(original_size));
+  if (original_size > kMaxInflatedSize) {
+    LOG_ERROR("Compressed payload is too large: %u", original_size);
+    return false;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  out.resize(original_size);
+  inflateReset(&stream_);
+  stream_.next_in = const_cast<Bytef*>(data + sizeof(original_size));
+  stream_.avail_in = size - sizeof(original_size);
+  stream_.next_out = out.data();
+  stream_.avail_out = out.size();
+  int ret = inflate(&stream_, Z_FINISH);
+  if (ret == Z_NEED_DICT) {
+    auto dictionary = dictionaries_.find(stream_.adler);
+    if (dictionary == dictionaries_.end()) {
+      LOG_ERROR("Unknown compression dictionary: %lu", stream_.adler);
+      return false;
+    }
+    inflateSetDictionary(&stream_, dictionary->second.data(),
+                         dictionary->second.size());
+    ret = inflate(&stream_, Z_FINISH);
+  }
+  stats_.time_us += ElapsedUs(start);
+
+  if (ret != Z_STREAM_END || stream_.avail_out != 0) {
+    LOG_ERROR("Failed: inflate, %d", ret);
+    return false;
+  }
+  stats_.messages++;
+  stats_.compressed_messages++;
+  stats_.message_bytes += original_size;
+  stats_.bundle_bytes += size;
+  return true;
+}
@@ -0,0 +1,86 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <zlib.h>
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Compression counters of one port. |message_bytes| are sizes of encoded
+// messages and |bundle_bytes| are sizes of what was put into bundles.
+struct CompressionStats {
+  size_t messages = 0;
+  size_t compressed_messages = 0;
+  size_t message_bytes = 0;
+  size_t bundle_bytes = 0;
+  int64_t time_us = 0;
+};
+
+// Deflates payloads sent to one remote port with a preset dictionary. The
+// deflate stream records the dictionary id, so the receiver can tell which
+// of its dictionaries to use. Compressed payloads start with the uint32_t
+// size of the original payload. Nothing is compressed until the receiver
+// confirmed it can inflate the payloads.
+class PayloadCompressor {
+ public:
+  PayloadCompressor(size_t threshold, std::vector<uint8_t> dictionary);
+  ~PayloadCompressor();
+
+  PayloadCompressor(const PayloadCompressor&) = delete;
+  PayloadCompressor& operator=(const PayloadCompressor&) = delete;
+
+  // Returns false, leaving |out| untouched, if compression is not confirmed,
+  // or |data| is smaller than the threshold or does not get smaller when
+  // compressed.
+  bool Compress(const std::vector<uint8_t>& data, std::vector<uint8_t>& out);
+
+  // Zero without a dictionary.
+  uLong dictionary_id() const { return dictionary_id_; }
+  bool confirmed() const { return confirmed_; }
+  void Confirm() { confirmed_ = true; }
+
+  const CompressionStats& stats() const { return stats_; }
+
+ private:
+  size_t threshold_;
+  std::vector<uint8_t> dictionary_;
+  uLong dictionary_id_;
+  z_stream stream_;
+  bool initialized_;
+  bool confirmed_ = false;
+  CompressionStats stats_;
+};
+
+// Inflates payloads received on one local port, using dictionaries it was
+// given by their ids.
+class PayloadDecompressor {
+ public:
+  PayloadDecompressor();
+  ~PayloadDecompressor();
+
+  PayloadDecompressor(const PayloadDecompressor&) = delete;
+  PayloadDecompressor& operator=(const PayloadDecompressor&) = delete;
+
+  void AddDictionary(std::vector<uint8_t> dictionary);
+  // True for zero, which stands for no dictionary.
+  bool HasDictionary(uLong id) const;
+
+  // Returns false if |data| is malformed or compressed with a dictionary
+  // which was not added.
+  bool Decompress(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+
+  const CompressionStats& stats() const { return stats_; }
+
+ private:
+  std::map<uLong, std::vector<uint8_t>> dictionaries_;
+  z_stream stream_;
+  bool initialized_;
+  CompressionStats stats_;
+};
+
+#endif  // COMPRESSION_H
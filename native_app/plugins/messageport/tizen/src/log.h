@@ -16,9 +16,47 @@
   dlog_print(prio, LOG_TAG, "%s: %s(%d) > " fmt, __MODULE__, __func__, \
              __LINE__, ##arg)
 
+// Arguments are still type checked, but never evaluated.
+#define LOG_NONE(fmt, arg...)      \
+  do {                             \
+    if (0) {                       \
+      LOG(DLOG_DEBUG, fmt, ##arg); \
+    }                              \
+  } while (0)
+
+// Levels below LOG_LEVEL compile to nothing. Release builds keep warnings
+// and errors only, define LOG_LEVEL to override it.
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef LOG_LEVEL
+#ifdef NDEBUG
+#define LOG_LEVEL LOG_LEVEL_WARN
+#else
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
 #define LOG_DEBUG(fmt, args...) LOG(DLOG_DEBUG, fmt, ##args)
+#else
+#define LOG_DEBUG(fmt, args...) LOG_NONE(fmt, ##args)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
 #define LOG_INFO(fmt, args...) LOG(DLOG_INFO, fmt, ##args)
+#else
+#define LOG_INFO(fmt, args...) LOG_NONE(fmt, ##args)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
 #define LOG_WARN(fmt, args...) LOG(DLOG_WARN, fmt, ##args)
+#else
+#define LOG_WARN(fmt, args...) LOG_NONE(fmt, ##args)
+#endif
+
 #define LOG_ERROR(fmt, args...) LOG(DLOG_ERROR, fmt, ##args)
 
 #endif  // __LOG_H__
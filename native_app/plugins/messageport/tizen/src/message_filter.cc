@@ -0,0 +1,334 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "message_filter.h"
+
+#include <cstring>
+
+namespace {
+
+// Type tags of StandardMessageCodec.
+enum : uint8_t {
+  kNull,
+  kTrue,
+  kFalse,
+  kInt32,
+  kInt64,
+  kLargeInt,
+  kFloat64,
+  kString,
+  kUint8List,
+  kInt32List,
+  kInt64List,
+  kFloat64List,
+  kList,
+  kMap,
+  kFloat32List,
+};
+
+// Nested containers deeper than this are not skipped, the message is
+// treated as not matching instead.
+constexpr int kMaxDepth = 32;
+
+// Walks a value encoded by StandardMessageCodec without decoding it.
+// Alignment is relative to the start of the payload, as in the codec.
+class PayloadReader {
+ public:
+  PayloadReader(const uint8_t* data, size_t size)
+      : data_(data), size_(size) {}
+
+  bool ReadByte(uint8_t* value) {
+    if (position_ >= size_) {
+      return false;
+    }
+    *value = data_[position_++];
+    return true;
+  }
+
+  bool ReadSize(size_t* value) {
+    uint8_t byte;
+    if (!ReadByte(&byte)) {
+      return false;
+    }
+    if (byte < 254) {
+      *value = byte;
+      return true;
+    }
+    if (byte == 254) {
+      uint16_t size;
+      if (!Read(&size, sizeof(size))) {
+        return false;
+      }
+      *value = size;
+      return true;
+    }
+    uint32_t size;
+    if (!Read(&size, sizeof(size))) {
+      return false;
+    }
+    *value = size;
+    return true;
+  }
+
+  bool Read(void* out, size_t length) {
+    if (size_ - position_ < length) {
+      return false;
+    }
+    memcpy(out, data_ + position_, length);
+    position_ += length;
+    return true;
+  }
+
+  // Returns a pointer to the next |length| bytes and skips them.
+  const uint8_t* Take(size_t length) {
+    if (size_ - position_ < length) {
+      return nullptr;
+    }
+    const uint8_t* bytes = data_ + position_;
+    position_ += length;
+    return bytes;
+  }
+
+  bool Align(size_t alignment) {
+    size_t mod = position_ % alignment;
+    return mod == 0 || Take(alignment - mod) != nullptr;
+  }
+
+  // Skips a value of type |type|, whose tag was already read.
+  bool SkipValue(uint8_t type, int depth) {
+    if (depth > kMaxDepth) {
+      return false;
+    }
+    size_t length;
+    switch (type) {
+      case kNull:
+      case kTrue:
+      case kFalse:
+        return true;
+      case kInt32:
+        return Take(4) != nullptr;
+      case kInt64:
+        return Take(8) != nullptr;
+      case kFloat64:
+        return Align(8) && Take(8) != nullptr;
+      case kLargeInt:
+      case kString:
+      case kUint8List:
+        return ReadSize(&length) && Take(length) != nullptr;
+      case kInt32List:
+      case kFloat32List:
+        return ReadSize(&length) && Align(4) && length <= SIZE_MAX / 4 &&
+               Take(length * 4) != nullptr;
+      case kInt64List:
+      case kFloat64List:
+        return ReadSize(&length) && Align(8) && length <= SIZE_MAX / 8 &&
+               Take(length * 8) != nullptr;
+      case kList:
+        if (!ReadSize(&length)) {
+          return false;
+        }
+        for (size_t i = 0; i < length; i++) {
+          if (!Skip(depth + 1)) {
+            return false;
+          }
+        }
+        return true;
+      case kMap:
+        if (!ReadSize(&length)) {
+          return false;
+        }
+        for (size_t i = 0; i < length; i++) {
+          if (!Skip(depth + 1) || !Skip(depth + 1)) {
+            return false;
+          }
+        }
+        return true;
+    }
+    return false;
+  }
+
+  bool Skip(int depth) {
+    uint8_t type;
+    return ReadByte(&type) && SkipValue(type, depth);
+  }
+
+  size_t position() const { return position_; }
+
+ private:
+  const uint8_t* data_;
+  size_t size_;
+  size_t position_ = 0;
+};
+
+const flutter::EncodableValue* Find(const flutter::EncodableMap& map,
+                                    const char* key) {
+  auto entry = map.find(flutter::EncodableValue(key));
+  return entry == map.end() ? nullptr : &entry->second;
+}
+
+}  // namespace
+
+bool MessageFilter::Create(const flutter::EncodableValue& spec,
+                           MessageFilter* filter) {
+  const auto* map = std::get_if<flutter::EncodableMap>(&spec);
+  if (map == nullptr) {
+    return false;
+  }
+  *filter = MessageFilter();
+
+  if (const auto* value = Find(*map, "remoteAppIds")) {
+    const auto* list = std::get_if<flutter::EncodableList>(value);
+    if (list == nullptr) {
+      return false;
+    }
+    for (const auto& app_id : *list) {
+      const auto* string = std::get_if<std::string>(&app_id);
+      if (string == nullptr) {
+        return false;
+      }
+      filter->remote_app_ids_.push_back(*string);
+    }
+  }
+
+  if (const auto* value = Find(*map, "trusted")) {
+    const auto* trusted = std::get_if<bool>(value);
+    if (trusted == nullptr) {
+      return false;
+    }
+    filter->trusted_ = *trusted;
+  }
+
+  if (const auto* value = Find(*map, "key")) {
+    const auto* key = std::get_if<std::string>(value);
+    if (key == nullptr) {
+      return false;
+    }
+    filter->has_key_ = true;
+    filter->key_ = *key;
+  }
+
+  if (const auto* value = Find(*map, "value")) {
+    if (!filter->has_key_) {
+      return false;
+    }
+    if (const auto* string = std::get_if<std::string>(value)) {
+      filter->value_type_ = ValueType::kString;
+      filter->string_value_ = *string;
+    } else if (const auto* boolean = std::get_if<bool>(value)) {
+      filter->value_type_ = ValueType::kBool;
+      filter->int_value_ = *boolean;
+    } else if (std::holds_alternative<int32_t>(*value) ||
+               std::holds_alternative<int64_t>(*value)) {
+      filter->value_type_ = ValueType::kInt;
+      filter->int_value_ = value->LongValue();
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool MessageFilter::Matches(const uint8_t* data, size_t size,
+                            const char* remote_app_id,
+                            bool trusted_remote_port) const {
+  if (trusted_ >= 0 && trusted_ != trusted_remote_port) {
+    return false;
+  }
+  if (!remote_app_ids_.empty()) {
+    bool found = false;
+    for (const auto& app_id : remote_app_ids_) {
+      if (app_id.compare(remote_app_id) == 0) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      return false;
+    }
+  }
+  return !has_key_ || MatchesPayload(data, size);
+}
+
+bool MessageFilter::MatchesPayload(const uint8_t* data, size_t size) const {
+  const uint8_t* value;
+  size_t value_size;
+  if (!PeekMapValue(data, size, key_, &value, &value_size)) {
+    return false;
+  }
+
+  // Strings, ints and bools are not aligned, so the value can be read on
+  // its own.
+  PayloadReader reader(value, value_size);
+  uint8_t type;
+  if (!reader.ReadByte(&type)) {
+    return false;
+  }
+  switch (value_type_) {
+    case ValueType::kNone:
+      return true;
+    case ValueType::kBool:
+      return (type == kTrue && int_value_) || (type == kFalse && !int_value_);
+    case ValueType::kInt: {
+      if (type == kInt32) {
+        int32_t number;
+        return reader.Read(&number, sizeof(number)) && number == int_value_;
+      }
+      int64_t number;
+      return type == kInt64 && reader.Read(&number, sizeof(number)) &&
+             number == int_value_;
+    }
+    case ValueType::kString: {
+      size_t length;
+      const uint8_t* string;
+      return type == kString && reader.ReadSize(&length) &&
+             length == string_value_.size() &&
+             (string = reader.Take(length)) != nullptr &&
+             memcmp(string, string_value_.data(), length) == 0;
+    }
+  }
+  return false;
+}
+
+bool PeekMapValue(const uint8_t* data, size_t size, const std::string& key,
+                  const uint8_t** value, size_t* value_size) {
+  PayloadReader reader(data, size);
+  uint8_t type;
+  size_t entries;
+  if (!reader.ReadByte(&type) || type != kMap || !reader.ReadSize(&entries)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < entries; i++) {
+    size_t length;
+    if (!reader.ReadByte(&type)) {
+      return false;
+    }
+    if (type != kString) {
+      if (!reader.SkipValue(type, 0) || !reader.Skip(0)) {
+        return false;
+      }
+      continue;
+    }
+    const uint8_t* entry_key;
+    if (!reader.ReadSize(&length) ||
+        (entry_key = reader.Take(length)) == nullptr) {
+      return false;
+    }
+    if (length != key.size() || memcmp(entry_key, key.data(), length) != 0) {
+      if (!reader.Skip(0)) {
+        return false;
+      }
+      continue;
+    }
+
+    size_t start = reader.position();
+    if (!reader.Skip(0)) {
+      return false;
+    }
+    *value = data + start;
+    *value_size = reader.position() - start;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,55 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MESSAGE_FILTER_H
+#define MESSAGE_FILTER_H
+
+#include <flutter/encodable_value.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A condition received messages have to meet to be sent to Dart. Messages
+// are checked still encoded with StandardMessageCodec, by peeking into the
+// top-level map, so dropped messages are never decoded. Conditions which
+// are not set match every message.
+class MessageFilter {
+ public:
+  // Compiles a filter map with optional "remoteAppIds" (a list of strings),
+  // "trusted" (a bool), "key" (a string) and "value" (a string, int or bool
+  // |key| has to map to). Returns false if |spec| is malformed.
+  static bool Create(const flutter::EncodableValue& spec,
+                     MessageFilter* filter);
+
+  bool Matches(const uint8_t* data, size_t size, const char* remote_app_id,
+               bool trusted_remote_port) const;
+
+  // Messages dropped because they did not match this filter.
+  uint64_t dropped() const { return dropped_; }
+  void AddDropped() { dropped_++; }
+
+ private:
+  enum class ValueType { kNone, kString, kInt, kBool };
+
+  bool MatchesPayload(const uint8_t* data, size_t size) const;
+
+  std::vector<std::string> remote_app_ids_;
+  // Unset if negative.
+  int trusted_ = -1;
+  bool has_key_ = false;
+  std::string key_;
+  ValueType value_type_ = ValueType::kNone;
+  std::string string_value_;
+  int64_t int_value_ = 0;
+  uint64_t dropped_ = 0;
+};
+
+// Finds |key| in the top-level map of |data|, a message encoded with
+// StandardMessageCodec. On success, |value| points to the encoded value,
+// starting with its type.
+bool PeekMapValue(const uint8_t* data, size_t size, const std::string& key,
+                  const uint8_t** value, size_t* value_size);
+
+#endif  // MESSAGE_FILTER_H
@@ -0,0 +1,109 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "message_pools.h"
+
+#include <cstring>
+#include <string>
+
+BundlePool::BundlePool(size_t capacity) : capacity_(capacity) {
+  free_.reserve(capacity);
+}
+
+BundlePool::~BundlePool() {
+  for (bundle* b : free_) {
+    bundle_free(b);
+  }
+}
+
+bundle* BundlePool::Acquire() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!free_.empty()) {
+      bundle* b = free_.back();
+      free_.pop_back();
+      reused_++;
+      return b;
+    }
+  }
+  created_++;
+  return bundle_create();
+}
+
+void BundlePool::Release(bundle* b) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.size() < capacity_) {
+      free_.push_back(b);
+      return;
+    }
+  }
+  bundle_free(b);
+}
+
+void BundlePool::AddStats(AllocationStats& stats) const {
+  stats.bundles_created += created_;
+  stats.bundles_reused += reused_;
+}
+
+EventArena::EventArena(size_t capacity) : capacity_(capacity) {
+  free_.reserve(capacity);
+}
+
+flutter::EncodableValue EventArena::Acquire() {
+  if (free_.empty()) {
+    created_++;
+    return flutter::EncodableValue(flutter::EncodableMap());
+  }
+  flutter::EncodableValue event = std::move(free_.back());
+  free_.pop_back();
+  reused_++;
+  return event;
+}
+
+void EventArena::Release(flutter::EncodableValue event) {
+  if (free_.size() < capacity_) {
+    free_.push_back(std::move(event));
+  }
+}
+
+void EventArena::ReleaseAll(flutter::EncodableList& events) {
+  for (auto& event : events) {
+    Release(std::move(event));
+  }
+  events.clear();
+}
+
+void EventArena::SetBytes(flutter::EncodableMap& map, const char* key,
+                          const uint8_t* data, size_t size) {
+  flutter::EncodableValue& value = map[flutter::EncodableValue(key)];
+  auto* bytes = std::get_if<std::vector<uint8_t>>(&value);
+  if (bytes == nullptr) {
+    value = std::vector<uint8_t>();
+    bytes = std::get_if<std::vector<uint8_t>>(&value);
+  }
+  if (bytes->capacity() < size) {
+    buffer_growths_++;
+  }
+  bytes->assign(data, data + size);
+}
+
+void EventArena::SetString(flutter::EncodableMap& map, const char* key,
+                           const char* value) {
+  flutter::EncodableValue& entry = map[flutter::EncodableValue(key)];
+  auto* string = std::get_if<std::string>(&entry);
+  if (string == nullptr) {
+    entry = std::string();
+    string = std::get_if<std::string>(&entry);
+  }
+  if (string->capacity() < strlen(value)) {
+    buffer_growths_++;
+  }
+  string->assign(value);
+}
+
+void EventArena::AddStats(AllocationStats& stats) const {
+  stats.events_created += created_;
+  stats.events_reused += reused_;
+  stats.buffer_growths += buffer_growths_;
+}
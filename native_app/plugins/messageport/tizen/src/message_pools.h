@@ -0,0 +1,110 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MESSAGE_POOLS_H
+#define MESSAGE_POOLS_H
+
+#include <bundle.h>
+#include <flutter/byte_streams.h>
+#include <flutter/encodable_value.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Counts allocations made by the pools. In the steady state only the
+// reused counters grow. Allocations outside the pools are not counted.
+// Once the pools are warm, Send and Reply allocate nothing themselves and
+// received messages are delivered in pooled events, though bundles still
+// allocate their keys and values and sends to a socket port allocate its
+// address.
+// Other sends allocate per call:
+// - SendAsync and coalesced batches allocate their sender task and
+//   completion, and a copy of the messages if the port has an outbox.
+// - Request allocates its pending entry and deadline.
+// - Broadcast allocates its shared state and a task per port, and copies
+//   the message once if any port has an outbox.
+struct AllocationStats {
+  size_t bundles_created = 0;
+  size_t bundles_reused = 0;
+  size_t events_created = 0;
+  size_t events_reused = 0;
+  size_t buffer_growths = 0;
+};
+
+// Bundles kept for reuse instead of being freed. Safe to use from any
+// thread, as bundles are released by sender threads too.
+class BundlePool {
+ public:
+  explicit BundlePool(size_t capacity);
+  ~BundlePool();
+
+  // Returns nullptr if a new bundle cannot be created.
+  bundle* Acquire();
+  // |b| must not hold any key anymore.
+  void Release(bundle* b);
+
+  void AddStats(AllocationStats& stats) const;
+
+ private:
+  size_t capacity_;
+  std::vector<bundle*> free_;
+  std::mutex mutex_;
+  std::atomic<size_t> created_{0};
+  std::atomic<size_t> reused_{0};
+};
+
+// Message events of one local port kept for reuse. Reused events keep the
+// capacity of their strings and byte buffers, so filling them does not
+// allocate once they are large enough.
+class EventArena {
+ public:
+  explicit EventArena(size_t capacity);
+
+  // Returns an event map, either a released one or a new empty one.
+  flutter::EncodableValue Acquire();
+  void Release(flutter::EncodableValue event);
+  // Releases all events of |events| and clears it, keeping its capacity.
+  void ReleaseAll(flutter::EncodableList& events);
+
+  void SetBytes(flutter::EncodableMap& map, const char* key,
+                const uint8_t* data, size_t size);
+  void SetString(flutter::EncodableMap& map, const char* key,
+                 const char* value);
+
+  void AddStats(AllocationStats& stats) const;
+
+ private:
+  size_t capacity_;
+  std::vector<flutter::EncodableValue> free_;
+  size_t created_ = 0;
+  size_t reused_ = 0;
+  size_t buffer_growths_ = 0;
+};
+
+// Appends to a vector the way StandardMessageCodec does, so a vector can
+// be reused for encoding.
+class VectorStreamWriter : public flutter::ByteStreamWriter {
+ public:
+  explicit VectorStreamWriter(std::vector<uint8_t>* bytes) : bytes_(bytes) {}
+
+  void WriteByte(uint8_t byte) override { bytes_->push_back(byte); }
+
+  void WriteBytes(const uint8_t* bytes, size_t length) override {
+    bytes_->insert(bytes_->end(), bytes, bytes + length);
+  }
+
+  void WriteAlignment(uint8_t alignment) override {
+    uint8_t mod = bytes_->size() % alignment;
+    if (mod) {
+      bytes_->insert(bytes_->end(), alignment - mod, 0);
+    }
+  }
+
+ private:
+  std::vector<uint8_t>* bytes_;
+};
+
+#endif  // MESSAGE_POOLS_H
@@ -4,47 +4,543 @@
 #include "messageport.h"
 
 #include <bundle.h>
-#include <flutter/standard_message_codec.h>
+#include <flutter/standard_codec_serializer.h>
 
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cinttypes>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 #include <vector>
 
 #include "log.h"
+#include "platform_thread.h"
 
-MessagePortManager::MessagePortManager() {}
+// Sends which are not done yet are rejected beyond this limit.
+static constexpr size_t kSendQueueCapacity = 256;
+
+// At most this many bundles and message events of a local port are kept
+// for reuse.
+static constexpr size_t kBundlePoolCapacity = 32;
+static constexpr size_t kEventArenaCapacity = 256;
+
+// Threads doing async sends and broadcasts.
+static constexpr size_t kSenderThreads = 4;
+
+// Events of less urgent classes wait at most this long behind more urgent
+// ones, in microseconds.
+static constexpr std::array<int64_t, kPriorityCount> kDeliveryMaxWaitUs = {
+    0, 20000, 100000};
+
+MessagePortManager::MessagePortManager()
+    : delivery_lanes_(kDeliveryMaxWaitUs),
+      bundle_pool_(kBundlePoolCapacity),
+      sender_(kSenderThreads, kSendQueueCapacity) {}
 
 MessagePortManager::~MessagePortManager() {
-  for (const auto& m : sinks_) {
-    int ret;
-    bool is_trusted = trusted_ports_.find(m.first) != trusted_ports_.end();
-    if (is_trusted) {
-      ret = message_port_unregister_trusted_local_port(m.first);
-    } else {
-      ret = message_port_unregister_local_port(m.first);
+  for (size_t i = 0; i < remote_ports_.size(); i++) {
+    RemotePortState& port = *remote_ports_.Get(i);
+    std::lock_guard<std::mutex> lock(port.mutex);
+    FlushBatch(port);
+  }
+  // Nothing runs on sender threads from here on, and tasks they left for
+  // the platform thread are dropped.
+  sender_.Stop();
+  alive_.reset();
+
+  // Pending requests are dropped without calling their callbacks.
+  if (request_timer_) {
+    ecore_timer_del(request_timer_);
+  }
+  if (lane_timer_) {
+    ecore_timer_del(lane_timer_);
+  }
+  for (size_t i = 0; i < remote_ports_.size(); i++) {
+    RemotePortState& port = *remote_ports_.Get(i);
+    if (port.outbox_timer) {
+      ecore_timer_del(port.outbox_timer);
     }
+  }
+  for (const auto& presence : presence_) {
+    message_port_remove_registration_event_cb(
+        presence.second.registered_watcher);
+    message_port_remove_registration_event_cb(
+        presence.second.unregistered_watcher);
+  }
+
+  local_ports_.ForEach([this](LocalPortState& port) {
+    FlushDeliveryBatch(port);
+    int ret =
+        port.transport->UnregisterLocalPort(port.native_id, port.is_trusted);
     if (MESSAGE_PORT_ERROR_NONE != ret) {
-      LOG_ERROR("Failed: message_port_unregister_%s_local_port",
-                is_trusted ? "trusted" : "");
+      LOG_ERROR("Failed to unregister local %sport %d",
+                port.is_trusted ? "trusted " : "", port.native_id);
+    }
+  });
+}
+
+// Bundle keys. A bundle holds either a single message under kMessageKey or
+// several coalesced messages under kBatchKey, each prefixed with its
+// uint32_t size. If kCodecKey is present, the payload is compressed with
+// the codec it names. Requests carry their id under kRequestIdKey, and
+// replies the id of the request under kReplyToKey, both as decimal strings.
+// State updates carry their sequence number under kSyncSeqKey and, if they
+// are diffs, the number of the state they apply to under kSyncBaseKey. A
+// bundle with kSyncResyncKey asks for a full state and holds no message.
+// Neither do bundles with kCodecOfferKey, which offer compression, or with
+// kCodecAcceptKey, which confirm it. Both name the codec and the id of the
+// dictionary, see CodecOffer.
+static const char* kMessageKey = "bytes";
+static const char* kBatchKey = "batch";
+static const char* kCodecKey = "codec";
+static const char* kDeflateCodec = "deflate";
+static const char* kRequestIdKey = "requestId";
+static const char* kReplyToKey = "replyTo";
+static const char* kSyncSeqKey = "syncSeq";
+static const char* kSyncBaseKey = "syncBase";
+static const char* kSyncResyncKey = "syncResync";
+static const char* kCodecOfferKey = "codecOffer";
+static const char* kCodecAcceptKey = "codecAccept";
+
+// Returns "<codec>/<dictionary id>", the compression |compressor| offers.
+static std::string CodecOffer(const PayloadCompressor& compressor) {
+  return std::string(kDeflateCodec) + "/" +
+         std::to_string(compressor.dictionary_id());
+}
+
+// Holds a number written by FormatNumber, so that ids and sequence numbers
+// are added to bundles without allocating.
+using NumberBuffer = char[21];
+
+static const char* FormatNumber(uint64_t value, NumberBuffer& buffer) {
+  snprintf(buffer, sizeof(buffer), "%" PRIu64, value);
+  return buffer;
+}
+
+// Returns the id stored under |key|, or zero if there is none.
+static uint32_t GetCorrelationId(bundle* b, const char* key) {
+  char* value = nullptr;
+  if (bundle_get_str(b, key, &value) != BUNDLE_ERROR_NONE) {
+    return 0;
+  }
+  return strtoul(value, nullptr, 10);
+}
+
+// Coalesced messages are sent earlier if the batch grows beyond this size.
+static constexpr size_t kMaxBatchBytes = 256 * 1024;
+
+// Seconds before stored messages are sent again, after sending them failed.
+static constexpr double kOutboxRetryDelay = 1.0;
+
+// Called with the mutex of |port| held.
+static uint64_t TakeTurn(RemotePortState& port) { return port.turns.next++; }
+
+// Gives back the last turn taken, when its send could not be queued.
+// Called with the mutex of |port| held since the turn was taken.
+static void GiveBackTurn(RemotePortState& port) { port.turns.next--; }
+
+static void WaitForTurn(RemotePortState& port,
+                        std::unique_lock<std::mutex>& lock, uint64_t turn) {
+  port.turns.ended.wait(lock,
+                        [&port, turn] { return port.turns.current == turn; });
+}
+
+// Sync sends on the platform thread wait at most this long for their turn.
+static constexpr std::chrono::seconds kPlatformTurnTimeout(1);
+
+// Waits for |turn| of a sync send. Returns false on the platform thread if
+// the turn does not come in time, which is then given up.
+static bool WaitForSyncTurn(RemotePortState& port,
+                            std::unique_lock<std::mutex>& lock,
+                            uint64_t turn) {
+  if (!IsPlatformThread()) {
+    WaitForTurn(port, lock, turn);
+    return true;
+  }
+  if (port.turns.ended.wait_for(lock, kPlatformTurnTimeout, [&port, turn] {
+        return port.turns.current == turn;
+      })) {
+    return true;
+  }
+  LOG_WARN("Gave up waiting for sends to %s", port.key.port_name.c_str());
+  port.turns.abandoned.insert(turn);
+  return false;
+}
+
+static void EndTurn(RemotePortState& port) {
+  {
+    std::lock_guard<std::mutex> lock(port.mutex);
+    SendTurns& turns = port.turns;
+    turns.current++;
+    while (!turns.abandoned.empty() &&
+           *turns.abandoned.begin() == turns.current) {
+      turns.abandoned.erase(turns.abandoned.begin());
+      turns.current++;
     }
   }
+  port.turns.ended.notify_all();
+}
+
+// Returns a send function doing |send| in |turn| of |port|.
+static AsyncSender::SendFunction InTurn(RemotePortState* port, uint64_t turn,
+                                        AsyncSender::SendFunction send) {
+  return [port, turn, send = std::move(send)]() {
+    {
+      std::unique_lock<std::mutex> lock(port->mutex);
+      WaitForTurn(*port, lock, turn);
+    }
+    int ret = send();
+    EndTurn(*port);
+    return ret;
+  };
 }
 
-static bool ConvertEncodableValueToBundle(flutter::EncodableValue& v,
-                                          bundle* b) {
+static bool AddBytesToBundle(const char* key, const std::vector<uint8_t>& data,
+                             bundle* b) {
   if (nullptr == b) {
     LOG_ERROR("Invalid bundle handle");
     return false;
   }
-  std::unique_ptr<std::vector<uint8_t>> encoded =
-      flutter::StandardMessageCodec::GetInstance().EncodeMessage(v);
 
-  int ret = bundle_add_byte(b, "bytes", encoded->data(), encoded->size());
+  int ret = bundle_add_byte(b, key, data.data(), data.size());
   if (BUNDLE_ERROR_NONE != ret) {
     return false;
   }
   return true;
 }
 
+void MessagePortManager::FillMessageEvent(EventArena& arena,
+                                          flutter::EncodableValue& event,
+                                          const uint8_t* data, size_t size,
+                                          const char* remote_app_id,
+                                          const char* remote_port,
+                                          bool trusted_remote_port,
+                                          uint32_t request_id) {
+  // The payload is forwarded still encoded, it is decoded on the Dart side.
+  flutter::EncodableMap& map = std::get<flutter::EncodableMap>(event);
+  // Queue pressure events are released to the arena too.
+  map.erase(flutter::EncodableValue("queuePressure"));
+  arena.SetBytes(map, "encodedMessage", data, size);
+  if (remote_port) {
+    arena.SetString(map, "remotePort", remote_port);
+  } else {
+    map.erase(flutter::EncodableValue("remotePort"));
+  }
+  arena.SetString(map, "remoteAppId", remote_app_id);
+
+  map[flutter::EncodableValue("trusted")] =
+      flutter::EncodableValue(trusted_remote_port);
+  if (request_id) {
+    map[flutter::EncodableValue("requestId")] =
+        flutter::EncodableValue(static_cast<int64_t>(request_id));
+  } else {
+    map.erase(flutter::EncodableValue("requestId"));
+  }
+}
+
+void MessagePortManager::Deliver(LocalPortState& port, const uint8_t* data,
+                                 size_t size, const char* remote_app_id,
+                                 const char* remote_port,
+                                 bool trusted_remote_port,
+                                 uint32_t request_id) {
+  for (auto& filter : port.filters) {
+    if (!filter.Matches(data, size, remote_app_id, trusted_remote_port)) {
+      filter.AddDropped();
+      return;
+    }
+  }
+
+  flutter::EncodableValue event = port.arena.Acquire();
+  FillMessageEvent(port.arena, event, data, size, remote_app_id, remote_port,
+                   trusted_remote_port, request_id);
+  if (port.queue.high_water_mark > 0) {
+    Enqueue(port, std::move(event), data, size);
+  } else {
+    Emit(port, std::move(event));
+  }
+}
+
+void MessagePortManager::Emit(LocalPortState& port,
+                              flutter::EncodableValue event) {
+  if (Priority::kHigh != port.priority) {
+    double loop_time = ecore_loop_time_get();
+    if (loop_time != budget_loop_time_) {
+      budget_loop_time_ = loop_time;
+      delivery_budget_used_ = 0;
+    }
+    // Events queued earlier in the same or a more urgent lane go first.
+    if (delivery_budget_used_ >= kDeliveryBudget ||
+        delivery_lanes_.HasQueued(port.priority)) {
+      delivery_lanes_.Push(port.priority, LaneEvent{&port, std::move(event)});
+      if (nullptr == lane_timer_) {
+        // A zero timer runs in the next main loop iteration.
+        lane_timer_ = ecore_timer_add(0.0, OnLaneTimer, this);
+      }
+      return;
+    }
+    delivery_budget_used_++;
+  }
+  Dispatch(port, std::move(event));
+}
+
+Eina_Bool MessagePortManager::OnLaneTimer(void* user_data) {
+  MessagePortManager* manager = static_cast<MessagePortManager*>(user_data);
+  manager->lane_timer_ = nullptr;
+  manager->DrainLanes();
+  return ECORE_CALLBACK_CANCEL;
+}
+
+void MessagePortManager::DrainLanes() {
+  budget_loop_time_ = ecore_loop_time_get();
+  delivery_budget_used_ = 0;
+  while (!delivery_lanes_.empty() &&
+         delivery_budget_used_ < kDeliveryBudget) {
+    LaneEvent queued = delivery_lanes_.Pop();
+    delivery_budget_used_++;
+    Dispatch(*queued.port, std::move(queued.event));
+  }
+  if (!delivery_lanes_.empty() && nullptr == lane_timer_) {
+    lane_timer_ = ecore_timer_add(0.0, OnLaneTimer, this);
+  }
+}
+
+void MessagePortManager::Dispatch(LocalPortState& port,
+                                  flutter::EncodableValue event) {
+  DeliveryBatch& batch = port.batch;
+  if (batch.max_batch_size < 2) {
+    SendEvent(port, event);
+    port.arena.Release(std::move(event));
+    return;
+  }
+
+  batch.events.push_back(std::move(event));
+  if (batch.events.size() >= batch.max_batch_size) {
+    FlushDeliveryBatch(port);
+    return;
+  }
+
+  if (nullptr == batch.timer) {
+    batch.timer = ecore_timer_add(batch.flush_interval, OnDeliveryTimer, &port);
+    if (nullptr == batch.timer) {
+      LOG_ERROR("Failed to add delivery timer, delivering now");
+      FlushDeliveryBatch(port);
+    }
+  }
+}
+
+void MessagePortManager::SendEvent(LocalPortState& port,
+                                   const flutter::EncodableValue& event) {
+  if (port.sink) {
+    port.sink->Success(event);
+    return;
+  }
+  if (port.pending.size() >= kMaxPendingEvents) {
+    port.pending.pop_front();
+  }
+  port.pending.push_back(PendingEvent{Tracer::NowUs(), event});
+}
+
+void MessagePortManager::SendError(LocalPortState& port,
+                                   const std::string& error_code,
+                                   const std::string& error_message) {
+  if (port.sink) {
+    port.sink->Error(error_code, error_message);
+  } else {
+    LOG_ERROR("%s: %s", error_code.c_str(), error_message.c_str());
+  }
+}
+
+Eina_Bool MessagePortManager::OnDeliveryTimer(void* user_data) {
+  LocalPortState* port = static_cast<LocalPortState*>(user_data);
+  // The timer is deleted by Ecore after returning ECORE_CALLBACK_CANCEL.
+  port->batch.timer = nullptr;
+  port->manager->FlushDeliveryBatch(*port);
+  return ECORE_CALLBACK_CANCEL;
+}
+
+void MessagePortManager::FlushDeliveryBatch(LocalPortState& port) {
+  DeliveryBatch& batch = port.batch;
+  if (batch.timer) {
+    ecore_timer_del(batch.timer);
+    batch.timer = nullptr;
+  }
+  if (batch.events.empty()) {
+    return;
+  }
+
+  TraceScope trace(tracer_, TraceEvent::kFlushDelivery, port.stats->trace_port,
+                   batch.events.size());
+  LOG_DEBUG("FlushDeliveryBatch, local_port_id: %d, messages: %zu",
+            port.native_id, batch.events.size());
+
+  // Events and the list are moved back after sending, so that the arena
+  // and the batch keep their capacity.
+  flutter::EncodableValue events(std::move(batch.events));
+  SendEvent(port, events);
+  batch.events = std::move(std::get<flutter::EncodableList>(events));
+  port.arena.ReleaseAll(batch.events);
+}
+
+void MessagePortManager::Enqueue(LocalPortState& port,
+                                 flutter::EncodableValue event,
+                                 const uint8_t* data, size_t size) {
+  InboundQueue& queue = port.queue;
+  if (queue.events.empty() && queue.in_flight < queue.window) {
+    queue.in_flight++;
+    Emit(port, std::move(event));
+    return;
+  }
+
+  std::vector<uint8_t> key;
+  const uint8_t* value;
+  size_t value_size;
+  if (queue.policy == OverflowPolicy::kCoalesceByKey &&
+      PeekMapValue(data, size, queue.coalesce_key, &value, &value_size)) {
+    key.assign(value, value + value_size);
+    for (auto& queued : queue.events) {
+      if (queued.key == key) {
+        port.arena.Release(std::move(queued.event));
+        queued.event = std::move(event);
+        queue.dropped++;
+        return;
+      }
+    }
+  }
+
+  if (queue.events.size() >= queue.high_water_mark) {
+    queue.dropped++;
+    if (queue.policy == OverflowPolicy::kDropNewest) {
+      port.arena.Release(std::move(event));
+      return;
+    }
+    port.arena.Release(std::move(queue.events.front().event));
+    queue.events.pop_front();
+  }
+  queue.events.push_back(QueuedEvent{std::move(event), std::move(key)});
+
+  if (!queue.above_high_water_mark &&
+      queue.events.size() >= queue.high_water_mark) {
+    queue.above_high_water_mark = true;
+    ReportQueuePressure(port);
+  }
+}
+
+void MessagePortManager::PumpQueue(LocalPortState& port) {
+  InboundQueue& queue = port.queue;
+  while (!queue.events.empty() && queue.in_flight < queue.window) {
+    flutter::EncodableValue event = std::move(queue.events.front().event);
+    queue.events.pop_front();
+    queue.in_flight++;
+    Emit(port, std::move(event));
+  }
+
+  if (queue.above_high_water_mark &&
+      queue.events.size() <= queue.high_water_mark / 2) {
+    queue.above_high_water_mark = false;
+    ReportQueuePressure(port);
+  }
+}
+
+void MessagePortManager::ReportQueuePressure(LocalPortState& port) {
+  const InboundQueue& queue = port.queue;
+  LOG_WARN("Inbound queue of local port %d is %s the high water mark",
+           port.native_id, queue.above_high_water_mark ? "above" : "below");
+  flutter::EncodableMap pressure;
+  pressure[flutter::EncodableValue("aboveHighWaterMark")] =
+      flutter::EncodableValue(queue.above_high_water_mark);
+  pressure[flutter::EncodableValue("queued")] =
+      flutter::EncodableValue(static_cast<int64_t>(queue.events.size()));
+  pressure[flutter::EncodableValue("dropped")] =
+      flutter::EncodableValue(static_cast<int64_t>(queue.dropped));
+  flutter::EncodableMap event;
+  event[flutter::EncodableValue("queuePressure")] =
+      flutter::EncodableValue(std::move(pressure));
+  // Takes the lane and the batch of messages, so that events stay in order.
+  Emit(port, flutter::EncodableValue(std::move(event)));
+}
+
+MessagePortResult MessagePortManager::SetFlowControl(
+    int local_port, size_t high_water_mark, size_t window,
+    OverflowPolicy policy, std::string coalesce_key) {
+  LOG_DEBUG(
+      "SetFlowControl, local_port: %d, high_water_mark: %zu, window: %zu",
+      local_port, high_water_mark, window);
+  LocalPortState* port = GetLocalPort(local_port);
+  if (nullptr == port || (high_water_mark > 0 && window == 0)) {
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+  }
+
+  InboundQueue& queue = port->queue;
+  queue.high_water_mark = high_water_mark;
+  queue.window = window;
+  queue.policy = policy;
+  queue.coalesce_key = std::move(coalesce_key);
+  if (high_water_mark == 0) {
+    // Every queued message is sent right away.
+    queue.window = SIZE_MAX;
+    PumpQueue(*port);
+    queue.in_flight = 0;
+  } else {
+    PumpQueue(*port);
+  }
+  return CreateResult(MESSAGE_PORT_ERROR_NONE);
+}
+
+MessagePortResult MessagePortManager::AckDelivered(int local_port,
+                                                   size_t count) {
+  LocalPortState* port = GetLocalPort(local_port);
+  if (nullptr == port) {
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+  }
+  InboundQueue& queue = port->queue;
+  queue.in_flight = count < queue.in_flight ? queue.in_flight - count : 0;
+  PumpQueue(*port);
+  return CreateResult(MESSAGE_PORT_ERROR_NONE);
+}
+
+MessagePortResult MessagePortManager::SetDeliveryPriority(int local_port,
+                                                          Priority priority) {
+  LocalPortState* port = GetLocalPort(local_port);
+  if (nullptr == port) {
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+  }
+  port->priority = priority;
+  return CreateResult(MESSAGE_PORT_ERROR_NONE);
+}
+
+MessagePortResult MessagePortManager::SetSendPriority(int remote_port,
+                                                      Priority priority) {
+  RemotePortState* port = GetRemotePort(remote_port);
+  if (nullptr == port) {
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+  }
+  sender_.SetPriority(port->send_queue, priority);
+  return CreateResult(MESSAGE_PORT_ERROR_NONE);
+}
+
+MessagePortResult MessagePortManager::SetInboundBatching(
+    int local_port, size_t max_batch_size, int64_t flush_interval_us) {
+  LOG_DEBUG(
+      "SetInboundBatching, local_port: %d, max_batch_size: %zu, "
+      "flush_interval_us: %lld",
+      local_port, max_batch_size, static_cast<long long>(flush_interval_us));
+  LocalPortState* port = GetLocalPort(local_port);
+  if (nullptr == port || flush_interval_us < 0) {
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+  }
+
+  if (max_batch_size < 2) {
+    FlushDeliveryBatch(*port);
+  }
+  port->batch.max_batch_size = max_batch_size;
+  port->batch.flush_interval = flush_interval_us / 1000000.0;
+  return CreateResult(MESSAGE_PORT_ERROR_NONE);
+}
+
 void MessagePortManager::OnMessageReceived(int local_port_id,
                                            const char* remote_app_id,
                                            const char* remote_port,
@@ -56,178 +552,1684 @@ void MessagePortManager::OnMessageReceived(int local_port_id,
       local_port_id, remote_app_id, remote_port,
       trusted_remote_port ? "yes" : "no");
 
-  MessagePortManager* manager = static_cast<MessagePortManager*>(user_data);
+  // Each registration gets its own state, so no lookup is needed here.
+  LocalPortState* port = static_cast<LocalPortState*>(user_data);
+  LocalPortStats& stats = *port->stats;
 
-  if (manager->sinks_.find(local_port_id) != manager->sinks_.end()) {
-    uint8_t* byte_array = NULL;
-    size_t size = 0;
+  TraceScope trace(port->manager->tracer_, TraceEvent::kReceive,
+                   stats.trace_port, 0);
+  Stopwatch stopwatch;
+  size_t messages = 0;
+  size_t bytes = 0;
+  if (!port->manager->DeliverBundle(*port, message, remote_app_id,
+                                    remote_port, trusted_remote_port,
+                                    &messages, &bytes)) {
+    stats.AddFailure();
+  }
+  stats.Add(messages, bytes);
+  trace.set_size(bytes);
+  stats.decode_time.Record(stopwatch.ElapsedUs());
+}
 
-    int ret = bundle_get_byte(message, "bytes", (void**)&byte_array, &size);
-    if (ret != BUNDLE_ERROR_NONE) {
-      manager->sinks_[local_port_id]->Error("Failed to parse a response");
-    }
+bool MessagePortManager::DeliverBundle(LocalPortState& port, bundle* message,
+                                       const char* remote_app_id,
+                                       const char* remote_port,
+                                       bool trusted_remote_port,
+                                       size_t* messages, size_t* bytes) {
+  char* resync = nullptr;
+  if (bundle_get_str(message, kSyncResyncKey, &resync) == BUNDLE_ERROR_NONE) {
+    HandleResyncRequest(port, remote_app_id, remote_port, trusted_remote_port);
+    return true;
+  }
+  char* codec = nullptr;
+  if (bundle_get_str(message, kCodecOfferKey, &codec) == BUNDLE_ERROR_NONE) {
+    HandleCodecOffer(port, codec, remote_app_id, remote_port,
+                     trusted_remote_port);
+    return true;
+  }
+  if (bundle_get_str(message, kCodecAcceptKey, &codec) == BUNDLE_ERROR_NONE) {
+    HandleCodecAccept(port, codec, remote_app_id, remote_port,
+                      trusted_remote_port);
+    return true;
+  }
 
-    std::vector<uint8_t> encoded(byte_array, byte_array + size);
+  uint8_t* byte_array = NULL;
+  size_t size = 0;
 
-    auto value =
-        flutter::StandardMessageCodec::GetInstance().DecodeMessage(encoded);
+  bool is_batch = false;
+  int ret = bundle_get_byte(message, kMessageKey, (void**)&byte_array, &size);
+  if (ret != BUNDLE_ERROR_NONE) {
+    is_batch = true;
+    ret = bundle_get_byte(message, kBatchKey, (void**)&byte_array, &size);
+  }
+  if (ret != BUNDLE_ERROR_NONE) {
+    SendError(port, "Failed to parse a response");
+    return false;
+  }
+  *bytes = size;
 
-    flutter::EncodableMap map;
-    map[flutter::EncodableValue("message")] = *(value.get());
-    if (remote_port) {
-      map[flutter::EncodableValue("remotePort")] =
-          flutter::EncodableValue(std::string(remote_port));
+  if (bundle_get_str(message, kCodecKey, &codec) == BUNDLE_ERROR_NONE) {
+    if (strcmp(codec, kDeflateCodec) != 0) {
+      SendError(port, "Failed to parse a response", "Unsupported codec");
+      return false;
     }
-    map[flutter::EncodableValue("remoteAppId")] =
-        flutter::EncodableValue(remote_app_id);
+    if (!port.decompressor) {
+      port.decompressor = std::make_unique<PayloadDecompressor>();
+    }
+    if (!port.decompressor->Decompress(byte_array, size, compress_buffer_)) {
+      SendError(port, "Failed to parse a response",
+                "Could not decompress message");
+      return false;
+    }
+    byte_array = compress_buffer_.data();
+    size = compress_buffer_.size();
+  }
 
-    map[flutter::EncodableValue("trusted")] =
-        flutter::EncodableValue(trusted_remote_port);
+  if (!is_batch) {
+    *messages = 1;
+    if (GetCorrelationId(message, kSyncSeqKey)) {
+      DeliverStateUpdate(port, message, byte_array, size, remote_app_id,
+                         remote_port, trusted_remote_port);
+      return true;
+    }
+    uint32_t reply_to = GetCorrelationId(message, kReplyToKey);
+    if (reply_to &&
+        CompleteRequest(reply_to, port, remote_app_id, byte_array, size)) {
+      return true;
+    }
+    // Replies to requests which timed out are delivered as messages.
+    Deliver(port, byte_array, size, remote_app_id, remote_port,
+            trusted_remote_port, GetCorrelationId(message, kRequestIdKey));
+    return true;
+  }
 
-    manager->sinks_[local_port_id]->Success(flutter::EncodableValue(map));
+  size_t offset = 0;
+  while (offset < size) {
+    uint32_t message_size = 0;
+    if (size - offset < sizeof(message_size)) {
+      SendError(port, "Failed to parse a response", "Malformed batch");
+      return false;
+    }
+    memcpy(&message_size, byte_array + offset, sizeof(message_size));
+    offset += sizeof(message_size);
+    if (size - offset < message_size) {
+      SendError(port, "Failed to parse a response", "Malformed batch");
+      return false;
+    }
+    Deliver(port, byte_array + offset, message_size, remote_app_id,
+            remote_port, trusted_remote_port, 0);
+    (*messages)++;
+    offset += message_size;
   }
+  return true;
 }
 
 MessagePortResult MessagePortManager::RegisterLocalPort(
     const std::string& port_name, EventSink sink, bool is_trusted,
-    int* local_port) {
+    TransportType transport, int* local_port) {
   LOG_DEBUG("RegisterLocalPort: %s, is_trusted: %s", port_name.c_str(),
             is_trusted ? "yes" : "no");
-  int ret = -1;
-  if (is_trusted) {
-    ret = message_port_register_trusted_local_port(port_name.c_str(),
-                                                   OnMessageReceived, this);
-  } else {
-    ret = message_port_register_local_port(port_name.c_str(), OnMessageReceived,
-                                           this);
-  }
+  auto port = std::unique_ptr<LocalPortState>(new LocalPortState{
+      this, GetTransport(transport), -1, is_trusted, std::move(sink), {},
+      EventArena(kEventArenaCapacity), &LocalStats(port_name, is_trusted),
+      DeliveryBatch{0, 0, {}, nullptr}, nullptr, {},
+      InboundQueue{0, 0, OverflowPolicy::kDropOldest, {}, {}, 0, 0, false},
+      Priority::kNormal, {}});
 
+  int ret = port->transport->RegisterLocalPort(port_name, is_trusted,
+                                               OnMessageReceived, port.get());
   if (ret < 0) {
     return CreateResult(ret);
   }
+  port->native_id = ret;
+  *local_port = local_ports_.Add(std::move(port));
+  LOG_DEBUG("Successfully opened local %s port, native id: %d, handle: %d",
+            port_name.c_str(), ret, *local_port);
 
-  *local_port = ret;
-  LOG_DEBUG("Successfully opened local %s port, native id: %d",
-            port_name.c_str(), *local_port);
+  return CreateResult(MESSAGE_PORT_ERROR_NONE);
+}
+
+MessagePortResult MessagePortManager::UnregisterLocalPort(int local_port) {
+  LOG_DEBUG("UnregisterLocalPort: %d", local_port);
+  LocalPortState* port = GetLocalPort(local_port);
+  if (nullptr == port) {
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+  }
+
+  int ret =
+      port->transport->UnregisterLocalPort(port->native_id, port->is_trusted);
+  if (MESSAGE_PORT_ERROR_NONE == ret) {
+    delivery_lanes_.RemoveIf(
+        [port](const LaneEvent& queued) { return queued.port == port; });
+    FlushDeliveryBatch(*port);
+    // Threads sending with the port as reply port may still hold it.
+    local_ports_.Remove(local_port);
+  }
 
-  sinks_[*local_port] = std::move(sink);
+  return CreateResult(ret);
+}
+
+MessagePortResult MessagePortManager::AttachSink(int local_port,
+                                                 EventSink sink) {
+  LocalPortState* port = GetLocalPort(local_port);
+  if (nullptr == port || !sink) {
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+  }
 
-  if (is_trusted) {
-    trusted_ports_.insert(*local_port);
+  port->sink = std::move(sink);
+  if (!port->pending.empty()) {
+    LOG_INFO("Replaying %zu events of local port %d", port->pending.size(),
+             local_port);
+  }
+  int64_t now_us = Tracer::NowUs();
+  for (const PendingEvent& pending : port->pending) {
+    port->stats->replay_delay.Record(now_us - pending.created_us);
+    port->sink->Success(pending.event);
   }
+  port->pending.clear();
+  return CreateResult(MESSAGE_PORT_ERROR_NONE);
+}
 
+MessagePortResult MessagePortManager::DetachSink(int local_port) {
+  LocalPortState* port = GetLocalPort(local_port);
+  if (nullptr == port) {
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+  }
+  // Batched events still go to the sink being detached.
+  FlushDeliveryBatch(*port);
+  port->sink.reset();
   return CreateResult(MESSAGE_PORT_ERROR_NONE);
 }
 
-MessagePortResult MessagePortManager::UnregisterLocalPort(int local_port_id) {
-  LOG_DEBUG("UnregisterLocalPort: %d", local_port_id);
-  bool is_trusted = trusted_ports_.find(local_port_id) != trusted_ports_.end();
-  int ret = -1;
+LocalPortState* MessagePortManager::GetLocalPort(int local_port) const {
+  return local_ports_.Get(local_port).get();
+}
 
-  if (is_trusted) {
-    ret = message_port_unregister_trusted_local_port(local_port_id);
-  } else {
-    ret = message_port_unregister_local_port(local_port_id);
+RemotePortState* MessagePortManager::GetRemotePort(int remote_port) const {
+  return remote_ports_.Get(remote_port);
+}
+
+MessagePortManager::HandleShard& MessagePortManager::ShardOf(
+    const RemotePortKey& key) const {
+  std::hash<std::string> hash;
+  return handle_shards_[(hash(key.app_id) * 31 + hash(key.port_name)) %
+                        kHandleShards];
+}
+
+RemotePortState* MessagePortManager::FindRemotePort(
+    const RemotePortKey& key) const {
+  HandleShard& shard = ShardOf(key);
+  std::shared_lock<std::shared_mutex> lock(shard.mutex);
+  auto handle = shard.handles.find(key);
+  if (handle == shard.handles.end()) {
+    return nullptr;
   }
+  return remote_ports_.Get(handle->second);
+}
 
-  if (MESSAGE_PORT_ERROR_NONE == ret) {
-    sinks_.erase(local_port_id);
-    if (is_trusted) {
-      trusted_ports_.erase(local_port_id);
+Transport* MessagePortManager::GetTransport(TransportType type) {
+  if (TransportType::kMessagePort == type) {
+    return &message_port_transport_;
+  }
+  std::call_once(socket_transport_once_, [this] {
+    socket_transport_ = std::make_unique<SocketTransport>();
+  });
+  return socket_transport_.get();
+}
+
+int MessagePortManager::OpenRemotePort(const RemotePortKey& key) {
+  HandleShard& shard = ShardOf(key);
+  {
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    auto handle = shard.handles.find(key);
+    if (handle != shard.handles.end()) {
+      return handle->second;
     }
   }
 
-  return CreateResult(ret);
+  std::unique_lock<std::shared_mutex> lock(shard.mutex);
+  // Another thread may have opened the port meanwhile.
+  auto handle = shard.handles.find(key);
+  if (handle != shard.handles.end()) {
+    return handle->second;
+  }
+  auto port = std::unique_ptr<RemotePortState>(new RemotePortState{
+      this, key, GetTransport(key.transport), {}, {}, {0, 0, {}, {}},
+      SendBatch{0, 0, 0, {}, nullptr, false, {}}, nullptr, {}, nullptr, -1,
+      nullptr, 0, nullptr, false});
+  port->stats.trace_port =
+      tracer_.RegisterPort("remote:" + key.app_id + "/" + key.port_name +
+                           (key.is_trusted ? " (trusted)" : "") +
+                           (TransportType::kSocket == key.transport
+                                ? " (socket)"
+                                : ""));
+  int new_handle;
+  {
+    std::lock_guard<std::mutex> add_lock(remote_ports_mutex_);
+    new_handle = remote_ports_.Add(std::move(port));
+  }
+  if (new_handle < 0) {
+    LOG_ERROR("Too many remote ports, could not open %s",
+              key.port_name.c_str());
+    return -1;
+  }
+  shard.handles[key] = new_handle;
+  LOG_DEBUG("OpenRemotePort (%s, %s), handle: %d", key.app_id.c_str(),
+            key.port_name.c_str(), new_handle);
+  return new_handle;
 }
 
-MessagePortResult MessagePortManager::CheckRemotePort(
-    std::string& remote_app_id, std::string& port_name, bool is_trusted,
-    bool* port_check) {
+MessagePortResult MessagePortManager::CheckRemotePort(const RemotePortKey& key,
+                                                      bool* port_check) {
+  const std::string& port_name = key.port_name;
+  bool is_trusted = key.is_trusted;
   LOG_DEBUG("CheckRemotePort remote_app_id: %s, port_name: %s, trusted: %s",
-            remote_app_id.c_str(), port_name.c_str(),
-            is_trusted ? "yes" : "no");
+            key.app_id.c_str(), port_name.c_str(), is_trusted ? "yes" : "no");
 
-  int ret;
-  if (is_trusted) {
-    ret = message_port_check_trusted_remote_port(remote_app_id.c_str(),
-                                                 port_name.c_str(), port_check);
-  } else {
-    ret = message_port_check_remote_port(remote_app_id.c_str(),
-                                         port_name.c_str(), port_check);
+  if (TransportType::kMessagePort != key.transport) {
+    int ret = GetTransport(key.transport)
+                  ->CheckRemotePort(key.app_id, port_name, is_trusted,
+                                    port_check);
+    // Registrations of these ports are not watched.
+    if (MESSAGE_PORT_ERROR_NONE == ret && *port_check) {
+      ResumeOutbox(key);
+    }
+    return CreateResult(ret);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(presence_mutex_);
+    auto presence = presence_.find(key);
+    if (presence != presence_.end()) {
+      *port_check = presence->second.is_registered;
+      LOG_DEBUG("Cached presence of %s: %s", port_name.c_str(),
+                *port_check ? "true" : "false");
+      return CreateResult(MESSAGE_PORT_ERROR_NONE);
+    }
   }
 
+  int ret = message_port_transport_.CheckRemotePort(key.app_id, port_name,
+                                                    is_trusted, port_check);
+
   LOG_DEBUG("message_port_check_%s_remote_port (%s): %s",
             is_trusted ? "trusted" : "", port_name.c_str(),
             *port_check ? "true" : "false");
 
+  if (MESSAGE_PORT_ERROR_NONE == ret) {
+    WatchRemotePort(key, *port_check);
+  }
+
   return CreateResult(ret);
 }
 
-MessagePortResult MessagePortManager::Send(std::string& remote_app_id,
-                                           std::string& port_name,
-                                           flutter::EncodableValue& message,
-                                           bool is_trusted) {
-  LOG_DEBUG("Send (%s, %s), trusted: %s", remote_app_id.c_str(),
-            port_name.c_str(), is_trusted ? "yes" : "no");
-  bundle* b = nullptr;
-  MessagePortResult result = PrepareBundle(message, b);
-  if (!result) {
-    return result;
+void MessagePortManager::SetPresenceListener(PresenceListener listener) {
+  presence_listener_ = std::move(listener);
+}
+
+LocalPortStats& MessagePortManager::LocalStats(const std::string& port_name,
+                                              bool is_trusted) {
+  auto inserted = local_stats_.try_emplace({port_name, is_trusted});
+  LocalPortStats& stats = inserted.first->second;
+  if (inserted.second) {
+    stats.trace_port = tracer_.RegisterPort(
+        "local:" + port_name + (is_trusted ? " (trusted)" : ""));
   }
+  return stats;
+}
 
-  int ret;
-  if (is_trusted) {
-    ret = message_port_send_trusted_message(remote_app_id.c_str(),
-                                            port_name.c_str(), b);
-  } else {
-    ret =
-        message_port_send_message(remote_app_id.c_str(), port_name.c_str(), b);
+void MessagePortManager::WatchRemotePort(const RemotePortKey& key,
+                                         bool is_registered) {
+  RemotePortPresence presence{is_registered, -1, -1};
+  int ret = message_port_add_registered_cb(
+      key.app_id.c_str(), key.port_name.c_str(), key.is_trusted,
+      OnRemotePortRegistered, this, &presence.registered_watcher);
+  if (MESSAGE_PORT_ERROR_NONE != ret) {
+    LOG_WARN("Failed to watch registration of %s: %s", key.port_name.c_str(),
+             get_error_message(ret));
+    return;
+  }
+
+  ret = message_port_add_unregistered_cb(
+      key.app_id.c_str(), key.port_name.c_str(), key.is_trusted,
+      OnRemotePortUnregistered, this, &presence.unregistered_watcher);
+  if (MESSAGE_PORT_ERROR_NONE != ret) {
+    LOG_WARN("Failed to watch unregistration of %s: %s",
+             key.port_name.c_str(), get_error_message(ret));
+    message_port_remove_registration_event_cb(presence.registered_watcher);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(presence_mutex_);
+  if (!presence_.emplace(key, presence).second) {
+    // Another thread started watching the port meanwhile.
+    message_port_remove_registration_event_cb(presence.registered_watcher);
+    message_port_remove_registration_event_cb(presence.unregistered_watcher);
+  }
+}
+
+void MessagePortManager::OnRemotePortRegistered(const char* remote_app_id,
+                                                const char* remote_port,
+                                                bool trusted_remote_port,
+                                                void* user_data) {
+  MessagePortManager* manager = static_cast<MessagePortManager*>(user_data);
+  manager->UpdatePresence({remote_app_id, remote_port, trusted_remote_port},
+                          true);
+}
+
+void MessagePortManager::OnRemotePortUnregistered(const char* remote_app_id,
+                                                  const char* remote_port,
+                                                  bool trusted_remote_port,
+                                                  void* user_data) {
+  MessagePortManager* manager = static_cast<MessagePortManager*>(user_data);
+  manager->UpdatePresence({remote_app_id, remote_port, trusted_remote_port},
+                          false);
+}
+
+void MessagePortManager::UpdatePresence(const RemotePortKey& key,
+                                        bool is_registered) {
+  LOG_DEBUG("UpdatePresence (%s, %s), registered: %s", key.app_id.c_str(),
+            key.port_name.c_str(), is_registered ? "yes" : "no");
+  {
+    std::lock_guard<std::mutex> lock(presence_mutex_);
+    auto presence = presence_.find(key);
+    if (presence == presence_.end() ||
+        presence->second.is_registered == is_registered) {
+      return;
+    }
+    presence->second.is_registered = is_registered;
+  }
+  if (is_registered) {
+    ResumeOutbox(key);
+  }
+  // Called without the lock, the listener may check other ports.
+  if (presence_listener_) {
+    presence_listener_(key, is_registered);
   }
-  bundle_free(b);
-  return CreateResult(ret);
 }
 
-MessagePortResult MessagePortManager::Send(std::string& remote_app_id,
-                                           std::string& port_name,
-                                           flutter::EncodableValue& message,
-                                           bool is_trusted, int local_port) {
-  LOG_DEBUG("Send (%s, %s), port: %d, trusted: %s", remote_app_id.c_str(),
-            port_name.c_str(), local_port, is_trusted ? "yes" : "no");
+MessagePortResult MessagePortManager::Send(
+    int remote_port, const std::vector<uint8_t>& encoded_message,
+    int local_port) {
+  LOG_DEBUG("Send, remote_port: %d, local_port: %d", remote_port, local_port);
+  RemotePortState* port = GetRemotePort(remote_port);
+  std::shared_ptr<LocalPortState> reply_port;
+  if (local_port != kNoLocalPort) {
+    reply_port = local_ports_.Get(local_port);
+  }
+  if (nullptr == port || (local_port != kNoLocalPort &&
+                           (nullptr == reply_port ||
+                            reply_port->transport != port->transport))) {
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+  }
+  port->stats.Add(1, encoded_message.size());
+  TraceScope trace(tracer_, TraceEvent::kSend, port->stats.trace_port,
+                   encoded_message.size());
+
+  std::unique_lock<std::mutex> lock(port->mutex);
+  if (port->batch.max_batch_size > 0) {
+    if (nullptr == reply_port) {
+      return QueueMessage(*port, encoded_message);
+    }
+    // Messages queued earlier have to reach the remote port first.
+    FlushBatch(*port);
+  }
+
   bundle* b = nullptr;
-  MessagePortResult result = PrepareBundle(message, b);
+  MessagePortResult result =
+      PrepareBundle(*port, kMessageKey, encoded_message, b);
   if (!result) {
     return result;
   }
-  int ret;
-  if (is_trusted) {
-    ret = message_port_send_trusted_message_with_local_port(
-        remote_app_id.c_str(), port_name.c_str(), b, local_port);
-  } else {
-    ret = message_port_send_message_with_local_port(
-        remote_app_id.c_str(), port_name.c_str(), b, local_port);
+  // Messages with a port to reply to are never stored, the reply would not
+  // come to this run of the application.
+  bool can_store = nullptr == reply_port && port->outbox;
+  if (!WaitForSyncTurn(*port, lock, TakeTurn(*port))) {
+    ReleaseBundle(b);
+    port->stats.AddFailure();
+    return CreateResult(MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE);
   }
+  lock.unlock();
 
-  bundle_free(b);
-
-  return CreateResult(ret);
+  result = SendInTurn(*port, b, reply_port ? reply_port->native_id : -1,
+                      can_store ? &encoded_message : nullptr, false);
+  EndTurn(*port);
+  ReleaseBundle(b);
+  return result;
 }
 
-MessagePortResult MessagePortManager::PrepareBundle(
-    flutter::EncodableValue& message, bundle*& b) {
-  b = bundle_create();
-  if (nullptr == b) {
-    return CreateResult(MESSAGE_PORT_ERROR_OUT_OF_MEMORY);
+MessagePortResult MessagePortManager::SendAsync(
+    int remote_port, const std::vector<uint8_t>& encoded_message,
+    int local_port, SendCallback on_done) {
+  LOG_DEBUG("SendAsync, remote_port: %d, local_port: %d", remote_port,
+            local_port);
+  RemotePortState* port = GetRemotePort(remote_port);
+  std::shared_ptr<LocalPortState> reply_port;
+  if (local_port != kNoLocalPort) {
+    reply_port = local_ports_.Get(local_port);
+  }
+  if (nullptr == port || (local_port != kNoLocalPort &&
+                           (nullptr == reply_port ||
+                            reply_port->transport != port->transport))) {
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
   }
+  port->stats.Add(1, encoded_message.size());
+  TraceScope trace(tracer_, TraceEvent::kSendAsync, port->stats.trace_port,
+                   encoded_message.size());
 
-  bool result = ConvertEncodableValueToBundle(message, b);
+  std::unique_lock<std::mutex> lock(port->mutex);
+  if (port->batch.max_batch_size > 0) {
+    if (nullptr == reply_port) {
+      // Queued messages are done once their batch is sent. Failures to
+      // send it, even from here, are reported to |on_done|.
+      port->batch.callbacks.push_back(std::move(on_done));
+      QueueMessage(*port, encoded_message);
+      return CreateResult(MESSAGE_PORT_ERROR_NONE);
+    }
+    // Messages queued earlier have to reach the remote port first.
+    FlushBatch(*port);
+  }
+
+  bundle* b = nullptr;
+  MessagePortResult result =
+      PrepareBundle(*port, kMessageKey, encoded_message, b);
   if (!result) {
-    LOG_ERROR("Failed to parse EncodableValue");
-    bundle_free(b);
-    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+    return result;
+  }
+
+  // The native id is copied, as the local port may be unregistered before
+  // the message is sent. The message is copied too if it can be stored.
+  int local_port_id = reply_port ? reply_port->native_id : -1;
+  std::shared_ptr<std::vector<uint8_t>> kept;
+  if (nullptr == reply_port && port->outbox) {
+    kept = std::make_shared<std::vector<uint8_t>>(encoded_message);
+  }
+  bool queued = sender_.Post(
+      port->send_queue,
+      InTurn(port, TakeTurn(*port),
+             [this, port, b, local_port_id, kept]() {
+               int ret =
+                   SendInTurn(*port, b, local_port_id, kept.get(), false)
+                       .error_code;
+               ReleaseBundle(b);
+               return ret;
+             }),
+      [on_done = std::move(on_done)](int ret) {
+        on_done(CreateResult(ret));
+      });
+  if (!queued) {
+    GiveBackTurn(*port);
+    lock.unlock();
+    ReleaseBundle(b);
+    port->stats.AddFailure();
+    return CreateResult(MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE);
   }
   return CreateResult(MESSAGE_PORT_ERROR_NONE);
 }
 
+MessagePortResult MessagePortManager::Broadcast(
+    const std::vector<int>& remote_ports,
+    const std::vector<uint8_t>& encoded_message, BroadcastCallback on_done) {
+  LOG_DEBUG("Broadcast, remote ports: %zu", remote_ports.size());
+  TraceScope trace(tracer_, TraceEvent::kBroadcast, 0, encoded_message.size());
+  std::vector<RemotePortState*> ports;
+  ports.reserve(remote_ports.size());
+  for (int remote_port : remote_ports) {
+    RemotePortState* port = GetRemotePort(remote_port);
+    if (nullptr == port) {
+      return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+    }
+    ports.push_back(port);
+  }
+  if (ports.empty()) {
+    on_done({});
+    return CreateResult(MESSAGE_PORT_ERROR_NONE);
+  }
+
+  // Each port is sent its own bundle, prepared as its sends are, since
+  // bundles are not safe to share between threads. The message is copied
+  // only once a port has an outbox to store it in, before that port's send
+  // is posted, and sends to other ports do not read it.
+  struct BroadcastState {
+    std::vector<uint8_t> message;
+    bool message_kept = false;
+    std::vector<MessagePortResult> results;
+    std::atomic<size_t> remaining;
+    BroadcastCallback on_done;
+  };
+  auto state = std::make_shared<BroadcastState>();
+  state->results.resize(ports.size());
+  state->remaining = ports.size();
+  state->on_done = std::move(on_done);
+  auto finish = [this, state]() {
+    if (state->remaining.fetch_sub(1) == 1) {
+      RunOnPlatformThread(
+          alive_, [state] { state->on_done(std::move(state->results)); });
+    }
+  };
+
+  for (size_t i = 0; i < ports.size(); i++) {
+    RemotePortState* port = ports[i];
+    port->stats.Add(1, encoded_message.size());
+    bool queued = false;
+    {
+      std::lock_guard<std::mutex> lock(port->mutex);
+      // Messages queued earlier have to reach the remote port first.
+      if (port->batch.max_batch_size > 0) {
+        FlushBatch(*port);
+      }
+      bundle* b = nullptr;
+      state->results[i] =
+          PrepareBundle(*port, kMessageKey, encoded_message, b);
+      if (state->results[i]) {
+        bool can_store = port->outbox != nullptr;
+        if (can_store && !state->message_kept) {
+          state->message = encoded_message;
+          state->message_kept = true;
+        }
+        queued = sender_.Post(
+            port->send_queue,
+            InTurn(port, TakeTurn(*port),
+                   [this, state, port, b, i, can_store, finish]() {
+                     state->results[i] = SendInTurn(
+                         *port, b, -1, can_store ? &state->message : nullptr,
+                         false);
+                     ReleaseBundle(b);
+                     int ret = state->results[i].error_code;
+                     finish();
+                     return ret;
+                   }),
+            nullptr);
+        if (!queued) {
+          GiveBackTurn(*port);
+          ReleaseBundle(b);
+          port->stats.AddFailure();
+          state->results[i] =
+              CreateResult(MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE);
+        }
+      }
+    }
+    if (!queued) {
+      finish();
+    }
+  }
+  return CreateResult(MESSAGE_PORT_ERROR_NONE);
+}
+
+int MessagePortManager::SendBundle(RemotePortState& port, bundle* b,
+                                   int local_port_id) {
+  const RemotePortKey& key = port.key;
+  TraceScope trace(tracer_, TraceEvent::kSendBundle, port.stats.trace_port,
+                   0);
+  Stopwatch stopwatch;
+  int ret = port.transport->Send(key.app_id, key.port_name, key.is_trusted, b,
+                                 local_port_id);
+
+  port.stats.send_time.Record(stopwatch.ElapsedUs());
+  if (MESSAGE_PORT_ERROR_NONE != ret) {
+    port.stats.AddFailure();
+  }
+  return ret;
+}
+
+MessagePortResult MessagePortManager::SendInTurn(
+    RemotePortState& port, bundle* b, int local_port_id,
+    const std::vector<uint8_t>* stored, bool is_batch) {
+  if (stored && OutboxPending(port)) {
+    return StoreInOutbox(port, stored->data(), stored->size(), is_batch);
+  }
+  int ret = SendBundle(port, b, local_port_id);
+  if (MESSAGE_PORT_ERROR_PORT_NOT_FOUND == ret && stored) {
+    return StoreInOutbox(port, stored->data(), stored->size(), is_batch);
+  }
+  return CreateResult(ret);
+}
+
+MessagePortResult MessagePortManager::SetCoalescing(int remote_port,
+                                                    size_t max_batch_size,
+                                                    int64_t max_delay_us) {
+  LOG_DEBUG(
+      "SetCoalescing, remote_port: %d, max_batch_size: %zu, "
+      "max_delay_us: %lld",
+      remote_port, max_batch_size, static_cast<long long>(max_delay_us));
+  RemotePortState* port = GetRemotePort(remote_port);
+  if (nullptr == port || max_delay_us < 0) {
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+  }
+
+  std::lock_guard<std::mutex> lock(port->mutex);
+  MessagePortResult result;
+  if (max_batch_size == 0) {
+    result = FlushBatch(*port);
+  }
+  port->batch.max_batch_size = max_batch_size;
+  port->batch.max_delay = max_delay_us / 1000000.0;
+  return result;
+}
+
+MessagePortResult MessagePortManager::SetCompression(
+    int remote_port, bool enabled, size_t threshold,
+    std::vector<uint8_t> dictionary, int local_port) {
+  LOG_DEBUG(
+      "SetCompression, remote_port: %d, enabled: %s, threshold: %zu, "
+      "dictionary: %zu bytes, local_port: %d",
+      remote_port, enabled ? "yes" : "no", threshold, dictionary.size(),
+      local_port);
+  RemotePortState* port = GetRemotePort(remote_port);
+  if (nullptr == port) {
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+  }
+  std::shared_ptr<LocalPortState> reply_port;
+  if (enabled) {
+    reply_port = local_ports_.Get(local_port);
+    if (nullptr == reply_port || reply_port->transport != port->transport) {
+      return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+    }
+  }
+  // Queued messages are compressed when sent, with the new settings.
+  std::unique_lock<std::mutex> lock(port->mutex);
+  port->compressor.reset();
+  if (!enabled) {
+    return CreateResult(MESSAGE_PORT_ERROR_NONE);
+  }
+  port->compressor =
+      std::make_unique<PayloadCompressor>(threshold, std::move(dictionary));
+
+  // Messages are sent uncompressed until the receiver accepts the offer.
+  bundle* b = bundle_pool_.Acquire();
+  if (nullptr == b) {
+    return CreateResult(MESSAGE_PORT_ERROR_OUT_OF_MEMORY);
+  }
+  std::string offer = CodecOffer(*port->compressor);
+  if (bundle_add_str(b, kCodecOfferKey, offer.c_str()) != BUNDLE_ERROR_NONE) {
+    ReleaseBundle(b);
+    return CreateResult(MESSAGE_PORT_ERROR_OUT_OF_MEMORY);
+  }
+  if (!WaitForSyncTurn(*port, lock, TakeTurn(*port))) {
+    // Not offered, so it can be enabled again.
+    port->compressor.reset();
+    ReleaseBundle(b);
+    return CreateResult(MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE);
+  }
+  lock.unlock();
+
+  int ret = SendBundle(*port, b, reply_port->native_id);
+  EndTurn(*port);
+  ReleaseBundle(b);
+  return CreateResult(ret);
+}
+
+void MessagePortManager::HandleCodecOffer(const LocalPortState& port,
+                                          const char* offer,
+                                          const char* remote_app_id,
+                                          const char* remote_port,
+                                          bool trusted_remote_port) {
+  if (nullptr == remote_port) {
+    return;
+  }
+  const char* dictionary_id = strchr(offer, '/');
+  size_t codec_size = dictionary_id ? dictionary_id - offer : strlen(offer);
+  if (nullptr == dictionary_id ||
+      strncmp(offer, kDeflateCodec, codec_size) != 0 ||
+      strlen(kDeflateCodec) != codec_size) {
+    LOG_WARN("Declined compression %s offered by %s/%s", offer, remote_app_id,
+             remote_port);
+    return;
+  }
+  uLong id = strtoul(dictionary_id + 1, nullptr, 10);
+  bool has_dictionary =
+      port.decompressor ? port.decompressor->HasDictionary(id) : 0 == id;
+  if (!has_dictionary) {
+    LOG_WARN("Declined compression offered by %s/%s, dictionary %lu is "
+             "unknown",
+             remote_app_id, remote_port, id);
+    return;
+  }
+
+  bundle* b = bundle_pool_.Acquire();
+  if (nullptr == b) {
+    return;
+  }
+  // Sent with the local port, which the sender knows as its remote port.
+  int ret = MESSAGE_PORT_ERROR_OUT_OF_MEMORY;
+  if (bundle_add_str(b, kCodecAcceptKey, offer) == BUNDLE_ERROR_NONE) {
+    ret = port.transport->Send(remote_app_id, remote_port, trusted_remote_port,
+                               b, port.native_id);
+  }
+  ReleaseBundle(b);
+  if (MESSAGE_PORT_ERROR_NONE != ret) {
+    LOG_WARN("Failed to accept compression: %s", get_error_message(ret));
+  }
+}
+
+void MessagePortManager::HandleCodecAccept(const LocalPortState& port,
+                                           const char* accepted,
+                                           const char* remote_app_id,
+                                           const char* remote_port,
+                                           bool trusted_remote_port) {
+  if (nullptr == remote_port) {
+    return;
+  }
+  RemotePortState* found = FindRemotePort(RemotePortKey{
+      remote_app_id, remote_port, trusted_remote_port,
+      port.transport->type()});
+  if (nullptr == found) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(found->mutex);
+  // Acceptances of offers made before compression was set again are
+  // ignored.
+  if (found->compressor && CodecOffer(*found->compressor) == accepted) {
+    LOG_DEBUG("Compression accepted by %s/%s", remote_app_id, remote_port);
+    found->compressor->Confirm();
+  }
+}
+
+MessagePortResult MessagePortManager::AddCompressionDictionary(
+    int local_port, std::vector<uint8_t> dictionary) {
+  LOG_DEBUG("AddCompressionDictionary, local_port: %d, size: %zu", local_port,
+            dictionary.size());
+  LocalPortState* port = GetLocalPort(local_port);
+  if (nullptr == port) {
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+  }
+  if (!port->decompressor) {
+    port->decompressor = std::make_unique<PayloadDecompressor>();
+  }
+  port->decompressor->AddDictionary(std::move(dictionary));
+  return CreateResult(MESSAGE_PORT_ERROR_NONE);
+}
+
+MessagePortResult MessagePortManager::SetFilters(
+    int local_port, std::vector<MessageFilter> filters) {
+  LOG_DEBUG("SetFilters, local_port: %d, filters: %zu", local_port,
+            filters.size());
+  LocalPortState* port = GetLocalPort(local_port);
+  if (nullptr == port) {
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+  }
+  port->filters = std::move(filters);
+  return CreateResult(MESSAGE_PORT_ERROR_NONE);
+}
+
+bool MessagePortManager::GetFilterDrops(int local_port,
+                                        std::vector<uint64_t>* dropped) const {
+  LocalPortState* port = GetLocalPort(local_port);
+  if (nullptr == port) {
+    return false;
+  }
+  dropped->clear();
+  for (const auto& filter : port->filters) {
+    dropped->push_back(filter.dropped());
+  }
+  return true;
+}
+
+bool MessagePortManager::GetCompressionStats(int remote_port,
+                                             CompressionStats* stats) const {
+  RemotePortState* port = GetRemotePort(remote_port);
+  if (nullptr == port) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(port->mutex);
+  if (!port->compressor) {
+    return false;
+  }
+  *stats = port->compressor->stats();
+  return true;
+}
+
+bool MessagePortManager::GetDecompressionStats(int local_port,
+                                               CompressionStats* stats) const {
+  LocalPortState* port = GetLocalPort(local_port);
+  if (nullptr == port || !port->decompressor) {
+    return false;
+  }
+  *stats = port->decompressor->stats();
+  return true;
+}
+
+MessagePortResult MessagePortManager::QueueMessage(
+    RemotePortState& port, const std::vector<uint8_t>& encoded_message) {
+  SendBatch& batch = port.batch;
+  uint32_t size = encoded_message.size();
+  const uint8_t* size_bytes = reinterpret_cast<const uint8_t*>(&size);
+  batch.buffer.insert(batch.buffer.end(), size_bytes,
+                      size_bytes + sizeof(size));
+  batch.buffer.insert(batch.buffer.end(), encoded_message.begin(),
+                      encoded_message.end());
+  batch.count++;
+
+  if (batch.count >= batch.max_batch_size ||
+      batch.buffer.size() >= kMaxBatchBytes) {
+    return FlushBatch(port);
+  }
+
+  if (nullptr != batch.timer || batch.timer_requested) {
+    return CreateResult(MESSAGE_PORT_ERROR_NONE);
+  }
+  if (IsPlatformThread()) {
+    return StartFlushTimer(port);
+  }
+  // Ecore timers can only be added on the platform thread.
+  batch.timer_requested = true;
+  RemotePortState* target = &port;
+  RunOnPlatformThread(alive_, [this, target]() {
+    std::lock_guard<std::mutex> lock(target->mutex);
+    target->batch.timer_requested = false;
+    if (target->batch.count > 0) {
+      StartFlushTimer(*target);
+    }
+  });
+  return CreateResult(MESSAGE_PORT_ERROR_NONE);
+}
+
+MessagePortResult MessagePortManager::StartFlushTimer(RemotePortState& port) {
+  SendBatch& batch = port.batch;
+  if (nullptr != batch.timer) {
+    return CreateResult(MESSAGE_PORT_ERROR_NONE);
+  }
+  batch.timer = ecore_timer_add(batch.max_delay, OnFlushTimer, &port);
+  if (nullptr == batch.timer) {
+    LOG_ERROR("Failed to add flush timer, sending batch now");
+    return FlushBatch(port);
+  }
+  return CreateResult(MESSAGE_PORT_ERROR_NONE);
+}
+
+Eina_Bool MessagePortManager::OnFlushTimer(void* user_data) {
+  RemotePortState* port = static_cast<RemotePortState*>(user_data);
+  std::lock_guard<std::mutex> lock(port->mutex);
+  // The timer is deleted by Ecore after returning ECORE_CALLBACK_CANCEL.
+  port->batch.timer = nullptr;
+  port->manager->FlushBatch(*port);
+  return ECORE_CALLBACK_CANCEL;
+}
+
+MessagePortResult MessagePortManager::FlushBatch(RemotePortState& port) {
+  SendBatch& batch = port.batch;
+  // Off the platform thread the timer is left to fire. It then sends a
+  // later batch early, or nothing.
+  if (batch.timer && IsPlatformThread()) {
+    ecore_timer_del(batch.timer);
+    batch.timer = nullptr;
+  }
+  if (batch.count == 0) {
+    return CreateResult(MESSAGE_PORT_ERROR_NONE);
+  }
+
+  LOG_DEBUG("FlushBatch (%s, %s), messages: %zu, bytes: %zu",
+            port.key.app_id.c_str(), port.key.port_name.c_str(), batch.count,
+            batch.buffer.size());
+  bundle* b = nullptr;
+  MessagePortResult result = PrepareBundle(port, kBatchKey, batch.buffer, b);
+  size_t size = batch.buffer.size();
+  // The messages are kept only if they can be stored, otherwise the buffer
+  // is reused.
+  std::shared_ptr<std::vector<uint8_t>> kept;
+  if (result && port.outbox) {
+    kept = std::make_shared<std::vector<uint8_t>>(std::move(batch.buffer));
+  }
+  batch.buffer.clear();
+  batch.count = 0;
+  // Called with the result of the batch, as the completion of SendAsync
+  // would be.
+  AsyncSender::DoneCallback on_done;
+  if (!batch.callbacks.empty()) {
+    on_done = [callbacks = std::move(batch.callbacks)](int ret) {
+      for (const auto& callback : callbacks) {
+        callback(CreateResult(ret));
+      }
+    };
+    batch.callbacks.clear();
+  }
+
+  if (result) {
+    RemotePortState* target = &port;
+    bool queued = sender_.PostUnbounded(
+        port.send_queue,
+        InTurn(target, TakeTurn(port),
+               [this, target, b, kept, size]() {
+                 TraceScope trace(tracer_, TraceEvent::kFlushBatch,
+                                  target->stats.trace_port, size);
+                 int ret = SendInTurn(*target, b, -1, kept.get(), true)
+                               .error_code;
+                 ReleaseBundle(b);
+                 return ret;
+               }),
+        std::move(on_done));
+    if (!queued) {
+      // The sender is only stopped with the manager, completions would be
+      // dropped anyway.
+      GiveBackTurn(port);
+      ReleaseBundle(b);
+      port.stats.AddFailure();
+      return CreateResult(MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE);
+    }
+    return result;
+  }
+  LOG_ERROR("Failed to send batch to %s: %s", port.key.port_name.c_str(),
+            result.message().c_str());
+  if (on_done) {
+    // Not called here, as the mutex of |port| is held.
+    int ret = result.error_code;
+    RunOnPlatformThread(alive_, [on_done = std::move(on_done), ret]() {
+      on_done(ret);
+    });
+  }
+  return result;
+}
+
+// Returns |name| with characters other than letters, digits, '-' and '.'
+// replaced by '_', to be used in a file name.
+static std::string SanitizeFileName(const std::string& name) {
+  std::string sanitized = name;
+  for (char& c : sanitized) {
+    if (!isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '.') {
+      c = '_';
+    }
+  }
+  return sanitized;
+}
+
+MessagePortResult MessagePortManager::SetOutbox(int remote_port,
+                                                const std::string& directory,
+                                                size_t max_bytes,
+                                                int64_t ttl_us) {
+  RemotePortState* port = GetRemotePort(remote_port);
+  if (nullptr == port) {
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+  }
+  const RemotePortKey& key = port->key;
+  {
+    std::lock_guard<std::mutex> lock(port->mutex);
+    if (port->outbox && 0 == max_bytes) {
+      LOG_DEBUG("Dropping %zu messages stored for %s",
+                port->outbox->pending(), key.port_name.c_str());
+      port->outbox->Delete();
+    }
+    // Unmapped before the file is opened again with other limits.
+    port->outbox.reset();
+    port->outbox_generation++;
+    if (0 == max_bytes) {
+      return CreateResult(MESSAGE_PORT_ERROR_NONE);
+    }
+    std::string suffix = std::string(key.is_trusted ? "/trusted" : "") +
+                         (TransportType::kSocket == key.transport ? "/socket"
+                                                                  : "");
+    // Names of different ports may be sanitized to the same file name, so
+    // the file also holds the key of the port its messages are for.
+    std::string outbox_key = key.app_id + "/" + key.port_name + suffix;
+    std::string path = directory + "/" + SanitizeFileName(outbox_key) +
+                       ".outbox";
+    port->outbox = Outbox::Open(path, outbox_key, max_bytes, ttl_us);
+    if (nullptr == port->outbox) {
+      return CreateResult(MESSAGE_PORT_ERROR_IO_ERROR);
+    }
+  }
+
+  // Checking the port starts watching its registration, or drains the
+  // outbox of a port which can not be watched.
+  bool is_registered = false;
+  if (CheckRemotePort(key, &is_registered) && is_registered &&
+      TransportType::kMessagePort == key.transport) {
+    ResumeOutbox(key);
+  }
+  return CreateResult(MESSAGE_PORT_ERROR_NONE);
+}
+
+bool MessagePortManager::OutboxPending(RemotePortState& port) {
+  {
+    std::lock_guard<std::mutex> lock(port.mutex);
+    if (nullptr == port.outbox) {
+      return false;
+    }
+  }
+  if (TransportType::kMessagePort == port.key.transport) {
+    std::lock_guard<std::mutex> lock(presence_mutex_);
+    auto presence = presence_.find(port.key);
+    if (presence != presence_.end() && !presence->second.is_registered) {
+      return true;
+    }
+  }
+  return !DrainOutbox(port);
+}
+
+bool MessagePortManager::DrainOutbox(RemotePortState& port) {
+  static thread_local std::vector<uint8_t> drain_buffer;
+  while (true) {
+    bool prepared = true;
+    uint64_t generation;
+    uint64_t cursor;
+    bundle* b = nullptr;
+    {
+      // Only the holder of the turn reads and appends to the outbox, but
+      // SetOutbox may replace it while a batch is sent.
+      std::lock_guard<std::mutex> lock(port.mutex);
+      if (nullptr == port.outbox || port.outbox->empty()) {
+        return true;
+      }
+      generation = port.outbox_generation;
+      drain_buffer.clear();
+      cursor = port.outbox->ReadBatch(drain_buffer, kMaxBatchBytes);
+      if (drain_buffer.empty()) {
+        // Every message read has expired.
+        port.outbox->Consume(cursor);
+        continue;
+      }
+      prepared = PrepareBundle(port, kBatchKey, drain_buffer, b);
+    }
+    if (!prepared) {
+      ScheduleOutboxRetry(port);
+      return false;
+    }
+
+    TraceScope trace(tracer_, TraceEvent::kFlushBatch, port.stats.trace_port,
+                     drain_buffer.size());
+    int ret = SendBundle(port, b, -1);
+    ReleaseBundle(b);
+    if (MESSAGE_PORT_ERROR_NONE != ret) {
+      LOG_DEBUG("Failed to drain the outbox of %s: %s",
+                port.key.port_name.c_str(), get_error_message(ret));
+      ScheduleOutboxRetry(port);
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(port.mutex);
+    if (port.outbox_generation == generation) {
+      port.outbox->Consume(cursor);
+    }
+  }
+}
+
+void MessagePortManager::ScheduleOutboxRetry(RemotePortState& port) {
+  std::lock_guard<std::mutex> lock(port.mutex);
+  if (nullptr == port.outbox || port.outbox_retry_requested) {
+    return;
+  }
+  // Ecore timers can only be added on the platform thread.
+  port.outbox_retry_requested = true;
+  RemotePortState* target = &port;
+  RunOnPlatformThread(alive_, [target]() {
+    std::lock_guard<std::mutex> lock(target->mutex);
+    target->outbox_timer = ecore_timer_add(kOutboxRetryDelay,
+                                           OnOutboxRetryTimer, target);
+    if (nullptr == target->outbox_timer) {
+      LOG_ERROR("Failed to add outbox retry timer");
+      target->outbox_retry_requested = false;
+    }
+  });
+}
+
+Eina_Bool MessagePortManager::OnOutboxRetryTimer(void* user_data) {
+  RemotePortState* port = static_cast<RemotePortState*>(user_data);
+  {
+    std::lock_guard<std::mutex> lock(port->mutex);
+    // The timer is deleted by Ecore after returning ECORE_CALLBACK_CANCEL.
+    port->outbox_timer = nullptr;
+    port->outbox_retry_requested = false;
+  }
+  MessagePortManager* manager = port->manager;
+  if (TransportType::kMessagePort == port->key.transport) {
+    std::lock_guard<std::mutex> lock(manager->presence_mutex_);
+    auto presence = manager->presence_.find(port->key);
+    if (presence != manager->presence_.end() &&
+        !presence->second.is_registered) {
+      // Drained once the port is registered again.
+      return ECORE_CALLBACK_CANCEL;
+    }
+  }
+  manager->ResumeOutbox(port->key);
+  return ECORE_CALLBACK_CANCEL;
+}
+
+void MessagePortManager::ResumeOutbox(const RemotePortKey& key) {
+  RemotePortState* port = FindRemotePort(key);
+  if (nullptr == port) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(port->mutex);
+  if (nullptr == port->outbox || port->outbox->empty()) {
+    return;
+  }
+  LOG_DEBUG("Draining %zu messages stored for %s", port->outbox->pending(),
+            key.port_name.c_str());
+  bool queued = sender_.PostUnbounded(
+      port->send_queue,
+      InTurn(port, TakeTurn(*port),
+             [this, port]() {
+               return DrainOutbox(*port) ? MESSAGE_PORT_ERROR_NONE
+                                         : MESSAGE_PORT_ERROR_IO_ERROR;
+             }),
+      nullptr);
+  if (!queued) {
+    // The messages stay stored.
+    GiveBackTurn(*port);
+  }
+}
+
+MessagePortResult MessagePortManager::StoreInOutbox(RemotePortState& port,
+                                                    const uint8_t* data,
+                                                    size_t size,
+                                                    bool is_batch) {
+  std::lock_guard<std::mutex> lock(port.mutex);
+  if (nullptr == port.outbox) {
+    // Disabled since the message was sent.
+    return CreateResult(MESSAGE_PORT_ERROR_PORT_NOT_FOUND);
+  }
+  size_t rejected = port.outbox->stats().rejected;
+  if (!is_batch) {
+    port.outbox->Append(data, size);
+  } else {
+    size_t offset = 0;
+    while (size - offset >= sizeof(uint32_t)) {
+      uint32_t message_size = 0;
+      memcpy(&message_size, data + offset, sizeof(message_size));
+      offset += sizeof(message_size);
+      port.outbox->Append(data + offset, message_size);
+      offset += message_size;
+    }
+  }
+  rejected = port.outbox->stats().rejected - rejected;
+  if (rejected > 0) {
+    LOG_WARN("Outbox of %s is full, dropped %zu messages",
+             port.key.port_name.c_str(), rejected);
+    port.stats.AddFailure();
+    return CreateResult(MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE);
+  }
+  return CreateResult(MESSAGE_PORT_ERROR_NONE);
+}
+
+MessagePortResult MessagePortManager::PrepareBundle(
+    RemotePortState& port, const char* bundle_key,
+    const std::vector<uint8_t>& data, bundle*& b) {
+  Stopwatch stopwatch;
+  b = bundle_pool_.Acquire();
+  if (nullptr == b) {
+    port.stats.AddFailure();
+    return CreateResult(MESSAGE_PORT_ERROR_OUT_OF_MEMORY);
+  }
+
+  // Each sending thread reuses its own buffer.
+  static thread_local std::vector<uint8_t> compress_buffer;
+  const std::vector<uint8_t>* payload = &data;
+  bool compressed = false;
+  if (port.compressor && port.compressor->Compress(data, compress_buffer)) {
+    payload = &compress_buffer;
+    compressed = true;
+  }
+
+  bool result = AddBytesToBundle(bundle_key, *payload, b);
+  if (result && compressed) {
+    result = bundle_add_str(b, kCodecKey, kDeflateCodec) == BUNDLE_ERROR_NONE;
+  }
+  if (!result) {
+    LOG_ERROR("Failed to add message to bundle");
+    ReleaseBundle(b);
+    port.stats.AddFailure();
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+  }
+  port.stats.encode_time.Record(stopwatch.ElapsedUs());
+  return CreateResult(MESSAGE_PORT_ERROR_NONE);
+}
+
+MessagePortResult MessagePortManager::Request(
+    int remote_port, const std::vector<uint8_t>& encoded_message,
+    int local_port, int64_t timeout_us, ReplyCallback on_reply) {
+  LOG_DEBUG("Request, remote_port: %d, local_port: %d, timeout_us: %lld",
+            remote_port, local_port, static_cast<long long>(timeout_us));
+  RemotePortState* port = GetRemotePort(remote_port);
+  LocalPortState* reply_port = GetLocalPort(local_port);
+  if (nullptr == port || nullptr == reply_port ||
+      reply_port->transport != port->transport || timeout_us < 0) {
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+  }
+  port->stats.Add(1, encoded_message.size());
+
+  uint32_t request_id = next_request_id_++;
+  if (0 == next_request_id_) {
+    next_request_id_ = 1;
+  }
+  MessagePortResult result =
+      SendCorrelated(*port, encoded_message, reply_port->native_id,
+                     kRequestIdKey, request_id);
+  if (!result) {
+    return result;
+  }
+
+  double deadline = ecore_time_get() + timeout_us / 1000000.0;
+  auto deadline_entry = request_deadlines_.emplace(deadline, request_id);
+  pending_requests_[request_id] = PendingRequest{
+      reply_port->native_id, port, deadline_entry, std::move(on_reply)};
+  if (deadline_entry == request_deadlines_.begin()) {
+    ScheduleRequestTimer();
+  }
+  return result;
+}
+
+MessagePortResult MessagePortManager::Reply(
+    int remote_port, const std::vector<uint8_t>& encoded_message,
+    uint32_t request_id) {
+  LOG_DEBUG("Reply, remote_port: %d, request_id: %u", remote_port,
+            request_id);
+  RemotePortState* port = GetRemotePort(remote_port);
+  if (nullptr == port || 0 == request_id) {
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+  }
+  port->stats.Add(1, encoded_message.size());
+  return SendCorrelated(*port, encoded_message, -1, kReplyToKey, request_id);
+}
+
+MessagePortResult MessagePortManager::SendCorrelated(
+    RemotePortState& port, const std::vector<uint8_t>& encoded_message,
+    int local_port_id, const char* correlation_key, uint32_t correlation_id) {
+  TraceScope trace(tracer_, TraceEvent::kSend, port.stats.trace_port,
+                   encoded_message.size());
+  std::unique_lock<std::mutex> lock(port.mutex);
+  if (port.batch.max_batch_size > 0) {
+    FlushBatch(port);
+  }
+
+  bundle* b = nullptr;
+  MessagePortResult result =
+      PrepareBundle(port, kMessageKey, encoded_message, b);
+  if (!result) {
+    return result;
+  }
+  NumberBuffer id;
+  if (bundle_add_str(b, correlation_key, FormatNumber(correlation_id, id)) !=
+      BUNDLE_ERROR_NONE) {
+    ReleaseBundle(b);
+    port.stats.AddFailure();
+    return CreateResult(MESSAGE_PORT_ERROR_OUT_OF_MEMORY);
+  }
+  if (!WaitForSyncTurn(port, lock, TakeTurn(port))) {
+    ReleaseBundle(b);
+    port.stats.AddFailure();
+    return CreateResult(MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE);
+  }
+  lock.unlock();
+
+  int ret = SendBundle(port, b, local_port_id);
+  EndTurn(port);
+  ReleaseBundle(b);
+  return CreateResult(ret);
+}
+
+MessagePortResult MessagePortManager::SyncState(int remote_port,
+                                                flutter::EncodableMap state,
+                                                int local_port) {
+  LOG_DEBUG("SyncState, remote_port: %d, local_port: %d, keys: %zu",
+            remote_port, local_port, state.size());
+  RemotePortState* port = GetRemotePort(remote_port);
+  std::shared_ptr<LocalPortState> reply_port = local_ports_.Get(local_port);
+  if (nullptr == port || nullptr == reply_port ||
+      reply_port->transport != port->transport) {
+    return CreateResult(MESSAGE_PORT_ERROR_INVALID_PARAMETER);
+  }
+
+  std::unique_lock<std::mutex> lock(port->mutex);
+  if (!port->sync) {
+    port->sync = std::make_unique<StateSyncSender>();
+  } else if (port->sync_local_port_id != reply_port->native_id) {
+    // The receiver keeps states by sender port, it has none for this one.
+    port->sync->RequestResync();
+  }
+  port->sync_local_port_id = reply_port->native_id;
+  if (port->batch.max_batch_size > 0) {
+    FlushBatch(*port);
+  }
+  bundle* b = nullptr;
+  MessagePortResult result = PrepareStateUpdate(*port, std::move(state), b);
+  if (!result) {
+    return result;
+  }
+  if (!WaitForSyncTurn(*port, lock, TakeTurn(*port))) {
+    ReleaseBundle(b);
+    port->stats.AddFailure();
+    // The update was committed when prepared.
+    port->sync->RequestResync();
+    return CreateResult(MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE);
+  }
+  lock.unlock();
+
+  int ret = SendStateUpdate(*port, b, reply_port->native_id);
+  EndTurn(*port);
+  return CreateResult(ret);
+}
+
+MessagePortResult MessagePortManager::PrepareStateUpdate(
+    RemotePortState& port, flutter::EncodableMap&& state, bundle*& b) {
+  // Each sending thread reuses its own buffer.
+  static thread_local std::vector<uint8_t> update;
+  uint32_t base_seq = 0;
+  uint32_t seq = port.sync->Encode(state, update, &base_seq);
+  // Committed before the update is sent, so that the next update can be
+  // encoded meanwhile. The next update is sent in full if this one fails.
+  port.sync->Commit(std::move(state));
+  port.stats.Add(1, update.size());
+
+  MessagePortResult result = PrepareBundle(port, kMessageKey, update, b);
+  if (!result) {
+    port.sync->RequestResync();
+    return result;
+  }
+  NumberBuffer seq_value;
+  NumberBuffer base_value;
+  if (bundle_add_str(b, kSyncSeqKey, FormatNumber(seq, seq_value)) !=
+          BUNDLE_ERROR_NONE ||
+      (base_seq && bundle_add_str(b, kSyncBaseKey,
+                                  FormatNumber(base_seq, base_value)) !=
+                       BUNDLE_ERROR_NONE)) {
+    ReleaseBundle(b);
+    port.sync->RequestResync();
+    port.stats.AddFailure();
+    return CreateResult(MESSAGE_PORT_ERROR_OUT_OF_MEMORY);
+  }
+  return result;
+}
+
+int MessagePortManager::SendStateUpdate(RemotePortState& port, bundle* b,
+                                        int local_port_id) {
+  int ret = SendBundle(port, b, local_port_id);
+  ReleaseBundle(b);
+  if (MESSAGE_PORT_ERROR_NONE != ret) {
+    std::lock_guard<std::mutex> lock(port.mutex);
+    port.sync->RequestResync();
+  }
+  return ret;
+}
+
+void MessagePortManager::DeliverStateUpdate(
+    LocalPortState& port, bundle* message, const uint8_t* data, size_t size,
+    const char* remote_app_id, const char* remote_port,
+    bool trusted_remote_port) {
+  if (nullptr == remote_port) {
+    SendError(port, "Failed to parse a response",
+              "State update without a port to resync with");
+    return;
+  }
+
+  RemotePortKey key{remote_app_id, remote_port, trusted_remote_port,
+                    port.transport->type()};
+  StateSyncReceiver& receiver = port.synced_states[key];
+  uint32_t seq = GetCorrelationId(message, kSyncSeqKey);
+  StateSyncReceiver::Result result = receiver.Apply(
+      seq, GetCorrelationId(message, kSyncBaseKey), data, size);
+  if (StateSyncReceiver::Result::kApplied == result) {
+    // Dart decodes messages itself, so the state is encoded again.
+    const std::vector<uint8_t>& state = EncodeMessage(receiver.state());
+    Deliver(port, state.data(), state.size(), remote_app_id, remote_port,
+            trusted_remote_port, 0);
+    return;
+  }
+
+  if (StateSyncReceiver::Result::kMalformed == result) {
+    SendError(port, "Failed to parse a response", "Malformed state update");
+  }
+  if (!receiver.ShouldRequestResync(Tracer::NowUs())) {
+    return;
+  }
+  LOG_INFO("Requesting state resync from %s/%s, update %u missed",
+           remote_app_id, remote_port, seq);
+  bundle* b = bundle_pool_.Acquire();
+  if (nullptr == b) {
+    return;
+  }
+  // Sent with the local port, which the sender knows as its remote port.
+  NumberBuffer seq_value;
+  int ret = MESSAGE_PORT_ERROR_OUT_OF_MEMORY;
+  if (bundle_add_str(b, kSyncResyncKey,
+                     FormatNumber(receiver.seq(), seq_value)) ==
+      BUNDLE_ERROR_NONE) {
+    ret = port.transport->Send(remote_app_id, remote_port, trusted_remote_port,
+                               b, port.native_id);
+  }
+  ReleaseBundle(b);
+  if (MESSAGE_PORT_ERROR_NONE != ret) {
+    LOG_WARN("Failed to request state resync: %s", get_error_message(ret));
+  }
+}
+
+void MessagePortManager::HandleResyncRequest(const LocalPortState& port,
+                                             const char* remote_app_id,
+                                             const char* remote_port,
+                                             bool trusted_remote_port) {
+  if (nullptr == remote_port) {
+    return;
+  }
+  RemotePortState* found = FindRemotePort(RemotePortKey{
+      remote_app_id, remote_port, trusted_remote_port,
+      port.transport->type()});
+  if (nullptr == found) {
+    LOG_WARN("State resync requested by unknown port %s/%s", remote_app_id,
+             remote_port);
+    return;
+  }
+  RemotePortState& remote = *found;
+  std::lock_guard<std::mutex> lock(remote.mutex);
+  if (!remote.sync || remote.sync_local_port_id != port.native_id) {
+    LOG_WARN("State resync requested by %s/%s, which is not synced",
+             remote_app_id, remote_port);
+    return;
+  }
+
+  LOG_INFO("State resync requested by %s/%s", remote_app_id, remote_port);
+  if (!remote.sync->has_snapshot()) {
+    remote.sync->RequestResync();
+    return;
+  }
+  if (remote.batch.max_batch_size > 0) {
+    FlushBatch(remote);
+  }
+  bundle* b = nullptr;
+  if (!PrepareStateUpdate(remote, remote.sync->TakeSnapshot(), b)) {
+    return;
+  }
+  // Sent from a sender thread, so that the platform thread does not wait
+  // for sends in progress.
+  RemotePortState* target = &remote;
+  int local_port_id = remote.sync_local_port_id;
+  bool queued = sender_.PostUnbounded(
+      remote.send_queue,
+      InTurn(target, TakeTurn(remote),
+             [this, target, b, local_port_id]() {
+               return SendStateUpdate(*target, b, local_port_id);
+             }),
+      nullptr);
+  if (!queued) {
+    GiveBackTurn(remote);
+    ReleaseBundle(b);
+    // The update was committed when prepared.
+    remote.sync->RequestResync();
+  }
+}
+
+bool MessagePortManager::CompleteRequest(uint32_t reply_to,
+                                         const LocalPortState& port,
+                                         const char* remote_app_id,
+                                         const uint8_t* data, size_t size) {
+  auto request = pending_requests_.find(reply_to);
+  // Only the requested application can reply, on the given local port.
+  if (request == pending_requests_.end() ||
+      request->second.local_port_id != port.native_id ||
+      request->second.port->transport != port.transport ||
+      request->second.port->key.app_id != remote_app_id) {
+    return false;
+  }
+
+  ReplyCallback on_reply = std::move(request->second.on_reply);
+  request_deadlines_.erase(request->second.deadline);
+  pending_requests_.erase(request);
+  on_reply(data, size);
+  return true;
+}
+
+void MessagePortManager::ScheduleRequestTimer() {
+  if (request_timer_) {
+    ecore_timer_del(request_timer_);
+    request_timer_ = nullptr;
+  }
+  if (request_deadlines_.empty()) {
+    return;
+  }
+
+  double delay = request_deadlines_.begin()->first - ecore_time_get();
+  request_timer_ = ecore_timer_add(delay > 0 ? delay : 0, OnRequestTimer, this);
+  if (nullptr == request_timer_) {
+    LOG_ERROR("Failed to add request timer");
+  }
+}
+
+Eina_Bool MessagePortManager::OnRequestTimer(void* user_data) {
+  MessagePortManager* manager = static_cast<MessagePortManager*>(user_data);
+  // The timer is deleted by Ecore after returning ECORE_CALLBACK_CANCEL.
+  manager->request_timer_ = nullptr;
+
+  double now = ecore_time_get();
+  auto& deadlines = manager->request_deadlines_;
+  while (!deadlines.empty() && deadlines.begin()->first <= now) {
+    auto request = manager->pending_requests_.find(deadlines.begin()->second);
+    deadlines.erase(deadlines.begin());
+    ReplyCallback on_reply = std::move(request->second.on_reply);
+    manager->pending_requests_.erase(request);
+    LOG_DEBUG("Request timed out");
+    on_reply(nullptr, 0);
+  }
+  manager->ScheduleRequestTimer();
+  return ECORE_CALLBACK_CANCEL;
+}
+
+void MessagePortManager::ReleaseBundle(bundle* b) {
+  bundle_del(b, kMessageKey);
+  bundle_del(b, kBatchKey);
+  bundle_del(b, kCodecKey);
+  bundle_del(b, kRequestIdKey);
+  bundle_del(b, kReplyToKey);
+  bundle_del(b, kSyncSeqKey);
+  bundle_del(b, kSyncBaseKey);
+  bundle_del(b, kSyncResyncKey);
+  bundle_del(b, kCodecOfferKey);
+  bundle_del(b, kCodecAcceptKey);
+  bundle_pool_.Release(b);
+}
+
+const std::vector<uint8_t>& MessagePortManager::EncodeMessage(
+    const flutter::EncodableValue& message) {
+  encode_buffer_.clear();
+  VectorStreamWriter writer(&encode_buffer_);
+  flutter::StandardCodecSerializer::GetInstance().WriteValue(message, &writer);
+  return encode_buffer_;
+}
+
+flutter::EncodableValue MessagePortManager::GetStats() const {
+  flutter::EncodableList local_ports;
+  for (const auto& stats : local_stats_) {
+    flutter::EncodableMap map = stats.second.ToEncodableMap();
+    map[flutter::EncodableValue("portName")] =
+        flutter::EncodableValue(stats.first.first);
+    map[flutter::EncodableValue("trusted")] =
+        flutter::EncodableValue(stats.first.second);
+    local_ports.push_back(flutter::EncodableValue(std::move(map)));
+  }
+
+  flutter::EncodableList remote_ports;
+  for (size_t i = 0; i < remote_ports_.size(); i++) {
+    RemotePortState* port = remote_ports_.Get(i);
+    flutter::EncodableMap map = port->stats.ToEncodableMap();
+    map[flutter::EncodableValue("remoteAppId")] =
+        flutter::EncodableValue(port->key.app_id);
+    map[flutter::EncodableValue("portName")] =
+        flutter::EncodableValue(port->key.port_name);
+    map[flutter::EncodableValue("trusted")] =
+        flutter::EncodableValue(port->key.is_trusted);
+    // Copied, so that the lock is not held while the map is built.
+    std::unique_ptr<StateSyncStats> sync_stats;
+    std::unique_ptr<OutboxStats> outbox_stats;
+    size_t outbox_pending = 0;
+    {
+      std::lock_guard<std::mutex> lock(port->mutex);
+      if (port->sync) {
+        sync_stats = std::make_unique<StateSyncStats>(port->sync->stats());
+      }
+      if (port->outbox) {
+        outbox_stats = std::make_unique<OutboxStats>(port->outbox->stats());
+        outbox_pending = port->outbox->pending();
+      }
+    }
+    if (sync_stats) {
+      const StateSyncStats& sync = *sync_stats;
+      flutter::EncodableMap sync_map;
+      sync_map[flutter::EncodableValue("updates")] =
+          flutter::EncodableValue(static_cast<int64_t>(sync.updates));
+      sync_map[flutter::EncodableValue("fullUpdates")] =
+          flutter::EncodableValue(static_cast<int64_t>(sync.full_updates));
+      sync_map[flutter::EncodableValue("resyncs")] =
+          flutter::EncodableValue(static_cast<int64_t>(sync.resyncs));
+      sync_map[flutter::EncodableValue("bytes")] =
+          flutter::EncodableValue(static_cast<int64_t>(sync.bytes));
+      map[flutter::EncodableValue("stateSync")] =
+          flutter::EncodableValue(std::move(sync_map));
+    }
+    if (outbox_stats) {
+      const OutboxStats& outbox = *outbox_stats;
+      flutter::EncodableMap outbox_map;
+      outbox_map[flutter::EncodableValue("pending")] =
+          flutter::EncodableValue(static_cast<int64_t>(outbox_pending));
+      outbox_map[flutter::EncodableValue("stored")] =
+          flutter::EncodableValue(static_cast<int64_t>(outbox.stored));
+      outbox_map[flutter::EncodableValue("drained")] =
+          flutter::EncodableValue(static_cast<int64_t>(outbox.drained));
+      outbox_map[flutter::EncodableValue("expired")] =
+          flutter::EncodableValue(static_cast<int64_t>(outbox.expired));
+      outbox_map[flutter::EncodableValue("rejected")] =
+          flutter::EncodableValue(static_cast<int64_t>(outbox.rejected));
+      map[flutter::EncodableValue("outbox")] =
+          flutter::EncodableValue(std::move(outbox_map));
+    }
+    remote_ports.push_back(flutter::EncodableValue(std::move(map)));
+  }
+
+  flutter::EncodableMap map;
+  map[flutter::EncodableValue("localPorts")] =
+      flutter::EncodableValue(std::move(local_ports));
+  map[flutter::EncodableValue("remotePorts")] =
+      flutter::EncodableValue(std::move(remote_ports));
+  map[flutter::EncodableValue("sendQueueDelay")] = sender_.GetQueueDelays();
+  map[flutter::EncodableValue("deliveryQueueDelay")] =
+      delivery_lanes_.DelaysToEncodableValue();
+  map[flutter::EncodableValue("elapsedUs")] =
+      flutter::EncodableValue(stats_since_.ElapsedUs());
+  return flutter::EncodableValue(std::move(map));
+}
+
+void MessagePortManager::ResetStats() {
+  // Entries are kept, as sends in progress may still update them.
+  for (auto& stats : local_stats_) {
+    stats.second.Reset();
+  }
+  for (size_t i = 0; i < remote_ports_.size(); i++) {
+    RemotePortState* port = remote_ports_.Get(i);
+    port->stats.Reset();
+    std::lock_guard<std::mutex> lock(port->mutex);
+    if (port->sync) {
+      port->sync->ResetStats();
+    }
+    if (port->outbox) {
+      port->outbox->ResetStats();
+    }
+  }
+  sender_.ResetQueueDelays();
+  delivery_lanes_.ResetDelays();
+  stats_since_ = Stopwatch();
+}
+
+AllocationStats MessagePortManager::GetAllocationStats() const {
+  AllocationStats stats;
+  bundle_pool_.AddStats(stats);
+  local_ports_.ForEach(
+      [&stats](const LocalPortState& port) { port.arena.AddStats(stats); });
+  return stats;
+}
+
 MessagePortResult MessagePortManager::CreateResult(int return_code) {
   MessagePortResult result(return_code);
 
@@ -1,12 +1,38 @@
 #ifndef MESSAGEPORT_H
 #define MESSAGEPORT_H
 
+#include <Ecore.h>
 #include <flutter/event_channel.h>
 #include <flutter/standard_method_codec.h>
 #include <message_port.h>
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <shared_mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "async_sender.h"
+#include "compression.h"
+#include "message_filter.h"
+#include "message_pools.h"
+#include "outbox.h"
+#include "port_stats.h"
+#include "port_table.h"
+#include "priority_lanes.h"
+#include "socket_transport.h"
+#include "state_sync.h"
+#include "trace.h"
+#include "transport.h"
 
 typedef std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> EventSink;
 
@@ -22,23 +48,369 @@ struct MessagePortResult {
   int error_code;
 };
 
+struct RemotePortKey {
+  std::string app_id;
+  std::string port_name;
+  bool is_trusted;
+  TransportType transport = TransportType::kMessagePort;
+
+  bool operator<(const RemotePortKey& other) const {
+    return std::tie(app_id, port_name, is_trusted, transport) <
+           std::tie(other.app_id, other.port_name, other.is_trusted,
+                    other.transport);
+  }
+};
+
+class MessagePortManager;
+
+// Messages queued for one remote port while coalescing is enabled on it.
+struct SendBatch {
+  // Zero while coalescing is disabled.
+  size_t max_batch_size;
+  double max_delay;  // In seconds, as expected by Ecore timers.
+  size_t count;
+  // Messages prefixed with their uint32_t size.
+  std::vector<uint8_t> buffer;
+  // Only added and deleted on the platform thread.
+  Ecore_Timer* timer;
+  // Set while the platform thread is asked to add |timer|.
+  bool timer_requested;
+  // Completions of the async sends of queued messages, called once the
+  // batch is sent.
+  std::vector<std::function<void(MessagePortResult result)>> callbacks;
+};
+
+// Messages received on one local port while inbound batching is enabled on
+// it, waiting to be sent to Dart as one list.
+struct DeliveryBatch {
+  // Below 2 while inbound batching is disabled.
+  size_t max_batch_size;
+  double flush_interval;  // In seconds, as expected by Ecore timers.
+  flutter::EncodableList events;
+  Ecore_Timer* timer;
+};
+
+// What to do with a message received while the inbound queue of a local
+// port is full.
+enum class OverflowPolicy {
+  kDropOldest,
+  kDropNewest,
+  // Replaces a queued message with the same value under the coalesce key,
+  // or drops the oldest one if there is none.
+  kCoalesceByKey,
+};
+
+struct QueuedEvent {
+  flutter::EncodableValue event;
+  // Encoded value under the coalesce key, empty if there is none.
+  std::vector<uint8_t> key;
+};
+
+// Messages received on one local port while Dart has not acknowledged
+// enough of the earlier ones, when flow control is enabled on the port.
+struct InboundQueue {
+  // Zero while flow control is disabled.
+  size_t high_water_mark;
+  // Messages sent to Dart and not acknowledged yet, at most.
+  size_t window;
+  OverflowPolicy policy;
+  std::string coalesce_key;
+  std::deque<QueuedEvent> events;
+  size_t in_flight;
+  uint64_t dropped;
+  bool above_high_water_mark;
+};
+
+// An event produced while no sink was attached to its local port.
+struct PendingEvent {
+  int64_t created_us;  // Tracer::NowUs() time.
+  flutter::EncodableValue event;
+};
+
+// A registered local port, kept in a table indexed by its handle.
+struct LocalPortState {
+  MessagePortManager* manager;
+  Transport* transport;
+  // Id of the port in |transport|.
+  int native_id;
+  bool is_trusted;
+  // Null until something listens to the port. Events are kept in |pending|
+  // meanwhile.
+  EventSink sink;
+  std::deque<PendingEvent> pending;
+  EventArena arena;
+  LocalPortStats* stats;
+  DeliveryBatch batch;
+  // Created when a dictionary is added or the first compressed payload is
+  // received.
+  std::unique_ptr<PayloadDecompressor> decompressor;
+  // Messages are sent to the sink only if they match all filters.
+  std::vector<MessageFilter> filters;
+  InboundQueue queue;
+  Priority priority;
+  // States rebuilt from updates of each remote port syncing to this one.
+  std::map<RemotePortKey, StateSyncReceiver> synced_states;
+};
+
+// Turns to send to one remote port, handed out in the order sends to it
+// are made, so that they reach the port in that order even when different
+// threads do them. Guarded by the mutex of the port.
+struct SendTurns {
+  uint64_t next;
+  // Sends of later turns wait for this one to end.
+  uint64_t current;
+  // Turns given up before they came, skipped when they do.
+  std::set<uint64_t> abandoned;
+  std::condition_variable ended;
+};
+
+// A remote port messages are sent to, kept in a table indexed by its
+// handle. Entries are never removed, so sender threads can keep pointers
+// to them.
+struct RemotePortState {
+  MessagePortManager* manager;
+  const RemotePortKey key;
+  Transport* transport;
+  RemotePortStats stats;
+  // Guards |turns|, |batch|, |compressor|, |sync|, |sync_local_port_id|
+  // and the outbox fields. Not held while a message is sent, sends wait for
+  // their turn instead.
+  std::mutex mutex;
+  SendTurns turns;
+  SendBatch batch;
+  // Null while compression is disabled.
+  std::unique_ptr<PayloadCompressor> compressor;
+  // Sends from the sender threads, done one at a time.
+  AsyncSender::Queue send_queue;
+  // Null until a state is synced to the port.
+  std::unique_ptr<StateSyncSender> sync;
+  // Native id of the local port resync requests come to.
+  int sync_local_port_id;
+  // Null unless messages are stored while the port is not registered.
+  std::unique_ptr<Outbox> outbox;
+  // Incremented when |outbox| is replaced.
+  uint64_t outbox_generation;
+  // Retries draining |outbox| after sending stored messages failed. Added
+  // on the platform thread, once |outbox_retry_requested| is set.
+  Ecore_Timer* outbox_timer;
+  bool outbox_retry_requested;
+};
+
+// Registration state of a remote port, kept up to date by message port
+// registration event callbacks.
+struct RemotePortPresence {
+  bool is_registered;
+  int registered_watcher;
+  int unregistered_watcher;
+};
+
+typedef std::function<void(const RemotePortKey& key, bool is_registered)>
+    PresenceListener;
+typedef std::function<void(MessagePortResult result)> SendCallback;
+typedef std::function<void(std::vector<MessagePortResult> results)>
+    BroadcastCallback;
+// Called with the reply payload, still encoded, or with null |reply| if no
+// reply came in time.
+typedef std::function<void(const uint8_t* reply, size_t size)> ReplyCallback;
+
+// A request waiting for its reply.
+struct PendingRequest {
+  // Native id of the local port the reply is expected on, in the transport
+  // of |port|.
+  int local_port_id;
+  const RemotePortState* port;
+  std::multimap<double, uint32_t>::iterator deadline;
+  ReplyCallback on_reply;
+};
+
+// Ports are referred to by integer handles, which index flat tables, so
+// that sends and received messages do not look ports up by name. Invalid
+// handles are reported as MESSAGE_PORT_ERROR_INVALID_PARAMETER.
+//
+// Remote ports can be opened, checked and sent to from any thread:
+// OpenRemotePort, CheckRemotePort, Send, SendAsync, Broadcast, Reply and
+// SyncState are thread safe. Remote port lookups take no lock, local port
+// lookups only briefly, see SnapshotTable. Sends lock only the port they go
+// to, and not while the message is sent. Local ports are registered,
+// configured and receive messages on the platform thread, where transports
+// call back, so sinks are only used there. Other methods have to be called
+// on the platform thread too.
+//
+// Send, Request, Reply, SyncState and SetCompression send on the calling
+// thread, once sends made earlier to the port, also in the background, are
+// done. On the platform thread they wait at most a second for that, and
+// then return MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE without sending.
+//
+// Each port is bound to a transport, message port by default. A local port
+// can be given as the port to reply to only to remote ports of the same
+// transport.
 class MessagePortManager {
  public:
+  static constexpr int kNoLocalPort = -1;
+  // Events kept for a local port without a sink, at most. The oldest ones
+  // are dropped beyond that.
+  static constexpr size_t kMaxPendingEvents = 1024;
+  static constexpr size_t kDeliveryBudget = 32;
+
   MessagePortManager();
   ~MessagePortManager();
 
-  MessagePortResult CheckRemotePort(std::string& remote_app_id,
-                                    std::string& port_name, bool is_trusted,
-                                    bool* result);
+  // Answers from the presence cache if the remote port is already watched.
+  // Otherwise checks the port and starts watching its registration. Only
+  // message port registrations can be watched, ports of other transports
+  // are checked on every call.
+  MessagePortResult CheckRemotePort(const RemotePortKey& key, bool* result);
+  // |listener| is called when a watched remote port is registered or
+  // unregistered.
+  void SetPresenceListener(PresenceListener listener);
+  // Returns the handle of |key|, the same one on every call, or -1 if too
+  // many remote ports are open.
+  int OpenRemotePort(const RemotePortKey& key);
+  // |sink| may be null, for a port registered before anything listens to
+  // it. Messages received on it are then kept, up to kMaxPendingEvents, and
+  // sent to the sink given to AttachSink.
   MessagePortResult RegisterLocalPort(const std::string& port_name,
                                       EventSink sink, bool is_trusted,
+                                      TransportType transport,
                                       int* local_port);
-  MessagePortResult UnregisterLocalPort(int local_port_id);
-  MessagePortResult Send(std::string& remote_app_id, std::string& port_name,
-                         flutter::EncodableValue& message, bool is_trusted);
-  MessagePortResult Send(std::string& remote_app_id, std::string& port_name,
-                         flutter::EncodableValue& message, bool is_trusted,
-                         int local_port);
+  MessagePortResult UnregisterLocalPort(int local_port);
+  // Sends events kept while |local_port| had no sink to |sink|, then every
+  // later one.
+  MessagePortResult AttachSink(int local_port, EventSink sink);
+  // Keeps events of |local_port| again, until the next AttachSink.
+  MessagePortResult DetachSink(int local_port);
+  // Sends messages received on |local_port| to its sink as lists of up to
+  // |max_batch_size| messages, at most |flush_interval_us| after the first
+  // one was received. |max_batch_size| below 2 sends every message on its
+  // own.
+  MessagePortResult SetInboundBatching(int local_port, size_t max_batch_size,
+                                       int64_t flush_interval_us);
+  // |encoded_message| is a message already serialized with
+  // StandardMessageCodec. It is put into the bundle as is. |local_port| is
+  // kNoLocalPort or a local port the remote application can reply to.
+  MessagePortResult Send(int remote_port,
+                         const std::vector<uint8_t>& encoded_message,
+                         int local_port = kNoLocalPort);
+
+  // Sends from a sender thread, after earlier sends to |remote_port|.
+  // |on_done| is called on the platform thread once the message is sent,
+  // or once its batch is if messages to the port are coalesced. Returns
+  // MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE, without calling |on_done|, if
+  // too many sends are pending.
+  MessagePortResult SendAsync(int remote_port,
+                              const std::vector<uint8_t>& encoded_message,
+                              int local_port, SendCallback on_done);
+
+  // Sends |encoded_message| to all |remote_ports| in parallel, from the
+  // sender threads, so a slow receiver does not delay the others. Each send
+  // comes after earlier sends to its port, and is compressed as they are.
+  // |on_done| is called on the platform thread with a result for each port,
+  // in the order of |remote_ports|.
+  MessagePortResult Broadcast(const std::vector<int>& remote_ports,
+                              const std::vector<uint8_t>& encoded_message,
+                              BroadcastCallback on_done);
+
+  // Sends |encoded_message| with |local_port| to reply to, and calls
+  // |on_reply| with the reply once it is received on |local_port|, or after
+  // |timeout_us| without it. Replies are matched by an id put into the
+  // bundle, and are not sent to the sink of |local_port|. |on_reply| is not
+  // called if an error is returned.
+  MessagePortResult Request(int remote_port,
+                            const std::vector<uint8_t>& encoded_message,
+                            int local_port, int64_t timeout_us,
+                            ReplyCallback on_reply);
+  // Sends |encoded_message| as the reply to |request_id|, a request
+  // received from |remote_port|.
+  MessagePortResult Reply(int remote_port,
+                          const std::vector<uint8_t>& encoded_message,
+                          uint32_t request_id);
+
+  // Sends |state| to |remote_port| as a diff from the last state sent to
+  // it, see StateSyncSender. The receiving local port applies the diff and
+  // delivers the full state as a message. If it missed an update, it asks
+  // for a resync on |local_port|, and the last state is sent in full.
+  // |state| is kept, without copying it, as the base of later diffs.
+  MessagePortResult SyncState(int remote_port, flutter::EncodableMap state,
+                              int local_port);
+
+  // Stores messages sent to |remote_port| without a port to reply to in an
+  // outbox, a file in |directory| named after the port, while the port is
+  // not registered, and sends them in order, in batches, once it is. The
+  // outbox holds up to |max_bytes| of messages, which are dropped after
+  // |ttl_us| unless it is zero. Messages left by an earlier run of the
+  // application are sent too, unless it stored them with another
+  // |max_bytes|. Zero |max_bytes| disables the outbox, dropping stored
+  // messages. Message port registrations are watched, ports of other
+  // transports are drained on the next send or check.
+  MessagePortResult SetOutbox(int remote_port, const std::string& directory,
+                              size_t max_bytes, int64_t ttl_us);
+
+  // Bounds messages sent to the sink of |local_port| and not acknowledged
+  // with AckDelivered to |window|. Further messages are queued, up to
+  // |high_water_mark|, beyond which |policy| applies. Crossings of the high
+  // water mark, and getting back to half of it, are sent to the sink as
+  // "queuePressure" events, in order with messages and batched with them.
+  // Zero |high_water_mark| disables flow control.
+  MessagePortResult SetFlowControl(int local_port, size_t high_water_mark,
+                                   size_t window, OverflowPolicy policy,
+                                   std::string coalesce_key);
+  // Called when Dart has received |count| messages of |local_port|.
+  MessagePortResult AckDelivered(int local_port, size_t count);
+
+  // Sets the priority class of messages of |local_port| sent to Dart. At
+  // most kDeliveryBudget messages of normal and low priority ports are sent
+  // per main loop iteration. Further ones are queued by class and sent in
+  // later iterations, more urgent ones first. Messages of high priority
+  // ports are never queued.
+  MessagePortResult SetDeliveryPriority(int local_port, Priority priority);
+  // Sets the priority class of sends to |remote_port| from the sender
+  // thread. Sends already queued keep their order.
+  MessagePortResult SetSendPriority(int remote_port, Priority priority);
+
+  // Replaces filters of |local_port|. Replies to requests are not filtered.
+  MessagePortResult SetFilters(int local_port,
+                               std::vector<MessageFilter> filters);
+  // Returns counts of messages dropped by each filter of |local_port|.
+  bool GetFilterDrops(int local_port, std::vector<uint64_t>* dropped) const;
+
+  // Encodes |message| into a buffer reused by every call. The result is
+  // valid until the next call. Platform thread only.
+  const std::vector<uint8_t>& EncodeMessage(
+      const flutter::EncodableValue& message);
+
+  AllocationStats GetAllocationStats() const;
+
+  // Returns a map with "localPorts" and "remotePorts" lists of port
+  // counters, "sendQueueDelay" and "deliveryQueueDelay" histograms by
+  // priority class, and "elapsedUs", the time since they were reset.
+  flutter::EncodableValue GetStats() const;
+  void ResetStats();
+
+  Tracer& tracer() { return tracer_; }
+
+  // Packs messages sent to |remote_port| into one bundle, which is sent
+  // when it holds |max_batch_size| messages or |max_delay_us| after the
+  // first one was queued. Zero |max_batch_size| sends queued messages and
+  // disables coalescing.
+  MessagePortResult SetCoalescing(int remote_port, size_t max_batch_size,
+                                  int64_t max_delay_us);
+
+  // Compresses payloads sent to |remote_port| which are at least
+  // |threshold| bytes, with |dictionary| preset. Compression is offered to
+  // the receiving local port, which accepts it on |local_port| if it knows
+  // the dictionary. Payloads are sent uncompressed until then. Compression
+  // is disabled if |enabled| is false, |local_port| is then ignored.
+  MessagePortResult SetCompression(int remote_port, bool enabled,
+                                   size_t threshold,
+                                   std::vector<uint8_t> dictionary,
+                                   int local_port);
+  // Adds a dictionary payloads received on |local_port| can be compressed
+  // with. Payloads compressed without a dictionary are always accepted.
+  MessagePortResult AddCompressionDictionary(int local_port,
+                                             std::vector<uint8_t> dictionary);
+  // Return false if compression is not set up on the port.
+  bool GetCompressionStats(int remote_port, CompressionStats* stats) const;
+  bool GetDecompressionStats(int local_port, CompressionStats* stats) const;
 
  private:
   static void OnMessageReceived(int local_port_id, const char* remote_app_id,
@@ -46,10 +418,200 @@ class MessagePortManager {
                                 bool trusted_remote_port, bundle* message,
                                 void* user_data);
 
-  MessagePortResult CreateResult(int return_code);
-  MessagePortResult PrepareBundle(flutter::EncodableValue& message, bundle*& b);
-  std::map<int, EventSink> sinks_;
-  std::set<int> trusted_ports_;
+  static Eina_Bool OnFlushTimer(void* user_data);
+  static Eina_Bool OnOutboxRetryTimer(void* user_data);
+  static void OnRemotePortRegistered(const char* remote_app_id,
+                                     const char* remote_port,
+                                     bool trusted_remote_port,
+                                     void* user_data);
+  static void OnRemotePortUnregistered(const char* remote_app_id,
+                                       const char* remote_port,
+                                       bool trusted_remote_port,
+                                       void* user_data);
+  static void FillMessageEvent(EventArena& arena,
+                               flutter::EncodableValue& event,
+                               const uint8_t* data, size_t size,
+                               const char* remote_app_id,
+                               const char* remote_port,
+                               bool trusted_remote_port, uint32_t request_id);
+  static Eina_Bool OnDeliveryTimer(void* user_data);
+  static Eina_Bool OnLaneTimer(void* user_data);
+  static Eina_Bool OnRequestTimer(void* user_data);
+
+  // Only the platform thread removes local ports, so the result stays
+  // valid there. Other threads have to hold a reference from local_ports_.
+  LocalPortState* GetLocalPort(int local_port) const;
+  RemotePortState* GetRemotePort(int remote_port) const;
+  // Returns null if |key| was never opened.
+  RemotePortState* FindRemotePort(const RemotePortKey& key) const;
+  // Creates the socket transport on first use.
+  Transport* GetTransport(TransportType type);
+
+  // Sends messages of |message| to the sink of |port|, or an error if it is
+  // malformed. |messages| and |bytes| are set to what was delivered and
+  // received.
+  bool DeliverBundle(LocalPortState& port, bundle* message,
+                     const char* remote_app_id, const char* remote_port,
+                     bool trusted_remote_port, size_t* messages,
+                     size_t* bytes);
+  // |request_id| is zero unless the message is a request.
+  void Deliver(LocalPortState& port, const uint8_t* data, size_t size,
+               const char* remote_app_id, const char* remote_port,
+               bool trusted_remote_port, uint32_t request_id);
+  // Dispatches |event|, or queues it in its priority lane if the delivery
+  // budget of this main loop iteration is spent.
+  void Emit(LocalPortState& port, flutter::EncodableValue event);
+  // Sends |event| to the sink, or adds it to the delivery batch.
+  void Dispatch(LocalPortState& port, flutter::EncodableValue event);
+  // Dispatches queued events up to the delivery budget.
+  void DrainLanes();
+  // Sends |event| to the sink, or keeps a copy if there is none.
+  void SendEvent(LocalPortState& port, const flutter::EncodableValue& event);
+  void SendError(LocalPortState& port, const std::string& error_code,
+                 const std::string& error_message = "");
+  void FlushDeliveryBatch(LocalPortState& port);
+  void Enqueue(LocalPortState& port, flutter::EncodableValue event,
+               const uint8_t* data, size_t size);
+  // Emits queued messages while the window allows.
+  void PumpQueue(LocalPortState& port);
+  void ReportQueuePressure(LocalPortState& port);
+
+  // Called on any thread. |local_port_id| is a native port id.
+  int SendBundle(RemotePortState& port, bundle* b, int local_port_id);
+  // Sends |b| in the turn of the caller. A message without a port to reply
+  // to is given as |stored|, and is stored in the outbox instead while
+  // earlier stored ones can not be sent, or if the port is not found.
+  // |stored| holds coalesced messages if |is_batch|.
+  MessagePortResult SendInTurn(RemotePortState& port, bundle* b,
+                               int local_port_id,
+                               const std::vector<uint8_t>* stored,
+                               bool is_batch);
+  // QueueMessage, StartFlushTimer, FlushBatch, PrepareBundle and
+  // PrepareStateUpdate are called with the mutex of |port| held.
+  // SendInTurn, SendStateUpdate, OutboxPending, DrainOutbox and
+  // StoreInOutbox are called in a turn of |port|, without its mutex held.
+  MessagePortResult QueueMessage(RemotePortState& port,
+                                 const std::vector<uint8_t>& encoded_message);
+  // Adds the flush timer of |port|, on the platform thread.
+  MessagePortResult StartFlushTimer(RemotePortState& port);
+  // Sends the queued messages from a sender thread, in the next turn.
+  MessagePortResult FlushBatch(RemotePortState& port);
+  // Sends |encoded_message| in its own bundle, after messages queued for
+  // |port|, with |correlation_id| under |correlation_key|.
+  MessagePortResult SendCorrelated(RemotePortState& port,
+                                   const std::vector<uint8_t>& encoded_message,
+                                   int local_port_id,
+                                   const char* correlation_key,
+                                   uint32_t correlation_id);
+  // Completes the request |reply_to| if |message| is its reply. Returns
+  // false if no such request is pending.
+  bool CompleteRequest(uint32_t reply_to, const LocalPortState& port,
+                       const char* remote_app_id, const uint8_t* data,
+                       size_t size);
+  // Sets the request timer to the earliest deadline.
+  void ScheduleRequestTimer();
+  // Encodes the update to |state| into |b|, with |port.sync| set. Later
+  // updates are diffs from |state|, unless sending |b| fails.
+  MessagePortResult PrepareStateUpdate(RemotePortState& port,
+                                       flutter::EncodableMap&& state,
+                                       bundle*& b);
+  // Sends a bundle made by PrepareStateUpdate, and has the next update
+  // sent in full if it fails. Releases |b|.
+  int SendStateUpdate(RemotePortState& port, bundle* b, int local_port_id);
+  // Applies a state update received on |port| and delivers the state.
+  void DeliverStateUpdate(LocalPortState& port, bundle* message,
+                          const uint8_t* data, size_t size,
+                          const char* remote_app_id, const char* remote_port,
+                          bool trusted_remote_port);
+  // Resends the last state synced to the sender of a resync request.
+  void HandleResyncRequest(const LocalPortState& port,
+                           const char* remote_app_id, const char* remote_port,
+                           bool trusted_remote_port);
+  // Accepts compression offered by a sender if |port| can inflate it.
+  void HandleCodecOffer(const LocalPortState& port, const char* offer,
+                        const char* remote_app_id, const char* remote_port,
+                        bool trusted_remote_port);
+  // Starts compressing payloads to the port which accepted compression.
+  void HandleCodecAccept(const LocalPortState& port, const char* accepted,
+                         const char* remote_app_id, const char* remote_port,
+                         bool trusted_remote_port);
+  // Returns true if messages to |port| have to be stored in its outbox, as
+  // it is known not to be registered or stored messages could not be sent.
+  bool OutboxPending(RemotePortState& port);
+  // Sends messages stored for |port|. Returns false if some are left, and
+  // has them sent again later unless |port| is known not to be registered.
+  bool DrainOutbox(RemotePortState& port);
+  // Adds the timer retrying DrainOutbox, on the platform thread.
+  void ScheduleOutboxRetry(RemotePortState& port);
+  // Drains the outbox of |key| from a sender thread, if it was opened and
+  // has one.
+  void ResumeOutbox(const RemotePortKey& key);
+  // |data| holds a single message, or coalesced ones if |is_batch|.
+  MessagePortResult StoreInOutbox(RemotePortState& port, const uint8_t* data,
+                                  size_t size, bool is_batch);
+  // Returns stats of a local port, creating them on first use.
+  LocalPortStats& LocalStats(const std::string& port_name, bool is_trusted);
+  void WatchRemotePort(const RemotePortKey& key, bool is_registered);
+  void UpdatePresence(const RemotePortKey& key, bool is_registered);
+  static MessagePortResult CreateResult(int return_code);
+  // Compresses |data| if compression is enabled for |port|.
+  MessagePortResult PrepareBundle(RemotePortState& port,
+                                  const char* bundle_key,
+                                  const std::vector<uint8_t>& data,
+                                  bundle*& b);
+  // Clears |b| and returns it to the pool. Safe to call from any thread.
+  void ReleaseBundle(bundle* b);
+
+  // Indexed by handles. Slots of unregistered local ports are reused.
+  SnapshotTable<LocalPortState> local_ports_;
+  AppendOnlyTable<RemotePortState> remote_ports_;
+  // Serializes additions to |remote_ports_|.
+  std::mutex remote_ports_mutex_;
+  // Handles of remote ports by key, sharded so that threads opening
+  // different ports rarely wait for each other.
+  static constexpr size_t kHandleShards = 16;
+  struct HandleShard {
+    mutable std::shared_mutex mutex;
+    std::map<RemotePortKey, int> handles;
+  };
+  HandleShard& ShardOf(const RemotePortKey& key) const;
+  mutable std::array<HandleShard, kHandleShards> handle_shards_;
+  uint32_t next_request_id_ = 1;
+  std::map<uint32_t, PendingRequest> pending_requests_;
+  // Deadlines in ecore_time_get() seconds, mapped to request ids.
+  std::multimap<double, uint32_t> request_deadlines_;
+  Ecore_Timer* request_timer_ = nullptr;
+  // Events waiting for a delivery budget, by priority.
+  struct LaneEvent {
+    LocalPortState* port;
+    flutter::EncodableValue event;
+  };
+  PriorityLanes<LaneEvent> delivery_lanes_;
+  Ecore_Timer* lane_timer_ = nullptr;
+  // ecore_loop_time_get() of the iteration |delivery_budget_used_| is for.
+  double budget_loop_time_ = 0;
+  size_t delivery_budget_used_ = 0;
+  // Guards |presence_|.
+  std::mutex presence_mutex_;
+  std::map<RemotePortKey, RemotePortPresence> presence_;
+  PresenceListener presence_listener_;
+  std::vector<uint8_t> encode_buffer_;
+  // Reused for received payloads being decompressed.
+  std::vector<uint8_t> compress_buffer_;
+  // Stats are kept by port name, so they outlive port registrations.
+  std::map<std::pair<std::string, bool>, LocalPortStats> local_stats_;
+  Stopwatch stats_since_;
+  Tracer tracer_;
+  BundlePool bundle_pool_;
+  MessagePortTransport message_port_transport_;
+  std::once_flag socket_transport_once_;
+  std::unique_ptr<SocketTransport> socket_transport_;
+  // Stopped first when destroying, so that pending sends are done before
+  // anything they use is destroyed.
+  AsyncSender sender_;
+  // Expires when the manager is destroyed. Tasks run on the platform thread
+  // from other threads hold it, as they use the manager or its ports.
+  std::shared_ptr<void> alive_ = std::make_shared<int>(0);
 };
 
 #endif  // MESSAGEPORT_H
@@ -4,23 +4,353 @@
 
 #include "messageport_tizen_plugin.h"
 
+#include <app_common.h>
 #include <flutter/event_channel.h>
 #include <flutter/event_sink.h>
 #include <flutter/event_stream_handler_functions.h>
 #include <flutter/method_channel.h>
 #include <flutter/plugin_registrar.h>
 #include <flutter/standard_method_codec.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <map>
 #include <memory>
+#include <set>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "log.h"
+#include "message_filter.h"
 #include "messageport.h"
+#include "method_args.h"
+#include "platform_thread.h"
+#include "shared_stream.h"
 
 namespace {
 
+namespace create_local_args {
+enum {
+  kPortName,
+  kTrusted,
+  kDeliveryBatchSize,
+  kDeliveryIntervalUs,
+  kCompressionDictionaries,
+  kHighWaterMark,
+  kAckWindow,
+  kOverflowPolicy,
+  kCoalesceKey,
+  kTransport,
+  kPriority
+};
+constexpr ArgSchema<11> kSchema = {{
+    {"portName", ArgType::kString, true},
+    {"trusted", ArgType::kBool, true},
+    {"deliveryBatchSize", ArgType::kInt, false},
+    {"deliveryIntervalUs", ArgType::kInt, false},
+    {"compressionDictionaries", ArgType::kList, false},
+    {"highWaterMark", ArgType::kInt, false},
+    {"ackWindow", ArgType::kInt, false},
+    {"overflowPolicy", ArgType::kString, false},
+    {"coalesceKey", ArgType::kString, false},
+    {"transport", ArgType::kString, false},
+    {"priority", ArgType::kString, false},
+}};
+}  // namespace create_local_args
+
+namespace ack_messages_args {
+enum { kLocalPort, kCount };
+constexpr ArgSchema<2> kSchema = {{
+    {"localPort", ArgType::kInt, true},
+    {"count", ArgType::kInt, true},
+}};
+}  // namespace ack_messages_args
+
+// Flow control options of a local port.
+struct FlowControl {
+  int64_t high_water_mark = 0;
+  int64_t window = 0;
+  OverflowPolicy policy = OverflowPolicy::kDropOldest;
+  std::string coalesce_key;
+};
+
+// Options of a local port, applied when it is registered.
+struct PortOptions {
+  int64_t delivery_batch_size = 0;
+  int64_t delivery_interval_us = 0;
+  std::vector<std::vector<uint8_t>> dictionaries;
+  FlowControl flow_control;
+  TransportType transport = TransportType::kMessagePort;
+  Priority priority = Priority::kNormal;
+};
+
+bool SameOptions(const PortOptions &a, const PortOptions &b) {
+  const FlowControl &fa = a.flow_control;
+  const FlowControl &fb = b.flow_control;
+  return a.delivery_batch_size == b.delivery_batch_size &&
+         a.delivery_interval_us == b.delivery_interval_us &&
+         a.dictionaries == b.dictionaries && a.transport == b.transport &&
+         a.priority == b.priority &&
+         fa.high_water_mark == fb.high_water_mark && fa.window == fb.window &&
+         fa.policy == fb.policy && fa.coalesce_key == fb.coalesce_key;
+}
+
+// A local port created by Dart or listed in the port manifest.
+struct LocalPortEntry {
+  // kNoLocalPort while the port is not registered.
+  int handle = MessagePortManager::kNoLocalPort;
+  // Applied whenever the port is registered.
+  std::vector<MessageFilter> filters;
+  PortOptions options;
+  // Registered from the port manifest, and kept registered.
+  bool preregistered = false;
+  // Whether createLocal was called for a preregistered port.
+  bool claimed = false;
+  // Whether options were applied to the registered port.
+  bool configured = false;
+};
+
+bool ParseOverflowPolicy(const std::string &name, OverflowPolicy *policy) {
+  if (name == "dropOldest") {
+    *policy = OverflowPolicy::kDropOldest;
+  } else if (name == "dropNewest") {
+    *policy = OverflowPolicy::kDropNewest;
+  } else if (name == "coalesceByKey") {
+    *policy = OverflowPolicy::kCoalesceByKey;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// "transport" is "messagePort", the default, or "socket".
+bool ParseTransport(const std::string &name, TransportType *transport) {
+  if (name == "messagePort") {
+    *transport = TransportType::kMessagePort;
+  } else if (name == "socket") {
+    *transport = TransportType::kSocket;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Directory of outboxes, in the data directory of the application.
+constexpr char kOutboxDirectoryName[] = "messageport_outbox";
+
+// Local ports listed in this file of the application resource directory
+// are registered when the plugin is loaded, one per line, as
+// "<port name> [trusted] [socket]". Lines starting with '#' are comments.
+constexpr char kPortManifestName[] = "messageport_ports.conf";
+
+// Returns false for blank, comment and malformed lines.
+bool ParseManifestLine(const std::string &line, std::string *port_name,
+                       bool *trusted, TransportType *transport) {
+  std::istringstream fields(line);
+  if (!(fields >> *port_name) || (*port_name)[0] == '#') {
+    return false;
+  }
+  std::string option;
+  while (fields >> option) {
+    if (option == "trusted") {
+      *trusted = true;
+    } else if (option == "socket") {
+      *transport = TransportType::kSocket;
+    } else {
+      LOG_ERROR("Unknown option %s of %s in the port manifest",
+                option.c_str(), port_name->c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ParsePriority(const std::string &name, Priority *priority) {
+  if (name == "high") {
+    *priority = Priority::kHigh;
+  } else if (name == "normal") {
+    *priority = Priority::kNormal;
+  } else if (name == "low") {
+    *priority = Priority::kLow;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Also used by connectRemote and for broadcast targets.
+namespace check_for_remote_args {
+enum { kRemoteAppId, kPortName, kTrusted, kTransport };
+constexpr ArgSchema<4> kSchema = {{
+    {"remoteAppId", ArgType::kString, true},
+    {"portName", ArgType::kString, true},
+    {"trusted", ArgType::kBool, true},
+    {"transport", ArgType::kString, false},
+}};
+
+// Returns false if the transport is not known.
+bool GetKey(const MethodArgs<4> &args, RemotePortKey *key) {
+  key->app_id = args.GetString(kRemoteAppId);
+  key->port_name = args.GetString(kPortName);
+  key->is_trusted = args.GetBool(kTrusted);
+  return !args.Has(kTransport) ||
+         ParseTransport(args.GetString(kTransport), &key->transport);
+}
+}  // namespace check_for_remote_args
+
+// Dart sends messages already encoded with StandardMessageCodec under
+// "encodedMessage", so they can be put into the bundle without decoding.
+// A decoded "message" is still accepted and encoded here.
+// Ports are given by the handles returned by connectRemote and createLocal.
+// A message with "replyTo" is the reply to the request with that id.
+namespace send_args {
+enum {
+  kRemotePort,
+  kEncodedMessage,
+  kMessage,
+  kLocalPort,
+  kBackground,
+  kReplyTo
+};
+constexpr ArgSchema<6> kSchema = {{
+    {"remotePort", ArgType::kInt, true},
+    {"encodedMessage", ArgType::kBytes, false},
+    {"message", ArgType::kAny, false},
+    {"localPort", ArgType::kInt, false},
+    {"background", ArgType::kBool, false},
+    {"replyTo", ArgType::kInt, false},
+}};
+}  // namespace send_args
+
+// "targets" is a list of maps with "remoteAppId", "portName" and "trusted".
+namespace broadcast_args {
+enum { kTargets, kEncodedMessage, kMessage };
+constexpr ArgSchema<3> kSchema = {{
+    {"targets", ArgType::kList, true},
+    {"encodedMessage", ArgType::kBytes, false},
+    {"message", ArgType::kAny, false},
+}};
+}  // namespace broadcast_args
+
+namespace request_args {
+enum { kRemotePort, kEncodedMessage, kMessage, kLocalPort, kTimeoutUs };
+constexpr ArgSchema<5> kSchema = {{
+    {"remotePort", ArgType::kInt, true},
+    {"encodedMessage", ArgType::kBytes, false},
+    {"message", ArgType::kAny, false},
+    {"localPort", ArgType::kInt, true},
+    {"timeoutUs", ArgType::kInt, true},
+}};
+}  // namespace request_args
+
+// "state" is sent decoded, as it is diffed natively.
+namespace sync_state_args {
+enum { kRemotePort, kLocalPort, kState };
+constexpr ArgSchema<3> kSchema = {{
+    {"remotePort", ArgType::kInt, true},
+    {"localPort", ArgType::kInt, true},
+    {"state", ArgType::kMap, true},
+}};
+}  // namespace sync_state_args
+
+namespace set_coalescing_args {
+enum { kRemotePort, kMaxBatchSize, kMaxDelayUs };
+constexpr ArgSchema<3> kSchema = {{
+    {"remotePort", ArgType::kInt, true},
+    {"maxBatchSize", ArgType::kInt, true},
+    {"maxDelayUs", ArgType::kInt, true},
+}};
+}  // namespace set_coalescing_args
+
+namespace set_priority_args {
+enum { kRemotePort, kPriority };
+constexpr ArgSchema<2> kSchema = {{
+    {"remotePort", ArgType::kInt, true},
+    {"priority", ArgType::kString, true},
+}};
+}  // namespace set_priority_args
+
+// Zero "maxBytes" disables the outbox.
+namespace set_outbox_args {
+enum { kRemotePort, kMaxBytes, kTtlUs };
+constexpr ArgSchema<3> kSchema = {{
+    {"remotePort", ArgType::kInt, true},
+    {"maxBytes", ArgType::kInt, true},
+    {"ttlUs", ArgType::kInt, false},
+}};
+}  // namespace set_outbox_args
+
+// "localPort" is required if "enabled" is true.
+namespace set_compression_args {
+enum { kRemotePort, kEnabled, kThreshold, kDictionary, kLocalPort };
+constexpr ArgSchema<5> kSchema = {{
+    {"remotePort", ArgType::kInt, true},
+    {"enabled", ArgType::kBool, true},
+    {"threshold", ArgType::kInt, false},
+    {"dictionary", ArgType::kBytes, false},
+    {"localPort", ArgType::kInt, false},
+}};
+}  // namespace set_compression_args
+
+// Stats of "remotePort" if given, otherwise of "localPort".
+namespace compression_stats_args {
+enum { kRemotePort, kLocalPort };
+constexpr ArgSchema<2> kSchema = {{
+    {"remotePort", ArgType::kInt, false},
+    {"localPort", ArgType::kInt, false},
+}};
+}  // namespace compression_stats_args
+
+// "filters" is a list of filter maps, see MessageFilter::Create.
+namespace set_filters_args {
+enum { kLocalPort, kFilters };
+constexpr ArgSchema<2> kSchema = {{
+    {"localPort", ArgType::kInt, true},
+    {"filters", ArgType::kList, true},
+}};
+}  // namespace set_filters_args
+
+namespace filter_stats_args {
+enum { kLocalPort };
+constexpr ArgSchema<1> kSchema = {{
+    {"localPort", ArgType::kInt, true},
+}};
+}  // namespace filter_stats_args
+
+namespace set_tracing_args {
+enum { kEnabled };
+constexpr ArgSchema<1> kSchema = {{
+    {"enabled", ArgType::kBool, true},
+}};
+}  // namespace set_tracing_args
+
+namespace create_stream_args {
+enum { kCapacity };
+constexpr ArgSchema<1> kSchema = {{
+    {"capacity", ArgType::kInt, true},
+}};
+}  // namespace create_stream_args
+
+namespace write_stream_args {
+enum { kPath, kData };
+constexpr ArgSchema<2> kSchema = {{
+    {"path", ArgType::kString, true},
+    {"data", ArgType::kBytes, true},
+}};
+}  // namespace write_stream_args
+
+namespace stream_args {
+enum { kPath };
+constexpr ArgSchema<1> kSchema = {{
+    {"path", ArgType::kString, true},
+}};
+}  // namespace stream_args
+
 class MessageportTizenPlugin : public flutter::Plugin {
  public:
   static void RegisterWithRegistrar(flutter::PluginRegistrar *registrar) {
@@ -40,75 +370,130 @@ class MessageportTizenPlugin : public flutter::Plugin {
   }
 
   MessageportTizenPlugin(flutter::PluginRegistrar *pluginRegistrar)
-      : plugin_registrar_(pluginRegistrar) {}
+      : plugin_registrar_(pluginRegistrar) {
+    SetUpPresenceChannel();
+    RegisterManifestPorts();
+  }
 
   virtual ~MessageportTizenPlugin() {}
 
  private:
-  template <typename T>
-  bool GetValueFromArgs(const flutter::EncodableValue *args, const char *key,
-                        T &out) {
-    if (std::holds_alternative<flutter::EncodableMap>(*args)) {
-      flutter::EncodableMap map = std::get<flutter::EncodableMap>(*args);
-      if (map.find(flutter::EncodableValue(key)) != map.end()) {
-        flutter::EncodableValue value = map[flutter::EncodableValue(key)];
-        if (std::holds_alternative<T>(value)) {
-          out = std::get<T>(value);
-          return true;
-        }
-      }
-      LOG_DEBUG("Key %s not found", key);
-    }
-    return false;
-  }
-
-  bool GetEncodableValueFromArgs(const flutter::EncodableValue *args,
-                                 const char *key,
-                                 flutter::EncodableValue &out) {
-    if (std::holds_alternative<flutter::EncodableMap>(*args)) {
-      flutter::EncodableMap map = std::get<flutter::EncodableMap>(*args);
-      if (map.find(flutter::EncodableValue(key)) != map.end()) {
-        out = map[flutter::EncodableValue(key)];
-        return true;
-      }
-    }
-    return false;
-  }
-
   void HandleMethodCall(
       const flutter::MethodCall<flutter::EncodableValue> &method_call,
       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
     LOG_DEBUG("HandleMethodCall: %s", method_call.method_name().c_str());
+    TraceScope trace(manager_.tracer(), TraceEvent::kMethodCall, 0, 0);
     const flutter::EncodableValue *args = method_call.arguments();
 
     if (method_call.method_name().compare("createLocal") == 0) {
       CreateLocal(args, std::move(result));
     } else if (method_call.method_name().compare("checkForRemote") == 0) {
       CheckForRemote(args, std::move(result));
+    } else if (method_call.method_name().compare("connectRemote") == 0) {
+      ConnectRemote(args, std::move(result));
     } else if (method_call.method_name().compare("send") == 0) {
       Send(args, std::move(result));
+    } else if (method_call.method_name().compare("broadcast") == 0) {
+      Broadcast(args, std::move(result));
+    } else if (method_call.method_name().compare("request") == 0) {
+      Request(args, std::move(result));
+    } else if (method_call.method_name().compare("syncState") == 0) {
+      SyncState(args, std::move(result));
+    } else if (method_call.method_name().compare("setCoalescing") == 0) {
+      SetCoalescing(args, std::move(result));
+    } else if (method_call.method_name().compare("setPriority") == 0) {
+      SetPriority(args, std::move(result));
+    } else if (method_call.method_name().compare("setOutbox") == 0) {
+      SetOutbox(args, std::move(result));
+    } else if (method_call.method_name().compare("setCompression") == 0) {
+      SetCompression(args, std::move(result));
+    } else if (method_call.method_name().compare("getCompressionStats") == 0) {
+      GetCompressionStats(args, std::move(result));
+    } else if (method_call.method_name().compare("ackMessages") == 0) {
+      AckMessages(args, std::move(result));
+    } else if (method_call.method_name().compare("setFilters") == 0) {
+      SetFilters(args, std::move(result));
+    } else if (method_call.method_name().compare("getFilterStats") == 0) {
+      GetFilterStats(args, std::move(result));
+    } else if (method_call.method_name().compare("getStats") == 0) {
+      result->Success(manager_.GetStats());
+    } else if (method_call.method_name().compare("resetStats") == 0) {
+      manager_.ResetStats();
+      result->Success();
+    } else if (method_call.method_name().compare("setTracing") == 0) {
+      SetTracing(args, std::move(result));
+    } else if (method_call.method_name().compare("dumpTrace") == 0) {
+      result->Success(flutter::EncodableValue(manager_.tracer().DumpJson()));
+    } else if (method_call.method_name().compare("getAllocationStats") == 0) {
+      GetAllocationStats(std::move(result));
+    } else if (method_call.method_name().compare("createStream") == 0) {
+      CreateStream(args, std::move(result));
+    } else if (method_call.method_name().compare("writeStream") == 0) {
+      WriteStream(args, std::move(result));
+    } else if (method_call.method_name().compare("closeStream") == 0) {
+      CloseStream(args, std::move(result));
+    } else if (method_call.method_name().compare("openStream") == 0) {
+      OpenStream(args, std::move(result));
     } else {
       result->Error("Invalid method");
     }
   }
 
+  // Remote ports are watched once checked. Their registration changes are
+  // sent to Dart through the presence channel.
+  void SetUpPresenceChannel() {
+    presence_channel_ =
+        std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
+            plugin_registrar_->messenger(), "tizen/messageport/presence",
+            &flutter::StandardMethodCodec::GetInstance());
+
+    auto presence_handler = std::make_unique<
+        flutter::StreamHandlerFunctions<>>(
+        [this](const flutter::EncodableValue *arguments,
+               std::unique_ptr<flutter::EventSink<>> &&events)
+            -> std::unique_ptr<flutter::StreamHandlerError<>> {
+          LOG_DEBUG("OnListen: presence");
+          presence_sink_ = std::move(events);
+          manager_.SetPresenceListener(
+              [this](const RemotePortKey &key, bool is_registered) {
+                flutter::EncodableMap map;
+                map[flutter::EncodableValue("remoteAppId")] =
+                    flutter::EncodableValue(key.app_id);
+                map[flutter::EncodableValue("portName")] =
+                    flutter::EncodableValue(key.port_name);
+                map[flutter::EncodableValue("trusted")] =
+                    flutter::EncodableValue(key.is_trusted);
+                map[flutter::EncodableValue("registered")] =
+                    flutter::EncodableValue(is_registered);
+                presence_sink_->Success(flutter::EncodableValue(map));
+              });
+          return nullptr;
+        },
+        [this](const flutter::EncodableValue *arguments)
+            -> std::unique_ptr<flutter::StreamHandlerError<>> {
+          LOG_DEBUG("OnCancel: presence");
+          manager_.SetPresenceListener(nullptr);
+          presence_sink_.reset();
+          return nullptr;
+        });
+    presence_channel_->SetStreamHandler(std::move(presence_handler));
+  }
+
   void CheckForRemote(
-      const flutter::EncodableValue *args,
+      const flutter::EncodableValue *arguments,
       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
     LOG_DEBUG("CheckForRemote");
-    std::string remote_app_id = "";
-    std::string port_name = "";
-    bool trusted = false;
-    if (!GetValueFromArgs<std::string>(args, "remoteAppId", remote_app_id) ||
-        !GetValueFromArgs<std::string>(args, "portName", port_name) ||
-        !GetValueFromArgs<bool>(args, "trusted", trusted)) {
+    using namespace check_for_remote_args;
+    MethodArgs args(kSchema);
+    RemotePortKey key;
+    if (!args.Bind(arguments) || !GetKey(args, &key)) {
       result->Error("Invalid parameter");
       return;
     }
 
     bool port_check = false;
-    MessagePortResult native_result = manager_.CheckRemotePort(
-        remote_app_id, port_name, trusted, &port_check);
+    MessagePortResult native_result =
+        manager_.CheckRemotePort(key, &port_check);
     if (native_result) {
       result->Success(flutter::EncodableValue(port_check));
     } else {
@@ -116,25 +501,174 @@ class MessageportTizenPlugin : public flutter::Plugin {
     }
   }
 
+  // Returns a handle later calls refer to the remote port by.
+  void ConnectRemote(
+      const flutter::EncodableValue *arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    LOG_DEBUG("ConnectRemote");
+    using namespace check_for_remote_args;
+    MethodArgs args(kSchema);
+    RemotePortKey key;
+    if (!args.Bind(arguments) || !GetKey(args, &key)) {
+      result->Error("Could not connect remote port", "Invalid parameter");
+      return;
+    }
+    int handle = manager_.OpenRemotePort(key);
+    if (handle < 0) {
+      result->Error("Could not connect remote port", "Too many remote ports");
+      return;
+    }
+    result->Success(flutter::EncodableValue(handle));
+  }
+
+  // Returns a handle later calls refer to the local port by. Ports created
+  // with the same name and trust share the handle, and the options of the
+  // first one, including its transport. Options of a port registered from
+  // the port manifest are taken from the first createLocal, and later ones
+  // have to pass the same options.
   void CreateLocal(
-      const flutter::EncodableValue *args,
+      const flutter::EncodableValue *arguments,
       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
     LOG_DEBUG("CreateLocal");
-    std::string port_name = "";
-    bool trusted = false;
-    if (!GetValueFromArgs<std::string>(args, "portName", port_name) ||
-        !GetValueFromArgs<bool>(args, "trusted", trusted)) {
+    using namespace create_local_args;
+    MethodArgs args(kSchema);
+    if (!args.Bind(arguments)) {
+      result->Error("Could not create local port", "Invalid parameter");
+      return;
+    }
+    const std::string &port_name = args.GetString(kPortName);
+    bool trusted = args.GetBool(kTrusted);
+    PortOptions options;
+    options.delivery_batch_size =
+        args.Has(kDeliveryBatchSize) ? args.GetInt(kDeliveryBatchSize) : 0;
+    options.delivery_interval_us =
+        args.Has(kDeliveryIntervalUs) ? args.GetInt(kDeliveryIntervalUs) : 0;
+    if (options.delivery_batch_size < 0 || options.delivery_interval_us < 0 ||
+        (args.Has(kTransport) &&
+         !ParseTransport(args.GetString(kTransport), &options.transport)) ||
+        (args.Has(kPriority) &&
+         !ParsePriority(args.GetString(kPriority), &options.priority))) {
       result->Error("Could not create local port", "Invalid parameter");
       return;
     }
+    FlowControl &flow_control = options.flow_control;
+    if (args.Has(kHighWaterMark)) {
+      flow_control.high_water_mark = args.GetInt(kHighWaterMark);
+      flow_control.window = args.Has(kAckWindow) ? args.GetInt(kAckWindow) : 0;
+      if (args.Has(kCoalesceKey)) {
+        flow_control.coalesce_key = args.GetString(kCoalesceKey);
+      }
+      if (flow_control.high_water_mark < 0 || flow_control.window <= 0 ||
+          (args.Has(kOverflowPolicy) &&
+           !ParseOverflowPolicy(args.GetString(kOverflowPolicy),
+                                &flow_control.policy))) {
+        result->Error("Could not create local port", "Invalid parameter");
+        return;
+      }
+    }
+    if (args.Has(kCompressionDictionaries)) {
+      for (const auto &dictionary : args.GetList(kCompressionDictionaries)) {
+        const auto *bytes = std::get_if<std::vector<uint8_t>>(&dictionary);
+        if (bytes == nullptr) {
+          result->Error("Could not create local port", "Invalid parameter");
+          return;
+        }
+        options.dictionaries.push_back(*bytes);
+      }
+    }
 
-    auto key = std::make_pair(port_name, trusted);
-    if (native_ports_.find(key) != native_ports_.end()) {
+    auto existing = local_port_ids_.find(std::make_pair(port_name, trusted));
+    if (existing != local_port_ids_.end()) {
       LOG_DEBUG("Stream handler for %s, already registered", port_name.c_str());
-      result->Success();
+      LocalPortEntry &entry = local_ports_[existing->second];
+      if (entry.preregistered) {
+        // The port is registered already, so its transport stays.
+        if (args.Has(kTransport) &&
+            options.transport != entry.options.transport) {
+          result->Error("Could not create local port",
+                        "Transport differs from the port manifest");
+          return;
+        }
+        options.transport = entry.options.transport;
+        if (!entry.claimed) {
+          entry.options = std::move(options);
+          entry.claimed = true;
+          // Dart may listen before creating the port.
+          if (entry.configured) {
+            ConfigureLocalPort(entry);
+          }
+        } else if (!SameOptions(options, entry.options)) {
+          result->Error("Could not create local port",
+                        "Options differ from those the port was created with");
+          return;
+        }
+      }
+      result->Success(flutter::EncodableValue(existing->second));
+      return;
+    }
+    int id = AddLocalPort(port_name, trusted, std::move(options),
+                          MessagePortManager::kNoLocalPort);
+    LOG_DEBUG(
+        "Successfully registered stream for local port, port_name: %s, "
+        "trusted: %s",
+        port_name.c_str(), trusted ? "yes " : "no");
+    result->Success(flutter::EncodableValue(id));
+  }
+
+  // Registers ports listed in the port manifest, so that messages sent to
+  // them before Dart starts are kept until it listens.
+  void RegisterManifestPorts() {
+    char *resource_path = app_get_resource_path();
+    if (resource_path == nullptr) {
+      return;
+    }
+    std::string path = std::string(resource_path) + kPortManifestName;
+    free(resource_path);
+    std::ifstream manifest(path);
+    if (!manifest) {
+      LOG_DEBUG("No port manifest at %s", path.c_str());
       return;
     }
 
+    Stopwatch stopwatch;
+    std::string line;
+    while (std::getline(manifest, line)) {
+      std::string port_name;
+      bool trusted = false;
+      PortOptions options;
+      if (!ParseManifestLine(line, &port_name, &trusted, &options.transport)) {
+        continue;
+      }
+      if (local_port_ids_.count(std::make_pair(port_name, trusted))) {
+        continue;
+      }
+      int port = MessagePortManager::kNoLocalPort;
+      MessagePortResult native_result = manager_.RegisterLocalPort(
+          port_name, nullptr, trusted, options.transport, &port);
+      if (!native_result) {
+        LOG_ERROR("Could not register %s from the port manifest: %s",
+                  port_name.c_str(), native_result.message().c_str());
+        continue;
+      }
+      AddLocalPort(port_name, trusted, std::move(options), port);
+    }
+    LOG_INFO("Registered %zu ports from the port manifest in %lld us",
+             local_ports_.size(),
+             static_cast<long long>(stopwatch.ElapsedUs()));
+  }
+
+  // Adds a local port entry and its event channel, and returns its id.
+  // |handle| is a port registered ahead of Dart, or kNoLocalPort.
+  int AddLocalPort(const std::string &port_name, bool trusted,
+                   PortOptions options, int handle) {
+    int id = local_ports_.size();
+    LocalPortEntry entry;
+    entry.handle = handle;
+    entry.options = std::move(options);
+    entry.preregistered = handle != MessagePortManager::kNoLocalPort;
+    local_ports_.push_back(std::move(entry));
+    local_port_ids_[std::make_pair(port_name, trusted)] = id;
+
     std::stringstream event_channel_name;
     if (trusted) {
       event_channel_name << "tizen/messageport/" << port_name << "_trusted";
@@ -149,32 +683,51 @@ class MessageportTizenPlugin : public flutter::Plugin {
 
     auto event_channel_handler =
         std::make_unique<flutter::StreamHandlerFunctions<>>(
-            [this, key](const flutter::EncodableValue *arguments,
-                        std::unique_ptr<flutter::EventSink<>> &&events)
+            [this, port_name, trusted, id](
+                const flutter::EncodableValue *arguments,
+                std::unique_ptr<flutter::EventSink<>> &&events)
                 -> std::unique_ptr<flutter::StreamHandlerError<>> {
-              LOG_DEBUG("OnListen: %s", key.first.c_str());
-              int port = -1;
+              LOG_DEBUG("OnListen: %s", port_name.c_str());
+              LocalPortEntry &entry = local_ports_[id];
+              if (entry.preregistered) {
+                if (!entry.configured) {
+                  ConfigureLocalPort(entry);
+                }
+                // Replays messages received before Dart listened.
+                manager_.AttachSink(entry.handle, std::move(events));
+                return nullptr;
+              }
 
+              int port = -1;
               MessagePortResult native_result = manager_.RegisterLocalPort(
-                  key.first, std::move(events), key.second, &port);
+                  port_name, std::move(events), trusted,
+                  entry.options.transport, &port);
               if (native_result) {
-                native_ports_[key] = port;
+                entry.handle = port;
+                ConfigureLocalPort(entry);
               }
               return nullptr;
             },
-            [this, key](const flutter::EncodableValue *arguments)
+            [this, port_name, id](const flutter::EncodableValue *arguments)
                 -> std::unique_ptr<flutter::StreamHandlerError<>> {
-              LOG_DEBUG("OnCancel: %s", key.first.c_str());
-              if (native_ports_.find(key) == native_ports_.end()) {
+              LOG_DEBUG("OnCancel: %s", port_name.c_str());
+              LocalPortEntry &entry = local_ports_[id];
+              if (entry.handle == MessagePortManager::kNoLocalPort) {
                 LOG_ERROR("Error OnCancel: %s",
                           "Could not find port to unregister");
                 return nullptr;
               }
+              // Ports from the manifest stay registered, keeping messages
+              // until Dart listens again.
+              if (entry.preregistered) {
+                manager_.DetachSink(entry.handle);
+                return nullptr;
+              }
 
               MessagePortResult native_result =
-                  manager_.UnregisterLocalPort(native_ports_[key]);
+                  manager_.UnregisterLocalPort(entry.handle);
               if (native_result) {
-                native_ports_.erase(key);
+                entry.handle = MessagePortManager::kNoLocalPort;
                 return nullptr;
               }
               LOG_ERROR("Error OnCancel: %s", native_result.message().c_str());
@@ -183,48 +736,80 @@ class MessageportTizenPlugin : public flutter::Plugin {
 
     event_channel->SetStreamHandler(std::move(event_channel_handler));
     event_channels_.insert(std::move(event_channel));
-    LOG_DEBUG(
-        "Successfully registered stream for local port, port_name: %s, "
-        "trusted: %s",
-        port_name.c_str(), trusted ? "yes " : "no");
-    result->Success();
+    return id;
+  }
+
+  // Applies filters and options of |entry| to its registered port.
+  void ConfigureLocalPort(LocalPortEntry &entry) {
+    const PortOptions &options = entry.options;
+    int port = entry.handle;
+    manager_.SetFilters(port, entry.filters);
+    manager_.SetInboundBatching(port, options.delivery_batch_size,
+                                options.delivery_interval_us);
+    manager_.SetDeliveryPriority(port, options.priority);
+    for (const auto &dictionary : options.dictionaries) {
+      manager_.AddCompressionDictionary(port, dictionary);
+    }
+    const FlowControl &flow_control = options.flow_control;
+    if (flow_control.high_water_mark > 0) {
+      manager_.SetFlowControl(port, flow_control.high_water_mark,
+                              flow_control.window, flow_control.policy,
+                              flow_control.coalesce_key);
+    }
+    entry.configured = true;
   }
 
   void Send(
-      const flutter::EncodableValue *args,
-      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
-    flutter::EncodableValue message(nullptr);
-    std::string remote_app_id = "";
-    std::string port_name = "";
-    bool trusted = false;
-    if (!GetEncodableValueFromArgs(args, "message", message) ||
-        !GetValueFromArgs<std::string>(args, "remoteAppId", remote_app_id) ||
-        !GetValueFromArgs<std::string>(args, "portName", port_name) ||
-        !GetValueFromArgs<bool>(args, "trusted", trusted)) {
+      const flutter::EncodableValue *arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    using namespace send_args;
+    MethodArgs args(kSchema);
+    if (!args.Bind(arguments) ||
+        (!args.Has(kEncodedMessage) && !args.Has(kMessage))) {
       result->Error("Could not send message", "Invalid parameter");
       return;
     }
 
-    std::string local_port_name;
-    bool local_port_trusted = false;
-    MessagePortResult native_result;
-    if (GetValueFromArgs<std::string>(args, "localPort", local_port_name) &&
-        GetValueFromArgs<bool>(args, "localPortTrusted", local_port_trusted)) {
-      LOG_DEBUG("localPort: %s, trusted: %s", local_port_name.c_str(),
-                local_port_trusted ? "yes" : "no");
-      auto key = std::make_pair(local_port_name, local_port_trusted);
-      if (native_ports_.find(key) == native_ports_.end()) {
+    const std::vector<uint8_t> *encoded_message;
+    if (args.Has(kEncodedMessage)) {
+      encoded_message = &args.GetBytes(kEncodedMessage);
+    } else {
+      encoded_message = &manager_.EncodeMessage(args.Get(kMessage));
+    }
+
+    int remote_port = args.GetInt(kRemotePort);
+    int local_port = MessagePortManager::kNoLocalPort;
+    if (args.Has(kLocalPort)) {
+      local_port = GetLocalPort(args.GetInt(kLocalPort));
+      if (local_port == MessagePortManager::kNoLocalPort) {
         result->Error("Could not send message",
                       "Local port is not registered.");
         return;
       }
+    }
 
-      native_result = manager_.Send(remote_app_id, port_name, message, trusted,
-                                    native_ports_[key]);
-    } else {
-      native_result = manager_.Send(remote_app_id, port_name, message, trusted);
+    // Replies are sent right away, so that they do not wait behind
+    // background sends.
+    if (args.Has(kReplyTo)) {
+      MessagePortResult native_result = manager_.Reply(
+          remote_port, *encoded_message, args.GetInt(kReplyTo));
+      if (native_result) {
+        result->Success();
+      } else {
+        result->Error("Could not send message", native_result.message());
+      }
+      return;
     }
 
+    if (args.Has(kBackground) && args.GetBool(kBackground)) {
+      SendInBackground(remote_port, *encoded_message, local_port,
+                       std::move(result));
+      return;
+    }
+
+    MessagePortResult native_result =
+        manager_.Send(remote_port, *encoded_message, local_port);
+
     if (native_result) {
       result->Success();
     } else {
@@ -232,10 +817,579 @@ class MessageportTizenPlugin : public flutter::Plugin {
     }
   }
 
-  // < channel_name, is_trusted > -> native number >
-  std::map<std::pair<std::string, bool>, int> native_ports_;
+  void SyncState(
+      const flutter::EncodableValue *arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    using namespace sync_state_args;
+    MethodArgs args(kSchema);
+    if (!args.Bind(arguments)) {
+      result->Error("Could not sync state", "Invalid parameter");
+      return;
+    }
+    int local_port = GetLocalPort(args.GetInt(kLocalPort));
+    if (local_port == MessagePortManager::kNoLocalPort) {
+      result->Error("Could not sync state", "Local port is not registered.");
+      return;
+    }
+
+    // Copied once, the manager keeps the state as the base of later diffs.
+    MessagePortResult native_result = manager_.SyncState(
+        args.GetInt(kRemotePort), args.GetMap(kState), local_port);
+    if (native_result) {
+      result->Success();
+    } else {
+      result->Error("Could not sync state", native_result.message());
+    }
+  }
+
+  // Completes |result| with a list holding null for each target the message
+  // was sent to, or an error message.
+  void Broadcast(
+      const flutter::EncodableValue *arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    using namespace broadcast_args;
+    MethodArgs args(kSchema);
+    if (!args.Bind(arguments) ||
+        (!args.Has(kEncodedMessage) && !args.Has(kMessage))) {
+      result->Error("Could not broadcast message", "Invalid parameter");
+      return;
+    }
+
+    std::vector<int> remote_ports;
+    for (const auto &target : args.GetList(kTargets)) {
+      MethodArgs<4> target_args(check_for_remote_args::kSchema);
+      RemotePortKey key;
+      if (!target_args.Bind(&target) ||
+          !check_for_remote_args::GetKey(target_args, &key)) {
+        result->Error("Could not broadcast message", "Invalid target");
+        return;
+      }
+      remote_ports.push_back(manager_.OpenRemotePort(key));
+    }
+
+    const std::vector<uint8_t> *encoded_message;
+    if (args.Has(kEncodedMessage)) {
+      encoded_message = &args.GetBytes(kEncodedMessage);
+    } else {
+      encoded_message = &manager_.EncodeMessage(args.Get(kMessage));
+    }
+
+    std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>
+        shared_result = std::move(result);
+    MessagePortResult native_result = manager_.Broadcast(
+        remote_ports, *encoded_message,
+        [shared_result](std::vector<MessagePortResult> results) {
+          flutter::EncodableList list;
+          list.reserve(results.size());
+          for (auto &target_result : results) {
+            if (target_result) {
+              list.push_back(flutter::EncodableValue());
+            } else {
+              list.push_back(flutter::EncodableValue(target_result.message()));
+            }
+          }
+          shared_result->Success(flutter::EncodableValue(list));
+        });
+    if (!native_result) {
+      shared_result->Error("Could not broadcast message",
+                           native_result.message());
+    }
+  }
+
+  // Completes |result| with the encoded reply, so Dart awaits one future per
+  // round trip.
+  void Request(
+      const flutter::EncodableValue *arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    using namespace request_args;
+    MethodArgs args(kSchema);
+    if (!args.Bind(arguments) ||
+        (!args.Has(kEncodedMessage) && !args.Has(kMessage))) {
+      result->Error("Could not send request", "Invalid parameter");
+      return;
+    }
+
+    const std::vector<uint8_t> *encoded_message;
+    if (args.Has(kEncodedMessage)) {
+      encoded_message = &args.GetBytes(kEncodedMessage);
+    } else {
+      encoded_message = &manager_.EncodeMessage(args.Get(kMessage));
+    }
+    int local_port = GetLocalPort(args.GetInt(kLocalPort));
+    if (local_port == MessagePortManager::kNoLocalPort) {
+      result->Error("Could not send request", "Local port is not registered.");
+      return;
+    }
+
+    std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>
+        shared_result = std::move(result);
+    MessagePortResult native_result = manager_.Request(
+        args.GetInt(kRemotePort), *encoded_message, local_port,
+        args.GetInt(kTimeoutUs),
+        [shared_result](const uint8_t *reply, size_t size) {
+          if (reply == nullptr) {
+            shared_result->Error("Request timed out");
+            return;
+          }
+          shared_result->Success(flutter::EncodableValue(
+              std::vector<uint8_t>(reply, reply + size)));
+        });
+    if (!native_result) {
+      shared_result->Error("Could not send request", native_result.message());
+    }
+  }
+
+  // Completes |result| once a sender thread has sent the message.
+  void SendInBackground(
+      int remote_port, const std::vector<uint8_t> &encoded_message,
+      int local_port,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>
+        shared_result = std::move(result);
+    MessagePortResult native_result = manager_.SendAsync(
+        remote_port, encoded_message, local_port,
+        [shared_result](MessagePortResult send_result) {
+          if (send_result) {
+            shared_result->Success();
+          } else {
+            shared_result->Error("Could not send message",
+                                 send_result.message());
+          }
+        });
+    if (native_result) {
+      return;
+    }
+    if (MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE == native_result.error_code) {
+      shared_result->Error("Send queue is full", native_result.message());
+    } else {
+      shared_result->Error("Could not send message", native_result.message());
+    }
+  }
+
+  void SetCoalescing(
+      const flutter::EncodableValue *arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    using namespace set_coalescing_args;
+    MethodArgs args(kSchema);
+    if (!args.Bind(arguments) || args.GetInt(kMaxBatchSize) < 0) {
+      result->Error("Could not set coalescing", "Invalid parameter");
+      return;
+    }
+    int64_t max_batch_size = args.GetInt(kMaxBatchSize);
+    int64_t max_delay_us = args.GetInt(kMaxDelayUs);
+
+    MessagePortResult native_result = manager_.SetCoalescing(
+        args.GetInt(kRemotePort), max_batch_size, max_delay_us);
+    if (native_result) {
+      result->Success();
+    } else {
+      result->Error("Could not set coalescing", native_result.message());
+    }
+  }
+
+  void SetPriority(
+      const flutter::EncodableValue *arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    using namespace set_priority_args;
+    MethodArgs args(kSchema);
+    Priority priority;
+    if (!args.Bind(arguments) ||
+        !ParsePriority(args.GetString(kPriority), &priority)) {
+      result->Error("Could not set priority", "Invalid parameter");
+      return;
+    }
+
+    MessagePortResult native_result =
+        manager_.SetSendPriority(args.GetInt(kRemotePort), priority);
+    if (native_result) {
+      result->Success();
+    } else {
+      result->Error("Could not set priority", native_result.message());
+    }
+  }
+
+  void SetOutbox(
+      const flutter::EncodableValue *arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    using namespace set_outbox_args;
+    MethodArgs args(kSchema);
+    if (!args.Bind(arguments) || args.GetInt(kMaxBytes) < 0 ||
+        (args.Has(kTtlUs) && args.GetInt(kTtlUs) < 0)) {
+      result->Error("Could not set outbox", "Invalid parameter");
+      return;
+    }
+    int64_t ttl_us = args.Has(kTtlUs) ? args.GetInt(kTtlUs) : 0;
+
+    char *data_path = app_get_data_path();
+    if (data_path == nullptr) {
+      result->Error("Could not set outbox", "No data directory");
+      return;
+    }
+    std::string directory = std::string(data_path) + kOutboxDirectoryName;
+    free(data_path);
+    if (mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) {
+      result->Error("Could not set outbox", strerror(errno));
+      return;
+    }
+
+    MessagePortResult native_result =
+        manager_.SetOutbox(args.GetInt(kRemotePort), directory,
+                           args.GetInt(kMaxBytes), ttl_us);
+    if (native_result) {
+      result->Success();
+    } else {
+      result->Error("Could not set outbox", native_result.message());
+    }
+  }
+
+  void SetCompression(
+      const flutter::EncodableValue *arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    using namespace set_compression_args;
+    MethodArgs args(kSchema);
+    if (!args.Bind(arguments) ||
+        (args.Has(kThreshold) && args.GetInt(kThreshold) < 0)) {
+      result->Error("Could not set compression", "Invalid parameter");
+      return;
+    }
+    int64_t threshold = args.Has(kThreshold) ? args.GetInt(kThreshold) : 0;
+    std::vector<uint8_t> dictionary;
+    if (args.Has(kDictionary)) {
+      dictionary = args.GetBytes(kDictionary);
+    }
+    int local_port = MessagePortManager::kNoLocalPort;
+    if (args.GetBool(kEnabled)) {
+      local_port = args.Has(kLocalPort) ? GetLocalPort(args.GetInt(kLocalPort))
+                                        : MessagePortManager::kNoLocalPort;
+      if (local_port == MessagePortManager::kNoLocalPort) {
+        result->Error("Could not set compression",
+                      "Local port is not registered.");
+        return;
+      }
+    }
+
+    MessagePortResult native_result = manager_.SetCompression(
+        args.GetInt(kRemotePort), args.GetBool(kEnabled), threshold,
+        std::move(dictionary), local_port);
+    if (native_result) {
+      result->Success();
+    } else {
+      result->Error("Could not set compression", native_result.message());
+    }
+  }
+
+  void GetCompressionStats(
+      const flutter::EncodableValue *arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    using namespace compression_stats_args;
+    MethodArgs args(kSchema);
+    if (!args.Bind(arguments)) {
+      result->Error("Could not get compression stats", "Invalid parameter");
+      return;
+    }
+
+    CompressionStats stats;
+    bool found = false;
+    if (args.Has(kRemotePort)) {
+      found = manager_.GetCompressionStats(args.GetInt(kRemotePort), &stats);
+    } else if (args.Has(kLocalPort)) {
+      found = manager_.GetDecompressionStats(
+          GetLocalPort(args.GetInt(kLocalPort)), &stats);
+    }
+    if (!found) {
+      result->Error("Could not get compression stats",
+                    "Compression is not set up on the port");
+      return;
+    }
+
+    flutter::EncodableMap map;
+    map[flutter::EncodableValue("messages")] =
+        flutter::EncodableValue(static_cast<int64_t>(stats.messages));
+    map[flutter::EncodableValue("compressedMessages")] =
+        flutter::EncodableValue(
+            static_cast<int64_t>(stats.compressed_messages));
+    map[flutter::EncodableValue("messageBytes")] =
+        flutter::EncodableValue(static_cast<int64_t>(stats.message_bytes));
+    map[flutter::EncodableValue("bundleBytes")] =
+        flutter::EncodableValue(static_cast<int64_t>(stats.bundle_bytes));
+    map[flutter::EncodableValue("timeUs")] =
+        flutter::EncodableValue(stats.time_us);
+    result->Success(flutter::EncodableValue(map));
+  }
+
+  // Dart acknowledges messages it received from a local port with flow
+  // control, so that more can be sent.
+  void AckMessages(
+      const flutter::EncodableValue *arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    using namespace ack_messages_args;
+    MethodArgs args(kSchema);
+    if (!args.Bind(arguments) || args.GetInt(kCount) < 0) {
+      result->Error("Could not acknowledge messages", "Invalid parameter");
+      return;
+    }
+    int local_port = GetLocalPort(args.GetInt(kLocalPort));
+    // Messages of an unregistered port need no acknowledgement.
+    if (local_port != MessagePortManager::kNoLocalPort) {
+      manager_.AckDelivered(local_port, args.GetInt(kCount));
+    }
+    result->Success();
+  }
+
+  // Filters are kept with the local port, so they apply from the moment it
+  // is registered.
+  void SetFilters(
+      const flutter::EncodableValue *arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    using namespace set_filters_args;
+    MethodArgs args(kSchema);
+    int64_t id = -1;
+    if (args.Bind(arguments)) {
+      id = args.GetInt(kLocalPort);
+    }
+    if (id < 0 || static_cast<size_t>(id) >= local_ports_.size()) {
+      result->Error("Could not set filters", "Invalid parameter");
+      return;
+    }
+
+    std::vector<MessageFilter> filters;
+    for (const auto &spec : args.GetList(kFilters)) {
+      MessageFilter filter;
+      if (!MessageFilter::Create(spec, &filter)) {
+        result->Error("Could not set filters", "Invalid filter");
+        return;
+      }
+      filters.push_back(std::move(filter));
+    }
+
+    LocalPortEntry &entry = local_ports_[id];
+    entry.filters = std::move(filters);
+    if (entry.handle != MessagePortManager::kNoLocalPort) {
+      manager_.SetFilters(entry.handle, entry.filters);
+    }
+    result->Success();
+  }
+
+  // Returns a list of messages dropped by each filter.
+  void GetFilterStats(
+      const flutter::EncodableValue *arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    using namespace filter_stats_args;
+    MethodArgs args(kSchema);
+    int64_t id = -1;
+    if (args.Bind(arguments)) {
+      id = args.GetInt(kLocalPort);
+    }
+    if (id < 0 || static_cast<size_t>(id) >= local_ports_.size()) {
+      result->Error("Could not get filter stats", "Invalid parameter");
+      return;
+    }
+
+    const LocalPortEntry &entry = local_ports_[id];
+    std::vector<uint64_t> dropped(entry.filters.size(), 0);
+    if (entry.handle != MessagePortManager::kNoLocalPort) {
+      manager_.GetFilterDrops(entry.handle, &dropped);
+    }
+    flutter::EncodableList list;
+    for (uint64_t count : dropped) {
+      list.push_back(flutter::EncodableValue(static_cast<int64_t>(count)));
+    }
+    result->Success(flutter::EncodableValue(list));
+  }
+
+  void SetTracing(
+      const flutter::EncodableValue *arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    using namespace set_tracing_args;
+    MethodArgs args(kSchema);
+    if (!args.Bind(arguments)) {
+      result->Error("Could not set tracing", "Invalid parameter");
+      return;
+    }
+    manager_.tracer().SetEnabled(args.GetBool(kEnabled));
+    result->Success();
+  }
+
+  void GetAllocationStats(
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    AllocationStats stats = manager_.GetAllocationStats();
+    flutter::EncodableMap map;
+    map[flutter::EncodableValue("bundlesCreated")] =
+        flutter::EncodableValue(static_cast<int64_t>(stats.bundles_created));
+    map[flutter::EncodableValue("bundlesReused")] =
+        flutter::EncodableValue(static_cast<int64_t>(stats.bundles_reused));
+    map[flutter::EncodableValue("eventsCreated")] =
+        flutter::EncodableValue(static_cast<int64_t>(stats.events_created));
+    map[flutter::EncodableValue("eventsReused")] =
+        flutter::EncodableValue(static_cast<int64_t>(stats.events_reused));
+    map[flutter::EncodableValue("bufferGrowths")] =
+        flutter::EncodableValue(static_cast<int64_t>(stats.buffer_growths));
+    result->Success(flutter::EncodableValue(map));
+  }
+
+  // Shared streams are files in the shared trusted directory, which other
+  // applications signed with the same certificate can map.
+  void CreateStream(
+      const flutter::EncodableValue *arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    using namespace create_stream_args;
+    MethodArgs args(kSchema);
+    if (!args.Bind(arguments) || args.GetInt(kCapacity) <= 0) {
+      result->Error("Could not create stream", "Invalid parameter");
+      return;
+    }
+
+    char *shared_path = app_get_shared_trusted_path();
+    if (shared_path == nullptr) {
+      result->Error("Could not create stream", "No shared trusted directory");
+      return;
+    }
+    std::stringstream path;
+    path << shared_path << "messageport_stream_" << getpid() << "_"
+         << next_stream_id_++;
+    free(shared_path);
+
+    auto stream = SharedStream::Create(path.str(), args.GetInt(kCapacity));
+    if (!stream) {
+      result->Error("Could not create stream", "Failed to map stream file");
+      return;
+    }
+    stream_writers_[path.str()] = std::move(stream);
+    result->Success(flutter::EncodableValue(path.str()));
+  }
+
+  void WriteStream(
+      const flutter::EncodableValue *arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    using namespace write_stream_args;
+    MethodArgs args(kSchema);
+    if (!args.Bind(arguments)) {
+      result->Error("Could not write to stream", "Invalid parameter");
+      return;
+    }
+    auto stream = stream_writers_.find(args.GetString(kPath));
+    if (stream == stream_writers_.end()) {
+      result->Error("Could not write to stream", "Stream is not created.");
+      return;
+    }
+
+    const std::vector<uint8_t> &data = args.GetBytes(kData);
+    if (!stream->second->Write(data.data(), data.size())) {
+      result->Error("Stream is full");
+      return;
+    }
+    result->Success();
+  }
+
+  void CloseStream(
+      const flutter::EncodableValue *arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    using namespace stream_args;
+    MethodArgs args(kSchema);
+    if (!args.Bind(arguments)) {
+      result->Error("Could not close stream", "Invalid parameter");
+      return;
+    }
+    stream_writers_.erase(args.GetString(kPath));
+    result->Success();
+  }
+
+  // Records read from the stream are sent to the event channel of the stream
+  // as lists of byte arrays, one list per wakeup of the receiver thread.
+  void OpenStream(
+      const flutter::EncodableValue *arguments,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+    using namespace stream_args;
+    MethodArgs args(kSchema);
+    if (!args.Bind(arguments)) {
+      result->Error("Could not open stream", "Invalid parameter");
+      return;
+    }
+    const std::string &path = args.GetString(kPath);
+    if (stream_readers_.find(path) != stream_readers_.end()) {
+      result->Success();
+      return;
+    }
+
+    StreamReader &reader = stream_readers_[path];
+    reader.channel =
+        std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
+            plugin_registrar_->messenger(), "tizen/messageport/stream" + path,
+            &flutter::StandardMethodCodec::GetInstance());
+
+    auto handler = std::make_unique<flutter::StreamHandlerFunctions<>>(
+        [this, path](const flutter::EncodableValue *arguments,
+                     std::unique_ptr<flutter::EventSink<>> &&events)
+            -> std::unique_ptr<flutter::StreamHandlerError<>> {
+          LOG_DEBUG("OnListen: %s", path.c_str());
+          auto stream = SharedStream::Open(path);
+          if (!stream) {
+            return std::make_unique<flutter::StreamHandlerError<>>(
+                "Could not open stream", "Failed to map stream file", nullptr);
+          }
+
+          StreamReader &reader = stream_readers_[path];
+          reader.sink = std::move(events);
+          std::weak_ptr<flutter::EventSink<>> weak_sink = reader.sink;
+          reader.receiver = std::make_unique<SharedStreamReceiver>(
+              std::move(stream),
+              [weak_sink](std::vector<std::vector<uint8_t>> records) {
+                RunOnPlatformThread([weak_sink,
+                                     records = std::move(records)]() mutable {
+                  auto sink = weak_sink.lock();
+                  if (!sink) {
+                    return;
+                  }
+                  flutter::EncodableList list;
+                  list.reserve(records.size());
+                  for (auto &record : records) {
+                    list.push_back(flutter::EncodableValue(std::move(record)));
+                  }
+                  sink->Success(flutter::EncodableValue(std::move(list)));
+                });
+              });
+          return nullptr;
+        },
+        [this, path](const flutter::EncodableValue *arguments)
+            -> std::unique_ptr<flutter::StreamHandlerError<>> {
+          LOG_DEBUG("OnCancel: %s", path.c_str());
+          StreamReader &reader = stream_readers_[path];
+          reader.receiver.reset();
+          reader.sink.reset();
+          return nullptr;
+        });
+    reader.channel->SetStreamHandler(std::move(handler));
+    result->Success();
+  }
+
+  // Returns the manager handle of the local port created as |id|, or
+  // kNoLocalPort if it is not registered.
+  int GetLocalPort(int64_t id) const {
+    if (id < 0 || static_cast<size_t>(id) >= local_ports_.size()) {
+      return MessagePortManager::kNoLocalPort;
+    }
+    return local_ports_[id].handle;
+  }
+
+  struct StreamReader {
+    std::unique_ptr<flutter::EventChannel<flutter::EncodableValue>> channel;
+    std::shared_ptr<flutter::EventSink<>> sink;
+    std::unique_ptr<SharedStreamReceiver> receiver;
+  };
+
+  int next_stream_id_ = 0;
+  std::map<std::string, std::unique_ptr<SharedStream>> stream_writers_;
+  std::map<std::string, StreamReader> stream_readers_;
+
+  // Indexed by ids returned by createLocal.
+  std::vector<LocalPortEntry> local_ports_;
+  // < channel_name, is_trusted > -> id >
+  std::map<std::pair<std::string, bool>, int> local_port_ids_;
   std::set<std::unique_ptr<flutter::EventChannel<flutter::EncodableValue>>>
       event_channels_;
+  std::unique_ptr<flutter::EventChannel<flutter::EncodableValue>>
+      presence_channel_;
+  std::unique_ptr<flutter::EventSink<>> presence_sink_;
   MessagePortManager manager_;
   flutter::PluginRegistrar *plugin_registrar_;
 };
@@ -0,0 +1,132 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef METHOD_ARGS_H
+#define METHOD_ARGS_H
+
+#include <flutter/encodable_value.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class ArgType { kBool, kInt, kString, kBytes, kList, kMap, kAny };
+
+struct ArgSpec {
+  const char* name;
+  ArgType type;
+  bool required;
+};
+
+template <size_t N>
+using ArgSchema = std::array<ArgSpec, N>;
+
+// Binds method call arguments to a schema in one pass over the argument map.
+// Values are borrowed from the method call, nothing is copied, so accessors
+// are valid only as long as the method call arguments are.
+template <size_t N>
+class MethodArgs {
+ public:
+  explicit MethodArgs(const ArgSchema<N>& schema) : schema_(schema) {}
+
+  // Returns false if |args| is not a map, a value has a type other than
+  // declared in the schema or a required value is missing.
+  bool Bind(const flutter::EncodableValue* args) {
+    values_.fill(nullptr);
+    if (args == nullptr) {
+      return !HasRequired();
+    }
+    const auto* map = std::get_if<flutter::EncodableMap>(args);
+    if (map == nullptr) {
+      return false;
+    }
+
+    for (const auto& entry : *map) {
+      const auto* key = std::get_if<std::string>(&entry.first);
+      if (key == nullptr) {
+        continue;
+      }
+      for (size_t i = 0; i < N; i++) {
+        if (key->compare(schema_[i].name) != 0) {
+          continue;
+        }
+        if (!HasType(entry.second, schema_[i].type)) {
+          return false;
+        }
+        values_[i] = &entry.second;
+        break;
+      }
+    }
+
+    for (size_t i = 0; i < N; i++) {
+      if (schema_[i].required && values_[i] == nullptr) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool Has(size_t index) const { return values_[index] != nullptr; }
+
+  const flutter::EncodableValue& Get(size_t index) const {
+    return *values_[index];
+  }
+
+  bool GetBool(size_t index) const { return std::get<bool>(*values_[index]); }
+
+  int64_t GetInt(size_t index) const { return values_[index]->LongValue(); }
+
+  const std::string& GetString(size_t index) const {
+    return std::get<std::string>(*values_[index]);
+  }
+
+  const std::vector<uint8_t>& GetBytes(size_t index) const {
+    return std::get<std::vector<uint8_t>>(*values_[index]);
+  }
+
+  const flutter::EncodableList& GetList(size_t index) const {
+    return std::get<flutter::EncodableList>(*values_[index]);
+  }
+
+  const flutter::EncodableMap& GetMap(size_t index) const {
+    return std::get<flutter::EncodableMap>(*values_[index]);
+  }
+
+ private:
+  static bool HasType(const flutter::EncodableValue& value, ArgType type) {
+    switch (type) {
+      case ArgType::kBool:
+        return std::holds_alternative<bool>(value);
+      case ArgType::kInt:
+        return std::holds_alternative<int32_t>(value) ||
+               std::holds_alternative<int64_t>(value);
+      case ArgType::kString:
+        return std::holds_alternative<std::string>(value);
+      case ArgType::kBytes:
+        return std::holds_alternative<std::vector<uint8_t>>(value);
+      case ArgType::kList:
+        return std::holds_alternative<flutter::EncodableList>(value);
+      case ArgType::kMap:
+        return std::holds_alternative<flutter::EncodableMap>(value);
+      case ArgType::kAny:
+        return true;
+    }
+    return false;
+  }
+
+  bool HasRequired() const {
+    for (const auto& spec : schema_) {
+      if (spec.required) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const ArgSchema<N>& schema_;
+  std::array<const flutter::EncodableValue*, N> values_;
+};
+
+#endif  // METHOD_ARGS_H
@@ -0,0 +1,261 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "outbox.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include "log.h"
+
+static constexpr uint32_t kOutboxMagic = 0x424f504d;  // "MPOB"
+static constexpr uint32_t kOutboxVersion = 2;
+static constexpr size_t kMaxKeyLength = 255;
+
+// Placed at the beginning of the file, followed by |capacity| bytes of
+// records. Records between the offsets are pending, the ones before
+// |read_offset| were drained.
+struct OutboxHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t capacity;
+  uint64_t read_offset;
+  uint64_t write_offset;
+  char key[kMaxKeyLength + 1];
+};
+
+// Precedes each message, which is padded to a multiple of 8 bytes.
+struct OutboxRecord {
+  uint32_t size;
+  // CRC-32 of |stored_at_us| and the message.
+  uint32_t checksum;
+  // Wall clock time, which is comparable across restarts.
+  int64_t stored_at_us;
+};
+
+static size_t RecordSize(size_t message_size) {
+  return sizeof(OutboxRecord) + ((message_size + 7) & ~size_t(7));
+}
+
+static int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+static uint32_t Checksum(const OutboxRecord* record) {
+  uLong crc = crc32(0L, Z_NULL, 0);
+  crc = crc32(crc, reinterpret_cast<const Bytef*>(&record->stored_at_us),
+              sizeof(record->stored_at_us));
+  return crc32(crc, reinterpret_cast<const Bytef*>(record + 1), record->size);
+}
+
+// Returns the number of valid records of |header|, and drops the ones from
+// the first invalid one on. A crash can leave a partly written record, and
+// the kernel may write the header back before the record it points past.
+static size_t CheckRecords(OutboxHeader* header, const uint8_t* data) {
+  size_t count = 0;
+  uint64_t offset = header->read_offset;
+  while (offset < header->write_offset) {
+    const auto* record = reinterpret_cast<const OutboxRecord*>(data + offset);
+    if (header->write_offset - offset < sizeof(OutboxRecord) ||
+        RecordSize(record->size) > header->write_offset - offset ||
+        Checksum(record) != record->checksum) {
+      LOG_WARN("Dropping %s outbox records",
+               count > 0 ? "corrupt trailing" : "corrupt");
+      header->write_offset = offset;
+      break;
+    }
+    offset += RecordSize(record->size);
+    count++;
+  }
+  return count;
+}
+
+// Maps the file at |path|, which is created or resized to |mapping_size|
+// unless it has that size already. |existing| tells whether it had.
+// |flags| are added to the flags of open(). Returns null on failure.
+static OutboxHeader* MapFile(const std::string& path, size_t mapping_size,
+                             int flags, bool* existing) {
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | flags, 0600);
+  if (fd < 0) {
+    LOG_ERROR("Failed to open %s: %s", path.c_str(), strerror(errno));
+    return nullptr;
+  }
+  void* mapping = nullptr;
+  struct stat file_stat;
+  *existing = fstat(fd, &file_stat) == 0 &&
+              static_cast<size_t>(file_stat.st_size) == mapping_size;
+  if (*existing || ftruncate(fd, mapping_size) == 0) {
+    mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd, 0);
+  }
+  close(fd);
+  if (mapping == nullptr || mapping == MAP_FAILED) {
+    LOG_ERROR("Failed to map %s: %s", path.c_str(), strerror(errno));
+    unlink(path.c_str());
+    return nullptr;
+  }
+  return static_cast<OutboxHeader*>(mapping);
+}
+
+std::unique_ptr<Outbox> Outbox::Open(const std::string& path,
+                                     const std::string& key, size_t capacity,
+                                     int64_t ttl_us) {
+  if (capacity < RecordSize(0) || capacity > UINT32_MAX ||
+      key.size() > kMaxKeyLength) {
+    LOG_ERROR("Invalid outbox for %s", key.c_str());
+    return nullptr;
+  }
+  size_t mapping_size = sizeof(OutboxHeader) + capacity;
+  bool existing = false;
+  OutboxHeader* header = MapFile(path, mapping_size, 0, &existing);
+  if (nullptr == header) {
+    return nullptr;
+  }
+  if (existing && header->magic == kOutboxMagic &&
+      header->version == kOutboxVersion && header->capacity == capacity &&
+      header->read_offset <= header->write_offset &&
+      header->write_offset <= capacity &&
+      strncmp(header->key, key.c_str(), sizeof(header->key)) == 0) {
+    size_t pending =
+        CheckRecords(header, reinterpret_cast<uint8_t*>(header + 1));
+    LOG_DEBUG("Reopened %s with %zu messages", path.c_str(), pending);
+    return std::unique_ptr<Outbox>(
+        new Outbox(path, header, mapping_size, ttl_us, pending));
+  }
+  if (existing) {
+    LOG_WARN("Discarding %s, it does not match %s", path.c_str(), key.c_str());
+  }
+
+  header->capacity = capacity;
+  header->read_offset = 0;
+  header->write_offset = 0;
+  memset(header->key, 0, sizeof(header->key));
+  memcpy(header->key, key.c_str(), key.size());
+  header->version = kOutboxVersion;
+  header->magic = kOutboxMagic;
+  return std::unique_ptr<Outbox>(
+      new Outbox(path, header, mapping_size, ttl_us, 0));
+}
+
+Outbox::Outbox(std::string path, OutboxHeader* header, size_t mapping_size,
+               int64_t ttl_us, size_t pending)
+    : path_(std::move(path)),
+      header_(header),
+      data_(reinterpret_cast<uint8_t*>(header + 1)),
+      mapping_size_(mapping_size),
+      ttl_us_(ttl_us),
+      pending_(pending) {}
+
+Outbox::~Outbox() { munmap(header_, mapping_size_); }
+
+bool Outbox::empty() const {
+  return header_->read_offset == header_->write_offset;
+}
+
+bool Outbox::Append(const uint8_t* data, size_t size) {
+  size_t record_size = RecordSize(size);
+  if (size <= UINT32_MAX &&
+      record_size > header_->capacity - header_->write_offset &&
+      record_size <= header_->capacity -
+                         (header_->write_offset - header_->read_offset)) {
+    Compact();
+  }
+  if (size > UINT32_MAX ||
+      record_size > header_->capacity - header_->write_offset) {
+    stats_.rejected++;
+    return false;
+  }
+
+  auto* record = reinterpret_cast<OutboxRecord*>(data_ + header_->write_offset);
+  record->size = size;
+  record->stored_at_us = NowUs();
+  memcpy(record + 1, data, size);
+  record->checksum = Checksum(record);
+  // Written last, so a crash of the application never leaves a partial
+  // record pending. Records the kernel had no time to write back fail
+  // their checksum when the log is reopened.
+  header_->write_offset += record_size;
+  pending_++;
+  stats_.stored++;
+  return true;
+}
+
+uint64_t Outbox::ReadBatch(std::vector<uint8_t>& batch, size_t max_bytes) {
+  read_messages_ = 0;
+  read_expired_ = 0;
+  int64_t now_us = NowUs();
+  uint64_t offset = header_->read_offset;
+  while (offset < header_->write_offset) {
+    const auto* record = reinterpret_cast<const OutboxRecord*>(data_ + offset);
+    uint32_t size = record->size;
+    bool expired = ttl_us_ > 0 && now_us - record->stored_at_us > ttl_us_;
+    if (!expired) {
+      if (!batch.empty() && batch.size() + sizeof(size) + size > max_bytes) {
+        break;
+      }
+      const auto* size_bytes = reinterpret_cast<const uint8_t*>(&size);
+      const auto* message = reinterpret_cast<const uint8_t*>(record + 1);
+      batch.insert(batch.end(), size_bytes, size_bytes + sizeof(size));
+      batch.insert(batch.end(), message, message + size);
+    } else {
+      read_expired_++;
+    }
+    read_messages_++;
+    offset += RecordSize(size);
+  }
+  return offset;
+}
+
+void Outbox::Consume(uint64_t cursor) {
+  header_->read_offset = cursor;
+  if (header_->read_offset == header_->write_offset) {
+    // Rewound end first: a crash in between leaves the read offset past
+    // the end, and the log is discarded, rather than drained again.
+    header_->write_offset = 0;
+    header_->read_offset = 0;
+  }
+  pending_ -= read_messages_;
+  stats_.drained += read_messages_ - read_expired_;
+  stats_.expired += read_expired_;
+  read_messages_ = 0;
+  read_expired_ = 0;
+}
+
+void Outbox::Delete() { unlink(path_.c_str()); }
+
+bool Outbox::Compact() {
+  // Pending messages are copied to a new file which then replaces the log,
+  // so that a crash leaves either the old log or the new one.
+  std::string new_path = path_ + ".new";
+  bool existing = false;
+  OutboxHeader* header = MapFile(new_path, mapping_size_, O_TRUNC, &existing);
+  if (nullptr == header) {
+    return false;
+  }
+  uint64_t size = header_->write_offset - header_->read_offset;
+  memcpy(header, header_, sizeof(OutboxHeader));
+  header->read_offset = 0;
+  header->write_offset = size;
+  memcpy(header + 1, data_ + header_->read_offset, size);
+  if (msync(header, sizeof(OutboxHeader) + size, MS_SYNC) != 0 ||
+      rename(new_path.c_str(), path_.c_str()) != 0) {
+    LOG_ERROR("Failed to compact %s: %s", path_.c_str(), strerror(errno));
+    munmap(header, mapping_size_);
+    unlink(new_path.c_str());
+    return false;
+  }
+  munmap(header_, mapping_size_);
+  header_ = header;
+  data_ = reinterpret_cast<uint8_t*>(header + 1);
+  return true;
+}
@@ -0,0 +1,85 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct OutboxHeader;
+
+// Counters of one outbox, since it was opened or its stats were reset.
+struct OutboxStats {
+  size_t stored = 0;
+  size_t drained = 0;
+  // Dropped when drained, as they were older than the time to live.
+  size_t expired = 0;
+  // Not stored, as the log was full.
+  size_t rejected = 0;
+};
+
+// Messages sent to a remote port while it is not registered, kept in order
+// in an append-only log in a memory mapped file. The log is bounded, and is
+// reopened by a later run of the application, so messages survive a
+// restart. Records are checksummed, and ones a crash left incomplete are
+// dropped on reopening. Messages older than the time to live are dropped
+// when drained. Not thread safe.
+class Outbox {
+ public:
+  // Opens the log at |path|, or creates it, with room for |capacity| bytes
+  // of messages. Messages left by an earlier run are kept if they were
+  // stored for the same |key|. Zero |ttl_us| keeps messages until drained.
+  static std::unique_ptr<Outbox> Open(const std::string& path,
+                                      const std::string& key, size_t capacity,
+                                      int64_t ttl_us);
+
+  ~Outbox();
+
+  Outbox(const Outbox&) = delete;
+  Outbox& operator=(const Outbox&) = delete;
+
+  bool empty() const;
+  // Returns false, counting the message as rejected, if it does not fit.
+  bool Append(const uint8_t* data, size_t size);
+  // Appends the oldest messages which have not expired to |batch|, each
+  // prefixed with its uint32_t size, as long as |batch| stays within
+  // |max_bytes|. The first message is always appended. Returns a cursor to
+  // pass to Consume once they are sent, |batch| is left empty if all read
+  // messages expired.
+  uint64_t ReadBatch(std::vector<uint8_t>& batch, size_t max_bytes);
+  // Removes the messages read by the ReadBatch which returned |cursor|.
+  void Consume(uint64_t cursor);
+  // Removes the file.
+  void Delete();
+
+  const OutboxStats& stats() const { return stats_; }
+  void ResetStats() { stats_ = OutboxStats(); }
+  // Messages stored and not drained yet, including expired ones.
+  size_t pending() const { return pending_; }
+
+ private:
+  Outbox(std::string path, OutboxHeader* header, size_t mapping_size,
+         int64_t ttl_us, size_t pending);
+
+  // Moves pending messages to the beginning of a new log file, which
+  // replaces the current one. Returns false, leaving the log as it is, on
+  // failure.
+  bool Compact();
+
+  std::string path_;
+  OutboxHeader* header_;
+  uint8_t* data_;
+  size_t mapping_size_;
+  int64_t ttl_us_;
+  size_t pending_;
+  // Messages read by the last ReadBatch, expired ones included.
+  size_t read_messages_ = 0;
+  size_t read_expired_ = 0;
+  OutboxStats stats_;
+};
+
+#endif  // OUTBOX_H
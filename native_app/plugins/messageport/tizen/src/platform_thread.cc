@@ -0,0 +1,28 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "platform_thread.h"
+
+#include <Ecore.h>
+
+static void RunTask(void* data) {
+  std::function<void()>* task = static_cast<std::function<void()>*>(data);
+  (*task)();
+  delete task;
+}
+
+void RunOnPlatformThread(std::function<void()> task) {
+  ecore_main_loop_thread_safe_call_async(
+      RunTask, new std::function<void()>(std::move(task)));
+}
+
+void RunOnPlatformThread(std::weak_ptr<void> alive,
+                         std::function<void()> task) {
+  RunOnPlatformThread([alive = std::move(alive), task = std::move(task)] {
+    if (!alive.expired()) {
+      task();
+    }
+  });
+}
+
+bool IsPlatformThread() { return eina_main_loop_is(); }
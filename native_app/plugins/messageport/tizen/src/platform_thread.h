@@ -0,0 +1,23 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PLATFORM_THREAD_H
+#define PLATFORM_THREAD_H
+
+#include <functional>
+#include <memory>
+
+// Runs |task| on the platform thread, which runs the Ecore main loop.
+// Safe to call from any thread.
+void RunOnPlatformThread(std::function<void()> task);
+// Runs |task| on the platform thread, unless |alive| has expired by then,
+// for tasks using objects which may be destroyed first. The object owning
+// |alive| has to release it on the platform thread.
+void RunOnPlatformThread(std::weak_ptr<void> alive,
+                         std::function<void()> task);
+
+// Returns true if called on the platform thread.
+bool IsPlatformThread();
+
+#endif  // PLATFORM_THREAD_H
@@ -0,0 +1,93 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "port_stats.h"
+
+static flutter::EncodableValue ToValue(const std::atomic<uint64_t>& counter) {
+  return flutter::EncodableValue(
+      static_cast<int64_t>(counter.load(std::memory_order_relaxed)));
+}
+
+void LatencyHistogram::Record(int64_t latency_us) {
+  size_t bucket = 0;
+  if (latency_us > 0) {
+    bucket = 64 - __builtin_clzll(static_cast<uint64_t>(latency_us));
+    if (bucket >= kBuckets) {
+      bucket = kBuckets - 1;
+    }
+  } else {
+    latency_us = 0;
+  }
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_us_.fetch_add(latency_us, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Reset() {
+  for (auto& bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  count_.store(0, std::memory_order_relaxed);
+  sum_us_.store(0, std::memory_order_relaxed);
+}
+
+flutter::EncodableValue LatencyHistogram::ToEncodableValue() const {
+  size_t used = kBuckets;
+  while (used > 0 && buckets_[used - 1].load(std::memory_order_relaxed) == 0) {
+    used--;
+  }
+  flutter::EncodableList buckets;
+  buckets.reserve(used);
+  for (size_t i = 0; i < used; i++) {
+    buckets.push_back(ToValue(buckets_[i]));
+  }
+
+  flutter::EncodableMap map;
+  map[flutter::EncodableValue("count")] = ToValue(count_);
+  map[flutter::EncodableValue("sumUs")] = ToValue(sum_us_);
+  map[flutter::EncodableValue("buckets")] =
+      flutter::EncodableValue(std::move(buckets));
+  return flutter::EncodableValue(std::move(map));
+}
+
+void PortCounters::Reset() {
+  messages.store(0, std::memory_order_relaxed);
+  bytes.store(0, std::memory_order_relaxed);
+  failures.store(0, std::memory_order_relaxed);
+}
+
+void PortCounters::AddTo(flutter::EncodableMap& map) const {
+  map[flutter::EncodableValue("messages")] = ToValue(messages);
+  map[flutter::EncodableValue("bytes")] = ToValue(bytes);
+  map[flutter::EncodableValue("failures")] = ToValue(failures);
+}
+
+void LocalPortStats::Reset() {
+  PortCounters::Reset();
+  decode_time.Reset();
+  replay_delay.Reset();
+}
+
+flutter::EncodableMap LocalPortStats::ToEncodableMap() const {
+  flutter::EncodableMap map;
+  AddTo(map);
+  map[flutter::EncodableValue("decodeTime")] = decode_time.ToEncodableValue();
+  map[flutter::EncodableValue("replayDelay")] =
+      replay_delay.ToEncodableValue();
+  return map;
+}
+
+void RemotePortStats::Reset() {
+  PortCounters::Reset();
+  encode_time.Reset();
+  send_time.Reset();
+}
+
+flutter::EncodableMap RemotePortStats::ToEncodableMap() const {
+  flutter::EncodableMap map;
+  AddTo(map);
+  map[flutter::EncodableValue("encodeTime")] = encode_time.ToEncodableValue();
+  map[flutter::EncodableValue("sendTime")] = send_time.ToEncodableValue();
+  return map;
+}
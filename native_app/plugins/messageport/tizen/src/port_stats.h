@@ -0,0 +1,88 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PORT_STATS_H
+#define PORT_STATS_H
+
+#include <flutter/encodable_value.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Counts latencies in power of two buckets of microseconds. Bucket 0 counts
+// zero, bucket i counts values from 2^(i-1) up to 2^i. Safe to record from
+// any thread.
+class LatencyHistogram {
+ public:
+  static constexpr size_t kBuckets = 32;
+
+  void Record(int64_t latency_us);
+  void Reset();
+  // Returns a map with "count", "sumUs" and "buckets", with trailing empty
+  // buckets left out.
+  flutter::EncodableValue ToEncodableValue() const;
+
+ private:
+  std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_us_{0};
+};
+
+// Counters of one port, updated with relaxed atomics so that they can stay
+// enabled all the time.
+struct PortCounters {
+  // Id of the port in trace events.
+  uint32_t trace_port = 0;
+  std::atomic<uint64_t> messages{0};
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<uint64_t> failures{0};
+
+  void Add(uint64_t message_count, uint64_t byte_count) {
+    messages.fetch_add(message_count, std::memory_order_relaxed);
+    bytes.fetch_add(byte_count, std::memory_order_relaxed);
+  }
+  void AddFailure() { failures.fetch_add(1, std::memory_order_relaxed); }
+  void Reset();
+  void AddTo(flutter::EncodableMap& map) const;
+};
+
+// |decode_time| is the time taken to unpack one received bundle and pass
+// its messages on. |replay_delay| is the time events received while nothing
+// listened to the port waited for a listener.
+struct LocalPortStats : PortCounters {
+  LatencyHistogram decode_time;
+  LatencyHistogram replay_delay;
+
+  void Reset();
+  flutter::EncodableMap ToEncodableMap() const;
+};
+
+// |encode_time| is the time taken to prepare one bundle, |send_time| is the
+// time message port takes to send it.
+struct RemotePortStats : PortCounters {
+  LatencyHistogram encode_time;
+  LatencyHistogram send_time;
+
+  void Reset();
+  flutter::EncodableMap ToEncodableMap() const;
+};
+
+// Measures time from its creation.
+class Stopwatch {
+ public:
+  Stopwatch() : start_(std::chrono::steady_clock::now()) {}
+
+  int64_t ElapsedUs() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start_)
+        .count();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+};
+
+#endif  // PORT_STATS_H
@@ -0,0 +1,136 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PORT_TABLE_H
+#define PORT_TABLE_H
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// A table of entries which are never removed, indexed by handle. Lookups
+// take no lock and can run on any thread while entries are added. Entries
+// are allocated in fixed segments, so they never move.
+template <typename T>
+class AppendOnlyTable {
+ public:
+  static constexpr size_t kSegmentSize = 256;
+  static constexpr size_t kMaxSegments = 256;
+
+  // Returns the handle of |entry|, or -1 if the table is full. Calls must
+  // be serialized by the caller.
+  int Add(std::unique_ptr<T> entry) {
+    size_t handle = size_.load(std::memory_order_relaxed);
+    size_t segment = handle / kSegmentSize;
+    if (segment >= kMaxSegments) {
+      return -1;
+    }
+    if (!segments_[segment]) {
+      segments_[segment] = std::make_unique<Segment>();
+    }
+    (*segments_[segment])[handle % kSegmentSize] = std::move(entry);
+    // Publishes the entry, and the segment, to Get.
+    size_.store(handle + 1, std::memory_order_release);
+    return handle;
+  }
+
+  // Returns null if |handle| is not in the table.
+  T* Get(int handle) const {
+    if (handle < 0 ||
+        static_cast<size_t>(handle) >= size_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return (*segments_[handle / kSegmentSize])[handle % kSegmentSize].get();
+  }
+
+  size_t size() const { return size_.load(std::memory_order_acquire); }
+
+ private:
+  typedef std::array<std::unique_ptr<T>, kSegmentSize> Segment;
+
+  std::array<std::unique_ptr<Segment>, kMaxSegments> segments_;
+  std::atomic<size_t> size_{0};
+};
+
+// A table indexed by handle, read from any thread and changed rarely.
+// Readers take the current snapshot of the table, which writers replace
+// with an updated copy, RCU style. A removed entry stays alive as long as a
+// reader holds it. Slots of removed entries are reused.
+//
+// Reads are not lock free: std::atomic_load of a shared_ptr takes one of a
+// pool of spinlocks in the standard library, only while the snapshot is
+// copied. Readers never wait for writers otherwise.
+template <typename T>
+class SnapshotTable {
+ public:
+  SnapshotTable() : snapshot_(std::make_shared<const Entries>()) {}
+
+  // Returns the handle of |entry|.
+  int Add(std::shared_ptr<T> entry) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    auto entries = std::make_shared<Entries>(*Load());
+    size_t handle = 0;
+    while (handle < entries->size() && (*entries)[handle]) {
+      handle++;
+    }
+    if (handle == entries->size()) {
+      entries->push_back(std::move(entry));
+    } else {
+      (*entries)[handle] = std::move(entry);
+    }
+    Store(std::move(entries));
+    return handle;
+  }
+
+  // Returns the removed entry, or null if there was none.
+  std::shared_ptr<T> Remove(int handle) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    std::shared_ptr<const Entries> current = Load();
+    if (handle < 0 || static_cast<size_t>(handle) >= current->size()) {
+      return nullptr;
+    }
+    auto entries = std::make_shared<Entries>(*current);
+    std::shared_ptr<T> removed = std::move((*entries)[handle]);
+    Store(std::move(entries));
+    return removed;
+  }
+
+  // Returns null if there is no entry at |handle|.
+  std::shared_ptr<T> Get(int handle) const {
+    std::shared_ptr<const Entries> entries = Load();
+    if (handle < 0 || static_cast<size_t>(handle) >= entries->size()) {
+      return nullptr;
+    }
+    return (*entries)[handle];
+  }
+
+  // Calls |visitor| with each entry of the current snapshot.
+  template <typename Visitor>
+  void ForEach(Visitor visitor) const {
+    std::shared_ptr<const Entries> entries = Load();
+    for (const auto& entry : *entries) {
+      if (entry) {
+        visitor(*entry);
+      }
+    }
+  }
+
+ private:
+  typedef std::vector<std::shared_ptr<T>> Entries;
+
+  std::shared_ptr<const Entries> Load() const {
+    return std::atomic_load_explicit(&snapshot_, std::memory_order_acquire);
+  }
+  void Store(std::shared_ptr<const Entries> entries) {
+    std::atomic_store_explicit(&snapshot_, std::move(entries),
+                               std::memory_order_release);
+  }
+
+  std::shared_ptr<const Entries> snapshot_;
+  std::mutex write_mutex_;
+};
+
+#endif  // PORT_TABLE_H
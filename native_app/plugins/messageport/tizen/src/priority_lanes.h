@@ -0,0 +1,122 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef PRIORITY_LANES_H
+#define PRIORITY_LANES_H
+
+#include <flutter/encodable_value.h>
+
+#include <array>
+#include <cstdint>
+#include <deque>
+
+#include "port_stats.h"
+#include "trace.h"
+
+// Priority classes of ports, from the most urgent.
+enum class Priority : uint8_t { kHigh, kNormal, kLow };
+
+static constexpr size_t kPriorityCount = 3;
+
+// Queues of items of each priority class. Pop returns the oldest item of the
+// most urgent class, unless an item of a less urgent class has waited for
+// longer than the limit of its class, so that less urgent items are delayed
+// but never starved. Queueing delays are recorded for each class.
+//
+// Not thread safe.
+template <typename T>
+class PriorityLanes {
+ public:
+  // |max_wait_us| is indexed by priority. The limit of kHigh is not used.
+  explicit PriorityLanes(std::array<int64_t, kPriorityCount> max_wait_us)
+      : max_wait_us_(max_wait_us) {}
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+  // Whether an item of |priority| or a more urgent class is queued.
+  bool HasQueued(Priority priority) const {
+    for (size_t lane = 0; lane <= static_cast<size_t>(priority); lane++) {
+      if (!lanes_[lane].empty()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Push(Priority priority, T item) {
+    lanes_[static_cast<size_t>(priority)].push_back(
+        Entry{Tracer::NowUs(), std::move(item)});
+    size_++;
+  }
+
+  // Must not be called while empty.
+  T Pop() {
+    int64_t now_us = Tracer::NowUs();
+    size_t pick = kPriorityCount;
+    for (size_t lane = 1; lane < kPriorityCount; lane++) {
+      if (!lanes_[lane].empty() &&
+          now_us - lanes_[lane].front().queued_us >= max_wait_us_[lane]) {
+        pick = lane;
+        break;
+      }
+    }
+    if (pick == kPriorityCount) {
+      pick = 0;
+      while (lanes_[pick].empty()) {
+        pick++;
+      }
+    }
+
+    Entry entry = std::move(lanes_[pick].front());
+    lanes_[pick].pop_front();
+    size_--;
+    delays_[pick].Record(now_us - entry.queued_us);
+    return std::move(entry.item);
+  }
+
+  // Removes queued items for which |predicate| returns true.
+  template <typename Predicate>
+  void RemoveIf(Predicate predicate) {
+    for (auto& lane : lanes_) {
+      for (auto it = lane.begin(); it != lane.end();) {
+        if (predicate(it->item)) {
+          it = lane.erase(it);
+          size_--;
+        } else {
+          ++it;
+        }
+      }
+    }
+  }
+
+  // Returns a map of delay histograms by class name.
+  flutter::EncodableValue DelaysToEncodableValue() const {
+    static const char* kNames[] = {"high", "normal", "low"};
+    flutter::EncodableMap map;
+    for (size_t lane = 0; lane < kPriorityCount; lane++) {
+      map[flutter::EncodableValue(kNames[lane])] =
+          delays_[lane].ToEncodableValue();
+    }
+    return flutter::EncodableValue(std::move(map));
+  }
+
+  void ResetDelays() {
+    for (auto& delay : delays_) {
+      delay.Reset();
+    }
+  }
+
+ private:
+  struct Entry {
+    int64_t queued_us;
+    T item;
+  };
+
+  std::array<std::deque<Entry>, kPriorityCount> lanes_;
+  std::array<int64_t, kPriorityCount> max_wait_us_;
+  std::array<LatencyHistogram, kPriorityCount> delays_;
+  size_t size_ = 0;
+};
+
+#endif  // PRIORITY_LANES_H
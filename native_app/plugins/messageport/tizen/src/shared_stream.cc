@@ -0,0 +1,260 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+#include "shared_stream.h"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "log.h"
+
+static constexpr uint32_t kSharedStreamMagic = 0x4d505353;  // "MPSS"
+
+// Placed at the beginning of the mapping, followed by |capacity| bytes of
+// records. Positions only grow, the offset in the ring is position modulo
+// capacity.
+struct SharedStreamHeader {
+  uint32_t magic;
+  uint32_t capacity;
+  std::atomic<uint64_t> write_position;
+  std::atomic<uint64_t> read_position;
+  // Incremented on every write, the consumer waits on it with a futex.
+  std::atomic<uint32_t> write_sequence;
+  std::atomic<uint32_t> closed;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+              "Shared atomics must be lock free");
+
+static void FutexWait(std::atomic<uint32_t>* word, uint32_t expected,
+                      int timeout_ms) {
+  struct timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000};
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected,
+          &timeout, nullptr, 0);
+}
+
+static void FutexWake(std::atomic<uint32_t>* word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, 1, nullptr,
+          nullptr, 0);
+}
+
+static void* MapFile(int fd, size_t size) {
+  void* mapping =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  return mapping == MAP_FAILED ? nullptr : mapping;
+}
+
+std::unique_ptr<SharedStream> SharedStream::Create(const std::string& path,
+                                                   size_t capacity) {
+  if (capacity == 0 || capacity > UINT32_MAX) {
+    LOG_ERROR("Invalid capacity: %zu", capacity);
+    return nullptr;
+  }
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    LOG_ERROR("Failed to create %s: %s", path.c_str(), strerror(errno));
+    return nullptr;
+  }
+
+  size_t mapping_size = sizeof(SharedStreamHeader) + capacity;
+  void* mapping = nullptr;
+  if (ftruncate(fd, mapping_size) == 0) {
+    mapping = MapFile(fd, mapping_size);
+  }
+  close(fd);
+  if (mapping == nullptr) {
+    LOG_ERROR("Failed to map %s: %s", path.c_str(), strerror(errno));
+    unlink(path.c_str());
+    return nullptr;
+  }
+
+  SharedStreamHeader* header = new (mapping) SharedStreamHeader();
+  header->capacity = capacity;
+  header->write_position = 0;
+  header->read_position = 0;
+  header->write_sequence = 0;
+  header->closed = 0;
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = kSharedStreamMagic;
+  return std::unique_ptr<SharedStream>(
+      new SharedStream(path, true, header, capacity, mapping_size));
+}
+
+std::unique_ptr<SharedStream> SharedStream::Open(const std::string& path) {
+  int fd = open(path.c_str(), O_RDWR);
+  if (fd < 0) {
+    LOG_ERROR("Failed to open %s: %s", path.c_str(), strerror(errno));
+    return nullptr;
+  }
+
+  void* mapping = nullptr;
+  size_t mapping_size = lseek(fd, 0, SEEK_END);
+  if (mapping_size > sizeof(SharedStreamHeader)) {
+    mapping = MapFile(fd, mapping_size);
+  }
+  close(fd);
+  if (mapping == nullptr) {
+    LOG_ERROR("Failed to map %s", path.c_str());
+    return nullptr;
+  }
+
+  SharedStreamHeader* header = static_cast<SharedStreamHeader*>(mapping);
+  size_t capacity = header->capacity;
+  if (header->magic != kSharedStreamMagic || capacity == 0 ||
+      sizeof(SharedStreamHeader) + capacity != mapping_size) {
+    LOG_ERROR("%s is not a shared stream", path.c_str());
+    munmap(mapping, mapping_size);
+    return nullptr;
+  }
+  return std::unique_ptr<SharedStream>(
+      new SharedStream(path, false, header, capacity, mapping_size));
+}
+
+SharedStream::SharedStream(std::string path, bool is_producer,
+                           SharedStreamHeader* header, size_t capacity,
+                           size_t mapping_size)
+    : path_(std::move(path)),
+      is_producer_(is_producer),
+      header_(header),
+      data_(reinterpret_cast<uint8_t*>(header + 1)),
+      capacity_(capacity),
+      mapping_size_(mapping_size) {}
+
+SharedStream::~SharedStream() {
+  if (is_producer_) {
+    Close();
+    // The consumer keeps its mapping after the file is removed.
+    unlink(path_.c_str());
+  }
+  munmap(header_, mapping_size_);
+}
+
+bool SharedStream::Write(const uint8_t* data, size_t size) {
+  uint64_t write = header_->write_position.load(std::memory_order_relaxed);
+  uint64_t read = header_->read_position.load(std::memory_order_acquire);
+  uint32_t record_size = size;
+  // The read position is written by the consumer, it is not trusted.
+  uint64_t used = write - read;
+  if (size > UINT32_MAX || used > capacity_ ||
+      sizeof(record_size) + size > capacity_ - used) {
+    return false;
+  }
+
+  CopyIn(write, reinterpret_cast<const uint8_t*>(&record_size),
+         sizeof(record_size));
+  CopyIn(write + sizeof(record_size), data, size);
+  header_->write_position.store(write + sizeof(record_size) + size,
+                                std::memory_order_release);
+  header_->write_sequence.fetch_add(1, std::memory_order_release);
+  FutexWake(&header_->write_sequence);
+  return true;
+}
+
+bool SharedStream::Read(std::vector<std::vector<uint8_t>>& records,
+                        int timeout_ms) {
+  if (broken_) {
+    return false;
+  }
+  // Loaded before the positions, so a write made in between changes it and
+  // the wait below returns right away.
+  uint32_t sequence =
+      header_->write_sequence.load(std::memory_order_acquire);
+  uint64_t read = header_->read_position.load(std::memory_order_relaxed);
+  uint64_t write = header_->write_position.load(std::memory_order_acquire);
+  if (read == write) {
+    if (header_->closed.load(std::memory_order_acquire)) {
+      return false;
+    }
+    FutexWait(&header_->write_sequence, sequence, timeout_ms);
+    write = header_->write_position.load(std::memory_order_acquire);
+  }
+
+  // The write position and record sizes are written by the producer, so
+  // they are checked before anything is copied out of the ring.
+  uint64_t unread = std::min<uint64_t>(write - read, capacity_);
+  while (unread > 0) {
+    uint32_t record_size = 0;
+    if (unread < sizeof(record_size)) {
+      broken_ = true;
+      break;
+    }
+    CopyOut(read, reinterpret_cast<uint8_t*>(&record_size),
+            sizeof(record_size));
+    if (record_size > unread - sizeof(record_size)) {
+      broken_ = true;
+      break;
+    }
+    read += sizeof(record_size);
+    unread -= sizeof(record_size) + record_size;
+    std::vector<uint8_t> record(record_size);
+    CopyOut(read, record.data(), record_size);
+    read += record_size;
+    records.push_back(std::move(record));
+  }
+  header_->read_position.store(read, std::memory_order_release);
+  if (broken_) {
+    LOG_ERROR("Shared stream %s is corrupt", path_.c_str());
+    return false;
+  }
+  return true;
+}
+
+void SharedStream::Close() {
+  header_->closed.store(1, std::memory_order_release);
+  header_->write_sequence.fetch_add(1, std::memory_order_release);
+  FutexWake(&header_->write_sequence);
+}
+
+void SharedStream::CopyIn(uint64_t position, const uint8_t* data,
+                          size_t size) {
+  size_t offset = position % capacity_;
+  size_t first = std::min(size, capacity_ - offset);
+  memcpy(data_ + offset, data, first);
+  memcpy(data_, data + first, size - first);
+}
+
+void SharedStream::CopyOut(uint64_t position, uint8_t* data,
+                           size_t size) const {
+  size_t offset = position % capacity_;
+  size_t first = std::min(size, capacity_ - offset);
+  memcpy(data, data_ + offset, first);
+  memcpy(data + first, data_, size - first);
+}
+
+// How often the receiver thread checks whether it was stopped.
+static constexpr int kReceiverWaitMs = 100;
+
+SharedStreamReceiver::SharedStreamReceiver(std::unique_ptr<SharedStream> stream,
+                                           RecordsCallback on_records)
+    : stream_(std::move(stream)),
+      on_records_(std::move(on_records)),
+      thread_(&SharedStreamReceiver::Run, this) {}
+
+SharedStreamReceiver::~SharedStreamReceiver() {
+  stopped_ = true;
+  thread_.join();
+}
+
+void SharedStreamReceiver::Run() {
+  std::vector<std::vector<uint8_t>> records;
+  while (!stopped_) {
+    bool open = stream_->Read(records, kReceiverWaitMs);
+    if (!records.empty()) {
+      on_records_(std::move(records));
+      records.clear();
+    }
+    if (!open) {
+      LOG_DEBUG("Shared stream %s closed", stream_->path().c_str());
+      break;
+    }
+  }
+}
@@ -0,0 +1,82 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SHARED_STREAM_H
+#define SHARED_STREAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SharedStreamHeader;
+
+// Single-producer, single-consumer ring buffer of size-prefixed records in
+// a memory mapped file, shared by two processes. The consumer is woken up
+// with a futex in the mapping, so no IPC is made per record.
+class SharedStream {
+ public:
+  // Creates the file at |path| for the producer side.
+  static std::unique_ptr<SharedStream> Create(const std::string& path,
+                                              size_t capacity);
+  // Maps the file created by the producer for the consumer side.
+  static std::unique_ptr<SharedStream> Open(const std::string& path);
+
+  ~SharedStream();
+
+  // Returns false if there is not enough space for |size| bytes now.
+  bool Write(const uint8_t* data, size_t size);
+
+  // Waits up to |timeout_ms| for records and appends all available ones to
+  // |records|. Returns false once the producer has closed the stream and
+  // every record was read, or once the stream is found to be corrupt.
+  bool Read(std::vector<std::vector<uint8_t>>& records, int timeout_ms);
+
+  // Marks the stream closed and wakes up the consumer.
+  void Close();
+
+  const std::string& path() const { return path_; }
+
+ private:
+  SharedStream(std::string path, bool is_producer, SharedStreamHeader* header,
+               size_t capacity, size_t mapping_size);
+
+  void CopyIn(uint64_t position, const uint8_t* data, size_t size);
+  void CopyOut(uint64_t position, uint8_t* data, size_t size) const;
+
+  std::string path_;
+  bool is_producer_;
+  SharedStreamHeader* header_;
+  uint8_t* data_;
+  // Copied from the header when mapped, as the peer can change the header.
+  size_t capacity_;
+  size_t mapping_size_;
+  // Set when the positions or a record size in the mapping are invalid.
+  bool broken_ = false;
+};
+
+// Reads a consumer side SharedStream on its own thread.
+class SharedStreamReceiver {
+ public:
+  // |on_records| is called on the receiver thread.
+  typedef std::function<void(std::vector<std::vector<uint8_t>> records)>
+      RecordsCallback;
+
+  SharedStreamReceiver(std::unique_ptr<SharedStream> stream,
+                       RecordsCallback on_records);
+  ~SharedStreamReceiver();
+
+ private:
+  void Run();
+
+  std::unique_ptr<SharedStream> stream_;
+  RecordsCallback on_records_;
+  std::atomic<bool> stopped_{false};
+  std::thread thread_;
+};
+
+#endif  // SHARED_STREAM_H
@@ -0,0 +1,685 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "socket_transport.h"
+
+#include <app_common.h>
+#include <app_manager.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <package_manager.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "log.h"
+
+// Every datagram starts with a FrameHeader, followed by the name of the
+// port to reply to, and the bundle records, unless they are passed in a
+// memfd. Each record is a RecordHeader followed by the key and the value.
+// The sending application is not named in the frame, the receiver looks
+// it up from the credentials of the connection.
+struct FrameHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t flags;
+  uint32_t reply_port_size;
+  uint32_t records_size;
+};
+
+struct RecordHeader {
+  int32_t type;
+  uint32_t key_size;
+  uint32_t value_size;
+};
+
+// A bundle value to be sent, referenced where the bundle keeps it.
+struct Record {
+  RecordHeader header;
+  const char* key;
+  const void* value;
+};
+
+static constexpr uint32_t kFrameMagic = 0x4d50534b;  // "MPSK"
+static constexpr uint16_t kFrameVersion = 2;
+static constexpr uint16_t kReplyPortTrusted = 1 << 0;
+static constexpr uint16_t kRecordsInMemfd = 1 << 1;
+
+// Larger frames pass their records in a memfd. Kept well below the default
+// socket send buffer, as a datagram has to fit into it.
+static constexpr size_t kMaxFrameSize = 128 * 1024;
+
+static constexpr int kListenBacklog = 16;
+
+// Sends from other threads wait at most this long for a full receiver, the
+// platform thread does not wait.
+static constexpr timeval kSendTimeout = {1, 0};
+
+// At most this many frames are read from a connection at once, so that a
+// busy sender does not hold the platform thread.
+static constexpr int kMaxFramesPerRead = 64;
+
+static const char kAddressPrefix[] = "messageport/";
+
+// Returns the abstract socket address of a port, without the leading NUL.
+static std::string SocketAddress(const std::string& app_id,
+                                 const std::string& port_name,
+                                 bool is_trusted) {
+  return kAddressPrefix + app_id + "/" + port_name +
+         (is_trusted ? "/trusted" : "");
+}
+
+static bool ToSockaddr(const std::string& address, sockaddr_un* addr,
+                       socklen_t* length) {
+  // The leading NUL puts the address in the abstract namespace.
+  if (address.size() + 1 > sizeof(addr->sun_path)) {
+    LOG_ERROR("Socket address is too long: %s", address.c_str());
+    return false;
+  }
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  memcpy(addr->sun_path + 1, address.data(), address.size());
+  *length = offsetof(sockaddr_un, sun_path) + 1 + address.size();
+  return true;
+}
+
+// Returns the id of the application whose process is at the other end of
+// |fd|, as it was when the socket was connected, or an empty string.
+static std::string PeerAppId(int fd) {
+  ucred credentials;
+  socklen_t length = sizeof(credentials);
+  char* app_id = nullptr;
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) < 0 ||
+      app_manager_get_app_id(credentials.pid, &app_id) !=
+          APP_MANAGER_ERROR_NONE ||
+      nullptr == app_id) {
+    return std::string();
+  }
+  std::string peer_app_id = app_id;
+  free(app_id);
+  return peer_app_id;
+}
+
+static bool CertificatesMatch(const std::string& app_id,
+                              const std::string& other_app_id) {
+  package_manager_compare_result_type_e result;
+  return package_manager_compare_app_cert_info(
+             app_id.c_str(), other_app_id.c_str(), &result) ==
+             PACKAGE_MANAGER_ERROR_NONE &&
+         PACKAGE_MANAGER_COMPARE_MATCH == result;
+}
+
+SocketTransport::OutgoingSocket::~OutgoingSocket() { close(fd_); }
+
+SocketTransport::SocketTransport() {
+  char* app_id = nullptr;
+  if (app_get_id(&app_id) == 0 && app_id) {
+    app_id_ = app_id;
+  } else {
+    LOG_ERROR("Failed to get the application id");
+  }
+  free(app_id);
+}
+
+SocketTransport::~SocketTransport() {
+  for (auto& entry : local_ports_) {
+    LocalPort& port = *entry.second;
+    while (!port.connections.empty()) {
+      CloseConnection(port.connections.back().get());
+    }
+    ecore_main_fd_handler_del(port.handler);
+    close(port.listen_fd);
+  }
+  if (receive_bundle_) {
+    bundle_free(receive_bundle_);
+  }
+}
+
+int SocketTransport::RegisterLocalPort(const std::string& port_name,
+                                       bool is_trusted,
+                                       ReceiveCallback callback,
+                                       void* user_data) {
+  sockaddr_un addr;
+  socklen_t addr_length;
+  if (port_name.empty() ||
+      !ToSockaddr(SocketAddress(app_id_, port_name, is_trusted), &addr,
+                  &addr_length)) {
+    return MESSAGE_PORT_ERROR_INVALID_PARAMETER;
+  }
+
+  int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    LOG_ERROR("Failed to create a socket: %s", strerror(errno));
+    return MESSAGE_PORT_ERROR_IO_ERROR;
+  }
+  if (bind(fd, reinterpret_cast<sockaddr*>(&addr), addr_length) < 0 ||
+      listen(fd, kListenBacklog) < 0) {
+    LOG_ERROR("Failed to listen on port %s: %s", port_name.c_str(),
+              strerror(errno));
+    close(fd);
+    return MESSAGE_PORT_ERROR_IO_ERROR;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  int id = next_port_id_++;
+  auto port = std::unique_ptr<LocalPort>(
+      new LocalPort{this, id, port_name, is_trusted, fd, nullptr, callback,
+                    user_data, {}});
+  port->handler = ecore_main_fd_handler_add(fd, ECORE_FD_READ, OnAccept,
+                                            port.get(), nullptr, nullptr);
+  if (nullptr == port->handler) {
+    close(fd);
+    return MESSAGE_PORT_ERROR_IO_ERROR;
+  }
+  local_ports_[id] = std::move(port);
+  return id;
+}
+
+int SocketTransport::UnregisterLocalPort(int local_port_id,
+                                         bool /*is_trusted*/) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto entry = local_ports_.find(local_port_id);
+  if (entry == local_ports_.end()) {
+    return MESSAGE_PORT_ERROR_INVALID_PARAMETER;
+  }
+
+  LocalPort& port = *entry->second;
+  while (!port.connections.empty()) {
+    CloseConnection(port.connections.back().get());
+  }
+  ecore_main_fd_handler_del(port.handler);
+  close(port.listen_fd);
+  local_ports_.erase(entry);
+  return MESSAGE_PORT_ERROR_NONE;
+}
+
+int SocketTransport::CheckRemotePort(const std::string& app_id,
+                                     const std::string& port_name,
+                                     bool is_trusted, bool* exists) {
+  int error = MESSAGE_PORT_ERROR_NONE;
+  // The connection is kept for the sends which usually follow.
+  std::shared_ptr<OutgoingSocket> socket = GetSocket(
+      SocketAddress(app_id, port_name, is_trusted), app_id, is_trusted, &error);
+  *exists = socket != nullptr;
+  return error == MESSAGE_PORT_ERROR_PORT_NOT_FOUND ? MESSAGE_PORT_ERROR_NONE
+                                                    : error;
+}
+
+int SocketTransport::Send(const std::string& app_id,
+                          const std::string& port_name, bool is_trusted,
+                          bundle* b, int local_port_id) {
+  std::string reply_port;
+  bool reply_port_trusted = false;
+  if (local_port_id >= 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = local_ports_.find(local_port_id);
+    if (entry == local_ports_.end()) {
+      return MESSAGE_PORT_ERROR_INVALID_PARAMETER;
+    }
+    reply_port = entry->second->name;
+    reply_port_trusted = entry->second->is_trusted;
+  }
+
+  std::string address = SocketAddress(app_id, port_name, is_trusted);
+  int ret = MESSAGE_PORT_ERROR_NONE;
+  // A cached connection may have been closed by the remote port since, in
+  // which case a new one is opened once.
+  for (int attempt = 0; attempt < 2; attempt++) {
+    std::shared_ptr<OutgoingSocket> socket =
+        GetSocket(address, app_id, is_trusted, &ret);
+    if (nullptr == socket) {
+      return ret;
+    }
+    ret = SendFrame(socket->fd(), b, reply_port, reply_port_trusted);
+    if (MESSAGE_PORT_ERROR_PORT_NOT_FOUND != ret) {
+      return ret;
+    }
+    DropSocket(address, socket);
+  }
+  return ret;
+}
+
+std::shared_ptr<SocketTransport::OutgoingSocket> SocketTransport::GetSocket(
+    const std::string& address, const std::string& app_id, bool is_trusted,
+    int* error) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = sockets_.find(address);
+    if (entry != sockets_.end()) {
+      return entry->second;
+    }
+  }
+
+  sockaddr_un addr;
+  socklen_t addr_length;
+  if (!ToSockaddr(address, &addr, &addr_length)) {
+    *error = MESSAGE_PORT_ERROR_INVALID_PARAMETER;
+    return nullptr;
+  }
+  // Blocking with a timeout, so that a full receiver slows senders down
+  // instead of failing their sends, but does not hold them indefinitely.
+  // The timeout also bounds connecting to a port with a full backlog,
+  // which the platform thread does not wait for either.
+  bool on_platform_thread = eina_main_loop_is();
+  int fd = socket(AF_UNIX,
+                  SOCK_SEQPACKET | SOCK_CLOEXEC |
+                      (on_platform_thread ? SOCK_NONBLOCK : 0),
+                  0);
+  if (fd < 0) {
+    *error = MESSAGE_PORT_ERROR_IO_ERROR;
+    return nullptr;
+  }
+  if (setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &kSendTimeout,
+                 sizeof(kSendTimeout)) < 0 ||
+      connect(fd, reinterpret_cast<sockaddr*>(&addr), addr_length) < 0 ||
+      (on_platform_thread && fcntl(fd, F_SETFL, 0) < 0)) {
+    if (ECONNREFUSED == errno || ENOENT == errno) {
+      *error = MESSAGE_PORT_ERROR_PORT_NOT_FOUND;
+    } else if (EAGAIN == errno || EINPROGRESS == errno) {
+      *error = MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE;
+    } else {
+      *error = MESSAGE_PORT_ERROR_IO_ERROR;
+    }
+    close(fd);
+    return nullptr;
+  }
+  // Any process can listen on an abstract address, so the port only counts
+  // as found if the application it is addressed to listens on it.
+  std::string peer_app_id = PeerAppId(fd);
+  if (peer_app_id != app_id) {
+    LOG_WARN("Socket of port %s is not held by %s", address.c_str(),
+             app_id.c_str());
+    *error = MESSAGE_PORT_ERROR_PORT_NOT_FOUND;
+    close(fd);
+    return nullptr;
+  }
+  if (is_trusted && !CertificatesMatch(app_id_, peer_app_id)) {
+    LOG_WARN("%s is not signed with the same certificate", app_id.c_str());
+    *error = MESSAGE_PORT_ERROR_CERTIFICATE_NOT_MATCH;
+    close(fd);
+    return nullptr;
+  }
+
+  auto socket = std::make_shared<OutgoingSocket>(fd);
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Another thread may have connected meanwhile.
+  auto inserted = sockets_.emplace(address, socket);
+  return inserted.first->second;
+}
+
+void SocketTransport::DropSocket(
+    const std::string& address, const std::shared_ptr<OutgoingSocket>& socket) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto entry = sockets_.find(address);
+  if (entry != sockets_.end() && entry->second == socket) {
+    sockets_.erase(entry);
+  }
+}
+
+static void CollectRecord(const char* key, const int type,
+                          const bundle_keyval_t* kv, void* user_data) {
+  auto* records = static_cast<std::vector<Record>*>(user_data);
+  void* value = nullptr;
+  size_t size = 0;
+  if ((BUNDLE_TYPE_STR != type && BUNDLE_TYPE_BYTE != type) ||
+      bundle_keyval_get_basic_val(const_cast<bundle_keyval_t*>(kv), &value,
+                                  &size) != BUNDLE_ERROR_NONE) {
+    LOG_WARN("Bundle value %s is not sent over the socket", key);
+    return;
+  }
+  RecordHeader header{type, static_cast<uint32_t>(strlen(key)),
+                      static_cast<uint32_t>(size)};
+  records->push_back(Record{header, key, value});
+}
+
+// Copies |iov| into a sealed memfd, so the receiver can map it without the
+// sender changing it meanwhile. Returns the memfd, or -1.
+static int CreateMemfd(const std::vector<iovec>& iov, size_t size) {
+  int fd = memfd_create("messageport", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0) {
+    return -1;
+  }
+  void* map = MAP_FAILED;
+  if (ftruncate(fd, size) == 0) {
+    map = mmap(nullptr, size, PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  if (MAP_FAILED == map) {
+    close(fd);
+    return -1;
+  }
+  uint8_t* out = static_cast<uint8_t*>(map);
+  for (const iovec& part : iov) {
+    memcpy(out, part.iov_base, part.iov_len);
+    out += part.iov_len;
+  }
+  munmap(map, size);
+  if (fcntl(fd, F_ADD_SEALS,
+            F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int SocketTransport::SendFrame(int fd, bundle* b,
+                               const std::string& reply_port,
+                               bool reply_port_trusted) {
+  // Each sending thread reuses its own buffers.
+  static thread_local std::vector<Record> records;
+  static thread_local std::vector<iovec> record_iov;
+  static thread_local std::vector<iovec> iov;
+  records.clear();
+  record_iov.clear();
+  iov.clear();
+  bundle_foreach(b, CollectRecord, &records);
+
+  FrameHeader header{kFrameMagic,
+                     kFrameVersion,
+                     static_cast<uint16_t>(
+                         reply_port_trusted ? kReplyPortTrusted : 0),
+                     static_cast<uint32_t>(reply_port.size()),
+                     0};
+  size_t records_size = 0;
+  for (const Record& record : records) {
+    record_iov.push_back({const_cast<RecordHeader*>(&record.header),
+                          sizeof(record.header)});
+    record_iov.push_back(
+        {const_cast<char*>(record.key), record.header.key_size});
+    record_iov.push_back(
+        {const_cast<void*>(record.value), record.header.value_size});
+    records_size += sizeof(record.header) + record.header.key_size +
+                    record.header.value_size;
+  }
+  if (records_size > UINT32_MAX) {
+    return MESSAGE_PORT_ERROR_INVALID_PARAMETER;
+  }
+  header.records_size = records_size;
+
+  iov.push_back({&header, sizeof(header)});
+  iov.push_back({const_cast<char*>(reply_port.data()), reply_port.size()});
+
+  msghdr msg = {};
+  union {
+    char buffer[CMSG_SPACE(sizeof(int))];
+    cmsghdr align;
+  } control;
+  int memfd = -1;
+  size_t frame_size = sizeof(header) + reply_port.size() + records_size;
+  if (frame_size <= kMaxFrameSize &&
+      iov.size() + record_iov.size() <= IOV_MAX) {
+    iov.insert(iov.end(), record_iov.begin(), record_iov.end());
+  } else {
+    memfd = CreateMemfd(record_iov, records_size);
+    if (memfd < 0) {
+      LOG_ERROR("Failed to create a memfd: %s", strerror(errno));
+      return MESSAGE_PORT_ERROR_OUT_OF_MEMORY;
+    }
+    header.flags |= kRecordsInMemfd;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+  }
+  msg.msg_iov = iov.data();
+  msg.msg_iovlen = iov.size();
+
+  int flags = MSG_NOSIGNAL | (eina_main_loop_is() ? MSG_DONTWAIT : 0);
+  ssize_t sent;
+  do {
+    sent = sendmsg(fd, &msg, flags);
+  } while (sent < 0 && EINTR == errno);
+  int error = errno;
+  if (memfd >= 0) {
+    close(memfd);
+  }
+  if (sent >= 0) {
+    return MESSAGE_PORT_ERROR_NONE;
+  }
+  if (EPIPE == error || ECONNRESET == error || ENOTCONN == error) {
+    LOG_DEBUG("Connection closed by the remote port");
+    return MESSAGE_PORT_ERROR_PORT_NOT_FOUND;
+  }
+  if (EAGAIN == error || EWOULDBLOCK == error) {
+    LOG_WARN("The remote port does not keep up, dropped a frame");
+    return MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE;
+  }
+  LOG_ERROR("Failed to send a frame: %s", strerror(error));
+  return EMSGSIZE == error ? MESSAGE_PORT_ERROR_MAX_EXCEEDED
+                           : MESSAGE_PORT_ERROR_IO_ERROR;
+}
+
+Eina_Bool SocketTransport::OnAccept(void* user_data,
+                                    Ecore_Fd_Handler* /*handler*/) {
+  LocalPort* port = static_cast<LocalPort*>(user_data);
+  int fd = accept4(port->listen_fd, nullptr, nullptr,
+                   SOCK_NONBLOCK | SOCK_CLOEXEC);
+  if (fd < 0) {
+    if (EAGAIN != errno && EINTR != errno) {
+      LOG_ERROR("Failed to accept a connection: %s", strerror(errno));
+    }
+    return ECORE_CALLBACK_RENEW;
+  }
+
+  // The credentials are those of the process which connected, whatever
+  // it writes to the socket later.
+  std::string remote_app_id = PeerAppId(fd);
+  if (remote_app_id.empty()) {
+    LOG_WARN("Rejected a connection to port %s from a process which is not "
+             "an application",
+             port->name.c_str());
+    close(fd);
+    return ECORE_CALLBACK_RENEW;
+  }
+  if (port->is_trusted &&
+      !CertificatesMatch(port->transport->app_id_, remote_app_id)) {
+    LOG_WARN("Rejected a connection to trusted port %s from %s",
+             port->name.c_str(), remote_app_id.c_str());
+    close(fd);
+    return ECORE_CALLBACK_RENEW;
+  }
+
+  auto connection = std::unique_ptr<Connection>(
+      new Connection{port, fd, nullptr, std::move(remote_app_id)});
+  connection->handler = ecore_main_fd_handler_add(
+      fd, ECORE_FD_READ, OnReadable, connection.get(), nullptr, nullptr);
+  if (nullptr == connection->handler) {
+    close(fd);
+    return ECORE_CALLBACK_RENEW;
+  }
+  port->connections.push_back(std::move(connection));
+  return ECORE_CALLBACK_RENEW;
+}
+
+Eina_Bool SocketTransport::OnReadable(void* user_data,
+                                      Ecore_Fd_Handler* /*handler*/) {
+  Connection* connection = static_cast<Connection*>(user_data);
+  if (!connection->port->transport->Receive(*connection)) {
+    connection->port->transport->CloseConnection(connection);
+    // The handler is deleted with the connection.
+    return ECORE_CALLBACK_CANCEL;
+  }
+  return ECORE_CALLBACK_RENEW;
+}
+
+void SocketTransport::CloseConnection(Connection* connection) {
+  auto& connections = connection->port->connections;
+  for (auto it = connections.begin(); it != connections.end(); ++it) {
+    if (it->get() == connection) {
+      ecore_main_fd_handler_del(connection->handler);
+      close(connection->fd);
+      connections.erase(it);
+      return;
+    }
+  }
+}
+
+bool SocketTransport::ParseRecords(const uint8_t* data, size_t size) {
+  while (size > 0) {
+    RecordHeader header;
+    if (size < sizeof(header)) {
+      return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    data += sizeof(header);
+    size -= sizeof(header);
+    if (size < header.key_size || size - header.key_size < header.value_size) {
+      return false;
+    }
+    if (receive_key_count_ == receive_keys_.size()) {
+      receive_keys_.emplace_back();
+    }
+    std::string& key = receive_keys_[receive_key_count_];
+    key.assign(reinterpret_cast<const char*>(data), header.key_size);
+    const uint8_t* value = data + header.key_size;
+    int ret;
+    if (BUNDLE_TYPE_BYTE == header.type) {
+      ret = bundle_add_byte(receive_bundle_, key.c_str(), value,
+                            header.value_size);
+    } else if (BUNDLE_TYPE_STR == header.type) {
+      // Strings are sent with their terminating NUL, which is not trusted.
+      receive_text_.assign(reinterpret_cast<const char*>(value),
+                           strnlen(reinterpret_cast<const char*>(value),
+                                   header.value_size));
+      ret = bundle_add_str(receive_bundle_, key.c_str(),
+                           receive_text_.c_str());
+    } else {
+      return false;
+    }
+    if (BUNDLE_ERROR_NONE != ret) {
+      return false;
+    }
+    receive_key_count_++;
+    data += header.key_size + header.value_size;
+    size -= header.key_size + header.value_size;
+  }
+  return true;
+}
+
+void SocketTransport::ClearReceiveBundle() {
+  for (size_t i = 0; i < receive_key_count_; i++) {
+    bundle_del(receive_bundle_, receive_keys_[i].c_str());
+  }
+  receive_key_count_ = 0;
+}
+
+bool SocketTransport::Receive(Connection& connection) {
+  if (receive_buffer_.size() < kMaxFrameSize) {
+    receive_buffer_.resize(kMaxFrameSize);
+  }
+  if (nullptr == receive_bundle_) {
+    receive_bundle_ = bundle_create();
+    if (nullptr == receive_bundle_) {
+      LOG_ERROR("Failed to create a bundle");
+      return false;
+    }
+  }
+  for (int frames = 0; frames < kMaxFramesPerRead; frames++) {
+    iovec iov{receive_buffer_.data(), receive_buffer_.size()};
+    union {
+      char buffer[CMSG_SPACE(sizeof(int))];
+      cmsghdr align;
+    } control;
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+    ssize_t size =
+        recvmsg(connection.fd, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    if (size < 0) {
+      if (EINTR == errno) {
+        frames--;
+        continue;
+      }
+      return EAGAIN == errno || EWOULDBLOCK == errno;
+    }
+    if (size == 0) {
+      // The sender closed the connection.
+      return false;
+    }
+
+    int memfd = -1;
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg && SOL_SOCKET == cmsg->cmsg_level &&
+        SCM_RIGHTS == cmsg->cmsg_type &&
+        cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+      memcpy(&memfd, CMSG_DATA(cmsg), sizeof(int));
+    }
+
+    const uint8_t* data = receive_buffer_.data();
+    FrameHeader header;
+    size_t names_size = 0;
+    bool valid = !(msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) &&
+                 static_cast<size_t>(size) >= sizeof(header);
+    if (valid) {
+      memcpy(&header, data, sizeof(header));
+      names_size = header.reply_port_size;
+      valid = kFrameMagic == header.magic && kFrameVersion == header.version &&
+              size - sizeof(header) >= names_size &&
+              ((header.flags & kRecordsInMemfd) != 0) == (memfd >= 0);
+    }
+    if (!valid) {
+      LOG_ERROR("Dropped a malformed frame on port %s",
+                connection.port->name.c_str());
+      if (memfd >= 0) {
+        close(memfd);
+      }
+      continue;
+    }
+
+    const char* names = reinterpret_cast<const char*>(data + sizeof(header));
+    receive_reply_port_.assign(names, header.reply_port_size);
+    const uint8_t* records = data + sizeof(header) + names_size;
+    size_t records_size = size - sizeof(header) - names_size;
+    void* map = MAP_FAILED;
+    if (memfd >= 0) {
+      // Without the seals the sender could shrink the memfd while it is
+      // mapped here.
+      struct stat stat_buffer;
+      int seals = fcntl(memfd, F_GET_SEALS);
+      if (seals >= 0 && (seals & F_SEAL_SHRINK) && (seals & F_SEAL_WRITE) &&
+          fstat(memfd, &stat_buffer) == 0 &&
+          static_cast<uint64_t>(stat_buffer.st_size) >= header.records_size &&
+          header.records_size > 0) {
+        map = mmap(nullptr, header.records_size, PROT_READ, MAP_PRIVATE,
+                   memfd, 0);
+      }
+      close(memfd);
+      records = static_cast<const uint8_t*>(map);
+      records_size = MAP_FAILED == map ? 0 : header.records_size;
+    } else if (records_size != header.records_size) {
+      records_size = 0;
+    }
+
+    if (records_size > 0 && ParseRecords(records, records_size)) {
+      LocalPort& port = *connection.port;
+      port.callback(port.id, connection.app_id.c_str(),
+                    receive_reply_port_.empty() ? nullptr
+                                                : receive_reply_port_.c_str(),
+                    (header.flags & kReplyPortTrusted) != 0, receive_bundle_,
+                    port.user_data);
+    } else {
+      LOG_ERROR("Dropped a frame with malformed records on port %s",
+                connection.port->name.c_str());
+    }
+    ClearReceiveBundle();
+    if (MAP_FAILED != map) {
+      munmap(map, header.records_size);
+    }
+  }
+  return true;
+}
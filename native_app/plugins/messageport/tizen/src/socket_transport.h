@@ -0,0 +1,122 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SOCKET_TRANSPORT_H
+#define SOCKET_TRANSPORT_H
+
+#include <Ecore.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "transport.h"
+
+// Carries bundles over SOCK_SEQPACKET Unix domain sockets, bypassing the
+// message port daemon. Each local port listens on its own socket in the
+// abstract namespace, named after the application and the port. Bundle
+// values are written to the socket straight from the bundle, and frames
+// too large for one datagram are passed in a sealed memfd.
+//
+// Only string and byte bundle values are carried. Applications at both
+// ends of a connection are looked up from its socket credentials: messages
+// are reported as coming from the application which connected, and sends
+// only go to a socket the addressed application listens on. Trusted ports
+// and sends to them require both applications to be signed with the same
+// certificate. Sends to a receiver which does not keep up fail with
+// MESSAGE_PORT_ERROR_RESOURCE_UNAVAILABLE, at once on the platform thread
+// and after a timeout on other threads.
+class SocketTransport : public Transport {
+ public:
+  SocketTransport();
+  ~SocketTransport() override;
+
+  TransportType type() const override { return TransportType::kSocket; }
+  int RegisterLocalPort(const std::string& port_name, bool is_trusted,
+                        ReceiveCallback callback, void* user_data) override;
+  int UnregisterLocalPort(int local_port_id, bool is_trusted) override;
+  int CheckRemotePort(const std::string& app_id, const std::string& port_name,
+                      bool is_trusted, bool* exists) override;
+  int Send(const std::string& app_id, const std::string& port_name,
+           bool is_trusted, bundle* b, int local_port_id) override;
+
+ private:
+  struct LocalPort;
+
+  // A connection accepted on a local port.
+  struct Connection {
+    LocalPort* port;
+    int fd;
+    Ecore_Fd_Handler* handler;
+    // Of the process which connected.
+    std::string app_id;
+  };
+
+  struct LocalPort {
+    SocketTransport* transport;
+    int id;
+    std::string name;
+    bool is_trusted;
+    int listen_fd;
+    Ecore_Fd_Handler* handler;
+    ReceiveCallback callback;
+    void* user_data;
+    std::vector<std::unique_ptr<Connection>> connections;
+  };
+
+  // A connection to a remote port, closed once no send uses it.
+  class OutgoingSocket {
+   public:
+    explicit OutgoingSocket(int fd) : fd_(fd) {}
+    ~OutgoingSocket();
+
+    int fd() const { return fd_; }
+
+   private:
+    int fd_;
+  };
+
+  static Eina_Bool OnAccept(void* user_data, Ecore_Fd_Handler* handler);
+  static Eina_Bool OnReadable(void* user_data, Ecore_Fd_Handler* handler);
+
+  // Reads every pending frame. Returns false if the connection has to be
+  // closed.
+  bool Receive(Connection& connection);
+  // Adds records of |data| to |receive_bundle_|. Returns false if they are
+  // malformed.
+  bool ParseRecords(const uint8_t* data, size_t size);
+  // Removes the keys ParseRecords added.
+  void ClearReceiveBundle();
+  void CloseConnection(Connection* connection);
+  // Returns a connection to the port at |address| of |app_id|, opening it
+  // if needed, or null and |error| set.
+  std::shared_ptr<OutgoingSocket> GetSocket(const std::string& address,
+                                            const std::string& app_id,
+                                            bool is_trusted, int* error);
+  void DropSocket(const std::string& address,
+                  const std::shared_ptr<OutgoingSocket>& socket);
+  int SendFrame(int fd, bundle* b, const std::string& reply_port,
+                bool reply_port_trusted);
+
+  std::string app_id_;
+  // Guards the members below, as sends come from sender threads.
+  std::mutex mutex_;
+  int next_port_id_ = 1;
+  std::map<int, std::unique_ptr<LocalPort>> local_ports_;
+  // Keyed by socket address.
+  std::map<std::string, std::shared_ptr<OutgoingSocket>> sockets_;
+  // Only used on the platform thread, and reused for every frame received,
+  // along with their capacity.
+  std::vector<uint8_t> receive_buffer_;
+  bundle* receive_bundle_ = nullptr;
+  // Keys added to |receive_bundle_|, the first |receive_key_count_| of them.
+  std::vector<std::string> receive_keys_;
+  size_t receive_key_count_ = 0;
+  std::string receive_text_;
+  std::string receive_reply_port_;
+};
+
+#endif  // SOCKET_TRANSPORT_H
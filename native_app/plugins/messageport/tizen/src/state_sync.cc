@@ -0,0 +1,196 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "state_sync.h"
+
+#include <flutter/standard_codec_serializer.h>
+#include <flutter/standard_message_codec.h>
+
+#include "log.h"
+#include "message_pools.h"
+
+// Operations of diff entries.
+static constexpr int32_t kRemoved = 0;
+static constexpr int32_t kSet = 1;
+static constexpr int32_t kNested = 2;
+
+// EncodableValue only guarantees operator<, which compares deeply.
+static bool SameValue(const flutter::EncodableValue& a,
+                      const flutter::EncodableValue& b) {
+  return !(a < b) && !(b < a);
+}
+
+static flutter::EncodableValue Change(int32_t op,
+                                      flutter::EncodableValue value) {
+  return flutter::EncodableValue(
+      flutter::EncodableList{flutter::EncodableValue(op), std::move(value)});
+}
+
+void DiffStates(const flutter::EncodableMap& from,
+                const flutter::EncodableMap& to, flutter::EncodableMap* diff) {
+  // Both maps are sorted, so they are walked side by side.
+  auto less = from.key_comp();
+  auto old_entry = from.begin();
+  auto new_entry = to.begin();
+  while (old_entry != from.end() || new_entry != to.end()) {
+    if (new_entry == to.end() ||
+        (old_entry != from.end() && less(old_entry->first, new_entry->first))) {
+      (*diff)[old_entry->first] = flutter::EncodableValue(
+          flutter::EncodableList{flutter::EncodableValue(kRemoved)});
+      ++old_entry;
+      continue;
+    }
+    if (old_entry == from.end() || less(new_entry->first, old_entry->first)) {
+      (*diff)[new_entry->first] = Change(kSet, new_entry->second);
+      ++new_entry;
+      continue;
+    }
+
+    const auto* old_map =
+        std::get_if<flutter::EncodableMap>(&old_entry->second);
+    const auto* new_map =
+        std::get_if<flutter::EncodableMap>(&new_entry->second);
+    if (old_map && new_map) {
+      flutter::EncodableMap nested;
+      DiffStates(*old_map, *new_map, &nested);
+      if (!nested.empty()) {
+        (*diff)[new_entry->first] =
+            Change(kNested, flutter::EncodableValue(std::move(nested)));
+      }
+    } else if (!SameValue(old_entry->second, new_entry->second)) {
+      (*diff)[new_entry->first] = Change(kSet, new_entry->second);
+    }
+    ++old_entry;
+    ++new_entry;
+  }
+}
+
+bool ApplyStateDiff(flutter::EncodableMap& state,
+                    flutter::EncodableMap& diff) {
+  for (auto& entry : diff) {
+    auto* change = std::get_if<flutter::EncodableList>(&entry.second);
+    if (nullptr == change || change->empty() ||
+        !std::holds_alternative<int32_t>((*change)[0])) {
+      return false;
+    }
+
+    int32_t op = std::get<int32_t>((*change)[0]);
+    if (kRemoved == op) {
+      state.erase(entry.first);
+      continue;
+    }
+    if (change->size() != 2) {
+      return false;
+    }
+    flutter::EncodableValue& value = (*change)[1];
+    if (kSet == op) {
+      state[entry.first] = std::move(value);
+      continue;
+    }
+
+    auto* nested_diff = std::get_if<flutter::EncodableMap>(&value);
+    auto current = state.find(entry.first);
+    if (kNested != op || nullptr == nested_diff || current == state.end()) {
+      return false;
+    }
+    auto* nested_state = std::get_if<flutter::EncodableMap>(&current->second);
+    if (nullptr == nested_state ||
+        !ApplyStateDiff(*nested_state, *nested_diff)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t StateSyncSender::Encode(const flutter::EncodableMap& state,
+                                 std::vector<uint8_t>& out,
+                                 uint32_t* base_seq) {
+  encoded_seq_ = next_seq_;
+  encoded_full_ = !has_snapshot() || resync_;
+  out.clear();
+  VectorStreamWriter writer(&out);
+  const auto& serializer = flutter::StandardCodecSerializer::GetInstance();
+  if (encoded_full_) {
+    *base_seq = 0;
+    serializer.WriteValue(flutter::EncodableValue(state), &writer);
+  } else {
+    *base_seq = snapshot_seq_;
+    diff_.clear();
+    DiffStates(snapshot_, state, &diff_);
+    serializer.WriteValue(flutter::EncodableValue(diff_), &writer);
+  }
+  encoded_size_ = out.size();
+  return encoded_seq_;
+}
+
+void StateSyncSender::Commit(flutter::EncodableMap&& state) {
+  if (encoded_full_) {
+    snapshot_ = std::move(state);
+    resync_ = false;
+    stats_.full_updates++;
+  } else if (!ApplyStateDiff(snapshot_, diff_)) {
+    // Not expected, diffs are made here. The next update fixes it.
+    LOG_ERROR("Failed to apply a state diff to the snapshot");
+    resync_ = true;
+  }
+  diff_.clear();
+  snapshot_seq_ = encoded_seq_;
+  next_seq_++;
+  if (0 == next_seq_) {
+    next_seq_ = 1;
+  }
+  stats_.updates++;
+  stats_.bytes += encoded_size_;
+}
+
+void StateSyncSender::RequestResync() {
+  resync_ = true;
+  stats_.resyncs++;
+}
+
+flutter::EncodableMap StateSyncSender::TakeSnapshot() {
+  RequestResync();
+  flutter::EncodableMap snapshot;
+  snapshot.swap(snapshot_);
+  return snapshot;
+}
+
+StateSyncReceiver::Result StateSyncReceiver::Apply(uint32_t seq,
+                                                   uint32_t base_seq,
+                                                   const uint8_t* data,
+                                                   size_t size) {
+  if (0 != base_seq && (0 == seq_ || base_seq != seq_)) {
+    return Result::kGap;
+  }
+
+  std::unique_ptr<flutter::EncodableValue> update =
+      flutter::StandardMessageCodec::GetInstance().DecodeMessage(data, size);
+  auto* map =
+      update ? std::get_if<flutter::EncodableMap>(update.get()) : nullptr;
+  if (nullptr == map) {
+    return Result::kMalformed;
+  }
+
+  auto& state = std::get<flutter::EncodableMap>(state_);
+  if (0 == base_seq) {
+    state = std::move(*map);
+    resync_requested_us_ = 0;
+  } else if (!ApplyStateDiff(state, *map)) {
+    // The state can not be trusted anymore.
+    state.clear();
+    seq_ = 0;
+    return Result::kMalformed;
+  }
+  seq_ = seq;
+  return Result::kApplied;
+}
+
+bool StateSyncReceiver::ShouldRequestResync(int64_t now_us) {
+  if (resync_requested_us_ != 0 &&
+      now_us - resync_requested_us_ < kResyncIntervalUs) {
+    return false;
+  }
+  resync_requested_us_ = now_us;
+  return true;
+}
@@ -0,0 +1,106 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef STATE_SYNC_H
+#define STATE_SYNC_H
+
+#include <flutter/encodable_value.h>
+
+#include <cstdint>
+#include <vector>
+
+// Computes the changes turning |from| into |to|. Each changed key of the
+// diff maps to a list: [0] if the key was removed, [1, value] if it was
+// added or its value replaced, and [2, diff] if both values are maps, with
+// the diff of the nested maps.
+void DiffStates(const flutter::EncodableMap& from,
+                const flutter::EncodableMap& to, flutter::EncodableMap* diff);
+// Applies a diff made by DiffStates to |state|, moving values out of
+// |diff|. Returns false if |diff| is malformed, leaving |state| partly
+// updated.
+bool ApplyStateDiff(flutter::EncodableMap& state, flutter::EncodableMap& diff);
+
+// Counters of updates sent by one StateSyncSender. |bytes| are sizes of
+// encoded updates.
+struct StateSyncStats {
+  size_t updates = 0;
+  size_t full_updates = 0;
+  size_t resyncs = 0;
+  size_t bytes = 0;
+};
+
+// Encodes updates of a state map sent to one remote port. Updates are
+// numbered from 1. Each one is a diff from the snapshot of the last update
+// committed, or the full state if there is no snapshot or the receiver
+// asked for a resync.
+class StateSyncSender {
+ public:
+  // Encodes the update to |state| with StandardMessageCodec into |out|,
+  // replacing its content, and returns its sequence number. |base_seq| is
+  // set to the number of the snapshot the diff applies to, or to zero for
+  // a full update.
+  uint32_t Encode(const flutter::EncodableMap& state, std::vector<uint8_t>& out,
+                  uint32_t* base_seq);
+  // Makes |state|, the one given to the last Encode, the snapshot later
+  // updates are diffs from. It is moved in if the update is full, diffs
+  // are applied to the snapshot instead. May be called before the update
+  // is sent, if RequestResync is called when sending fails.
+  void Commit(flutter::EncodableMap&& state);
+  // Sends the next update in full.
+  void RequestResync();
+  // Moves the snapshot out, so that it is encoded and committed again as
+  // the next update, in full.
+  flutter::EncodableMap TakeSnapshot();
+
+  bool has_snapshot() const { return snapshot_seq_ != 0; }
+  const StateSyncStats& stats() const { return stats_; }
+  void ResetStats() { stats_ = StateSyncStats(); }
+
+ private:
+  flutter::EncodableMap snapshot_;
+  // Zero while there is no snapshot.
+  uint32_t snapshot_seq_ = 0;
+  uint32_t next_seq_ = 1;
+  bool resync_ = false;
+  // Of the last Encode.
+  uint32_t encoded_seq_ = 0;
+  bool encoded_full_ = false;
+  size_t encoded_size_ = 0;
+  flutter::EncodableMap diff_;
+  StateSyncStats stats_;
+};
+
+// Rebuilds a state map from updates made by a StateSyncSender.
+class StateSyncReceiver {
+ public:
+  enum class Result {
+    kApplied,
+    // The update is a diff from a snapshot this receiver does not have.
+    kGap,
+    kMalformed,
+  };
+
+  // |data| is an update encoded with StandardMessageCodec. |base_seq| is
+  // zero for a full update.
+  Result Apply(uint32_t seq, uint32_t base_seq, const uint8_t* data,
+               size_t size);
+  // Returns true if a resync should be requested after a gap at |now_us|,
+  // at most once per kResyncIntervalUs until a full update comes.
+  bool ShouldRequestResync(int64_t now_us);
+
+  // An EncodableMap, empty until a full update is applied.
+  const flutter::EncodableValue& state() const { return state_; }
+  // Zero until a full update is applied.
+  uint32_t seq() const { return seq_; }
+
+  static constexpr int64_t kResyncIntervalUs = 1000000;
+
+ private:
+  flutter::EncodableValue state_ = flutter::EncodableMap();
+  uint32_t seq_ = 0;
+  // Zero if no resync is pending.
+  int64_t resync_requested_us_ = 0;
+};
+
+#endif  // STATE_SYNC_H
@@ -0,0 +1,123 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "trace.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <sstream>
+
+// Indexed by TraceEvent.
+static const char* kEventNames[] = {
+    "methodCall", "send",    "sendAsync",     "flushBatch",
+    "sendBundle", "receive", "flushDelivery", "broadcast",
+};
+static_assert(sizeof(kEventNames) / sizeof(kEventNames[0]) ==
+                  static_cast<size_t>(TraceEvent::kCount),
+              "Every trace event needs a name");
+
+// Small sequential ids, as system thread ids do not fit the packed slot.
+static uint16_t CurrentThreadId() {
+  static std::atomic<uint16_t> next_id{1};
+  thread_local uint16_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+  return id;
+}
+
+static void WriteEscaped(std::ostringstream& out, const std::string& value) {
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out << escaped;
+    } else {
+      out << c;
+    }
+  }
+}
+
+uint32_t Tracer::RegisterPort(std::string name) {
+  std::lock_guard<std::mutex> lock(ports_mutex_);
+  port_names_.push_back(std::move(name));
+  // Zero stands for no port.
+  return port_names_.size();
+}
+
+void Tracer::SetEnabled(bool enabled) {
+  enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void Tracer::Record(TraceEvent event, uint32_t port, uint32_t size,
+                    int64_t start_us) {
+  uint64_t duration_us = NowUs() - start_us;
+  if (duration_us > UINT32_MAX) {
+    duration_us = UINT32_MAX;
+  }
+
+  uint64_t index = next_.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = slots_[index & (kCapacity - 1)];
+  // Readers skip the slot until its sequence is set again.
+  slot.sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.start_us.store(start_us, std::memory_order_relaxed);
+  slot.id.store(static_cast<uint64_t>(event) |
+                    static_cast<uint64_t>(CurrentThreadId()) << 16 |
+                    static_cast<uint64_t>(port) << 32,
+                std::memory_order_relaxed);
+  slot.extent.store(size | duration_us << 32, std::memory_order_relaxed);
+  slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+std::string Tracer::DumpJson() {
+  std::vector<std::string> port_names;
+  {
+    std::lock_guard<std::mutex> lock(ports_mutex_);
+    port_names = port_names_;
+  }
+
+  std::ostringstream out;
+  out << "{\"traceEvents\":[";
+  uint64_t end = next_.load(std::memory_order_acquire);
+  uint64_t begin = end > kCapacity ? end - kCapacity : 0;
+  bool first = true;
+  pid_t pid = getpid();
+  for (uint64_t index = begin; index < end; index++) {
+    const Slot& slot = slots_[index & (kCapacity - 1)];
+    uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence != index + 1) {
+      continue;
+    }
+    int64_t start_us = slot.start_us.load(std::memory_order_relaxed);
+    uint64_t id = slot.id.load(std::memory_order_relaxed);
+    uint64_t extent = slot.extent.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+      continue;
+    }
+
+    size_t event = id & 0xffff;
+    uint32_t thread = (id >> 16) & 0xffff;
+    uint32_t port = id >> 32;
+    if (event >= static_cast<size_t>(TraceEvent::kCount)) {
+      continue;
+    }
+
+    out << (first ? "" : ",") << "{\"name\":\"" << kEventNames[event]
+        << "\",\"cat\":\"messageport\",\"ph\":\"X\",\"ts\":" << start_us
+        << ",\"dur\":" << (extent >> 32) << ",\"pid\":" << pid
+        << ",\"tid\":" << thread << ",\"args\":{\"size\":"
+        << (extent & 0xffffffff);
+    if (port > 0 && port <= port_names.size()) {
+      out << ",\"port\":\"";
+      WriteEscaped(out, port_names[port - 1]);
+      out << "\"";
+    }
+    out << "}}";
+    first = false;
+  }
+  out << "],\"displayTimeUnit\":\"ms\"}";
+  return out.str();
+}
@@ -0,0 +1,104 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class TraceEvent : uint16_t {
+  kMethodCall,
+  kSend,
+  kSendAsync,
+  kFlushBatch,
+  kSendBundle,
+  kReceive,
+  kFlushDelivery,
+  kBroadcast,
+  kCount
+};
+
+// Records fixed-size events into a ring buffer without locks or
+// formatting, so that message flows can be traced in release builds.
+// Events are formatted only when dumped, in the Chrome trace event format.
+// Recording is safe from any thread, and costs a single load while tracing
+// is disabled.
+class Tracer {
+ public:
+  // Most recent events kept. A power of two.
+  static constexpr size_t kCapacity = 8192;
+
+  static int64_t NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  // Returns an id for events of the port named |name|.
+  uint32_t RegisterPort(std::string name);
+
+  void SetEnabled(bool enabled);
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  // Records an event which started at |start_us| and ended now.
+  void Record(TraceEvent event, uint32_t port, uint32_t size,
+              int64_t start_us);
+
+  // Returns recorded events as Chrome trace JSON, which can be opened in
+  // chrome://tracing or Perfetto.
+  std::string DumpJson();
+
+ private:
+  // Fields are atomics, so a slot overwritten while it is being dumped is
+  // detected with |sequence| instead of being read torn.
+  struct Slot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<int64_t> start_us{0};
+    // Event, thread and port packed into one word.
+    std::atomic<uint64_t> id{0};
+    // Size and duration in microseconds packed into one word.
+    std::atomic<uint64_t> extent{0};
+  };
+
+  std::atomic<bool> enabled_{false};
+  std::atomic<uint64_t> next_{0};
+  std::array<Slot, kCapacity> slots_;
+  std::mutex ports_mutex_;
+  std::vector<std::string> port_names_;
+};
+
+// Records an event spanning the lifetime of the scope, if tracing is
+// enabled when the scope is entered.
+class TraceScope {
+ public:
+  TraceScope(Tracer& tracer, TraceEvent event, uint32_t port, uint32_t size)
+      : tracer_(tracer.enabled() ? &tracer : nullptr),
+        event_(event),
+        port_(port),
+        size_(size),
+        start_us_(tracer_ ? Tracer::NowUs() : 0) {}
+
+  ~TraceScope() {
+    if (tracer_) {
+      tracer_->Record(event_, port_, size_, start_us_);
+    }
+  }
+
+  void set_size(uint32_t size) { size_ = size; }
+
+ private:
+  Tracer* tracer_;
+  TraceEvent event_;
+  uint32_t port_;
+  uint32_t size_;
+  int64_t start_us_;
+};
+
+#endif  // TRACE_H
@@ -0,0 +1,54 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "transport.h"
+
+int MessagePortTransport::RegisterLocalPort(const std::string& port_name,
+                                            bool is_trusted,
+                                            ReceiveCallback callback,
+                                            void* user_data) {
+  if (is_trusted) {
+    return message_port_register_trusted_local_port(port_name.c_str(),
+                                                    callback, user_data);
+  }
+  return message_port_register_local_port(port_name.c_str(), callback,
+                                          user_data);
+}
+
+int MessagePortTransport::UnregisterLocalPort(int local_port_id,
+                                              bool is_trusted) {
+  if (is_trusted) {
+    return message_port_unregister_trusted_local_port(local_port_id);
+  }
+  return message_port_unregister_local_port(local_port_id);
+}
+
+int MessagePortTransport::CheckRemotePort(const std::string& app_id,
+                                          const std::string& port_name,
+                                          bool is_trusted, bool* exists) {
+  if (is_trusted) {
+    return message_port_check_trusted_remote_port(app_id.c_str(),
+                                                  port_name.c_str(), exists);
+  }
+  return message_port_check_remote_port(app_id.c_str(), port_name.c_str(),
+                                        exists);
+}
+
+int MessagePortTransport::Send(const std::string& app_id,
+                               const std::string& port_name, bool is_trusted,
+                               bundle* b, int local_port_id) {
+  if (local_port_id < 0) {
+    if (is_trusted) {
+      return message_port_send_trusted_message(app_id.c_str(),
+                                               port_name.c_str(), b);
+    }
+    return message_port_send_message(app_id.c_str(), port_name.c_str(), b);
+  }
+  if (is_trusted) {
+    return message_port_send_trusted_message_with_local_port(
+        app_id.c_str(), port_name.c_str(), b, local_port_id);
+  }
+  return message_port_send_message_with_local_port(
+      app_id.c_str(), port_name.c_str(), b, local_port_id);
+}
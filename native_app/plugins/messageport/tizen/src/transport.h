@@ -0,0 +1,53 @@
+// Copyright 2021 Samsung Electronics Co., Ltd. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <bundle.h>
+#include <message_port.h>
+
+#include <string>
+
+enum class TransportType { kMessagePort, kSocket };
+
+// Called on the platform thread for every message received on a local
+// port, with the same arguments as message port callbacks.
+typedef message_port_trusted_message_cb ReceiveCallback;
+
+// Carries bundles between local and remote ports. Errors are returned as
+// message port error codes.
+class Transport {
+ public:
+  virtual ~Transport() = default;
+
+  virtual TransportType type() const = 0;
+  // Returns a native id of the port, or a negative error code.
+  virtual int RegisterLocalPort(const std::string& port_name, bool is_trusted,
+                                ReceiveCallback callback, void* user_data) = 0;
+  virtual int UnregisterLocalPort(int local_port_id, bool is_trusted) = 0;
+  // Ports of other applications are not watched, |exists| is set once.
+  virtual int CheckRemotePort(const std::string& app_id,
+                              const std::string& port_name, bool is_trusted,
+                              bool* exists) = 0;
+  // Safe to call from any thread. |local_port_id| is -1, or a native id of
+  // a local port of this transport the remote application can reply to.
+  virtual int Send(const std::string& app_id, const std::string& port_name,
+                   bool is_trusted, bundle* b, int local_port_id) = 0;
+};
+
+// The message port API of the platform, which goes through its IPC daemon.
+class MessagePortTransport : public Transport {
+ public:
+  TransportType type() const override { return TransportType::kMessagePort; }
+  int RegisterLocalPort(const std::string& port_name, bool is_trusted,
+                        ReceiveCallback callback, void* user_data) override;
+  int UnregisterLocalPort(int local_port_id, bool is_trusted) override;
+  int CheckRemotePort(const std::string& app_id, const std::string& port_name,
+                      bool is_trusted, bool* exists) override;
+  int Send(const std::string& app_id, const std::string& port_name,
+           bool is_trusted, bundle* b, int local_port_id) override;
+};
+
+#endif  // TRANSPORT_H